@@ -23,8 +23,10 @@
 #include "Window.hpp"
 
 #include <chrono>
+#include <random>
 #include <thread>
 #include <utility>
+#include <vector>
 #include <cstdio>
 #include <cstdlib>
 
@@ -33,6 +35,10 @@ namespace CSItalyDemo
     ////////////////////////////////////////
     static Poe::FirstPersonCamera mainCamera;
 
+    ////////////////////////////////////////
+    // F5 starts and stops recording the camera into camera_path.txt, see tools/Benchmark.cpp
+    static Poe::CameraPathRecorder cameraPathRecorder("camera_path.txt");
+
     ////////////////////////////////////////
     static void keyCallback(GLFWwindow* window, int key, int scanCode, int action, int mods)
     {
@@ -41,6 +47,9 @@ namespace CSItalyDemo
                 case GLFW_KEY_ESCAPE:
                     glfwSetWindowShouldClose(window, GLFW_TRUE);
                     break;
+                case GLFW_KEY_F5:
+                    cameraPathRecorder.Toggle();
+                    break;
             }
         }
         mainCamera.UpdateInputConfig(key, action);
@@ -111,14 +120,28 @@ namespace CSItalyDemo
         glm::mat4 cubeModel = glm::translate(glm::mat4(1.0f), mainCamera.mPosition + glm::vec3(0.0f, 0.0f, -30.0f)) *
                               glm::scale(glm::mat4(1.0f), glm::vec3(4.0f));
 
+        // textured glass, drawn in no particular order, see TransparencyStack
+        auto glassPanes = Poe::CreateCube(8);
+        const glm::vec3 glassPosition{ mainCamera.mPosition + glm::vec3(0.0f, 0.0f, -60.0f) };
+        glassPanes.ApplyToAllInstances(4, 1, 2, 12.0f, 0.0f, 12.0f,
+        [=](int i, int j, int k, int numInstances) {
+            auto t = glm::translate(glm::mat4(1.0f), glassPosition);
+            t = glm::scale(t, glm::vec3(10.0f, 10.0f, 0.5f));
+            return t;
+        });
+        const Poe::Texture2D glassTexture{ Poe::CreateCheckerboardTexture2D(glm::vec3(0.6f, 0.8f, 1.0f), glm::vec3(0.2f, 0.4f, 0.6f)) };
+
         int numDirLights{ 2 }, numPointLights{ 4 }, numSpotLights{ 2 };
         int shadowSize{ 1024 };
         float directionalShadowMinBias{ 0.01f }, directionalShadowMaxBias{ 0.1f };
         float omniShadowBias{ 0.005f };
         constexpr int numCascades{ 4 };
 
-        Poe::ShaderLoader shaderLoader;
-        Poe::LightingStack<numCascades> lightingStack(numDirLights, numPointLights, numSpotLights, shadowSize, "..", shaderLoader);
+        Poe::ShaderLoader shaderLoader("../shaders/cache");
+        Poe::LightingStack<numCascades> lightingStack(numDirLights, numPointLights, numSpotLights, shadowSize, "..", shaderLoader, true);
+
+        Poe::Texture2DLoader texture2DLoader;
+        Poe::StaticModel staticModel = LoadCsItaly("..", texture2DLoader, true);
 
         Poe::EmissiveColorProgram emissiveColorProgram("..", shaderLoader);
         Poe::RealisticSkyboxProgram skybox("..", shaderLoader);
@@ -130,10 +153,34 @@ namespace CSItalyDemo
                                                  numCascades,
                                                  directionalShadowMinBias,
                                                  directionalShadowMaxBias,
-                                                 omniShadowBias);
-
-        Poe::Texture2DLoader texture2DLoader;
-        Poe::StaticModel staticModel = LoadCsItaly("..", texture2DLoader);
+                                                 omniShadowBias,
+                                                 staticModel.GetMaterialTableMode());
+        Poe::BlinnPhongProgram clusteredBlinnPhongProgram("..",
+                                                          shaderLoader,
+                                                          numDirLights,
+                                                          numPointLights,
+                                                          numSpotLights,
+                                                          numCascades,
+                                                          directionalShadowMinBias,
+                                                          directionalShadowMaxBias,
+                                                          omniShadowBias,
+                                                          staticModel.GetMaterialTableMode(),
+                                                          true);
+        Poe::BlinnPhongProgramInstanced glassProgram("..",
+                                                     shaderLoader,
+                                                     numDirLights,
+                                                     numPointLights,
+                                                     numSpotLights,
+                                                     numCascades,
+                                                     directionalShadowMinBias,
+                                                     directionalShadowMaxBias,
+                                                     omniShadowBias,
+                                                     Poe::MaterialTableMode::None,
+                                                     false,
+                                                     true);
+        Poe::GBufferProgram gBufferProgram("..", shaderLoader, staticModel.GetMaterialTableMode());
+        Poe::DepthPrepass depthPrepass("..", shaderLoader);
+        staticModel.EnablePositionStreams();
         std::vector<std::reference_wrapper<const Poe::StaticMesh>> staticModelMeshList = staticModel.ExtractMeshes();
 
         glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 2.0f, 0.0f));
@@ -142,11 +189,25 @@ namespace CSItalyDemo
 
         Poe::PostProcessStack ppStack("..", fbWidth, fbHeight, shaderLoader);
         mainCamera.SetAspectRatio(ppStack.GetWidth(), ppStack.GetHeight());
-
-        Poe::FogUB fogBlock(glm::vec3(1.0f), 1000.0f, 2.0f);
+        Poe::DynamicResolution dynamicResolution;
+        Poe::AmbientOcclusionStack ambientOcclusionStack("..", ppStack.GetWidth(), ppStack.GetHeight(), shaderLoader);
+        Poe::TransparencyStack transparencyStack("..", ppStack.GetWidth(), ppStack.GetHeight(), shaderLoader);
+
+        Poe::GBufferStack gBufferStack("..",
+                                       ppStack.GetWidth(), ppStack.GetHeight(),
+                                       numDirLights,
+                                       numPointLights,
+                                       numSpotLights,
+                                       numCascades,
+                                       directionalShadowMinBias,
+                                       directionalShadowMaxBias,
+                                       omniShadowBias,
+                                       shaderLoader);
+
+        Poe::FogUB fogBlock(glm::vec3(1.0f), 1000.0f, 2.0f, true);
         fogBlock.Buffer().TurnOn();
 
-        Poe::TransformUB transformBlock;
+        Poe::TransformUB transformBlock(true);
         transformBlock.Buffer().TurnOn();
 
         Poe::EmissiveColorMaterial gridMaterial{ glm::vec4(1.0f, 1.0f, 1.0f, 1.0f) };
@@ -197,23 +258,71 @@ namespace CSItalyDemo
             false                           // cast shadows
         };
 
+        // shadowless lights scattered over the map, shaded by the forward pass through the clusters
+        constexpr int numClusteredPointLights{ 256 };
+        constexpr int numClusteredSpotLights{ 64 };
+        Poe::ClusteredLightingStack clusteredLightingStack("..", shaderLoader, numClusteredPointLights, numClusteredSpotLights);
+        clusteredLightingStack.SetNumPointLights(numClusteredPointLights);
+        clusteredLightingStack.SetNumSpotLights(numClusteredSpotLights);
+
+        std::vector<Poe::PointLight> clusteredPointLights;
+        std::vector<Poe::SpotLight> clusteredSpotLights;
+        {
+            const Poe::Utility::AABB bounds{ staticModel.GetBounds() };
+            const glm::vec3 corner0{ model * glm::vec4(bounds.mMin, 1.0f) };
+            const glm::vec3 corner1{ model * glm::vec4(bounds.mMax, 1.0f) };
+            const glm::vec3 worldMin{ glm::min(corner0, corner1) };
+            const glm::vec3 worldMax{ glm::max(corner0, corner1) };
+
+            std::mt19937 generator{ 42 };
+            std::uniform_real_distribution<float> x{ worldMin.x, worldMax.x };
+            std::uniform_real_distribution<float> y{ worldMin.y, glm::mix(worldMin.y, worldMax.y, 0.3f) };
+            std::uniform_real_distribution<float> z{ worldMin.z, worldMax.z };
+            std::uniform_real_distribution<float> channel{ 0.2f, 1.0f };
+            auto randomColor = [&]{ return glm::vec3(channel(generator), channel(generator), channel(generator)); };
+
+            for (int i = 0; i < numClusteredPointLights; ++i) {
+                const glm::vec3 position{ x(generator), y(generator), z(generator) };
+                clusteredPointLights.push_back({ randomColor(), position, glm::vec3(0.0f), 15.0f, 5.0f, false, 0.3f, 200.0f });
+            }
+            for (int i = 0; i < numClusteredSpotLights; ++i) {
+                const glm::vec3 position{ x(generator), y(generator), z(generator) };
+                clusteredSpotLights.push_back({ randomColor(), glm::vec3(0.0f, -1.0f, 0.0f), position,
+                                                glm::cos(glm::radians(25.0f)), glm::cos(glm::radians(35.0f)),
+                                                40.0f, 10.0f, glm::mat4(1.0f), false });
+            }
+        }
+
         Poe::RealisticSkyboxUB skyboxBlock;
         skyboxBlock.Buffer().TurnOn();
 
+        Poe::RenderQueue renderQueue;
+
         float ambientFactor{0.1f};
 
+        // built once, braced lists would allocate every frame
+        const std::vector<std::reference_wrapper<Poe::DirLight>> dirLights{ sun };
+        const std::vector<std::reference_wrapper<const Poe::PointLight>> pointLights{ playerLight };
+        const std::vector<std::reference_wrapper<const Poe::SpotLight>> spotLights{ flashlight };
+        const std::vector<std::reference_wrapper<const glm::mat4>> modelMatrices{ model };
+
         float totalDt{};
         while (!glfwWindowShouldClose(window)) {
+            texture2DLoader.Update();
 
             float dt = Poe::Utility::ComputeDeltaTime();
             totalDt += dt;
 
             mainCamera.Update(dt);
+            cameraPathRecorder.Update(dt, mainCamera);
 
             transformBlock.Set(mainCamera);
             transformBlock.Update();
             fogBlock.Update();
 
+            // rebakes the sky only if the atmosphere panel changed it last frame
+            skybox.Update(skyboxBlock);
+
             sun.mDirection = glm::normalize(-skyboxBlock.GetSunPosition());
             sun.mIntensity = glm::max(0.0f, skyboxBlock.GetSunIntensity() * glm::dot(glm::vec3(0.0f, 1.0f, 0.0f), glm::normalize(skyboxBlock.GetSunPosition())));
 
@@ -226,13 +335,49 @@ namespace CSItalyDemo
             blinnPhongBlock.Set(blinnPhongMaterial);
             blinnPhongBlock.Update();
 
+            // recorded by the workers while the shadow passes are submitted
+            const glm::mat4 rotatedCubeModel{ cubeModel * glm::rotate(glm::mat4(1.0f), totalDt, glm::vec3(1.0f)) };
+            const glm::mat4 gridModel{ glm::scale(glm::mat4(1.0f), glm::vec3(10.0f)) };
+            Poe::Utility::JobCounter recordCounter;
+            // scheduled through a reference, jobs are stored in place and have to stay small
+            auto recordFrame = [&]{
+                auto setModelMatrix = [&emissiveColorProgram](const Poe::RenderItem& item) {
+                    emissiveColorProgram.SetModelMatrix(item.mModel);
+                };
+
+                renderQueue.Begin(mainCamera, Poe::DebugUI::mEnableFrustumCulling);
+                renderQueue.Push({ &emissiveColorProgram.GetProgram(),
+                                   &cube,
+                                   nullptr,             // textures
+                                   rotatedCubeModel,
+                                   0,                   // material id
+                                   [&]{ emissiveColorProgram.SetMaterial(cubeMaterial); },
+                                   setModelMatrix });
+                if (Poe::DebugUI::mEnableGrid) {
+                    renderQueue.Push({ &emissiveColorProgram.GetProgram(),
+                                       &grid,
+                                       nullptr,         // textures
+                                       gridModel,
+                                       1,               // material id
+                                       [&]{ emissiveColorProgram.SetMaterial(gridMaterial); },
+                                       setModelMatrix,
+                                       GL_LINES });
+                }
+            };
+            if (Poe::DebugUI::mEnableRenderQueue) {
+                Poe::Utility::JobSystem::Get().Schedule(recordCounter, [&recordFrame]{ recordFrame(); });
+            }
+
+            lightingStack.SetLayeredShadows(Poe::DebugUI::mEnableLayeredShadows);
+            lightingStack.SetShadowCaching(Poe::DebugUI::mEnableShadowCaching);
+            Poe::Profiler::BeginScope("Shadows");
             lightingStack.PrepareState();
-            lightingStack.DirectionalShadowPrepass(mainCamera, { sun }, { model }, staticModelMeshList);
-            lightingStack.OmnidirectionalShadowPrepass({ playerLight }, { model }, staticModelMeshList);
-            lightingStack.PerspectiveShadowPrepass({ flashlight }, { model }, staticModelMeshList);
+            // the level never moves, so there are no dynamic casters to redraw past the cache
+            lightingStack.DirectionalShadowPrepass(mainCamera, dirLights, modelMatrices, staticModelMeshList, {}, {});
+            lightingStack.OmnidirectionalShadowPrepass(pointLights, modelMatrices, staticModelMeshList, {}, {});
+            lightingStack.PerspectiveShadowPrepass(spotLights, modelMatrices, staticModelMeshList);
             lightingStack.ResetState();
-
-            ppStack.FirstPass();
+            Poe::Profiler::EndScope();
 
             if (Poe::DebugUI::mEnableWireframe) {
                 glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
@@ -249,46 +394,157 @@ namespace CSItalyDemo
                 glfwSwapInterval(0);
 
             glm::mat3 normal = glm::mat3(glm::transpose(glm::inverse(mainCamera.GetViewMatrix() * model)));
+            staticModel.SetLodView(Poe::ComputeLodView(mainCamera, ppStack.GetRenderHeight(), 1.0f, model));
+
+            Poe::Profiler::BeginScope("Main Pass");
+            if (Poe::DebugUI::mEnableDeferredShading) {
+                Poe::Profiler::BeginScope("Geometry");
+                gBufferStack.GeometryPass();
+
+                gBufferProgram.Use();
+                gBufferProgram.SetModelMatrix(model);
+                gBufferProgram.SetNormalMatrix(normal);
+                gBufferProgram.SetAmbientFactor(ambientFactor);
+                gBufferProgram.SetTexMultiplier(glm::vec2(1.0f));
+                gBufferProgram.SetTexOffset(glm::vec2(0.0f));
+                if (Poe::DebugUI::mEnableFrustumCulling)
+                    staticModel.DrawCulled(mainCamera.GetFrustum(model));
+                else
+                    staticModel.Draw();
+
+                Poe::Profiler::EndScope();
+
+                Poe::Profiler::BeginScope("Lighting");
+                gBufferStack.LightingPass(mainCamera, pointLights, spotLights);
+                Poe::Profiler::EndScope();
+
+                ppStack.FirstPass();
+                gBufferStack.BlitTo(ppStack.GetFramebuffer());
+            }
+            else {
+                ppStack.FirstPass();
+
+                // the ambient occlusion is computed from the depth of the prepass
+                const bool isDepthPrepassOn{ Poe::DebugUI::mEnableDepthPrepass || Poe::DebugUI::mEnableAmbientOcclusion };
+                if (isDepthPrepassOn) {
+                    Poe::Profiler::BeginScope("Depth Prepass");
+                    depthPrepass.Begin(mainCamera);
+                    depthPrepass.Program().SetModelMatrix(model);
+                    if (Poe::DebugUI::mEnableFrustumCulling)
+                        staticModel.DrawUntexturedCulled(mainCamera.GetFrustum(model));
+                    else
+                        staticModel.DrawUntextured();
+                    depthPrepass.EndPrepass();
+                    Poe::Profiler::EndScope();
+                }
+
+                if (Poe::DebugUI::mEnableAmbientOcclusion) {
+                    Poe::Profiler::BeginScope("SSAO");
+                    ambientOcclusionStack.Execute(ppStack.GetFramebuffer(), mainCamera, ppStack.GetRenderWidth(), ppStack.GetRenderHeight());
+                    Poe::Profiler::EndScope();
+                }
+
+                if (Poe::DebugUI::mEnableClusteredLights) {
+                    Poe::Profiler::BeginScope("Light Clustering");
+                    const glm::mat4& view{ mainCamera.GetViewMatrix() };
+                    for (size_t i = 0; i < clusteredPointLights.size(); ++i) {
+                        Poe::PointLight& light{ clusteredPointLights[i] };
+                        light.mViewPosition = view * glm::vec4(light.mWorldPosition, 1.0f);
+                        clusteredLightingStack.SetPointLight(static_cast<int>(i), light);
+                    }
+                    for (size_t i = 0; i < clusteredSpotLights.size(); ++i) {
+                        clusteredLightingStack.SetSpotLight(static_cast<int>(i), view, clusteredSpotLights[i]);
+                    }
+                    clusteredLightingStack.Update(mainCamera, ppStack.GetRenderWidth(), ppStack.GetRenderHeight());
+                    Poe::Profiler::EndScope();
+                }
+
+                Poe::Profiler::BeginScope("Forward");
+                const Poe::BlinnPhongProgram& forwardProgram{ Poe::DebugUI::mEnableClusteredLights ? clusteredBlinnPhongProgram : blinnPhongProgram };
+                forwardProgram.Use();
+                forwardProgram.SetModelMatrix(model);
+                forwardProgram.SetNormalMatrix(normal);
+                forwardProgram.SetAmbientFactor(ambientFactor);
+                forwardProgram.SetAmbientOcclusion(Poe::DebugUI::mEnableAmbientOcclusion);
+                forwardProgram.SetTexMultiplier(glm::vec2(1.0f));
+                forwardProgram.SetTexOffset(glm::vec2(0.0f));
+                if (Poe::DebugUI::mEnableFrustumCulling)
+                    staticModel.DrawCulled(mainCamera.GetFrustum(model));
+                else
+                    staticModel.Draw();
+
+                if (isDepthPrepassOn)
+                    depthPrepass.EndMainPass();
+                Poe::Profiler::EndScope();
+            }
 
-            blinnPhongProgram.Use();
-            blinnPhongProgram.SetModelMatrix(model);
-            blinnPhongProgram.SetNormalMatrix(normal);
-            blinnPhongProgram.SetAmbientFactor(ambientFactor);
-            blinnPhongProgram.SetTexMultiplier(glm::vec2(1.0f));
-            blinnPhongProgram.SetTexOffset(glm::vec2(0.0f));
-            staticModel.Draw();
-
-            emissiveColorProgram.Use();
-            emissiveColorProgram.SetMaterial(cubeMaterial);
-            emissiveColorProgram.SetModelMatrix(cubeModel * glm::rotate(glm::mat4(1.0f), totalDt, glm::vec3(1.0f)));
-            cube.Bind();
-            cube.Draw();
-
-            if (Poe::DebugUI::mEnableGrid) {
-                emissiveColorProgram.SetMaterial(gridMaterial);
-                emissiveColorProgram.SetModelMatrix(glm::scale(glm::mat4(1.0f), glm::vec3(10.0f)));
-                grid.Bind();
-                grid.Draw(GL_LINES);
+            if (Poe::DebugUI::mEnableRenderQueue) {
+                Poe::Utility::JobSystem::Get().Wait(recordCounter);
+                renderQueue.Submit();
+            }
+            else {
+                emissiveColorProgram.Use();
+                emissiveColorProgram.SetMaterial(cubeMaterial);
+                emissiveColorProgram.SetModelMatrix(rotatedCubeModel);
+                cube.Bind();
+                cube.Draw();
+
+                if (Poe::DebugUI::mEnableGrid) {
+                    emissiveColorProgram.SetMaterial(gridMaterial);
+                    emissiveColorProgram.SetModelMatrix(gridModel);
+                    grid.Bind();
+                    grid.Draw(GL_LINES);
+                }
             }
 
             if (Poe::DebugUI::mEnableSkybox) {
                 skybox.Draw();
             }
 
-            ppStack.SecondPass();
-            ppStack.BindColor0();
+            if (Poe::DebugUI::mEnableTransparency) {
+                Poe::Profiler::BeginScope("Transparency");
+                transparencyStack.Begin(ppStack.GetFramebuffer(), ppStack.GetRenderWidth(), ppStack.GetRenderHeight());
+                glassProgram.Use();
+                glassProgram.SetAmbientFactor(ambientFactor);
+                glassProgram.SetAmbientOcclusion(false);
+                glassProgram.SetTexMultiplier(glm::vec2(1.0f));
+                glassProgram.SetTexOffset(glm::vec2(0.0f));
+                glassProgram.SetOpacity(0.4f);
+                for (unsigned unit = 0; unit < 3; ++unit) {
+                    glassTexture.Bind(unit);
+                }
+                glassPanes.Bind();
+                glassPanes.DrawInstanced();
+                transparencyStack.Composite(ppStack.GetFramebuffer());
+                Poe::Profiler::EndScope();
+            }
+            Poe::Profiler::EndScope();
 
+            Poe::Profiler::BeginScope("Post Process");
             glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
             glEnable(GL_CULL_FACE);
 
-            ppStack.Use();
-            ppStack.Draw();
+            if (Poe::DebugUI::mEnableComputePostProcess) {
+                ppStack.Execute();
+            }
+            else {
+                ppStack.SecondPass();
+                ppStack.BindColor0();
+                ppStack.Use();
+                ppStack.Draw();
+            }
+            Poe::Profiler::EndScope();
 
+            Poe::Profiler::BeginScope("UI");
             Poe::DebugUI::NewFrame();
             Poe::DebugUI::Begin_GlobalInfo();
                 Poe::DebugUI::Draw_GlobalInfo_General();
+                Poe::DebugUI::Draw_GlobalInfo_Profiler();
                 Poe::DebugUI::Draw_GlobalInfo_Camera(mainCamera);
                 Poe::DebugUI::Draw_GlobalInfo_PostProcess(ppStack.GetBlock());
+                Poe::DebugUI::Draw_GlobalInfo_PostProcessChain(ppStack.GetChain());
+                Poe::DebugUI::Draw_GlobalInfo_DynamicResolution(dynamicResolution, ppStack);
+                Poe::DebugUI::Draw_GlobalInfo_AmbientOcclusion(ambientOcclusionStack);
                 Poe::DebugUI::Draw_GlobalInfo_Fog(fogBlock);
                 Poe::DebugUI::Draw_GlobalIlluminationInfo(ambientFactor);
             Poe::DebugUI::End_GlobalInfo();
@@ -301,10 +557,21 @@ namespace CSItalyDemo
             Poe::DebugUI::Render_BlinnPhongMaterialsInfo({ blinnPhongMaterial }, fbWidth, fbHeight);
             Poe::DebugUI::RenderStats(fbWidth, fbHeight, 75.0f);
             Poe::DebugUI::EndFrame();
+            Poe::Profiler::EndScope();
 
             Poe::RuntimeStats::Reset();
+            Poe::Profiler::EndFrame();
+
+            // GBufferStack renders at full resolution
+            if (Poe::DebugUI::mEnableDynamicResolution && !Poe::DebugUI::mEnableDeferredShading) {
+                dynamicResolution.Update(ppStack);
+            }
+            else {
+                ppStack.SetRenderScale(1.0f);
+            }
 
             glfwSwapBuffers(window);
+            Poe::PersistentBuffer::EndFrame();
             glfwPollEvents();
         }
 
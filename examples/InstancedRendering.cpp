@@ -201,18 +201,36 @@ namespace CSItalyDemo
         glEnable(GL_CULL_FACE);
         glDepthFunc(GL_LEQUAL);
 
-        // glEnable(GL_BLEND);
-        // glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
         auto cube = Poe::CreateIcoSphere(3, 100);
+        cube.GenerateLods();
+        cube.EnableInstanceCulling();
+        cube.EnablePersistentMatrixBuffer();
+        cube.ApplyToAllInstances(10, 1, 10, 20.0f, 20.0f, 20.0f,
+        [=](int i, int j, int k, int numInstances) {
+            auto t = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 150.0f, -50.0f));
+            t = glm::scale(t, glm::vec3(9.0f));
+            return t;
+        });
+
+        // drawn in no particular order, see TransparencyStack
+        auto glass = Poe::CreateIcoSphere(2, 100);
+        glass.EnableInstanceCulling();
+        glass.ApplyToAllInstances(10, 1, 10, 20.0f, 20.0f, 20.0f,
+        [=](int i, int j, int k, int numInstances) {
+            auto t = glm::translate(glm::mat4(1.0f), glm::vec3(10.0f, 165.0f, -40.0f));
+            t = glm::scale(t, glm::vec3(7.0f));
+            return t;
+        });
 
         auto grid = Poe::CreateGrid(100, 100, 0);
         // grid.SetInstanceMatrix(glm::scale(glm::mat4(1.0f), glm::vec3(10.0f)));
 
-        Poe::ShaderLoader shaderLoader;
+        Poe::ShaderLoader shaderLoader("../shaders/cache");
         Poe::EmissiveColorProgram emissiveColorProgram("..", shaderLoader);
+        Poe::EmissiveColorProgramInstanced glassProgram("..", shaderLoader, true);
         Poe::TexturedSkyboxProgram skybox("..", shaderLoader, Poe::DefaultSkyboxTexture::Clear);
         Poe::PbrLightProgramInstanced pbrLightProgram("..", shaderLoader);
+        Poe::InstanceCullingProgram instanceCullingProgram("..", shaderLoader);
 
         mainCamera.mPosition = mainCamera.mTargetPosition = glm::vec3(0.0f, 180.0f, 100.0f);
 
@@ -223,19 +241,22 @@ namespace CSItalyDemo
         constexpr int fbSizeMultiplier{ 1 };
         Poe::PostProcessStack ppStack("..", fbWidth / fbSizeMultiplier, fbHeight / fbSizeMultiplier, fbWidth, fbHeight, 8, shaderLoader);
         mainCamera.SetAspectRatio(ppStack.GetWidth(), ppStack.GetHeight());
+        Poe::DynamicResolution dynamicResolution;
+        Poe::TransparencyStack transparencyStack("..", ppStack.GetWidth(), ppStack.GetHeight(), shaderLoader);
 
         Poe::PostProcessUB ppBlock;
         ppBlock.SetExposure(1.0f);
         ppBlock.SetGamma(2.2f);
         ppBlock.Buffer().TurnOn();
 
-        Poe::FogUB fogBlock(glm::vec3(0.01f, 0.01f, 0.01f), 1000.0f, 2.0f);
+        Poe::FogUB fogBlock(glm::vec3(0.01f, 0.01f, 0.01f), 1000.0f, 2.0f, true);
         fogBlock.Buffer().TurnOn();
 
-        Poe::TransformUB transformBlock;
+        Poe::TransformUB transformBlock(true);
         transformBlock.Buffer().TurnOn();
 
         Poe::EmissiveColorMaterial gridMaterial{ glm::vec4(0.5f, 0.5f, 0.5f, 1.0f) };
+        Poe::EmissiveColorMaterial glassMaterial{ glm::vec4(1.0f, 0.6f, 0.2f, 0.3f) };
 
         Poe::PbrLightMaterialUB pbrBlock;
         pbrBlock.Buffer().TurnOn();
@@ -247,7 +268,7 @@ namespace CSItalyDemo
             0.5f // ao
         };
 
-        Poe::DirLightUB<4> dirLightBlock(2);
+        Poe::DirLightUB<4> dirLightBlock(2, true);
         dirLightBlock.Buffer().TurnOn();
 
         Poe::DirLight sun{
@@ -262,6 +283,7 @@ namespace CSItalyDemo
         };
 
         while (!glfwWindowShouldClose(window)) {
+            Poe::Profiler::BeginScope("Main Pass");
             ppStack.FirstPass();
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
@@ -291,13 +313,14 @@ namespace CSItalyDemo
             dirLightBlock.Update();
 
             cube.Bind();
-            cube.ApplyToAllInstances(10, 1, 10, 20.0f, 20.0f, 20.0f,
-            [=](int i, int j, int k, int numInstances) {
-                auto t = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 150.0f, -50.0f));
-                t = glm::scale(t, glm::vec3(9.0f));
-                return t;
-            });
-            cube.DrawInstanced();
+            if (Poe::DebugUI::mEnableFrustumCulling) {
+                instanceCullingProgram.Cull(cube, mainCamera.GetFrustum(), Poe::ComputeLodView(mainCamera, ppStack.GetRenderHeight()));
+                pbrLightProgram.Use();
+                cube.DrawInstancedCulled();
+            }
+            else {
+                cube.DrawInstanced();
+            }
 
             emissiveColorProgram.Use();
 
@@ -311,31 +334,73 @@ namespace CSItalyDemo
             if (Poe::DebugUI::mEnableSkybox)
                 skybox.Draw();
 
+            if (Poe::DebugUI::mEnableTransparency) {
+                Poe::Profiler::BeginScope("Transparency");
+                if (Poe::DebugUI::mEnableFrustumCulling) {
+                    instanceCullingProgram.Cull(glass, mainCamera.GetFrustum(), Poe::ComputeLodView(mainCamera, ppStack.GetRenderHeight()));
+                }
+                transparencyStack.Begin(ppStack.GetFramebuffer(), ppStack.GetRenderWidth(), ppStack.GetRenderHeight());
+                glassProgram.Use();
+                glassProgram.SetMaterial(glassMaterial);
+                glass.Bind();
+                if (Poe::DebugUI::mEnableFrustumCulling) {
+                    glass.DrawInstancedCulled();
+                }
+                else {
+                    glass.DrawInstanced();
+                }
+                transparencyStack.Composite(ppStack.GetFramebuffer());
+                Poe::Profiler::EndScope();
+            }
+
             if (Poe::DebugUI::mEnableWireframe) {
                 glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
                 glEnable(GL_CULL_FACE);
             }
 
-            ppStack.SecondPass();
-            ppStack.BindColor0();
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+            Poe::Profiler::EndScope();
 
-            ppStack.Use();
-            ppStack.Draw();
+            Poe::Profiler::BeginScope("Post Process");
+            if (Poe::DebugUI::mEnableComputePostProcess) {
+                ppStack.Execute();
+            }
+            else {
+                ppStack.SecondPass();
+                ppStack.BindColor0();
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+                ppStack.Use();
+                ppStack.Draw();
+            }
+            Poe::Profiler::EndScope();
 
+            Poe::Profiler::BeginScope("UI");
             Poe::DebugUI::NewFrame();
             Poe::DebugUI::Begin_GlobalInfo();
                 Poe::DebugUI::Draw_GlobalInfo_General();
+                Poe::DebugUI::Draw_GlobalInfo_Profiler();
                 Poe::DebugUI::Draw_GlobalInfo_Camera(mainCamera);
                 Poe::DebugUI::Draw_GlobalInfo_PostProcess(ppBlock);
+                Poe::DebugUI::Draw_GlobalInfo_PostProcessChain(ppStack.GetChain());
+                Poe::DebugUI::Draw_GlobalInfo_DynamicResolution(dynamicResolution, ppStack);
                 Poe::DebugUI::Draw_GlobalInfo_Fog(fogBlock);
                 Poe::DebugUI::Render_PbrLightMaterialInfo(pbrLightMaterial);
             Poe::DebugUI::End_GlobalInfo();
             Poe::DebugUI::Render_LogInfo(fbWidth, fbHeight);
 
             Poe::DebugUI::EndFrame();
+            Poe::Profiler::EndScope();
+            Poe::Profiler::EndFrame();
+
+            if (Poe::DebugUI::mEnableDynamicResolution) {
+                dynamicResolution.Update(ppStack);
+            }
+            else {
+                ppStack.SetRenderScale(1.0f);
+            }
 
             glfwSwapBuffers(window);
+            Poe::PersistentBuffer::EndFrame();
             glfwPollEvents();
         }
 
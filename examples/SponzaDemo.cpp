@@ -31,6 +31,10 @@ namespace CSItalyDemo
     ////////////////////////////////////////
     static Poe::FirstPersonCamera mainCamera;
 
+    ////////////////////////////////////////
+    // F5 starts and stops recording the camera into camera_path.txt, see tools/Benchmark.cpp
+    static Poe::CameraPathRecorder cameraPathRecorder("camera_path.txt");
+
     ////////////////////////////////////////
     static void keyCallback(GLFWwindow* window, int key, int scanCode, int action, int mods)
     {
@@ -39,6 +43,9 @@ namespace CSItalyDemo
                 case GLFW_KEY_ESCAPE:
                     glfwSetWindowShouldClose(window, GLFW_TRUE);
                     break;
+                case GLFW_KEY_F5:
+                    cameraPathRecorder.Toggle();
+                    break;
             }
         }
         mainCamera.UpdateInputConfig(key, action);
@@ -207,16 +214,16 @@ namespace CSItalyDemo
         auto grid = Poe::CreateGrid(100, 100, 0);
         // grid.SetInstanceMatrix(glm::scale(glm::mat4(1.0f), glm::vec3(10.0f)));
 
-        Poe::ShaderLoader shaderLoader;
+        Poe::Texture2DLoader texture2DLoader;
+        auto staticModel = LoadSponza("..", texture2DLoader, true, Poe::VertexFormat::Quantized);
+
+        Poe::ShaderLoader shaderLoader("../shaders/cache");
         Poe::EmissiveColorProgram emissiveColorProgram("..", shaderLoader);
-        Poe::EmissiveTextureProgram emissiveTextureProgram("..", shaderLoader);
+        Poe::EmissiveTextureProgram emissiveTextureProgram("..", shaderLoader, staticModel.GetMaterialTableMode());
         Poe::TexturedSkyboxProgram skybox("..", shaderLoader, Poe::DefaultSkyboxTexture::Clear);
 
         mainCamera.mTargetPosition = mainCamera.mPosition = glm::vec3(0.0f, 15.0f, 0.0f);
 
-        Poe::Texture2DLoader texture2DLoader;
-        auto staticModel = LoadSponza("..", texture2DLoader);
-
         auto model = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 2.0f, 0.0f));
         model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
         model = glm::scale(model, glm::vec3(0.1f));
@@ -224,16 +231,17 @@ namespace CSItalyDemo
         constexpr int fbSizeMultiplier{ 1 };
         Poe::PostProcessStack ppStack("..", fbWidth / fbSizeMultiplier, fbHeight / fbSizeMultiplier, fbWidth, fbHeight, 8, shaderLoader);
         mainCamera.SetAspectRatio(ppStack.GetWidth(), ppStack.GetHeight());
+        Poe::DynamicResolution dynamicResolution;
 
         Poe::PostProcessUB ppBlock;
         ppBlock.SetExposure(1.0f);
         ppBlock.SetGamma(2.2f);
         ppBlock.Buffer().TurnOn();
 
-        Poe::FogUB fogBlock(glm::vec3(0.01f, 0.01f, 0.01f), 1000.0f, 2.0f);
+        Poe::FogUB fogBlock(glm::vec3(0.01f, 0.01f, 0.01f), 1000.0f, 2.0f, true);
         fogBlock.Buffer().TurnOn();
 
-        Poe::TransformUB transformBlock;
+        Poe::TransformUB transformBlock(true);
         transformBlock.Buffer().TurnOn();
 
         Poe::EmissiveColorMaterial gridMaterial{ glm::vec4(0.5f, 0.5f, 0.5f, 1.0f) };
@@ -242,7 +250,7 @@ namespace CSItalyDemo
         Poe::PbrLightMaterialUB pbrBlock;
         pbrBlock.Buffer().TurnOn();
 
-        Poe::DirLightUB<4> dirLightBlock(2);
+        Poe::DirLightUB<4> dirLightBlock(2, true);
         dirLightBlock.Buffer().TurnOn();
 
         Poe::DirLight sun{
@@ -257,6 +265,8 @@ namespace CSItalyDemo
         };
 
         while (!glfwWindowShouldClose(window)) {
+            texture2DLoader.Update();
+            Poe::Profiler::BeginScope("Main Pass");
             ppStack.FirstPass();
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
@@ -272,6 +282,7 @@ namespace CSItalyDemo
 
             float dt = Poe::Utility::ComputeDeltaTime();
             mainCamera.Update(dt);
+            cameraPathRecorder.Update(dt, mainCamera);
 
             transformBlock.Set(mainCamera);
             transformBlock.Update();
@@ -280,7 +291,11 @@ namespace CSItalyDemo
             emissiveTextureProgram.Use();
             emissiveTextureProgram.SetMaterial(modelMaterial);
             emissiveTextureProgram.SetModelMatrix(model);
-            staticModel.Draw();
+            staticModel.SetLodView(Poe::ComputeLodView(mainCamera, ppStack.GetRenderHeight(), 1.0f, model));
+            if (Poe::DebugUI::mEnableFrustumCulling)
+                staticModel.DrawCulled(mainCamera.GetFrustum(model));
+            else
+                staticModel.Draw();
 
             dirLightBlock.Set(0, mainCamera.GetViewMatrix(), sun);
             dirLightBlock.Update();
@@ -302,25 +317,48 @@ namespace CSItalyDemo
                 glEnable(GL_CULL_FACE);
             }
 
-            ppStack.SecondPass();
-            ppStack.BindColor0();
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+            Poe::Profiler::EndScope();
 
-            ppStack.Use();
-            ppStack.Draw();
+            Poe::Profiler::BeginScope("Post Process");
+            if (Poe::DebugUI::mEnableComputePostProcess) {
+                ppStack.Execute();
+            }
+            else {
+                ppStack.SecondPass();
+                ppStack.BindColor0();
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+                ppStack.Use();
+                ppStack.Draw();
+            }
+            Poe::Profiler::EndScope();
 
+            Poe::Profiler::BeginScope("UI");
             Poe::DebugUI::NewFrame();
             Poe::DebugUI::Begin_GlobalInfo();
                 Poe::DebugUI::Draw_GlobalInfo_General();
+                Poe::DebugUI::Draw_GlobalInfo_Profiler();
                 Poe::DebugUI::Draw_GlobalInfo_Camera(mainCamera);
                 Poe::DebugUI::Draw_GlobalInfo_PostProcess(ppBlock);
+                Poe::DebugUI::Draw_GlobalInfo_PostProcessChain(ppStack.GetChain());
+                Poe::DebugUI::Draw_GlobalInfo_DynamicResolution(dynamicResolution, ppStack);
                 Poe::DebugUI::Draw_GlobalInfo_Fog(fogBlock);
             Poe::DebugUI::End_GlobalInfo();
             Poe::DebugUI::Render_LogInfo(fbWidth, fbHeight);
 
             Poe::DebugUI::EndFrame();
+            Poe::Profiler::EndScope();
+            Poe::Profiler::EndFrame();
+
+            if (Poe::DebugUI::mEnableDynamicResolution) {
+                dynamicResolution.Update(ppStack);
+            }
+            else {
+                ppStack.SetRenderScale(1.0f);
+            }
 
             glfwSwapBuffers(window);
+            Poe::PersistentBuffer::EndFrame();
             glfwPollEvents();
         }
 
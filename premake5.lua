@@ -160,11 +160,22 @@ local compiler_ignore_options = { "-Wno-unused-but-set-variable",
                                   "-Wno-unused-variable",
                                   "-Wno-unused-function",
                                   "-fno-omit-frame-pointer" }
+--------------------------------------------------
+newoption {
+    trigger = "count-allocations",
+    description = "Replace the global operator new to count the heap allocations of every frame"
+}
+
 --------------------------------------------------
 workspace "poe"
     configurations { "debug", "release", "testing" }
     location "build"
 
+    filter "options:count-allocations"
+        defines { "POE_COUNT_ALLOCATIONS" }
+
+    filter {}
+
     --------------------------------------------------
     project "imgui"
         kind "StaticLib"
@@ -374,3 +385,75 @@ workspace "poe"
 
         filter { "system:linux", "action:gmake2", "configurations:Debug" }
             buildoptions(compiler_ignore_options)
+
+    --------------------------------------------------
+    project "texture_baker"
+        kind "ConsoleApp"
+        language "C++"
+        location "build/poe"
+        targetdir "build/%{cfg.buildcfg}"
+
+        files {
+            "tools/TextureBaker.cpp"
+        }
+
+        includedirs { "include", "src" }
+
+        filter "system:linux"
+            libdirs { "lib" }
+            links { "m", "glfw3", "pthread", "GL", "assimp", "imgui", "glad", "poe" }
+
+        filter "configurations:debug"
+            defines { "_DEBUG", "DEBUG" }
+            symbols "On"
+
+        filter "configurations:testing"
+            defines { "NDEBUG" }
+            symbols "On"
+            optimize "On"
+
+        filter "configurations:release"
+            defines { "NDEBUG" }
+            optimize "On"
+
+        filter { "system:linux", "action:gmake2" }
+            buildoptions(compiler_options)
+
+        filter { "system:linux", "action:gmake2", "configurations:Debug" }
+            buildoptions(compiler_ignore_options)
+
+    --------------------------------------------------
+    project "benchmark"
+        kind "ConsoleApp"
+        language "C++"
+        location "build/poe"
+        targetdir "build/%{cfg.buildcfg}"
+
+        files {
+            "tools/Benchmark.cpp"
+        }
+
+        includedirs { "include", "src" }
+
+        filter "system:linux"
+            libdirs { "lib" }
+            links { "m", "glfw3", "pthread", "GL", "assimp", "imgui", "glad", "poe" }
+
+        filter "configurations:debug"
+            defines { "_DEBUG", "DEBUG" }
+            symbols "On"
+
+        filter "configurations:testing"
+            defines { "NDEBUG" }
+            symbols "On"
+            optimize "On"
+
+        filter "configurations:release"
+            defines { "NDEBUG" }
+            optimize "On"
+
+        filter { "system:linux", "action:gmake2" }
+            buildoptions(compiler_options)
+
+        filter { "system:linux", "action:gmake2", "configurations:Debug" }
+            buildoptions(compiler_ignore_options)
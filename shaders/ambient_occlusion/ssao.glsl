@@ -0,0 +1,202 @@
+#ifdef POE_COMPUTE_SHADER
+
+////////////////////////////////////////
+//////////// COMPUTE SHADER ////////////
+////////////////////////////////////////
+
+// POE_SSAO_PASS 0: linearizes the full resolution depth into the top level of the half resolution pyramid
+// POE_SSAO_PASS 1: picks one texel of every 2x2 block of a level for the next smaller one
+// POE_SSAO_PASS 2: estimates the obscurance at half resolution, the taps far from the pixel read smaller levels
+// POE_SSAO_PASS 3: blurs the obscurance along a direction, weighted by the depth difference
+// POE_SSAO_PASS 4: upsamples the obscurance to full resolution, weighted by the depth difference
+// every level is only valid in its lower left corner, see PostProcessStack::SetRenderScale
+
+layout (local_size_x = POE_WORK_GROUP_SIZE, local_size_y = POE_WORK_GROUP_SIZE) in;
+
+#if POE_SSAO_PASS <= 1
+    layout (location = POE_UOUTPUT_IMAGE_LOC, r32f) uniform writeonly image2D uOutputImage;
+#elif POE_SSAO_PASS <= 3
+    layout (location = POE_UOUTPUT_IMAGE_LOC, rg16f) uniform writeonly image2D uOutputImage;
+#else
+    layout (location = POE_UOUTPUT_IMAGE_LOC, r8) uniform writeonly image2D uOutputImage;
+#endif
+layout (location = POE_UOUTPUT_REGION_LOC) uniform ivec2 uOutputRegion;
+layout (location = POE_USOURCE_REGION_LOC) uniform ivec2 uSourceRegion;
+
+#if POE_SSAO_PASS == 0 || POE_SSAO_PASS == 4
+    layout (location = POE_UDEPTH_TEXTURE_LOC) uniform sampler2D uDepthTexture;
+#endif
+#if POE_SSAO_PASS != 0
+    layout (location = POE_USOURCE_TEXTURE_LOC) uniform sampler2D uSourceTexture;
+#endif
+#if POE_SSAO_PASS != 1 && POE_SSAO_PASS != 3
+    layout (location = POE_UPROJECTION_LOC) uniform vec4 uProjection; // [0][0], [1][1], [2][2] and [3][2]
+#endif
+
+#if POE_SSAO_PASS == 1
+    layout (location = POE_USOURCE_LEVEL_LOC) uniform int uSourceLevel;
+#elif POE_SSAO_PASS == 2
+    layout (location = POE_URADIUS_LOC) uniform float uRadius;
+    layout (location = POE_UINTENSITY_LOC) uniform float uIntensity;
+    layout (location = POE_UBIAS_LOC) uniform float uBias;
+    layout (location = POE_UNUM_SAMPLES_LOC) uniform int uNumSamples;
+    layout (location = POE_UNUM_LEVELS_LOC) uniform int uNumLevels;
+#elif POE_SSAO_PASS == 3
+    layout (location = POE_UBLUR_DIRECTION_LOC) uniform ivec2 uBlurDirection;
+    layout (location = POE_USHARPNESS_LOC) uniform float uSharpness;
+#endif
+
+// stored for the background, 2^15 is exact in half precision so the stored value compares equal
+const float SKY_DISTANCE = 32768.0f;
+
+#if POE_SSAO_PASS == 0 || POE_SSAO_PASS == 4
+////////////////////////////////////////
+// distance along the view direction
+float LinearizeDepth(float depth)
+{
+    if (depth >= 1.0f)
+        return SKY_DISTANCE;
+    return uProjection.w / (depth * 2.0f - 1.0f + uProjection.z);
+}
+#endif
+
+#if POE_SSAO_PASS == 2
+// one tap per turn would line up, see McGuire et al., Scalable Ambient Obscurance
+const float SPIRAL_TURNS = 7.0f;
+
+// taps up to 2^LOG_MAX_OFFSET texels away read the top level
+const int LOG_MAX_OFFSET = 3;
+
+////////////////////////////////////////
+vec3 ViewPosition(ivec2 texel, float distance)
+{
+    vec2 ndc = (vec2(texel) + 0.5f) / vec2(uOutputRegion) * 2.0f - 1.0f;
+    return vec3(ndc * distance / uProjection.xy, -distance);
+}
+
+////////////////////////////////////////
+float FetchDistance(ivec2 texel, int level)
+{
+    ivec2 region = max(uOutputRegion >> level, ivec2(1));
+    return texelFetch(uSourceTexture, clamp(texel >> level, ivec2(0), region - 1), level).r;
+}
+
+////////////////////////////////////////
+// of the neighbours on either side the closer one in depth, so edges don't bend the normal
+vec3 ReconstructNormal(ivec2 texel, vec3 pos)
+{
+    vec3 right = ViewPosition(texel + ivec2(1, 0), FetchDistance(texel + ivec2(1, 0), 0)) - pos;
+    vec3 left = pos - ViewPosition(texel - ivec2(1, 0), FetchDistance(texel - ivec2(1, 0), 0));
+    vec3 up = ViewPosition(texel + ivec2(0, 1), FetchDistance(texel + ivec2(0, 1), 0)) - pos;
+    vec3 down = pos - ViewPosition(texel - ivec2(0, 1), FetchDistance(texel - ivec2(0, 1), 0));
+
+    vec3 dx = abs(right.z) < abs(left.z) ? right : left;
+    vec3 dy = abs(up.z) < abs(down.z) ? up : down;
+    return normalize(cross(dx, dy));
+}
+#endif
+
+#if POE_SSAO_PASS == 3
+// of a radius of 4 texels
+const float GAUSSIAN_WEIGHTS[5] = float[](0.153170f, 0.144893f, 0.122649f, 0.092902f, 0.062970f);
+#endif
+
+void main()
+{
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(texel, uOutputRegion)))
+        return;
+
+#if POE_SSAO_PASS <= 1
+    // alternating the picked texel keeps every level from drifting to one corner
+    ivec2 sourceTexel = clamp(texel * 2 + ivec2(texel.y & 1, texel.x & 1), ivec2(0), uSourceRegion - 1);
+    #if POE_SSAO_PASS == 0
+        float distance = LinearizeDepth(texelFetch(uDepthTexture, sourceTexel, 0).r);
+    #else
+        float distance = texelFetch(uSourceTexture, sourceTexel, uSourceLevel).r;
+    #endif
+    imageStore(uOutputImage, texel, vec4(distance));
+#elif POE_SSAO_PASS == 2
+    float distance = FetchDistance(texel, 0);
+    vec3 pos = ViewPosition(texel, distance);
+
+    // texels covered by the radius at this distance
+    float radiusTexels = uRadius * uProjection.y * 0.5f * float(uOutputRegion.y) / distance;
+    if (distance >= SKY_DISTANCE || radiusTexels < 1.0f)
+    {
+        imageStore(uOutputImage, texel, vec4(1.0f, distance, 0.0f, 0.0f));
+        return;
+    }
+
+    vec3 normal = ReconstructNormal(texel, pos);
+    float radius2 = uRadius * uRadius;
+    float rotation = float((3 * texel.x ^ texel.y + texel.x * texel.y) * 10);
+
+    float sum = 0.0f;
+    for (int i = 0; i < uNumSamples; ++i)
+    {
+        float alpha = (float(i) + 0.5f) / float(uNumSamples);
+        float angle = alpha * SPIRAL_TURNS * 6.2831853f + rotation;
+        float tapRadius = alpha * radiusTexels;
+        ivec2 tap = texel + ivec2(tapRadius * vec2(cos(angle), sin(angle)));
+        int level = clamp(findMSB(int(tapRadius)) - LOG_MAX_OFFSET, 0, uNumLevels - 1);
+
+        vec3 v = ViewPosition(tap, FetchDistance(tap, level)) - pos;
+        float vv = dot(v, v);
+        float vn = dot(v, normal);
+        float falloff = max(radius2 - vv, 0.0f);
+        sum += falloff * falloff * falloff * max((vn - uBias) / (0.01f + vv), 0.0f);
+    }
+
+    float occlusion = max(0.0f, 1.0f - sum * uIntensity * 5.0f / (float(uNumSamples) * radius2 * radius2 * radius2));
+    imageStore(uOutputImage, texel, vec4(occlusion, distance, 0.0f, 0.0f));
+#elif POE_SSAO_PASS == 3
+    vec2 center = texelFetch(uSourceTexture, texel, 0).rg;
+    if (center.g >= SKY_DISTANCE)
+    {
+        imageStore(uOutputImage, texel, vec4(center, 0.0f, 0.0f));
+        return;
+    }
+
+    float sum = center.r * GAUSSIAN_WEIGHTS[0];
+    float totalWeight = GAUSSIAN_WEIGHTS[0];
+    for (int r = -4; r <= 4; ++r)
+    {
+        if (r == 0)
+            continue;
+
+        vec2 tap = texelFetch(uSourceTexture, clamp(texel + uBlurDirection * r, ivec2(0), uSourceRegion - 1), 0).rg;
+        float weight = GAUSSIAN_WEIGHTS[abs(r)] * max(0.0f, 1.0f - uSharpness * abs(tap.g - center.g) / center.g);
+        sum += tap.r * weight;
+        totalWeight += weight;
+    }
+    imageStore(uOutputImage, texel, vec4(sum / totalWeight, center.g, 0.0f, 0.0f));
+#else
+    float distance = LinearizeDepth(texelFetch(uDepthTexture, texel, 0).r);
+    if (distance >= SKY_DISTANCE)
+    {
+        imageStore(uOutputImage, texel, vec4(1.0f));
+        return;
+    }
+
+    // bilinear weights of the four closest half resolution texels, scaled down across depth edges
+    vec2 coord = (vec2(texel) + 0.5f) * 0.5f - 0.5f;
+    ivec2 base = ivec2(floor(coord));
+    vec2 f = coord - vec2(base);
+
+    float sum = 0.0f;
+    float totalWeight = 0.0f;
+    for (int i = 0; i < 4; ++i)
+    {
+        ivec2 offset = ivec2(i & 1, i >> 1);
+        vec2 tap = texelFetch(uSourceTexture, clamp(base + offset, ivec2(0), uSourceRegion - 1), 0).rg;
+        vec2 bilinear = mix(1.0f - f, f, vec2(offset));
+        float weight = bilinear.x * bilinear.y / (1e-3f + abs(tap.g - distance) / distance);
+        sum += tap.r * weight;
+        totalWeight += weight;
+    }
+    imageStore(uOutputImage, texel, vec4(sum / max(totalWeight, 1e-6f)));
+#endif
+}
+
+#endif
@@ -26,7 +26,6 @@ layout (location = POE_ANORM_LOC) in vec3 aNorm;
 
 #if POE_INSTANCED == 1
     layout (location = POE_AMODEL_LOC) in mat4 aModel;
-    layout (location = POE_ANORM_MAT_LOC) in mat3 aNormMat;
 #endif
 
 layout (std140, binding = POE_TRANSFORM_BLOCK_LOC) uniform TransformBlock
@@ -60,63 +59,75 @@ layout (std140, binding = POE_SPOT_LIGHT_BLOCK_LOC) uniform SpotLightBlock
     SpotLight_t uSpotLights[NUM_SPOT_LIGHTS];
 };
 
+// invariant, see depth.glsl
+invariant gl_Position;
+
 out VS_OUT
 {
     vec3 vFragPos;
     vec3 vFragPosWorld;
     vec3 vNorm;
     vec2 vTexCoord;
+#if POE_MATERIAL_TABLE != 0
+    flat int vMaterialIndex;
+#endif
 
     vec4 vFragPosInDirLightSpace[NUM_DIR_LIGHTS][NUM_CASCADES];
     vec4 vFragPosInSpotLightSpace[NUM_SPOT_LIGHTS];
 }
 vs_out;
 
-void ComputeDirLightSpace()
+void ComputeDirLightSpace(vec4 localPos)
 {
     for (int i = 0; i < NUM_DIR_LIGHTS; ++i)
     {
         for (int j = 0; j < NUM_CASCADES; ++j)
         {
 #if POE_INSTANCED == 0
-            vs_out.vFragPosInDirLightSpace[i][j] = uDirLights[i].lightSpace[j] * uModel * vec4(aPos, 1.0f);
+            vs_out.vFragPosInDirLightSpace[i][j] = uDirLights[i].lightSpace[j] * uModel * localPos;
 #elif POE_INSTANCED == 1
-            vs_out.vFragPosInDirLightSpace[i][j] = uDirLights[i].lightSpace[j] * aModel * vec4(aPos, 1.0f);
+            vs_out.vFragPosInDirLightSpace[i][j] = uDirLights[i].lightSpace[j] * aModel * localPos;
 #endif
         }
     }
 }
 
-void ComputeSpotLightSpace()
+void ComputeSpotLightSpace(vec4 localPos)
 {
     for (int i = 0; i < NUM_SPOT_LIGHTS; ++i)
     {
 #if POE_INSTANCED == 0
-        vs_out.vFragPosInSpotLightSpace[i] = uSpotLights[i].lightSpace * uModel * vec4(aPos, 1.0f);
+        vs_out.vFragPosInSpotLightSpace[i] = uSpotLights[i].lightSpace * uModel * localPos;
 #elif POE_INSTANCED == 1
-        vs_out.vFragPosInSpotLightSpace[i] = uSpotLights[i].lightSpace * aModel * vec4(aPos, 1.0f);
+        vs_out.vFragPosInSpotLightSpace[i] = uSpotLights[i].lightSpace * aModel * localPos;
 #endif
     }
 }
 
 void main()
 {
+    vec4 localPos = vec4(DecodePosition(aPos), 1.0f);
+
 #if POE_INSTANCED == 0
-    gl_Position = uProjView * uModel * vec4(aPos, 1.0f);
-    vs_out.vFragPos = vec3(uView * uModel * vec4(aPos, 1.0f));
-    vs_out.vFragPosWorld = vec3(uModel * vec4(aPos, 1.0f));
+    gl_Position = uProjView * (uModel * localPos);
+    vs_out.vFragPos = vec3(uView * uModel * localPos);
+    vs_out.vFragPosWorld = vec3(uModel * localPos);
     vs_out.vNorm = uNorm * aNorm;
 #elif POE_INSTANCED == 1
-    gl_Position = uProjView * aModel * vec4(aPos, 1.0f);
-    vs_out.vFragPos = vec3(uView * aModel * vec4(aPos, 1.0f));
-    vs_out.vFragPosWorld = vec3(aModel * vec4(aPos, 1.0f));
-    vs_out.vNorm = aNormMat * aNorm;
+    gl_Position = uProjView * (aModel * localPos);
+    vs_out.vFragPos = vec3(uView * aModel * localPos);
+    vs_out.vFragPosWorld = vec3(aModel * localPos);
+    // instances only carry their model matrix, see StaticMesh::ConfigureMatrixBuffer
+    vs_out.vNorm = transpose(inverse(mat3(aModel))) * aNorm;
 #endif
 
     vs_out.vTexCoord = aTexCoord * uTexMultiplier + uTexOffset; 
+#if POE_MATERIAL_TABLE != 0
+    vs_out.vMaterialIndex = GetMaterialIndex();
+#endif
 
-    ComputeDirLightSpace();
-    ComputeSpotLightSpace();
+    ComputeDirLightSpace(localPos);
+    ComputeSpotLightSpace(localPos);
 }
 
 #elif defined(POE_FRAGMENT_SHADER)
@@ -163,6 +174,9 @@ in VS_OUT
     vec3 vFragPosWorld;
     vec3 vNorm;
     vec2 vTexCoord;
+#if POE_MATERIAL_TABLE != 0
+    flat int vMaterialIndex;
+#endif
 
     vec4 vFragPosInDirLightSpace[NUM_DIR_LIGHTS][NUM_CASCADES];
     vec4 vFragPosInSpotLightSpace[NUM_SPOT_LIGHTS];
@@ -209,12 +223,21 @@ layout (std140, binding = POE_POST_PROCESS_BLOCK_LOC) uniform PostProcessBlock
     mat3 uKernel;
 };
 
+#if POE_MATERIAL_TABLE == 0
 layout (location = POE_UMATERIAL_AMBIENT_TEXTURE_LOC) uniform sampler2D uMaterialAmbientTexture;
 layout (location = POE_UMATERIAL_DIFFUSE_TEXTURE_LOC) uniform sampler2D uMaterialDiffuseTexture;
 layout (location = POE_UMATERIAL_SPECULAR_TEXTURE_LOC) uniform sampler2D uMaterialSpecularTexture;
+#endif
 
 layout (location = POE_UAMBIENT_FACTOR_LOC) uniform float uAmbientFactor;
 
+// full resolution, written by AmbientOcclusionStack for the pixels of this frame
+layout (location = POE_UAMBIENT_OCCLUSION_MAP_LOC) uniform sampler2D uAmbientOcclusionMap;
+layout (location = POE_UAMBIENT_OCCLUSION_LOC) uniform bool uHasAmbientOcclusion;
+
+// declared by the opaque variants too so that the location is valid in every program
+layout (location = POE_UOPACITY_LOC) uniform float uOpacity;
+
 vec3 computeDirLight(vec3 normal, vec3 pixelPos, vec3 viewDir, vec3 diffuseTexColor, vec3 specularTexColor)
 {
     vec3 result = vec3(0.0f);
@@ -235,25 +258,49 @@ vec3 computeDirLight(vec3 normal, vec3 pixelPos, vec3 viewDir, vec3 diffuseTexCo
     return result;
 }
 
+vec3 shadePointLight(PointLight_t light, vec3 normal, vec3 pixelPos, vec3 viewDir, vec3 diffuseTexColor, vec3 specularTexColor)
+{
+    vec3 lightDir = normalize(light.viewPosition - pixelPos);
+    float diff = max(dot(normal, lightDir), 0.0f);
+    vec3 diffuse = diff * light.color * uMaterialDiffuse * diffuseTexColor;
+
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+    float spec = pow(max(dot(normal, halfwayDir), 0.0f), uMaterialShininess);
+    vec3 specular = spec * light.color * specularTexColor * uMaterialSpecular;
+
+    float dist = length(light.viewPosition - pixelPos);
+    float attenuation = 1.0f / (light.constant + dist * light.linear + dist * dist * light.quadratic);
+
+    return light.intensity * attenuation * (diffuse + specular);
+}
+
+vec3 shadeSpotLight(SpotLight_t light, vec3 normal, vec3 pixelPos, vec3 viewDir, vec3 diffuseTexColor, vec3 specularTexColor)
+{
+    vec3 lightDir = normalize(light.position - pixelPos);
+    float theta = dot(lightDir, normalize(-light.direction));
+    float epsilon = light.innerCutoff - light.outerCutoff;
+    float intensity = clamp((theta - light.outerCutoff) / epsilon, 0.0f, 1.0f);
+
+    float diff = max(dot(normal, lightDir), 0.0f);
+    vec3 diffuse = diff * light.color * uMaterialDiffuse * diffuseTexColor;
+
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+    float spec = pow(max(dot(normal, halfwayDir), 0.0f), uMaterialShininess);
+    vec3 specular = spec * light.color * specularTexColor * uMaterialSpecular;
+
+    float dist = length(light.position - pixelPos);
+    float attenuation = 1.0f / (light.constant + dist * light.linear + dist * dist * light.quadratic);
+
+    return intensity * attenuation * light.intensity * (diffuse + specular);
+}
+
 vec3 computePointLight(vec3 normal, vec3 pixelPos, vec3 viewDir, vec3 diffuseTexColor, vec3 specularTexColor)
 {
     vec3 result = vec3(0.0f);
     for (int i = 0; i < NUM_POINT_LIGHTS; ++i)
     {
-        vec3 lightDir = normalize(uPointLights[i].viewPosition - pixelPos);
-        float diff = max(dot(normal, lightDir), 0.0f);
-        vec3 diffuse = diff * uPointLights[i].color * uMaterialDiffuse * diffuseTexColor;
-
-        vec3 halfwayDir = normalize(lightDir + viewDir);
-        float spec = pow(max(dot(normal, halfwayDir), 0.0f), uMaterialShininess);
-        vec3 specular = spec * uPointLights[i].color * specularTexColor * uMaterialSpecular;
-
-        float dist = length(uPointLights[i].viewPosition - pixelPos);
-        float attenuation = 1.0f / (uPointLights[i].constant + dist * uPointLights[i].linear + dist * dist * uPointLights[i].quadratic);
-
         float shadowComp = ComputeShadowForPointLights(uPointLights[i].worldPosition, fs_in.vFragPosWorld, uPointLights[i].farPlane);
-
-        result += shadowComp * uPointLights[i].intensity * attenuation * (diffuse + specular);
+        result += shadowComp * shadePointLight(uPointLights[i], normal, pixelPos, viewDir, diffuseTexColor, specularTexColor);
     }
     return result;
 }
@@ -263,40 +310,49 @@ vec3 computeSpotLight(vec3 normal, vec3 pixelPos, vec3 viewDir, vec3 diffuseTexC
     vec3 result = vec3(0.0f);
     for (int i = 0; i < NUM_SPOT_LIGHTS; ++i)
     {
-        vec3 lightDir = normalize(uSpotLights[i].position - pixelPos);
-        float theta = dot(lightDir, normalize(-uSpotLights[i].direction));
-        float epsilon = uSpotLights[i].innerCutoff - uSpotLights[i].outerCutoff;
-        float intensity = clamp((theta - uSpotLights[i].outerCutoff) / epsilon, 0.0f, 1.0f);
-
-        float diff = max(dot(normal, lightDir), 0.0f);
-        vec3 diffuse = diff * uSpotLights[i].color * uMaterialDiffuse * diffuseTexColor;
-
-        vec3 halfwayDir = normalize(lightDir + viewDir);
-        float spec = pow(max(dot(normal, halfwayDir), 0.0f), uMaterialShininess);
-        vec3 specular = spec * uSpotLights[i].color * specularTexColor * uMaterialSpecular;
-
-        float dist = length(uSpotLights[i].position - pixelPos);
-        float attenuation = 1.0f / (uSpotLights[i].constant + dist * uSpotLights[i].linear + dist * dist * uSpotLights[i].quadratic);
-
         float shadowComp = ComputeShadowForSpotLights(fs_in.vFragPosInSpotLightSpace[i]);
-        result += shadowComp * intensity * attenuation * uSpotLights[i].intensity * (diffuse + specular);
+        result += shadowComp * shadeSpotLight(uSpotLights[i], normal, pixelPos, viewDir, diffuseTexColor, specularTexColor);
     }
     return result;
 }
 
+#ifdef CLUSTERED_LIGHTS_INCLUDED
+// shadowless lights binned into the froxel of the fragment
+vec3 computeClusteredLights(vec3 normal, vec3 pixelPos, vec3 viewDir, vec3 diffuseTexColor, vec3 specularTexColor)
+{
+    vec3 result = vec3(0.0f);
+    uvec4 cluster = GetLightCluster(-pixelPos.z);
+    for (uint i = 0u; i < cluster.y; ++i)
+        result += shadePointLight(uPointLightList[uLightIndices[cluster.x + i]], normal, pixelPos, viewDir, diffuseTexColor, specularTexColor);
+    for (uint i = cluster.y; i < cluster.y + cluster.z; ++i)
+        result += shadeSpotLight(uSpotLightList[uLightIndices[cluster.x + i]], normal, pixelPos, viewDir, diffuseTexColor, specularTexColor);
+    return result;
+}
+#endif
+
+#ifdef WEIGHTED_BLENDED_INCLUDED
+vec4 color;
+#else
 out vec4 color;
+#endif
 void main()
 {
+#if POE_MATERIAL_TABLE == 0
     vec4 _ambientTexColor = texture(uMaterialAmbientTexture, fs_in.vTexCoord);
     vec4 _diffuseTexColor = texture(uMaterialDiffuseTexture, fs_in.vTexCoord);
     vec4 _specularTexColor = texture(uMaterialSpecularTexture, fs_in.vTexCoord);
+#else
+    vec4 _ambientTexColor = SampleMaterial(fs_in.vMaterialIndex, MATERIAL_SLOT_AMBIENT, fs_in.vTexCoord);
+    vec4 _diffuseTexColor = SampleMaterial(fs_in.vMaterialIndex, MATERIAL_SLOT_DIFFUSE, fs_in.vTexCoord);
+    vec4 _specularTexColor = SampleMaterial(fs_in.vMaterialIndex, MATERIAL_SLOT_SPECULAR, fs_in.vTexCoord);
+#endif
 
     if (_diffuseTexColor.a < 0.01f) discard;
 
 #ifdef GAMMA_INCLUDED
-    vec3 ambientTexColor = FixGamma(uGamma, texture(uMaterialAmbientTexture, fs_in.vTexCoord)).rgb;
-    vec3 diffuseTexColor = FixGamma(uGamma, texture(uMaterialDiffuseTexture, fs_in.vTexCoord)).rgb;
-    vec3 specularTexColor = FixGamma(uGamma, texture(uMaterialSpecularTexture, fs_in.vTexCoord)).rgb;
+    vec3 ambientTexColor = FixGamma(uGamma, _ambientTexColor).rgb;
+    vec3 diffuseTexColor = FixGamma(uGamma, _diffuseTexColor).rgb;
+    vec3 specularTexColor = FixGamma(uGamma, _specularTexColor).rgb;
 #else
     vec3 ambientTexColor = _ambientTexColor.rgb;
     vec3 diffuseTexColor = _diffuseTexColor.rgb;
@@ -310,12 +366,20 @@ void main()
     color.rgb += computeDirLight(normal, fs_in.vFragPos, viewDir, diffuseTexColor, specularTexColor);
     color.rgb += computePointLight(normal, fs_in.vFragPos, viewDir, diffuseTexColor, specularTexColor);
     color.rgb += computeSpotLight(normal, fs_in.vFragPos, viewDir, diffuseTexColor, specularTexColor);
+#ifdef CLUSTERED_LIGHTS_INCLUDED
+    color.rgb += computeClusteredLights(normal, fs_in.vFragPos, viewDir, diffuseTexColor, specularTexColor);
+#endif
 
-    color.rgb += uAmbientFactor * ambientTexColor * uMaterialAmbient;
+    float ambientOcclusion = uHasAmbientOcclusion ? texelFetch(uAmbientOcclusionMap, ivec2(gl_FragCoord.xy), 0).r : 1.0f;
+    color.rgb += uAmbientFactor * ambientTexColor * uMaterialAmbient * ambientOcclusion;
 
 #ifdef FOG_INCLUDED
     color.rgb = ApplyFog(color.rgb, fs_in.vFragPos);
 #endif
+
+#ifdef WEIGHTED_BLENDED_INCLUDED
+    WriteWeightedBlended(vec4(color.rgb, _diffuseTexColor.a * uOpacity), fs_in.vFragPos);
+#endif
 }
 
 #endif
@@ -0,0 +1,92 @@
+#ifdef POE_COMPUTE_SHADER
+
+////////////////////////////////////////
+//////////// COMPUTE SHADER ////////////
+////////////////////////////////////////
+
+layout (local_size_x = POE_WORK_GROUP_SIZE) in;
+
+layout (std430, binding = POE_INSTANCE_INPUT_BLOCK_LOC) readonly buffer InstanceInputBlock
+{
+    mat4 uInputMatrices[];
+};
+
+layout (std430, binding = POE_INSTANCE_OUTPUT_BLOCK_LOC) writeonly buffer InstanceOutputBlock
+{
+    mat4 uOutputMatrices[];
+};
+
+// mirrors DrawElementsIndirectCommand
+struct DrawCommand
+{
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+
+// one command per level of detail
+layout (std430, binding = POE_INSTANCE_COMMAND_BLOCK_LOC) buffer InstanceCommandBlock
+{
+    DrawCommand uCommands[];
+};
+
+layout (location = POE_UFRUSTUM_PLANES_LOC) uniform vec4 uFrustumPlanes[6];
+layout (location = POE_UBOUNDING_SPHERE_LOC) uniform vec4 uBoundingSphere;
+layout (location = POE_UNUM_INSTANCES_LOC) uniform uint uNumInstances;
+
+layout (location = POE_UCAMERA_POS_LOC) uniform vec3 uCameraPos;
+layout (location = POE_ULOD_SCALE_LOC) uniform float uLodScale;
+layout (location = POE_UNUM_LODS_LOC) uniform uint uNumLods;
+layout (location = POE_ULOD_ERRORS_LOC) uniform float uLodErrors[POE_MAX_LODS];
+
+////////////////////////////////////////
+bool IsSphereVisible(vec3 center, float radius)
+{
+    for (int i = 0; i < 6; ++i)
+    {
+        if (dot(uFrustumPlanes[i].xyz, center) + uFrustumPlanes[i].w < -radius)
+            return false;
+    }
+    return true;
+}
+
+////////////////////////////////////////
+// coarsest level whose projected error stays within budget, mirrors Poe::SelectLod
+uint SelectLod(vec3 center, float radius, float scale)
+{
+    if (uLodScale <= 0.0f)
+        return 0u;
+
+    float distance = max(length(center - uCameraPos) - radius, 0.0f);
+    uint lod = 0u;
+    for (uint i = 1u; i < uNumLods; ++i)
+    {
+        if (uLodErrors[i] * scale * uLodScale > distance)
+            break;
+        lod = i;
+    }
+    return lod;
+}
+
+void main()
+{
+    uint instance = gl_GlobalInvocationID.x;
+    if (instance >= uNumInstances)
+        return;
+
+    mat4 model = uInputMatrices[instance];
+    vec3 center = vec3(model * vec4(uBoundingSphere.xyz, 1.0f));
+    float scale = max(length(model[0].xyz), max(length(model[1].xyz), length(model[2].xyz)));
+    float radius = uBoundingSphere.w * scale;
+
+    if (IsSphereVisible(center, radius))
+    {
+        uint lod = SelectLod(center, radius, scale);
+        uint slot = atomicAdd(uCommands[lod].instanceCount, 1u);
+        uOutputMatrices[lod * uNumInstances + slot] = model;
+    }
+}
+
+#endif
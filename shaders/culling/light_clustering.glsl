@@ -0,0 +1,129 @@
+#ifdef POE_COMPUTE_SHADER
+
+////////////////////////////////////////
+//////////// COMPUTE SHADER ////////////
+////////////////////////////////////////
+
+layout (local_size_x = POE_WORK_GROUP_SIZE) in;
+
+layout (std430, binding = POE_POINT_LIGHT_LIST_BLOCK_LOC) readonly buffer PointLightListBlock
+{
+    PointLight_t uPointLightList[];
+};
+
+layout (std430, binding = POE_SPOT_LIGHT_LIST_BLOCK_LOC) readonly buffer SpotLightListBlock
+{
+    SpotLight_t uSpotLightList[];
+};
+
+// x: offset into uLightIndices, y: point lights, z: spot lights
+layout (std430, binding = POE_LIGHT_CLUSTER_BLOCK_LOC) buffer LightClusterBlock
+{
+    vec4 uClusterParams; // near, far, width, height
+    uvec4 uClusters[];
+};
+
+layout (std430, binding = POE_LIGHT_INDEX_BLOCK_LOC) writeonly buffer LightIndexBlock
+{
+    uint uLightIndices[];
+};
+
+layout (location = POE_UINVERSE_PROJECTION_LOC) uniform mat4 uInverseProjection;
+layout (location = POE_UNUM_POINT_LIGHTS_LOC) uniform uint uNumPointLights;
+layout (location = POE_UNUM_SPOT_LIGHTS_LOC) uniform uint uNumSpotLights;
+
+// lights are tested in batches shared by the whole work group
+shared vec4 sLightSpheres[POE_WORK_GROUP_SIZE];
+
+////////////////////////////////////////
+vec3 UnprojectToDepth(vec2 ndc, float depth)
+{
+    vec4 pos = uInverseProjection * vec4(ndc, -1.0f, 1.0f);
+    pos.xyz /= pos.w;
+    return pos.xyz * (depth / -pos.z);
+}
+
+////////////////////////////////////////
+bool IsSphereInAABB(vec4 sphere, vec3 aabbMin, vec3 aabbMax)
+{
+    vec3 closest = clamp(sphere.xyz, aabbMin, aabbMax);
+    vec3 d = closest - sphere.xyz;
+    return dot(d, d) <= sphere.w * sphere.w;
+}
+
+void main()
+{
+    uint cluster = gl_GlobalInvocationID.x;
+    const uint numClusters = POE_CLUSTER_GRID_X * POE_CLUSTER_GRID_Y * POE_CLUSTER_GRID_Z;
+    bool isValid = cluster < numClusters;
+
+    // view space bounds of the froxel, depth slices are exponential
+    uvec3 coord = uvec3(cluster % POE_CLUSTER_GRID_X,
+                        (cluster / POE_CLUSTER_GRID_X) % POE_CLUSTER_GRID_Y,
+                        cluster / (POE_CLUSTER_GRID_X * POE_CLUSTER_GRID_Y));
+    vec2 ndcMin = vec2(coord.xy) / vec2(POE_CLUSTER_GRID_X, POE_CLUSTER_GRID_Y) * 2.0f - 1.0f;
+    vec2 ndcMax = vec2(coord.xy + 1u) / vec2(POE_CLUSTER_GRID_X, POE_CLUSTER_GRID_Y) * 2.0f - 1.0f;
+    float near = uClusterParams.x;
+    float far = uClusterParams.y;
+    float sliceNear = near * pow(far / near, float(coord.z) / float(POE_CLUSTER_GRID_Z));
+    float sliceFar = near * pow(far / near, float(coord.z + 1u) / float(POE_CLUSTER_GRID_Z));
+
+    vec3 aabbMin = vec3(1e30f);
+    vec3 aabbMax = vec3(-1e30f);
+    for (int i = 0; i < 4; ++i)
+    {
+        vec2 ndc = vec2((i & 1) == 0 ? ndcMin.x : ndcMax.x, (i & 2) == 0 ? ndcMin.y : ndcMax.y);
+        vec3 a = UnprojectToDepth(ndc, sliceNear);
+        vec3 b = UnprojectToDepth(ndc, sliceFar);
+        aabbMin = min(aabbMin, min(a, b));
+        aabbMax = max(aabbMax, max(a, b));
+    }
+
+    uint offset = cluster * POE_MAX_LIGHTS_PER_CLUSTER;
+    uint numPoint = 0u;
+    uint numSpot = 0u;
+
+    // the radius is where the attenuation of PointLightListElem__DATA::SetRadius fades out
+    for (uint first = 0u; first < uNumPointLights; first += POE_WORK_GROUP_SIZE)
+    {
+        uint light = first + gl_LocalInvocationID.x;
+        if (light < uNumPointLights)
+            sLightSpheres[gl_LocalInvocationID.x] = vec4(uPointLightList[light].viewPosition, 4.5f / uPointLightList[light].linear);
+        barrier();
+
+        uint batchSize = min(uint(POE_WORK_GROUP_SIZE), uNumPointLights - first);
+        for (uint i = 0u; isValid && i < batchSize; ++i)
+        {
+            if (numPoint < POE_MAX_LIGHTS_PER_CLUSTER && IsSphereInAABB(sLightSpheres[i], aabbMin, aabbMax))
+            {
+                uLightIndices[offset + numPoint] = first + i;
+                ++numPoint;
+            }
+        }
+        barrier();
+    }
+
+    for (uint first = 0u; first < uNumSpotLights; first += POE_WORK_GROUP_SIZE)
+    {
+        uint light = first + gl_LocalInvocationID.x;
+        if (light < uNumSpotLights)
+            sLightSpheres[gl_LocalInvocationID.x] = vec4(uSpotLightList[light].position, 4.5f / uSpotLightList[light].linear);
+        barrier();
+
+        uint batchSize = min(uint(POE_WORK_GROUP_SIZE), uNumSpotLights - first);
+        for (uint i = 0u; isValid && i < batchSize; ++i)
+        {
+            if (numPoint + numSpot < POE_MAX_LIGHTS_PER_CLUSTER && IsSphereInAABB(sLightSpheres[i], aabbMin, aabbMax))
+            {
+                uLightIndices[offset + numPoint + numSpot] = first + i;
+                ++numSpot;
+            }
+        }
+        barrier();
+    }
+
+    if (isValid)
+        uClusters[cluster] = uvec4(offset, numPoint, numSpot, 0u);
+}
+
+#endif
@@ -0,0 +1,44 @@
+// packing shared by the G-buffer writes and the lighting passes
+
+////////////////////////////////////////
+vec2 OctahedronWrap(vec2 v)
+{
+    return (1.0f - abs(v.yx)) * vec2(v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f);
+}
+
+////////////////////////////////////////
+// unit vector to [0, 1]^2, stored in RG16
+vec2 EncodeNormal(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 e = n.z >= 0.0f ? n.xy : OctahedronWrap(n.xy);
+    return e * 0.5f + 0.5f;
+}
+
+////////////////////////////////////////
+vec3 DecodeNormal(vec2 e)
+{
+    e = e * 2.0f - 1.0f;
+    vec3 n = vec3(e, 1.0f - abs(e.x) - abs(e.y));
+    if (n.z < 0.0f)
+        n.xy = OctahedronWrap(n.xy);
+    return normalize(n);
+}
+
+////////////////////////////////////////
+// log2 mapping keeps the precision of RG8 where small exponents differ the most
+#define MAX_SHININESS_LOG2 11.0f
+
+////////////////////////////////////////
+float EncodeShininess(float shininess)
+{
+    return clamp(log2(max(shininess, 1.0f)) / MAX_SHININESS_LOG2, 0.0f, 1.0f);
+}
+
+////////////////////////////////////////
+float DecodeShininess(float e)
+{
+    return exp2(e * MAX_SHININESS_LOG2);
+}
+
+#define GBUFFER_ENCODING_INCLUDED
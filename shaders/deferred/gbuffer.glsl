@@ -0,0 +1,145 @@
+#ifdef POE_VERTEX_SHADER
+
+////////////////////////////////////////
+//////////// VERTEX SHADER /////////////
+////////////////////////////////////////
+
+layout (location = POE_APOS_LOC) in vec3 aPos;
+layout (location = POE_ATEXCOORD_LOC) in vec2 aTexCoord;
+layout (location = POE_ANORM_LOC) in vec3 aNorm;
+
+#if POE_INSTANCED == 1
+    layout (location = POE_AMODEL_LOC) in mat4 aModel;
+    layout (location = POE_ANORM_MAT_LOC) in mat3 aNormMat;
+#endif
+
+layout (std140, binding = POE_TRANSFORM_BLOCK_LOC) uniform TransformBlock
+{
+    mat4 uProjection;
+    mat4 uView;
+    mat4 uProjView;
+    vec3 uCamDir;
+};
+
+#if POE_INSTANCED == 0
+    layout (location = POE_UMODEL_LOC) uniform mat4 uModel;
+#endif
+
+layout (location = POE_UNORM_LOC) uniform mat3 uNorm;
+layout (location = POE_UTEX_OFFSET_LOC) uniform vec2 uTexOffset;
+layout (location = POE_UTEX_MULTIPLIER_LOC) uniform vec2 uTexMultiplier;
+
+out VS_OUT
+{
+    vec3 vFragPos;
+    vec3 vNorm;
+    vec2 vTexCoord;
+#if POE_MATERIAL_TABLE != 0
+    flat int vMaterialIndex;
+#endif
+}
+vs_out;
+
+void main()
+{
+    vec4 localPos = vec4(DecodePosition(aPos), 1.0f);
+
+#if POE_INSTANCED == 0
+    gl_Position = uProjView * uModel * localPos;
+    vs_out.vFragPos = vec3(uView * uModel * localPos);
+    vs_out.vNorm = uNorm * aNorm;
+#elif POE_INSTANCED == 1
+    gl_Position = uProjView * aModel * localPos;
+    vs_out.vFragPos = vec3(uView * aModel * localPos);
+    vs_out.vNorm = aNormMat * aNorm;
+#endif
+
+    vs_out.vTexCoord = aTexCoord * uTexMultiplier + uTexOffset;
+#if POE_MATERIAL_TABLE != 0
+    vs_out.vMaterialIndex = GetMaterialIndex();
+#endif
+}
+
+#elif defined(POE_FRAGMENT_SHADER)
+
+////////////////////////////////////////
+//////////// FRAGMENT SHADER ///////////
+////////////////////////////////////////
+
+in VS_OUT
+{
+    vec3 vFragPos;
+    vec3 vNorm;
+    vec2 vTexCoord;
+#if POE_MATERIAL_TABLE != 0
+    flat int vMaterialIndex;
+#endif
+}
+fs_in;
+
+layout (std140, binding = POE_BLINN_PHONG_MATERIAL_BLOCK_LOC) uniform BlinnPhongMaterialBlock
+{
+    vec3 uMaterialAmbient;
+    vec3 uMaterialDiffuse;
+    vec3 uMaterialSpecular;
+    float uMaterialShininess;
+};
+
+layout (std140, binding = POE_POST_PROCESS_BLOCK_LOC) uniform PostProcessBlock
+{
+    float uGrayscaleWeight;
+    float uKernelWeight;
+    float uGamma;
+    float uExposure;
+    mat3 uKernel;
+};
+
+#if POE_MATERIAL_TABLE == 0
+layout (location = POE_UMATERIAL_AMBIENT_TEXTURE_LOC) uniform sampler2D uMaterialAmbientTexture;
+layout (location = POE_UMATERIAL_DIFFUSE_TEXTURE_LOC) uniform sampler2D uMaterialDiffuseTexture;
+layout (location = POE_UMATERIAL_SPECULAR_TEXTURE_LOC) uniform sampler2D uMaterialSpecularTexture;
+#endif
+
+layout (location = POE_UAMBIENT_FACTOR_LOC) uniform float uAmbientFactor;
+
+layout (location = 0) out vec4 gAlbedo;   // diffuse color, specular intensity
+layout (location = 1) out vec2 gNormal;   // octahedral view space normal
+layout (location = 2) out vec2 gMaterial; // encoded shininess, occlusion
+layout (location = 3) out vec4 gLight;    // ambient term, lights are added on top
+
+void main()
+{
+#if POE_MATERIAL_TABLE == 0
+    vec4 _ambientTexColor = texture(uMaterialAmbientTexture, fs_in.vTexCoord);
+    vec4 _diffuseTexColor = texture(uMaterialDiffuseTexture, fs_in.vTexCoord);
+    vec4 _specularTexColor = texture(uMaterialSpecularTexture, fs_in.vTexCoord);
+#else
+    vec4 _ambientTexColor = SampleMaterial(fs_in.vMaterialIndex, MATERIAL_SLOT_AMBIENT, fs_in.vTexCoord);
+    vec4 _diffuseTexColor = SampleMaterial(fs_in.vMaterialIndex, MATERIAL_SLOT_DIFFUSE, fs_in.vTexCoord);
+    vec4 _specularTexColor = SampleMaterial(fs_in.vMaterialIndex, MATERIAL_SLOT_SPECULAR, fs_in.vTexCoord);
+#endif
+
+    if (_diffuseTexColor.a < 0.01f) discard;
+
+#ifdef GAMMA_INCLUDED
+    vec3 ambientTexColor = FixGamma(uGamma, _ambientTexColor).rgb;
+    vec3 diffuseTexColor = FixGamma(uGamma, _diffuseTexColor).rgb;
+    vec3 specularTexColor = FixGamma(uGamma, _specularTexColor).rgb;
+#else
+    vec3 ambientTexColor = _ambientTexColor.rgb;
+    vec3 diffuseTexColor = _diffuseTexColor.rgb;
+    vec3 specularTexColor = _specularTexColor.rgb;
+#endif
+
+    gAlbedo.rgb = diffuseTexColor * uMaterialDiffuse;
+    gAlbedo.a = dot(specularTexColor * uMaterialSpecular, vec3(0.2126f, 0.7152f, 0.0722f));
+    gNormal = EncodeNormal(normalize(fs_in.vNorm));
+    gMaterial = vec2(EncodeShininess(uMaterialShininess), 1.0f);
+
+    gLight = vec4(uAmbientFactor * ambientTexColor * uMaterialAmbient, 1.0f);
+#ifdef FOG_INCLUDED
+    gLight.rgb = ApplyFog(gLight.rgb, fs_in.vFragPos);
+#endif
+}
+
+#endif
@@ -0,0 +1,206 @@
+#ifndef NUM_DIR_LIGHTS
+#define NUM_DIR_LIGHTS 2
+#endif
+
+#ifndef NUM_POINT_LIGHTS
+#define NUM_POINT_LIGHTS 4
+#endif
+
+#ifndef NUM_SPOT_LIGHTS
+#define NUM_SPOT_LIGHTS 4
+#endif
+
+#ifndef NUM_CASCADES
+#define NUM_CASCADES 4
+#endif
+
+#ifdef POE_VERTEX_SHADER
+
+////////////////////////////////////////
+//////////// VERTEX SHADER /////////////
+////////////////////////////////////////
+
+#if POE_LIGHT_VOLUME == 0
+
+// covers the screen with a single triangle
+void main()
+{
+    vec2 pos = vec2(float((gl_VertexID & 1) << 2) - 1.0f, float((gl_VertexID & 2) << 1) - 1.0f);
+    gl_Position = vec4(pos, 0.0f, 1.0f);
+}
+
+#else
+
+#define PI 3.14159265f
+
+layout (std140, binding = POE_TRANSFORM_BLOCK_LOC) uniform TransformBlock
+{
+    mat4 uProjection;
+    mat4 uView;
+    mat4 uProjView;
+    vec3 uCamDir;
+};
+
+layout (location = POE_UVOLUME_SPHERE_LOC) uniform vec4 uVolumeSphere; // view space
+
+// POE_SPHERE_SEGMENTS * POE_SPHERE_RINGS quads, counter-clockwise seen from outside
+void main()
+{
+    const ivec2 corners[6] = ivec2[](ivec2(0, 0), ivec2(1, 0), ivec2(1, 1),
+                                     ivec2(1, 1), ivec2(0, 1), ivec2(0, 0));
+    int quad = gl_VertexID / 6;
+    ivec2 corner = ivec2(quad % POE_SPHERE_SEGMENTS, quad / POE_SPHERE_SEGMENTS) + corners[gl_VertexID % 6];
+
+    float phi = float(corner.x) / float(POE_SPHERE_SEGMENTS) * 2.0f * PI;
+    float theta = float(corner.y) / float(POE_SPHERE_RINGS) * PI;
+    vec3 dir = vec3(sin(theta) * cos(phi), cos(theta), sin(theta) * sin(phi));
+
+    // pushes the flat faces out so that the mesh encloses the sphere
+    float enclose = 1.0f / (cos(PI / float(POE_SPHERE_SEGMENTS)) * cos(PI / float(2 * POE_SPHERE_RINGS)));
+    gl_Position = uProjection * vec4(uVolumeSphere.xyz + dir * uVolumeSphere.w * enclose, 1.0f);
+}
+
+#endif
+
+#elif defined(POE_FRAGMENT_SHADER)
+
+////////////////////////////////////////
+//////////// FRAGMENT SHADER ///////////
+////////////////////////////////////////
+
+#if POE_LIGHT_TYPE == 3
+
+// stencil marking only, color writes are masked
+void main() {}
+
+#else
+
+#ifndef SHADOW_BIAS_MIN
+#define SHADOW_BIAS_MIN 0.01f
+#endif
+
+#ifndef SHADOW_BIAS_MAX
+#define SHADOW_BIAS_MAX 0.1f
+#endif
+
+#ifndef POINT_SHADOW_BIAS
+#define POINT_SHADOW_BIAS 0.005f
+#endif
+
+layout (std140, binding = POE_DIR_LIGHT_BLOCK_LOC) uniform DirLightBlock
+{
+    DirLight_t uDirLights[NUM_DIR_LIGHTS];
+};
+
+layout (std140, binding = POE_POINT_LIGHT_BLOCK_LOC) uniform PointLightBlock
+{
+    PointLight_t uPointLights[NUM_POINT_LIGHTS];
+};
+
+layout (std140, binding = POE_SPOT_LIGHT_BLOCK_LOC) uniform SpotLightBlock
+{
+    SpotLight_t uSpotLights[NUM_SPOT_LIGHTS];
+};
+
+layout (location = POE_UALBEDO_TEXTURE_LOC) uniform sampler2D uAlbedoTexture;
+layout (location = POE_UNORMAL_TEXTURE_LOC) uniform sampler2D uNormalTexture;
+layout (location = POE_UMATERIAL_TEXTURE_LOC) uniform sampler2D uMaterialTexture;
+layout (location = POE_UDEPTH_TEXTURE_LOC) uniform sampler2D uDepthTexture;
+
+layout (location = POE_UINVERSE_PROJECTION_LOC) uniform mat4 uInverseProjection;
+layout (location = POE_UINVERSE_VIEW_LOC) uniform mat4 uInverseView;
+layout (location = POE_ULIGHT_INDEX_LOC) uniform int uLightIndex;
+
+struct Surface
+{
+    vec3 position; // view space
+    vec3 worldPosition;
+    vec3 normal;
+    vec3 viewDir;
+    vec3 diffuse;
+    float specular;
+    float shininess;
+};
+
+////////////////////////////////////////
+bool FetchSurface(out Surface s)
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(uDepthTexture, texel, 0).r;
+    if (depth >= 1.0f)
+        return false;
+
+    vec2 uv = gl_FragCoord.xy / vec2(textureSize(uDepthTexture, 0));
+    vec4 pos = uInverseProjection * vec4(vec3(uv, depth) * 2.0f - 1.0f, 1.0f);
+    s.position = pos.xyz / pos.w;
+    s.worldPosition = vec3(uInverseView * vec4(s.position, 1.0f));
+    s.viewDir = normalize(-s.position);
+
+    vec4 albedo = texelFetch(uAlbedoTexture, texel, 0);
+    s.diffuse = albedo.rgb;
+    s.specular = albedo.a;
+    s.normal = DecodeNormal(texelFetch(uNormalTexture, texel, 0).rg);
+    s.shininess = DecodeShininess(texelFetch(uMaterialTexture, texel, 0).r);
+    return true;
+}
+
+////////////////////////////////////////
+vec3 ShadeSurface(Surface s, vec3 lightDir, vec3 lightColor)
+{
+    float diff = max(dot(s.normal, lightDir), 0.0f);
+    vec3 halfwayDir = normalize(lightDir + s.viewDir);
+    float spec = pow(max(dot(s.normal, halfwayDir), 0.0f), s.shininess);
+    return lightColor * (diff * s.diffuse + spec * s.specular);
+}
+
+////////////////////////////////////////
+float ComputeAttenuation(float dist, float constant, float linear, float quadratic)
+{
+    return 1.0f / (constant + dist * linear + dist * dist * quadratic);
+}
+
+out vec4 color;
+void main()
+{
+    Surface s;
+    if (!FetchSurface(s))
+        discard;
+
+    color = vec4(0.0f);
+
+#if POE_LIGHT_TYPE == 0
+    for (int i = 0; i < NUM_DIR_LIGHTS; ++i)
+    {
+        vec3 lightDir = normalize(-uDirLights[i].direction);
+        int layer = ChooseCascade(length(s.position), uDirLights[i].cascadeRanges);
+        vec4 lightSpacePos = uDirLights[i].lightSpace[layer] * vec4(s.worldPosition, 1.0f);
+        float shadowComp = ComputeShadowForDirLights(lightSpacePos, s.normal, lightDir, layer, uDirLights[i].farPlane, uDirLights[i].cascadeRanges);
+        color.rgb += shadowComp * uDirLights[i].intensity * ShadeSurface(s, lightDir, uDirLights[i].color);
+    }
+#elif POE_LIGHT_TYPE == 1
+    PointLight_t light = uPointLights[uLightIndex];
+    vec3 toLight = light.viewPosition - s.position;
+    float dist = length(toLight);
+    float shadowComp = ComputeShadowForPointLights(light.worldPosition, s.worldPosition, light.farPlane);
+    color.rgb = shadowComp * light.intensity * ComputeAttenuation(dist, light.constant, light.linear, light.quadratic)
+              * ShadeSurface(s, toLight / dist, light.color);
+#elif POE_LIGHT_TYPE == 2
+    SpotLight_t light = uSpotLights[uLightIndex];
+    vec3 toLight = light.position - s.position;
+    float dist = length(toLight);
+    vec3 lightDir = toLight / dist;
+    float theta = dot(lightDir, normalize(-light.direction));
+    float cone = clamp((theta - light.outerCutoff) / (light.innerCutoff - light.outerCutoff), 0.0f, 1.0f);
+    float shadowComp = ComputeShadowForSpotLights(light.lightSpace * vec4(s.worldPosition, 1.0f));
+    color.rgb = shadowComp * cone * light.intensity * ComputeAttenuation(dist, light.constant, light.linear, light.quadratic)
+              * ShadeSurface(s, lightDir, light.color);
+#endif
+
+#ifdef FOG_INCLUDED
+    // the ambient term was mixed with the fog color in the geometry pass
+    color.rgb *= 1.0f - ComputeFogFactor(s.position);
+#endif
+}
+
+#endif
+#endif
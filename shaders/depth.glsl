@@ -1,12 +1,28 @@
 #ifdef POE_VERTEX_SHADER
 
+#if POE_LAYERED == 2
+#extension GL_ARB_shader_viewport_layer_array : require
+#endif
+
 ////////////////////////////////////////
 //////////// VERTEX SHADER /////////////
 ////////////////////////////////////////
 
 layout (location = POE_APOS_LOC) in vec3 aPos;
 
-layout (location = POE_ULIGHT_MATRIX_LOC) uniform mat4 uLightMatrix;
+// vertex_decode.glsl inlined: the #extension above has to precede every declaration
+layout (std140, binding = POE_VERTEX_DECODE_BLOCK_LOC) uniform VertexDecodeBlock
+{
+    vec4 uPosScale;
+    vec4 uPosOffset;
+};
+
+#if POE_LAYERED == 0
+    layout (location = POE_ULIGHT_MATRIX_LOC) uniform mat4 uLightMatrix;
+#elif POE_LAYERED == 2
+    layout (location = POE_ULIGHT_MATRICES_LOC) uniform mat4 uLightMatrices[POE_NUM_LAYERS];
+    layout (location = POE_ULAYER_MASK_LOC) uniform uint uLayerMask;
+#endif
 
 #if POE_INSTANCED == 0
     layout (location = POE_UMODEL_LOC) uniform mat4 uModel;
@@ -16,7 +32,11 @@ layout (location = POE_ULIGHT_MATRIX_LOC) uniform mat4 uLightMatrix;
     layout (location = POE_AMODEL_LOC) in mat4 aModel;
 #endif
 
-#if POE_OMNI == 1
+// the forward shaders declare it too so that their positions match the prepass bit for bit
+// and the main pass can be tested with GL_EQUAL, see DepthPrepass
+invariant gl_Position;
+
+#if POE_OMNI == 1 && POE_LAYERED != 1
     out VS_OUT
     {
         vec3 vFragPos;
@@ -26,19 +46,69 @@ layout (location = POE_ULIGHT_MATRIX_LOC) uniform mat4 uLightMatrix;
 
 void main()
 {
+    vec4 localPos = vec4(aPos * uPosScale.xyz + uPosOffset.xyz, 1.0f);
 #if POE_INSTANCED == 0
-    gl_Position = uLightMatrix * uModel * vec4(aPos, 1.0f);
+    vec4 worldPos = uModel * localPos;
 #else
-    gl_Position = uLightMatrix * aModel * vec4(aPos, 1.0f);
+    vec4 worldPos = aModel * localPos;
+#endif
+
+#if POE_LAYERED == 0
+    gl_Position = uLightMatrix * worldPos;
+#elif POE_LAYERED == 1
+    // projected once per layer by the geometry shader
+    gl_Position = worldPos;
+#elif POE_LAYERED == 2
+    // each mesh is drawn with one instance per layer
+    gl_Layer = gl_InstanceID;
+    if ((uLayerMask & (1u << gl_InstanceID)) != 0u)
+        gl_Position = uLightMatrices[gl_InstanceID] * worldPos;
+    else
+        gl_Position = vec4(2.0f, 2.0f, 2.0f, 1.0f); // clipped away
 #endif
 
-#if POE_OMNI == 1 && POE_INSTANCED == 1
-    vs_out.vFragPos = vec3(aModel * vec4(aPos, 1.0f));
-#elif POE_OMNI == 1 && POE_INSTANCED == 0
-    vs_out.vFragPos = vec3(uModel * vec4(aPos, 1.0f));
+#if POE_OMNI == 1 && POE_LAYERED != 1
+    vs_out.vFragPos = vec3(worldPos);
 #endif
 }
 
+#elif defined(POE_GEOMETRY_SHADER)
+
+////////////////////////////////////////
+/////////// GEOMETRY SHADER ////////////
+////////////////////////////////////////
+
+layout (triangles, invocations = POE_NUM_LAYERS) in;
+layout (triangle_strip, max_vertices = 3) out;
+
+layout (location = POE_ULIGHT_MATRICES_LOC) uniform mat4 uLightMatrices[POE_NUM_LAYERS];
+layout (location = POE_ULAYER_MASK_LOC) uniform uint uLayerMask;
+
+#if POE_OMNI == 1
+    out VS_OUT
+    {
+        vec3 vFragPos;
+    }
+    gs_out;
+#endif
+
+void main()
+{
+    if ((uLayerMask & (1u << gl_InvocationID)) == 0u)
+        return;
+
+    for (int i = 0; i < 3; ++i)
+    {
+        gl_Layer = gl_InvocationID;
+        gl_Position = uLightMatrices[gl_InvocationID] * gl_in[i].gl_Position;
+#if POE_OMNI == 1
+        gs_out.vFragPos = vec3(gl_in[i].gl_Position);
+#endif
+        EmitVertex();
+    }
+    EndPrimitive();
+}
+
 #elif defined(POE_FRAGMENT_SHADER)
 
 ////////////////////////////////////////
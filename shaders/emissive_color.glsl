@@ -30,12 +30,14 @@ vs_out;
 
 void main(void)
 {
+    vec4 localPos = vec4(DecodePosition(aPos), 1.0f);
+
 #if POE_INSTANCED == 0
-    gl_Position = uProjView * uModel * vec4(aPos, 1.0f);
-    vs_out.vEyeSpace = vec3(uView * uModel * vec4(aPos, 1.0f));
+    gl_Position = uProjView * uModel * localPos;
+    vs_out.vEyeSpace = vec3(uView * uModel * localPos);
 #elif POE_INSTANCED == 1
-    gl_Position = uProjView * aModel * vec4(aPos, 1.0f);
-    vs_out.vEyeSpace = vec3(uView * aModel * vec4(aPos, 1.0f));
+    gl_Position = uProjView * aModel * localPos;
+    vs_out.vEyeSpace = vec3(uView * aModel * localPos);
 #endif
 }
 
@@ -53,7 +55,11 @@ fs_in;
 
 layout (location = POE_UCOLOR_LOC) uniform vec4 uColor;
 
+#ifdef WEIGHTED_BLENDED_INCLUDED
+vec4 color;
+#else
 out vec4 color;
+#endif
 void main(void)
 {
     color = uColor;
@@ -61,6 +67,10 @@ void main(void)
 #ifdef FOG_INCLUDED
     color.rgb = ApplyFog(uColor.rgb, fs_in.vEyeSpace);
 #endif
+
+#ifdef WEIGHTED_BLENDED_INCLUDED
+    WriteWeightedBlended(color, fs_in.vEyeSpace);
+#endif
 }
 
 #endif
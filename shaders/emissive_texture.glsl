@@ -27,19 +27,27 @@ out VS_OUT
 {
     vec3 vEyeSpace;
     vec2 vTexCoord;
+#if POE_MATERIAL_TABLE != 0
+    flat int vMaterialIndex;
+#endif
 }
 vs_out;
 
 void main(void)
 {
+    vec4 localPos = vec4(DecodePosition(aPos), 1.0f);
+
 #if POE_INSTANCED == 0
-    gl_Position = uProjView * uModel * vec4(aPos, 1.0f);
-    vs_out.vEyeSpace = vec3(uView * uModel * vec4(aPos, 1.0f));
+    gl_Position = uProjView * uModel * localPos;
+    vs_out.vEyeSpace = vec3(uView * uModel * localPos);
 #elif POE_INSTANCED == 1
-    gl_Position = uProjView * aModel * vec4(aPos, 1.0f);
-    vs_out.vEyeSpace = vec3(uView * aModel * vec4(aPos, 1.0f));
+    gl_Position = uProjView * aModel * localPos;
+    vs_out.vEyeSpace = vec3(uView * aModel * localPos);
 #endif
     vs_out.vTexCoord = aTexCoord;
+#if POE_MATERIAL_TABLE != 0
+    vs_out.vMaterialIndex = GetMaterialIndex();
+#endif
 }
 
 #elif defined(POE_FRAGMENT_SHADER)
@@ -52,10 +60,15 @@ in VS_OUT
 {
    vec3 vEyeSpace;
    vec2 vTexCoord;
+#if POE_MATERIAL_TABLE != 0
+   flat int vMaterialIndex;
+#endif
 }
 fs_in;
 
+#if POE_MATERIAL_TABLE == 0
 layout (location = POE_UEMISSIVE_TEXTURE_LOC) uniform sampler2D uEmissiveTexture;
+#endif
 layout (location = POE_UTILE_MULTIPLIER_LOC) uniform vec2 uTileMultiplier;
 layout (location = POE_UTILE_OFFSET_LOC) uniform vec2 uTileOffset;
 
@@ -71,7 +84,11 @@ layout (std140, binding = POE_POST_PROCESS_BLOCK_LOC) uniform PostProcessBlock
 out vec4 color;
 void main(void)
 {
+#if POE_MATERIAL_TABLE == 0
     vec4 texelColor = texture(uEmissiveTexture, fs_in.vTexCoord * uTileMultiplier + uTileOffset);
+#else
+    vec4 texelColor = SampleMaterial(fs_in.vMaterialIndex, MATERIAL_SLOT_AMBIENT, fs_in.vTexCoord * uTileMultiplier + uTileOffset);
+#endif
     if (texelColor.a < 0.01f) discard;
 
 #ifdef GAMMA_INCLUDED
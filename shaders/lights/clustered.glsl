@@ -0,0 +1,37 @@
+// light lists binned by ClusteredLightingStack, has to follow point.glsl and spot.glsl
+#if POE_CLUSTERED_LIGHTS == 1
+
+layout (std430, binding = POE_POINT_LIGHT_LIST_BLOCK_LOC) readonly buffer PointLightListBlock
+{
+    PointLight_t uPointLightList[];
+};
+
+layout (std430, binding = POE_SPOT_LIGHT_LIST_BLOCK_LOC) readonly buffer SpotLightListBlock
+{
+    SpotLight_t uSpotLightList[];
+};
+
+// x: offset into uLightIndices, y: point lights, z: spot lights
+layout (std430, binding = POE_LIGHT_CLUSTER_BLOCK_LOC) readonly buffer LightClusterBlock
+{
+    vec4 uClusterParams; // near, far, width, height
+    uvec4 uClusters[];
+};
+
+layout (std430, binding = POE_LIGHT_INDEX_BLOCK_LOC) readonly buffer LightIndexBlock
+{
+    uint uLightIndices[];
+};
+
+////////////////////////////////////////
+uvec4 GetLightCluster(float viewDepth)
+{
+    uvec2 tile = uvec2(clamp(gl_FragCoord.xy / uClusterParams.zw * vec2(POE_CLUSTER_GRID_X, POE_CLUSTER_GRID_Y),
+                             vec2(0.0f), vec2(POE_CLUSTER_GRID_X - 1, POE_CLUSTER_GRID_Y - 1)));
+    float slice = log(viewDepth / uClusterParams.x) / log(uClusterParams.y / uClusterParams.x) * float(POE_CLUSTER_GRID_Z);
+    uint z = uint(clamp(slice, 0.0f, float(POE_CLUSTER_GRID_Z - 1)));
+    return uClusters[tile.x + POE_CLUSTER_GRID_X * (tile.y + POE_CLUSTER_GRID_Y * z)];
+}
+
+#define CLUSTERED_LIGHTS_INCLUDED
+#endif
@@ -0,0 +1,84 @@
+// must be the first include: #extension directives have to
+// precede every non-preprocessor token of the shader
+#if POE_MATERIAL_TABLE != 0
+#extension GL_ARB_shader_draw_parameters : require
+#endif
+
+#if POE_MATERIAL_TABLE == 1
+#extension GL_ARB_bindless_texture : require
+#endif
+
+#if POE_MATERIAL_TABLE != 0
+
+#define MATERIAL_SLOT_AMBIENT 0
+#define MATERIAL_SLOT_DIFFUSE 1
+#define MATERIAL_SLOT_SPECULAR 2
+
+#ifdef POE_VERTEX_SHADER
+
+layout (std430, binding = POE_MATERIAL_INDEX_BLOCK_LOC) readonly buffer MaterialIndexBlock
+{
+    uint uMaterialIndices[];
+};
+
+////////////////////////////////////////
+int GetMaterialIndex()
+{
+    return int(uMaterialIndices[gl_DrawIDARB]);
+}
+
+#elif defined(POE_FRAGMENT_SHADER)
+
+struct Material_t
+{
+    uvec2 handles[3];
+    int arrays[3];
+    int layers[3];
+};
+
+layout (std430, binding = POE_MATERIAL_TABLE_BLOCK_LOC) readonly buffer MaterialTableBlock
+{
+    Material_t uMaterials[];
+};
+
+#if POE_MATERIAL_TABLE == 2
+layout (location = POE_UMATERIAL_TEXTURE_ARRAYS_LOC) uniform sampler2DArray uMaterialTextureArrays[POE_MAX_MATERIAL_TEXTURE_ARRAYS];
+
+////////////////////////////////////////
+vec4 SampleMaterialTextureArray(int array, vec3 texCoord)
+{
+    // constant indices keep the sampler access dynamically uniform
+    switch (array)
+    {
+        case 0: return texture(uMaterialTextureArrays[0], texCoord);
+        case 1: return texture(uMaterialTextureArrays[1], texCoord);
+        case 2: return texture(uMaterialTextureArrays[2], texCoord);
+        case 3: return texture(uMaterialTextureArrays[3], texCoord);
+        case 4: return texture(uMaterialTextureArrays[4], texCoord);
+        case 5: return texture(uMaterialTextureArrays[5], texCoord);
+        case 6: return texture(uMaterialTextureArrays[6], texCoord);
+        case 7: return texture(uMaterialTextureArrays[7], texCoord);
+    }
+    return vec4(0.0f, 0.0f, 0.0f, 1.0f);
+}
+#endif
+
+////////////////////////////////////////
+vec4 SampleMaterial(int materialIndex, int slot, vec2 texCoord)
+{
+#if POE_MATERIAL_TABLE == 1
+    uvec2 handle = uMaterials[materialIndex].handles[slot];
+    if (handle == uvec2(0))
+        return vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    return texture(sampler2D(handle), texCoord);
+#elif POE_MATERIAL_TABLE == 2
+    int array = uMaterials[materialIndex].arrays[slot];
+    int layer = uMaterials[materialIndex].layers[slot];
+    return SampleMaterialTextureArray(array, vec3(texCoord, float(layer)));
+#endif
+}
+
+#endif
+
+#define MATERIAL_TABLE_INCLUDED
+#endif
@@ -41,6 +41,10 @@ layout (std140, binding = 3) uniform DirLightBlock
     DirLight_t uDirLights[NUM_DIR_LIGHTS];
 };
 
+// AMBIENT_OCCLUSION_MAP_BIND_POINT, written by AmbientOcclusionStack
+layout (binding = 12) uniform sampler2D uAmbientOcclusionMap;
+layout (location = 1) uniform bool uHasAmbientOcclusion;
+
 vec3 FresnelSchlick(float cosTheta, vec3 F0)
 {
     return F0 + (1.0f - F0) * pow(clamp(1.0f - cosTheta, 0.0f, 1.0f), 5.0f);
@@ -122,7 +126,8 @@ void main(void)
 
         Lo += radiance * (diffuse + specular);
     }
-    vec3 ambient = vec3(0.03f) * uAlbedo * uAO;
+    float ambientOcclusion = uHasAmbientOcclusion ? texelFetch(uAmbientOcclusionMap, ivec2(gl_FragCoord.xy), 0).r : 1.0f;
+    vec3 ambient = vec3(0.03f) * uAlbedo * uAO * ambientOcclusion;
 
     color = vec4(Lo + ambient, 1.0f);
 }
@@ -12,8 +12,17 @@ layout (std140, binding = 1) uniform TransformBlock
     vec3 uCamDir;
 };
 
+layout (std140, binding = 9) uniform VertexDecodeBlock
+{
+    vec4 uPosScale;
+    vec4 uPosOffset;
+};
+
 layout (location = 0) uniform mat4 uModel;
 
+// invariant, see depth.glsl
+invariant gl_Position;
+
 out VS_OUT
 {
     vec2 vTexCoord;
@@ -23,9 +32,10 @@ out VS_OUT
 
 void main(void)
 {
-    gl_Position = uProjView * uModel * vec4(aPos, 1.0f);
+    vec4 localPos = vec4(aPos * uPosScale.xyz + uPosOffset.xyz, 1.0f);
+    gl_Position = uProjView * (uModel * localPos);
 
     vs_out.vTexCoord = aTexCoord;
-    vs_out.vViewPos = vec3(uView * uModel * vec4(aPos, 1.0f));
+    vs_out.vViewPos = vec3(uView * uModel * localPos);
     vs_out.vNormal = vec3(uView  * uModel * vec4(aNormal, 0.0f));
 }
@@ -0,0 +1,88 @@
+#ifdef POE_COMPUTE_SHADER
+
+////////////////////////////////////////
+//////////// COMPUTE SHADER ////////////
+////////////////////////////////////////
+
+// POE_BLOOM_PASS 0: thresholds the resolved scene into the top level of the half resolution chain
+// POE_BLOOM_PASS 1: filters a level into the next smaller one
+// POE_BLOOM_PASS 2: adds the tent filtered smaller level to a level of the downsampled chain
+// every level is only valid in its lower left corner, see PostProcessStack::SetRenderScale
+
+layout (local_size_x = POE_WORK_GROUP_SIZE, local_size_y = POE_WORK_GROUP_SIZE) in;
+
+layout (location = POE_UOUTPUT_IMAGE_LOC, rgba16f) uniform writeonly image2D uOutputImage;
+layout (location = POE_UOUTPUT_REGION_LOC) uniform ivec2 uOutputRegion;
+
+#if POE_BLOOM_PASS == 0
+    layout (location = POE_UBLOOM_THRESHOLD_LOC) uniform vec2 uBloomThreshold; // threshold and knee
+#else
+    layout (location = POE_USOURCE_TEXTURE_LOC) uniform sampler2D uSourceTexture;
+    layout (location = POE_USOURCE_LEVEL_LOC) uniform int uSourceLevel;
+    layout (location = POE_USOURCE_UV_MAX_LOC) uniform vec2 uSourceUvMax; // of the sampled level
+#endif
+
+#if POE_BLOOM_PASS == 2
+    layout (location = POE_UUPSAMPLE_TEXTURE_LOC) uniform sampler2D uUpsampleTexture;
+    layout (location = POE_UBLOOM_RADIUS_LOC) uniform float uBloomRadius;
+#endif
+
+#if POE_BLOOM_PASS == 0
+////////////////////////////////////////
+// quadratic knee below the threshold avoids hard edges around bright spots
+vec3 ApplyThreshold(vec3 col)
+{
+    float brightness = max(col.r, max(col.g, col.b));
+    float knee = max(uBloomThreshold.y, 1e-4f);
+    float soft = clamp(brightness - uBloomThreshold.x + knee, 0.0f, 2.0f * knee);
+    soft = soft * soft / (4.0f * knee);
+    return col * (max(soft, brightness - uBloomThreshold.x) / max(brightness, 1e-4f));
+}
+#endif
+
+#if POE_BLOOM_PASS != 0
+////////////////////////////////////////
+// keeps the bilinear taps off the invalid part of the level
+vec3 SampleLevel(sampler2D tex, vec2 uv, int level)
+{
+    vec2 halfTexel = 0.5f / vec2(textureSize(tex, level));
+    return textureLod(tex, clamp(uv, halfTexel, uSourceUvMax - halfTexel), float(level)).rgb;
+}
+#endif
+
+void main()
+{
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 size = imageSize(uOutputImage);
+    if (any(greaterThanEqual(texel, uOutputRegion)))
+        return;
+
+#if POE_BLOOM_PASS == 0
+    ivec2 sceneTexel = texel * 2;
+    vec3 color = 0.25f * (ResolveScene(sceneTexel) +
+                          ResolveScene(sceneTexel + ivec2(1, 0)) +
+                          ResolveScene(sceneTexel + ivec2(0, 1)) +
+                          ResolveScene(sceneTexel + ivec2(1, 1)));
+    color = ApplyThreshold(color);
+#elif POE_BLOOM_PASS == 1
+    // four bilinear taps cover the 4x4 source texels around the target texel
+    vec2 uv = (vec2(texel) + 0.5f) / vec2(size);
+    vec2 texelSize = 1.0f / vec2(textureSize(uSourceTexture, uSourceLevel));
+    vec3 color = 0.25f * (SampleLevel(uSourceTexture, uv + texelSize * vec2(-1.0f, -1.0f), uSourceLevel) +
+                          SampleLevel(uSourceTexture, uv + texelSize * vec2( 1.0f, -1.0f), uSourceLevel) +
+                          SampleLevel(uSourceTexture, uv + texelSize * vec2(-1.0f,  1.0f), uSourceLevel) +
+                          SampleLevel(uSourceTexture, uv + texelSize * vec2( 1.0f,  1.0f), uSourceLevel));
+#else
+    vec2 uv = (vec2(texel) + 0.5f) / vec2(size);
+    vec2 offset = uBloomRadius / vec2(size);
+    vec3 upsampled = vec3(0.0f);
+    for (int x = -1; x <= 1; ++x)
+        for (int y = -1; y <= 1; ++y)
+            upsampled += SampleLevel(uUpsampleTexture, uv + offset * vec2(x, y), uSourceLevel + 1) * float((2 - abs(x)) * (2 - abs(y)));
+    vec3 color = texelFetch(uSourceTexture, texel, uSourceLevel).rgb + upsampled / 16.0f;
+#endif
+
+    imageStore(uOutputImage, texel, vec4(color, 1.0f));
+}
+
+#endif
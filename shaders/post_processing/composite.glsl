@@ -0,0 +1,83 @@
+#ifdef POE_COMPUTE_SHADER
+
+////////////////////////////////////////
+//////////// COMPUTE SHADER ////////////
+////////////////////////////////////////
+
+// resolve, 3x3 kernel, bloom, grayscale, exposure and gamma in one pass,
+// mirrors the fragment shader of post_process.glsl
+
+layout (local_size_x = POE_WORK_GROUP_SIZE, local_size_y = POE_WORK_GROUP_SIZE) in;
+
+layout (location = POE_UBLOOM_TEXTURE_LOC) uniform sampler2D uBloomTexture;
+layout (location = POE_UBLOOM_INTENSITY_LOC) uniform float uBloomIntensity;
+layout (location = POE_UBLOOM_UV_SCALE_LOC) uniform vec2 uBloomUvScale; // the part of the bloom texture covering the scene
+layout (location = POE_UOUTPUT_IMAGE_LOC, rgba8) uniform writeonly image2D uOutputImage;
+
+layout (std140, binding = POE_POST_PROCESS_BLOCK_LOC) uniform PostProcessBlock
+{
+    float uGrayscaleWeight;
+    float uKernelWeight;
+    float uGamma;
+    float uExposure;
+    mat3 uKernel;
+};
+
+const int TILE_SIZE = POE_WORK_GROUP_SIZE + 2;
+
+// resolved texels of the work group and a one texel border for the kernel
+shared vec3 sTile[TILE_SIZE][TILE_SIZE];
+
+////////////////////////////////////////
+vec3 ApplyGrayscale(vec3 col)
+{
+    float avg = 0.2126f * col.r + 0.7152f * col.g + 0.0722f * col.b;
+    return vec3(avg);
+}
+
+////////////////////////////////////////
+vec3 ApplyKernel(ivec2 local)
+{
+    vec3 res = vec3(0.0f);
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            res += sTile[local.y + 1 - j][local.x + i - 1] * uKernel[i][j];
+    return res;
+}
+
+////////////////////////////////////////
+vec3 ApplyExposure(vec3 col)
+{
+    return vec3(1.0f) - exp(-col * uExposure);
+}
+
+void main()
+{
+    ivec2 tileOrigin = ivec2(gl_WorkGroupID.xy) * POE_WORK_GROUP_SIZE - 1;
+    for (int i = int(gl_LocalInvocationIndex); i < TILE_SIZE * TILE_SIZE; i += POE_WORK_GROUP_SIZE * POE_WORK_GROUP_SIZE)
+    {
+        ivec2 tileTexel = ivec2(i % TILE_SIZE, i / TILE_SIZE);
+        sTile[tileTexel.y][tileTexel.x] = ResolveScene(tileOrigin + tileTexel);
+    }
+    barrier();
+
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 size = uSceneSize;
+    if (any(greaterThanEqual(texel, size)))
+        return;
+
+    ivec2 local = ivec2(gl_LocalInvocationID.xy) + 1;
+    vec3 color = mix(sTile[local.y][local.x], ApplyKernel(local), uKernelWeight);
+    if (uBloomIntensity > 0.0f) {
+        color += uBloomIntensity * textureLod(uBloomTexture, (vec2(texel) + 0.5f) / vec2(size) * uBloomUvScale, 0.0f).rgb;
+    }
+    color = mix(color, ApplyGrayscale(color), uGrayscaleWeight);
+    color = ApplyExposure(color);
+
+#ifdef GAMMA_INCLUDED
+    color = GammaCorrect(color, uGamma);
+#endif
+    imageStore(uOutputImage, texel, vec4(color, 1.0f));
+}
+
+#endif
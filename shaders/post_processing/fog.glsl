@@ -5,9 +5,14 @@ layout (std140, binding = POE_FOG_BLOCK_LOC) uniform FogBlock
     float uFogExp;
 };
 
+float ComputeFogFactor(vec3 eyeSpace)
+{
+    return clamp(pow(length(eyeSpace) / uFogDistance, uFogExp), 0.0f, 1.0f);
+}
+
 vec3 ApplyFog(vec3 inColor, vec3 eyeSpace)
 {
-    return mix(inColor, uFogColor.rgb, clamp(pow(length(eyeSpace) / uFogDistance, uFogExp), 0.0f, 1.0f));
+    return mix(inColor, uFogColor.rgb, ComputeFogFactor(eyeSpace));
 }
 
 #define FOG_INCLUDED
@@ -0,0 +1,25 @@
+#if POE_NUM_SAMPLES > 1
+    layout (location = POE_USCENE_TEXTURE_LOC) uniform sampler2DMS uSceneTexture;
+#else
+    layout (location = POE_USCENE_TEXTURE_LOC) uniform sampler2D uSceneTexture;
+#endif
+
+// the scene covers the lower left corner of the texture, see PostProcessStack::SetRenderScale
+layout (location = POE_USCENE_SIZE_LOC) uniform ivec2 uSceneSize;
+
+////////////////////////////////////////
+// average of the samples of a texel, replaces the blit resolve; clamps to the edges
+vec3 ResolveScene(ivec2 texel)
+{
+    texel = clamp(texel, ivec2(0), uSceneSize - 1);
+#if POE_NUM_SAMPLES > 1
+    vec3 sum = vec3(0.0f);
+    for (int i = 0; i < POE_NUM_SAMPLES; ++i)
+        sum += texelFetch(uSceneTexture, texel, i).rgb;
+    return sum / float(POE_NUM_SAMPLES);
+#else
+    return texelFetch(uSceneTexture, texel, 0).rgb;
+#endif
+}
+
+#define RESOLVE_INCLUDED
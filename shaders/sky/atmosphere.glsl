@@ -0,0 +1,89 @@
+#ifndef PI
+#define PI 3.1415926f
+#endif
+
+layout (std140, binding = POE_REALISTIC_SKYBOX_BLOCK_LOC) uniform RealisticSkyboxBlock
+{
+    vec3 uRayleighScatteringCoefficent;
+    vec3 uRayOrigin;
+    vec3 uSunPosition;
+    float uSunIntensity;
+    float uPlanetRadius;
+    float uAtmosphereRadius;
+    float uMieScatteringCoefficient;
+    float uRayleighScaleHeight;
+    float uMieScaleHeight;
+    float uMiePreferredScatteringDirection;
+};
+
+////////////////////////////////////////
+// ray-sphere intersection where the sphere is at origin
+vec2 RSI(vec3 r0, vec3 rd, float sr)
+{
+    float a = dot(rd, rd);
+    float b = 2.0f * dot(rd, r0);
+    float c = dot(r0, r0) - (sr * sr);
+    float d = (b * b) - 4.0f * a * c;
+    if (d < 0.0f) {
+        return vec2(1e5, -1e5);
+    }
+    return vec2((-b - sqrt(d)) / (2.0f * a),
+                (-b + sqrt(d)) / (2.0f * a));
+}
+
+////////////////////////////////////////
+// distance to the ground along rd, negative if the ground isn't hit
+float GroundDistance(vec3 r0, vec3 rd)
+{
+    vec2 p = RSI(r0, rd, uPlanetRadius);
+    return (p.x <= p.y && p.x > 0.0f) ? p.x : -1.0f;
+}
+
+////////////////////////////////////////
+// Rayleigh and Mie densities at the given height above the ground
+vec2 AtmosphereDensity(float height)
+{
+    return exp(-height / vec2(uRayleighScaleHeight, uMieScaleHeight));
+}
+
+////////////////////////////////////////
+// the model doesn't absorb, so scattering and extinction coincide
+vec3 AtmosphereScattering(vec2 density)
+{
+    return uRayleighScatteringCoefficent * density.x + uMieScatteringCoefficient * density.y;
+}
+
+////////////////////////////////////////
+// both LUTs are indexed by the cosine of the sun's zenith angle and
+// the height above the ground, the sqrt spends more texels near the ground
+vec2 AtmosphereLutUv(float height, float cosZenith)
+{
+    float atmosphereHeight = uAtmosphereRadius - uPlanetRadius;
+    return vec2(cosZenith * 0.5f + 0.5f, sqrt(clamp(height / atmosphereHeight, 0.0f, 1.0f)));
+}
+
+////////////////////////////////////////
+vec2 AtmosphereLutUv(vec3 pos, vec3 sunDir)
+{
+    float r = length(pos);
+    return AtmosphereLutUv(r - uPlanetRadius, dot(pos / r, sunDir));
+}
+
+////////////////////////////////////////
+// inverse of AtmosphereLutUv, returns the height and the cosine
+vec2 AtmosphereLutParams(vec2 uv)
+{
+    float atmosphereHeight = uAtmosphereRadius - uPlanetRadius;
+    return vec2(uv.y * uv.y * atmosphereHeight, uv.x * 2.0f - 1.0f);
+}
+
+////////////////////////////////////////
+// the point and the sun direction a LUT texel stands for
+void AtmosphereLutTexel(ivec2 texel, ivec2 size, out vec3 pos, out vec3 sunDir)
+{
+    vec2 params = AtmosphereLutParams((vec2(texel) + 0.5f) / vec2(size));
+    pos = vec3(0.0f, uPlanetRadius + params.x, 0.0f);
+    sunDir = vec3(sqrt(max(1.0f - params.y * params.y, 0.0f)), params.y, 0.0f);
+}
+
+#define ATMOSPHERE_INCLUDED
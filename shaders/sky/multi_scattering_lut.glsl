@@ -0,0 +1,70 @@
+#ifdef POE_COMPUTE_SHADER
+
+////////////////////////////////////////
+//////////// COMPUTE SHADER ////////////
+////////////////////////////////////////
+
+// Hillaire, "A Scalable and Production Ready Sky and Atmosphere Rendering Technique":
+// the light reaching a point after any number of isotropic bounces is the second order
+// scattering times the geometric series of the fraction transferred by each bounce
+
+layout (local_size_x = POE_WORK_GROUP_SIZE, local_size_y = POE_WORK_GROUP_SIZE) in;
+
+layout (location = POE_UOUTPUT_IMAGE_LOC, rgba16f) uniform writeonly image2D uOutputImage;
+layout (location = POE_UTRANSMITTANCE_LUT_LOC) uniform sampler2D uTransmittanceLut;
+
+void main()
+{
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 size = imageSize(uOutputImage);
+    if (any(greaterThanEqual(texel, size)))
+        return;
+
+    vec3 pos, sunDir;
+    AtmosphereLutTexel(texel, size, pos, sunDir);
+
+    const float isotropicPhase = 1.0f / (4.0f * PI);
+
+    vec3 secondOrder = vec3(0.0f);
+    vec3 transferred = vec3(0.0f);
+    for (int i = 0; i < POE_SQRT_SAMPLES; ++i)
+    {
+        for (int j = 0; j < POE_SQRT_SAMPLES; ++j)
+        {
+            // directions spread uniformly over the sphere
+            float cosTheta = 1.0f - 2.0f * (float(i) + 0.5f) / float(POE_SQRT_SAMPLES);
+            float sinTheta = sqrt(max(1.0f - cosTheta * cosTheta, 0.0f));
+            float phi = 2.0f * PI * (float(j) + 0.5f) / float(POE_SQRT_SAMPLES);
+            vec3 dir = vec3(sinTheta * cos(phi), cosTheta, sinTheta * sin(phi));
+
+            float groundDistance = GroundDistance(pos, dir);
+            float rayLength = groundDistance > 0.0f ? groundDistance : RSI(pos, dir, uAtmosphereRadius).y;
+            float stepSize = rayLength / float(POE_STEPS);
+
+            vec3 throughput = vec3(1.0f);
+            for (int k = 0; k < POE_STEPS; ++k)
+            {
+                vec3 samplePos = pos + dir * ((float(k) + 0.5f) * stepSize);
+                vec3 scattering = AtmosphereScattering(AtmosphereDensity(length(samplePos) - uPlanetRadius));
+                vec3 sampleTransmittance = exp(-scattering * stepSize);
+
+                // scattering integrated over the step, extinction equals scattering
+                vec3 scattered = throughput * (1.0f - sampleTransmittance);
+                vec3 sunTransmittance = texture(uTransmittanceLut, AtmosphereLutUv(samplePos, sunDir)).rgb;
+
+                secondOrder += scattered * sunTransmittance * isotropicPhase;
+                transferred += scattered;
+                throughput *= sampleTransmittance;
+            }
+        }
+    }
+
+    const float numSamples = float(POE_SQRT_SAMPLES * POE_SQRT_SAMPLES);
+    secondOrder /= numSamples;
+    transferred /= numSamples;
+
+    vec3 multiScattering = secondOrder / max(1.0f - transferred, vec3(1e-4));
+    imageStore(uOutputImage, texel, vec4(multiScattering, 1.0f));
+}
+
+#endif
@@ -0,0 +1,94 @@
+#ifdef POE_COMPUTE_SHADER
+
+////////////////////////////////////////
+//////////// COMPUTE SHADER ////////////
+////////////////////////////////////////
+
+#ifndef I_STEPS
+#define I_STEPS 16
+#endif
+
+layout (local_size_x = POE_WORK_GROUP_SIZE, local_size_y = POE_WORK_GROUP_SIZE) in;
+
+layout (location = POE_UOUTPUT_IMAGE_LOC, rgba16f) uniform writeonly imageCube uOutputImage;
+layout (location = POE_UTRANSMITTANCE_LUT_LOC) uniform sampler2D uTransmittanceLut;
+layout (location = POE_UMULTI_SCATTERING_LUT_LOC) uniform sampler2D uMultiScatteringLut;
+
+////////////////////////////////////////
+// direction through the center of a texel, faces are ordered +X, -X, +Y, -Y, +Z, -Z
+vec3 CubemapDirection(ivec3 texel, int size)
+{
+    vec2 uv = (vec2(texel.xy) + 0.5f) / float(size) * 2.0f - 1.0f;
+    switch (texel.z) {
+        case 0:  return vec3( 1.0f, -uv.y, -uv.x);
+        case 1:  return vec3(-1.0f, -uv.y,  uv.x);
+        case 2:  return vec3( uv.x,  1.0f,  uv.y);
+        case 3:  return vec3( uv.x, -1.0f, -uv.y);
+        case 4:  return vec3( uv.x, -uv.y,  1.0f);
+        default: return vec3(-uv.x, -uv.y, -1.0f);
+    }
+}
+
+////////////////////////////////////////
+// single scattering towards the sun is looked up in the transmittance LUT
+// instead of marching a secondary ray, higher orders come from the multi-scattering LUT
+vec3 Atmosphere(vec3 r)
+{
+    vec3 r0 = uRayOrigin;
+    vec3 pSun = normalize(uSunPosition);
+
+    vec2 p = RSI(r0, r, uAtmosphereRadius);
+    if (p.x > p.y || p.y < 0.0f) {
+        return vec3(0.0f);
+    }
+    float groundDistance = GroundDistance(r0, r);
+    float iStart = max(p.x, 0.0f);
+    float iEnd = groundDistance > 0.0f ? groundDistance : p.y;
+    float iStepSize = (iEnd - iStart) / float(I_STEPS);
+
+    // Rayleigh & Mie phases
+    float mu = dot(r, pSun);
+    float mumu = mu * mu;
+    float g = uMiePreferredScatteringDirection;
+    float gg = g * g;
+    float pRlh = 3.0f / (16.0f * PI) * (1.0f + mumu);
+    float pMie = 3.0f / (8.0f * PI) * ((1.0f - gg) * (mumu + 1.0f)) / (pow(1.0f + gg - 2.0f * mu * g, 1.5f) * (2.0f + gg));
+
+    vec3 radiance = vec3(0.0f);
+    vec3 throughput = vec3(1.0f);
+    for (int i = 0; i < I_STEPS; ++i)
+    {
+        vec3 iPos = r0 + r * (iStart + (float(i) + 0.5f) * iStepSize);
+        vec2 density = AtmosphereDensity(length(iPos) - uPlanetRadius);
+
+        vec3 scatteringRlh = uRayleighScatteringCoefficent * density.x;
+        float scatteringMie = uMieScatteringCoefficient * density.y;
+        vec3 extinction = max(scatteringRlh + scatteringMie, vec3(1e-20));
+        vec3 sampleTransmittance = exp(-extinction * iStepSize);
+
+        vec2 lutUv = AtmosphereLutUv(iPos, pSun);
+        vec3 sunTransmittance = texture(uTransmittanceLut, lutUv).rgb;
+        vec3 multiScattering = texture(uMultiScatteringLut, lutUv).rgb;
+
+        vec3 inScattering = (scatteringRlh * pRlh + scatteringMie * pMie) * sunTransmittance +
+                            (scatteringRlh + scatteringMie) * multiScattering;
+
+        // integrated analytically over the step
+        radiance += throughput * inScattering * (1.0f - sampleTransmittance) / extinction;
+        throughput *= sampleTransmittance;
+    }
+    return uSunIntensity * radiance;
+}
+
+void main()
+{
+    ivec3 texel = ivec3(gl_GlobalInvocationID);
+    int size = imageSize(uOutputImage).x;
+    if (texel.x >= size || texel.y >= size)
+        return;
+
+    vec3 color = Atmosphere(normalize(CubemapDirection(texel, size)));
+    imageStore(uOutputImage, texel, vec4(color, 1.0f));
+}
+
+#endif
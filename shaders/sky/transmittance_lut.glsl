@@ -0,0 +1,45 @@
+#ifdef POE_COMPUTE_SHADER
+
+////////////////////////////////////////
+//////////// COMPUTE SHADER ////////////
+////////////////////////////////////////
+
+#ifndef J_STEPS
+#define J_STEPS 40
+#endif
+
+layout (local_size_x = POE_WORK_GROUP_SIZE, local_size_y = POE_WORK_GROUP_SIZE) in;
+
+layout (location = POE_UOUTPUT_IMAGE_LOC, rgba16f) uniform writeonly image2D uOutputImage;
+
+////////////////////////////////////////
+// transmittance from pos to the top of the atmosphere along dir
+vec3 Transmittance(vec3 pos, vec3 dir)
+{
+    if (GroundDistance(pos, dir) > 0.0f) {
+        return vec3(0.0f);
+    }
+
+    float stepSize = RSI(pos, dir, uAtmosphereRadius).y / float(J_STEPS);
+    vec2 opticalDepth = vec2(0.0f);
+    for (int j = 0; j < J_STEPS; ++j)
+    {
+        vec3 samplePos = pos + dir * ((float(j) + 0.5f) * stepSize);
+        opticalDepth += AtmosphereDensity(length(samplePos) - uPlanetRadius) * stepSize;
+    }
+    return exp(-AtmosphereScattering(opticalDepth));
+}
+
+void main()
+{
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 size = imageSize(uOutputImage);
+    if (any(greaterThanEqual(texel, size)))
+        return;
+
+    vec3 pos, sunDir;
+    AtmosphereLutTexel(texel, size, pos, sunDir);
+    imageStore(uOutputImage, texel, vec4(Transmittance(pos, sunDir), 1.0f));
+}
+
+#endif
@@ -0,0 +1,39 @@
+#ifdef POE_VERTEX_SHADER
+
+////////////////////////////////////////
+//////////// VERTEX SHADER /////////////
+////////////////////////////////////////
+
+void main()
+{
+    // fullscreen triangle
+    vec2 pos = vec2(float((gl_VertexID & 1) << 2) - 1.0f, float((gl_VertexID & 2) << 1) - 1.0f);
+    gl_Position = vec4(pos, 0.0f, 1.0f);
+}
+
+#elif defined(POE_FRAGMENT_SHADER)
+
+////////////////////////////////////////
+//////////// FRAGMENT SHADER ///////////
+////////////////////////////////////////
+
+layout (location = POE_UACCUMULATION_TEXTURE_LOC) uniform sampler2D uAccumulationTexture;
+layout (location = POE_UREVEALAGE_TEXTURE_LOC) uniform sampler2D uRevealageTexture;
+
+// blended with GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA over the opaque scene
+out vec4 color;
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    float revealage = texelFetch(uRevealageTexture, texel, 0).r;
+    if (revealage >= 1.0f) discard; // nothing transparent in front
+
+    vec4 accumulation = texelFetch(uAccumulationTexture, texel, 0);
+    if (any(isinf(accumulation.rgb)))
+        accumulation.rgb = vec3(accumulation.a);
+
+    // weighted average of the transparent colors, the scene shows through by the revealage
+    color = vec4(accumulation.rgb / clamp(accumulation.a, 1e-4f, 5e4f), revealage);
+}
+
+#endif
@@ -0,0 +1,19 @@
+// targets of TransparencyStack, replaces the color output of the forward shaders
+#if POE_WEIGHTED_BLENDED == 1
+
+layout (location = 0) out vec4 oAccumulation; // blended with GL_ONE, GL_ONE
+layout (location = 1) out float oRevealage;   // blended with GL_ZERO, GL_ONE_MINUS_SRC_COLOR
+
+////////////////////////////////////////
+// McGuire and Bavoil, Weighted Blended Order-Independent Transparency, equation 7:
+// closer surfaces weigh more, clamped so the sums stay within half precision
+void WriteWeightedBlended(vec4 color, vec3 eyeSpace)
+{
+    float z = abs(eyeSpace.z);
+    float weight = color.a * clamp(10.0f / (1e-5f + pow(z / 5.0f, 2.0f) + pow(z / 200.0f, 6.0f)), 1e-2f, 3e3f);
+    oAccumulation = vec4(color.rgb * color.a, color.a) * weight;
+    oRevealage = color.a;
+}
+
+#define WEIGHTED_BLENDED_INCLUDED
+#endif
@@ -0,0 +1,15 @@
+// positions of quantized meshes are normalized to the mesh bounds,
+// every StaticMesh binds the block, see StaticMesh::SetVertexDecode
+layout (std140, binding = POE_VERTEX_DECODE_BLOCK_LOC) uniform VertexDecodeBlock
+{
+    vec4 uPosScale;
+    vec4 uPosOffset;
+};
+
+////////////////////////////////////////
+vec3 DecodePosition(vec3 pos)
+{
+    return pos * uPosScale.xyz + uPosOffset.xyz;
+}
+
+#define VERTEX_DECODE_INCLUDED
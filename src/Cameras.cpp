@@ -15,6 +15,7 @@
 // along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include "Cameras.hpp"
+#include "UI.hpp"
 #include "Utility.hpp"
 #include "Constants.hpp"
 
@@ -36,6 +37,9 @@
 #include <glm/gtc/random.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
+#include <cstdio>
+
 namespace Poe
 {
     ////////////////////////////////////////
@@ -191,11 +195,12 @@ namespace Poe
     }
 
     ////////////////////////////////////////
-    std::vector<glm::vec4> AbstractCamera::GetFrustumCornersInWorldSpace(float near, float far) const
+    Utility::FrustumCorners AbstractCamera::GetFrustumCornersInWorldSpace(float near, float far) const
     {
         glm::mat4 projectionMatrix = glm::perspective(GetFovy(), GetAspectRatio(), near, far);
         glm::mat4 invMatrix{ glm::inverse(projectionMatrix * mViewMatrix) };
-        std::vector<glm::vec4> frustumCorners;
+        Utility::FrustumCorners frustumCorners;
+        size_t ind{};
         for (int x = 0; x < 2; ++x) {
             for (int y = 0; y < 2; ++y) {
                 for (int z = 0; z < 2; ++z) {
@@ -203,10 +208,105 @@ namespace Poe
                                                        2.0f * static_cast<float>(y) - 1.0f,
                                                        2.0f * static_cast<float>(z) - 1.0f,
                                                        1.0f) };
-                    frustumCorners.push_back(P / P.w);
+                    frustumCorners[ind++] = P / P.w;
                 }
             }
         }
         return frustumCorners;
     }
+
+    ////////////////////////////////////////
+    Utility::Frustum AbstractCamera::GetFrustum(float near, float far, const glm::mat4& model) const
+    {
+        glm::mat4 projectionMatrix = glm::perspective(GetFovy(), GetAspectRatio(), near, far);
+        return Utility::ComputeFrustum(projectionMatrix * mViewMatrix * model);
+    }
+
+    ////////////////////////////////////////
+    void CameraPath::Apply(float time, FirstPersonCamera& camera) const
+    {
+        if (mKeys.empty()) {
+            return;
+        }
+
+        auto it{ std::upper_bound(mKeys.begin(), mKeys.end(), time, [](float t, const Key& key){ return t < key.mTime; }) };
+        const Key& next{ it == mKeys.end() ? mKeys.back() : *it };
+        const Key& prev{ it == mKeys.begin() ? mKeys.front() : *(it - 1) };
+
+        float span{ next.mTime - prev.mTime };
+        float s{ span > 0.0f ? glm::clamp((time - prev.mTime) / span, 0.0f, 1.0f) : 0.0f };
+
+        camera.mPosition = camera.mTargetPosition = Utility::Lerp(prev.mPosition, next.mPosition, s);
+        camera.mDirection = glm::normalize(Utility::Lerp(prev.mDirection, next.mDirection, s));
+    }
+
+    ////////////////////////////////////////
+    bool CameraPath::Load(const std::string& filePath)
+    {
+        std::FILE* fp = std::fopen(filePath.c_str(), "r");
+        if (!fp) {
+            return false;
+        }
+
+        mKeys.clear();
+        char line[256];
+        while (std::fgets(line, sizeof(line), fp)) {
+            if (line[0] == '#') {
+                continue;
+            }
+            Key key;
+            if (std::sscanf(line, "%f %f %f %f %f %f %f", &key.mTime,
+                                                          &key.mPosition.x, &key.mPosition.y, &key.mPosition.z,
+                                                          &key.mDirection.x, &key.mDirection.y, &key.mDirection.z) == 7) {
+                mKeys.push_back(key);
+            }
+        }
+        std::fclose(fp);
+
+        // Apply searches the keys by time, hand edited files may be out of order
+        std::ranges::stable_sort(mKeys, {}, &Key::mTime);
+        return true;
+    }
+
+    ////////////////////////////////////////
+    bool CameraPath::Save(const std::string& filePath) const
+    {
+        std::FILE* fp = std::fopen(filePath.c_str(), "w");
+        if (!fp) {
+            return false;
+        }
+
+        std::fprintf(fp, "# time x y z dx dy dz\n");
+        for (const Key& key : mKeys) {
+            std::fprintf(fp, "%f %f %f %f %f %f %f\n", key.mTime,
+                                                       key.mPosition.x, key.mPosition.y, key.mPosition.z,
+                                                       key.mDirection.x, key.mDirection.y, key.mDirection.z);
+        }
+        return std::fclose(fp) == 0;
+    }
+
+    ////////////////////////////////////////
+    void CameraPathRecorder::Toggle()
+    {
+        mIsRecording = !mIsRecording;
+        if (mIsRecording) {
+            mPath.Clear();
+            mTime = 0.0f;
+        }
+        else if (mPath.Save(mFilePath)) {
+            DebugUI::PushLog(stdout, "[DEBUG] saved %d camera keys to %s\n", static_cast<int>(mPath.GetKeys().size()), mFilePath.c_str());
+        }
+        else {
+            DebugUI::PushLog(stderr, "[DEBUG] ERROR: couldn't write %s\n", mFilePath.c_str());
+        }
+    }
+
+    ////////////////////////////////////////
+    void CameraPathRecorder::Update(float dt, const FirstPersonCamera& camera)
+    {
+        if (mIsRecording) {
+            mPath.AddKey(mTime, camera);
+            mTime += dt;
+        }
+    }
 }
@@ -18,6 +18,7 @@
 
 #include "Constants.hpp"
 #include "Suppress.hpp"
+#include "Utility.hpp"
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -31,6 +32,7 @@ SUPPRESS_WARNINGS()
 ENABLE_WARNINGS()
 
 #include <vector>
+#include <string>
 
 namespace Poe
 {
@@ -54,7 +56,12 @@ namespace Poe
 
         glm::mat4 GetProjectionMatrix() const { return mProjectionMatrix; }
         glm::mat4 GetViewMatrix() const { return mViewMatrix; }
-        std::vector<glm::vec4> GetFrustumCornersInWorldSpace(float near, float far) const;
+        Utility::FrustumCorners GetFrustumCornersInWorldSpace(float near, float far) const;
+
+        // frustum in the local space of model, pass identity for world space
+        Utility::Frustum GetFrustum(const glm::mat4& model = glm::mat4(1.0f)) const
+        { return Utility::ComputeFrustum(mProjectionMatrix * mViewMatrix * model); }
+        Utility::Frustum GetFrustum(float near, float far, const glm::mat4& model = glm::mat4(1.0f)) const;
 
         virtual float GetFovy() const = 0;
         virtual float GetAspectRatio() const = 0;
@@ -123,4 +130,64 @@ namespace Poe
         float GetNear() const override { return mNear; }
         float GetFar() const override { return mFar; }
     };
+
+    ////////////////////////////////////////
+    // keyframed camera positions and directions, stored as lines of
+    // "time x y z dx dy dz" where lines starting with '#' are ignored
+    struct CameraPath
+    {
+        struct Key
+        {
+            float mTime;
+            glm::vec3 mPosition;
+            glm::vec3 mDirection;
+        };
+
+    private:
+        std::vector<Key> mKeys;
+
+    public:
+        // keys have to be added in increasing time
+        void AddKey(float time, const FirstPersonCamera& camera)
+        { mKeys.push_back({ time, camera.mPosition, camera.mDirection }); }
+
+        void AddKey(const Key& key) { mKeys.push_back(key); }
+
+        // moves the camera to the interpolated key at time, the view is updated by camera.Update
+        void Apply(float time, FirstPersonCamera& camera) const;
+
+        bool Load(const std::string& filePath);
+        bool Save(const std::string& filePath) const;
+
+        void Clear() { mKeys.clear(); }
+
+        bool IsEmpty() const { return mKeys.empty(); }
+        float GetDuration() const { return mKeys.empty() ? 0.0f : mKeys.back().mTime; }
+        const std::vector<Key>& GetKeys() const { return mKeys; }
+    };
+
+    ////////////////////////////////////////
+    // records a camera into a CameraPath while it's on and saves the path when it's toggled off
+    struct CameraPathRecorder
+    {
+    private:
+        CameraPath mPath;
+        std::string mFilePath;
+        float mTime;
+        bool mIsRecording;
+
+    public:
+        explicit CameraPathRecorder(const std::string& filePath)
+            : mFilePath{filePath}, mTime{}, mIsRecording{false} {}
+
+        // starts a new path, or stops and saves the current one
+        void Toggle();
+
+        // adds a key if recording, call once per frame after camera.Update
+        void Update(float dt, const FirstPersonCamera& camera);
+
+        bool IsRecording() const { return mIsRecording; }
+        const CameraPath& GetPath() const { return mPath; }
+        const std::string& GetFilePath() const { return mFilePath; }
+    };
 }
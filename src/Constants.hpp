@@ -38,6 +38,7 @@ namespace Poe
     inline constexpr int DIR_LIGHT_DEPTH_MAP_BIND_POINT     { 13 };
     inline constexpr int POINT_LIGHT_DEPTH_MAP_BIND_POINT   { 14 };
     inline constexpr int SPOT_LIGHT_DEPTH_MAP_BIND_POINT    { 15 };
+    inline constexpr int AMBIENT_OCCLUSION_MAP_BIND_POINT   { 12 };
 
     ////////////////////////////////////////
     inline constexpr float PP_DEFAULT_EXPOSURE              { 1.0f };
@@ -51,4 +52,7 @@ namespace Poe
     ////////////////////////////////////////
     inline constexpr int INSTANCED_MODEL_LOC                { 8 };
     inline constexpr int INSTANCED_NORMAL_LOC               { 12 };
+
+    ////////////////////////////////////////
+    inline constexpr int MAX_MESH_LODS                      { 4 };
 }
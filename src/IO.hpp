@@ -18,17 +18,116 @@
 
 #include <fstream>
 #include <string>
+#include <filesystem>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace Poe::IO
 {
     ////////////////////////////////////////
+    // in one read, empty if the file is missing
     inline std::string ReadTextFile(const std::string& filePath)
     {
         std::string all;
-        if (std::ifstream fp{filePath}) {
-            for (std::string current; std::getline(fp, current); all += current + '\n')
-                ;
+        if (std::ifstream fp{filePath, std::ios::binary | std::ios::ate}) {
+            std::streamsize size{ fp.tellg() };
+            if (size > 0) {
+                all.resize(static_cast<size_t>(size));
+                fp.seekg(0);
+                fp.read(all.data(), size);
+                all.resize(static_cast<size_t>(fp.gcount()));
+            }
         }
         return all;
     }
+
+    ////////////////////////////////////////
+    inline bool WriteBinaryFile(const std::string& filePath, const void* data, size_t size)
+    {
+        std::ofstream fp{filePath, std::ios::binary | std::ios::trunc};
+        fp.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+        return static_cast<bool>(fp);
+    }
+
+    ////////////////////////////////////////
+    // zero if the file is missing
+    inline long long GetFileModificationTime(const std::string& filePath)
+    {
+        std::error_code ec;
+        auto time = std::filesystem::last_write_time(filePath, ec);
+        return ec ? 0 : static_cast<long long>(time.time_since_epoch().count());
+    }
+
+    ////////////////////////////////////////
+    // false if either file is missing
+    inline bool IsFileUpToDate(const std::string& filePath, const std::string& sourcePath)
+    {
+        std::error_code ec;
+        auto fileTime = std::filesystem::last_write_time(filePath, ec);
+        if (ec) {
+            return false;
+        }
+        auto sourceTime = std::filesystem::last_write_time(sourcePath, ec);
+        return !ec && fileTime >= sourceTime;
+    }
+
+    ////////////////////////////////////////
+    // read-only view of a whole file, pages are faulted in on first access
+    struct MappedFile
+    {
+    private:
+        void* mData;
+        size_t mSize;
+
+    public:
+        explicit MappedFile(const std::string& filePath)
+            : mData{nullptr}, mSize{}
+        {
+            int fd = open(filePath.c_str(), O_RDONLY);
+            if (fd < 0) {
+                return;
+            }
+            struct stat st;
+            if (fstat(fd, &st) == 0 && st.st_size > 0) {
+                void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                if (data != MAP_FAILED) {
+                    mData = data;
+                    mSize = static_cast<size_t>(st.st_size);
+                }
+            }
+            close(fd);
+        }
+
+        ~MappedFile() { if (mData) munmap(mData, mSize); }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        MappedFile(MappedFile&& other)
+            : mData{other.mData}, mSize{other.mSize}
+        {
+            other.mData = nullptr;
+            other.mSize = 0;
+        }
+
+        MappedFile& operator=(MappedFile&& other)
+        {
+            if (this != &other) {
+                if (mData) munmap(mData, mSize);
+                mData = other.mData;
+                mSize = other.mSize;
+                other.mData = nullptr;
+                other.mSize = 0;
+            }
+            return *this;
+        }
+
+        bool IsValid() const { return mData != nullptr; }
+        const unsigned char* GetData() const { return static_cast<const unsigned char*>(mData); }
+        size_t GetSize() const { return mSize; }
+    };
 }
@@ -23,19 +23,27 @@
 #include "Constants.hpp"
 
 #include <map>
+#include <algorithm>
+#include <chrono>
 
 SUPPRESS_WARNINGS()
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
 
 #include <glm/gtc/integer.hpp>
+#include <glm/packing.hpp>
 ENABLE_WARNINGS()
 
+#include <cstddef>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <string>
 #include <sstream>
+#include <tuple>
+#include <limits>
+#include <new>
+#include <type_traits>
 
 namespace Poe
 {
@@ -87,6 +95,16 @@ namespace Poe
         return std::string("#define ") + param + " " + std::to_string(value) + '\n';
     }
 
+    ////////////////////////////////////////
+    // texture arrays of a MaterialTable are bound to units [0, MAX_TEXTURE_ARRAYS)
+    static void SetMaterialTextureArraySamplers(const Program& program, int loc)
+    {
+        // the elements of an array with an explicit location take consecutive locations
+        for (int i = 0; i < MaterialTable::MAX_TEXTURE_ARRAYS; ++i) {
+            program.SetInitialUniform(loc + i, i);
+        }
+    }
+
     ////////////////////////////////////////
     void APIENTRY GraphicsDebugOutput(GLenum source, GLenum type, unsigned int id, GLenum severity, GLsizei length, const char *message, const void *userParam)
     {
@@ -161,14 +179,35 @@ namespace Poe
     int RuntimeStats::NumInstancedDrawCalls{};
     int RuntimeStats::NumTextureBinds{};
     int RuntimeStats::NumVAOBinds{};
+    int RuntimeStats::NumVisibleMeshes{};
+    int RuntimeStats::NumCulledMeshes{};
+    int RuntimeStats::NumVisibleShadowCasters{};
+    int RuntimeStats::NumCulledShadowCasters{};
+    int RuntimeStats::NumSavedProgramBinds{};
+    int RuntimeStats::NumSavedVAOBinds{};
+    int RuntimeStats::NumSavedTextureBinds{};
+
+    ////////////////////////////////////////
+    // incremented by the replaced global operator new when built with POE_COUNT_ALLOCATIONS,
+    // see the end of this file
+    std::atomic<unsigned long long> RuntimeStats::sNumAllocations{};
+    unsigned long long RuntimeStats::sNumAllocationsAtReset{};
 
     ////////////////////////////////////////
     void RuntimeStats::Reset()
     {
+        sNumAllocationsAtReset = sNumAllocations.load(std::memory_order_relaxed);
         NumDrawCalls = 0;
         NumInstancedDrawCalls = 0;
         NumTextureBinds = 0;
         NumVAOBinds = 0;
+        NumVisibleMeshes = 0;
+        NumCulledMeshes = 0;
+        NumVisibleShadowCasters = 0;
+        NumCulledShadowCasters = 0;
+        NumSavedProgramBinds = 0;
+        NumSavedVAOBinds = 0;
+        NumSavedTextureBinds = 0;
     }
 
     ////////////////////////////////////////
@@ -189,6 +228,321 @@ namespace Poe
         return result;
     }
 
+    ////////////////////////////////////////
+    bool Profiler::sIsInitialized{};
+    unsigned long long Profiler::sFrame{};
+    std::array<std::array<GLuint, 2 * Profiler::MAX_SCOPES>, Profiler::NUM_FRAMES> Profiler::sQueries{};
+    std::array<std::vector<Profiler::ScopeRecord>, Profiler::NUM_FRAMES> Profiler::sRecords{};
+    std::array<GLuint, Profiler::NUM_FRAMES> Profiler::sLastQueries{};
+    std::array<unsigned long long, Profiler::NUM_FRAMES> Profiler::sRecordFrames{};
+    std::array<int, Profiler::MAX_DEPTH> Profiler::sOpenScopes{};
+    int Profiler::sDepth{};
+    std::vector<Profiler::ScopeStats> Profiler::sStats;
+    std::vector<std::pair<Profiler::ScopeKey, size_t>> Profiler::sStatsIndices;
+    std::vector<size_t> Profiler::sRecordStats;
+    std::vector<size_t> Profiler::sFrameScopes;
+    float Profiler::sFrameGpuTime{};
+    unsigned long long Profiler::sNumResolvedFrames{};
+
+    ////////////////////////////////////////
+    static double GetProfilerTime()
+    {
+        using namespace std::chrono;
+        return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    ////////////////////////////////////////
+    float Profiler::ScopeStats::ComputeAverage(const std::array<float, NUM_SAMPLES>& samples) const
+    {
+        if (mNumSamples == 0) {
+            return 0.0f;
+        }
+        float sum{};
+        for (int i = 0; i < mNumSamples; ++i) {
+            sum += samples[static_cast<size_t>(i)];
+        }
+        return sum / static_cast<float>(mNumSamples);
+    }
+
+    ////////////////////////////////////////
+    float Profiler::ScopeStats::ComputePercentile(const std::array<float, NUM_SAMPLES>& samples, float percentile) const
+    {
+        if (mNumSamples == 0) {
+            return 0.0f;
+        }
+        std::array<float, NUM_SAMPLES> sorted{ samples };
+        auto last{ sorted.begin() + mNumSamples };
+        auto nth{ sorted.begin() + static_cast<int>(glm::clamp(percentile, 0.0f, 100.0f) / 100.0f * static_cast<float>(mNumSamples - 1) + 0.5f) };
+        std::nth_element(sorted.begin(), nth, last);
+        return *nth;
+    }
+
+    ////////////////////////////////////////
+    void Profiler::BeginScope(const char* name, int index)
+    {
+        if (!sIsInitialized) {
+            for (std::array<GLuint, 2 * MAX_SCOPES>& queries : sQueries) {
+                glCreateQueries(GL_TIMESTAMP, static_cast<GLsizei>(queries.size()), queries.data());
+            }
+            for (std::vector<ScopeRecord>& records : sRecords) {
+                records.reserve(MAX_SCOPES);
+            }
+            sIsInitialized = true;
+        }
+
+        if (sDepth >= MAX_DEPTH) {
+            ++sDepth;
+            return;
+        }
+
+        size_t slot{ static_cast<size_t>(sFrame % NUM_FRAMES) };
+        std::vector<ScopeRecord>& records{ sRecords[slot] };
+        if (records.size() >= MAX_SCOPES) {
+            sOpenScopes[static_cast<size_t>(sDepth++)] = -1;
+            return;
+        }
+
+        sRecordFrames[slot] = sFrame;
+        int parent{ sDepth > 0 ? sOpenScopes[static_cast<size_t>(sDepth - 1)] : -1 };
+        int ind{ static_cast<int>(records.size()) };
+        records.push_back({ name, index, parent, GetProfilerTime(), 0.0 });
+        sLastQueries[slot] = sQueries[slot][static_cast<size_t>(2 * ind)];
+        glQueryCounter(sLastQueries[slot], GL_TIMESTAMP);
+        sOpenScopes[static_cast<size_t>(sDepth++)] = ind;
+    }
+
+    ////////////////////////////////////////
+    void Profiler::EndScope()
+    {
+        assert(sDepth > 0);
+        if (--sDepth >= MAX_DEPTH) {
+            return;
+        }
+
+        int ind{ sOpenScopes[static_cast<size_t>(sDepth)] };
+        if (ind < 0) {
+            return;
+        }
+
+        size_t slot{ static_cast<size_t>(sFrame % NUM_FRAMES) };
+        sRecords[slot][static_cast<size_t>(ind)].mCpuEnd = GetProfilerTime();
+        sLastQueries[slot] = sQueries[slot][static_cast<size_t>(2 * ind + 1)];
+        glQueryCounter(sLastQueries[slot], GL_TIMESTAMP);
+    }
+
+    ////////////////////////////////////////
+    bool Profiler::Resolve(size_t slot)
+    {
+        std::vector<ScopeRecord>& records{ sRecords[slot] };
+
+        // timestamps complete in order, the last one written stands for the whole frame
+        GLint isAvailable{};
+        glGetQueryObjectiv(sLastQueries[slot], GL_QUERY_RESULT_AVAILABLE, &isAvailable);
+        if (!isAvailable) {
+            return false;
+        }
+
+        auto isLess = [](const std::pair<ScopeKey, size_t>& entry, const ScopeKey& key) {
+            if (entry.first.mName != key.mName) {
+                return std::less<const char*>{}(entry.first.mName, key.mName);
+            }
+            if (entry.first.mIndex != key.mIndex) {
+                return entry.first.mIndex < key.mIndex;
+            }
+            return entry.first.mParent < key.mParent;
+        };
+
+        // a scope entered several times in a frame adds up to one sample
+        if (sRecordStats.size() < records.size()) {
+            sRecordStats.resize(records.size());
+        }
+        sFrameScopes.clear();
+        sFrameGpuTime = 0.0f;
+        for (size_t i = 0; i < records.size(); ++i) {
+            const ScopeRecord& record{ records[i] };
+            const size_t parent{ record.mParent >= 0 ? sRecordStats[static_cast<size_t>(record.mParent)] : std::numeric_limits<size_t>::max() };
+            const ScopeKey key{ record.mName, record.mIndex, parent };
+
+            auto it{ std::lower_bound(sStatsIndices.begin(), sStatsIndices.end(), key, isLess) };
+            if (it == sStatsIndices.end() || isLess({ key, 0 }, it->first)) {
+                std::string name{ record.mName };
+                if (record.mIndex >= 0) {
+                    name += ' ';
+                    name += std::to_string(record.mIndex);
+                }
+                const int depth{ record.mParent >= 0 ? sStats[parent].mDepth + 1 : 0 };
+                it = sStatsIndices.insert(it, { key, sStats.size() });
+                sStats.push_back({ std::move(name), depth, {}, {}, 0, 0, 0 });
+            }
+            sRecordStats[i] = it->second;
+
+            GLuint64 gpuBegin{}, gpuEnd{};
+            glGetQueryObjectui64v(sQueries[slot][2 * i], GL_QUERY_RESULT, &gpuBegin);
+            glGetQueryObjectui64v(sQueries[slot][2 * i + 1], GL_QUERY_RESULT, &gpuEnd);
+            float gpuTime{ static_cast<float>(static_cast<double>(gpuEnd - gpuBegin) / 1000000.0) };
+            float cpuTime{ static_cast<float>(record.mCpuEnd - record.mCpuBegin) };
+            if (record.mParent < 0) {
+                sFrameGpuTime += gpuTime;
+            }
+
+            ScopeStats& stats{ sStats[it->second] };
+            if (stats.mNumSamples > 0 && stats.mLastFrame == sRecordFrames[slot]) {
+                size_t sample{ static_cast<size_t>((stats.mNextSample + NUM_SAMPLES - 1) % NUM_SAMPLES) };
+                stats.mGpuSamples[sample] += gpuTime;
+                stats.mCpuSamples[sample] += cpuTime;
+                continue;
+            }
+
+            size_t sample{ static_cast<size_t>(stats.mNextSample) };
+            stats.mGpuSamples[sample] = gpuTime;
+            stats.mCpuSamples[sample] = cpuTime;
+            stats.mNextSample = (stats.mNextSample + 1) % NUM_SAMPLES;
+            stats.mNumSamples = std::min(stats.mNumSamples + 1, NUM_SAMPLES);
+            stats.mLastFrame = sRecordFrames[slot];
+
+            sFrameScopes.push_back(it->second);
+        }
+
+        records.clear();
+        ++sNumResolvedFrames;
+        return true;
+    }
+
+    ////////////////////////////////////////
+    void Profiler::EndFrame()
+    {
+        assert(sDepth == 0);
+        ++sFrame;
+
+        // oldest first, a frame that isn't available yet holds back the ones after it
+        for (unsigned long long frame = sFrame - std::min(sFrame, static_cast<unsigned long long>(NUM_FRAMES)); frame < sFrame; ++frame) {
+            size_t slot{ static_cast<size_t>(frame % NUM_FRAMES) };
+            if (sRecords[slot].empty()) {
+                continue;
+            }
+            if (!Resolve(slot)) {
+                break;
+            }
+        }
+
+        // the gpu is NUM_FRAMES frames behind, drop the oldest frame instead of waiting
+        sRecords[static_cast<size_t>(sFrame % NUM_FRAMES)].clear();
+    }
+
+    ////////////////////////////////////////
+    void Profiler::Reset()
+    {
+        sStats.clear();
+        sStatsIndices.clear();
+        sFrameScopes.clear();
+    }
+
+    ////////////////////////////////////////
+    unsigned long long PersistentBuffer::sFrame{};
+    std::array<GLsync, PersistentBuffer::NUM_FRAMES> PersistentBuffer::sFences{};
+
+    ////////////////////////////////////////
+    PersistentBuffer::PersistentBuffer(size_t size, size_t alignment)
+        : mSize{size},
+          mSegmentSize{(size + alignment - 1) / alignment * alignment},
+          mPtr{nullptr},
+          mShadow(size),
+          mWriteFrame{std::numeric_limits<unsigned long long>::max()},
+          mSegment{NUM_FRAMES - 1}
+    {
+        const GLbitfield flags{ GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT };
+        const GLsizeiptr totalSize{ static_cast<GLsizeiptr>(mSegmentSize * NUM_FRAMES) };
+
+        glCreateBuffers(1, &mId);
+        glNamedBufferStorage(mId, totalSize, nullptr, flags);
+        mPtr = static_cast<unsigned char*>(glMapNamedBufferRange(mId, 0, totalSize, flags));
+        if (!mPtr) {
+            DebugUI::PushLog(stderr, "[DEBUG] ERROR: couldn't map persistent buffer %u\n", mId);
+            assert(false);
+        }
+    }
+
+    ////////////////////////////////////////
+    PersistentBuffer::~PersistentBuffer()
+    {
+        if (mId) {
+            glUnmapNamedBuffer(mId);
+            glDeleteBuffers(1, &mId);
+        }
+    }
+
+    ////////////////////////////////////////
+    PersistentBuffer::PersistentBuffer(PersistentBuffer&& other)
+        : mId{other.mId},
+          mSize{other.mSize},
+          mSegmentSize{other.mSegmentSize},
+          mPtr{other.mPtr},
+          mShadow{std::move(other.mShadow)},
+          mWriteFrame{other.mWriteFrame},
+          mSegment{other.mSegment}
+    {
+        other.mId = 0;
+        other.mPtr = nullptr;
+    }
+
+    ////////////////////////////////////////
+    PersistentBuffer& PersistentBuffer::operator=(PersistentBuffer&& other)
+    {
+        if (this != &other) {
+            if (mId) {
+                glUnmapNamedBuffer(mId);
+                glDeleteBuffers(1, &mId);
+            }
+
+            mId = other.mId;
+            mSize = other.mSize;
+            mSegmentSize = other.mSegmentSize;
+            mPtr = other.mPtr;
+            mShadow = std::move(other.mShadow);
+            mWriteFrame = other.mWriteFrame;
+            mSegment = other.mSegment;
+
+            other.mId = 0;
+            other.mPtr = nullptr;
+        }
+        return *this;
+    }
+
+    ////////////////////////////////////////
+    void PersistentBuffer::Write(size_t offset, size_t size, const void* data)
+    {
+        assert(offset + size <= mSize);
+        if (data != mShadow.data() + offset) {
+            std::memcpy(mShadow.data() + offset, data, size);
+        }
+
+        if (mWriteFrame != sFrame) {
+            // the next segment was last read NUM_FRAMES - 1 write frames ago, EndFrame() made sure those frames are done
+            mWriteFrame = sFrame;
+            mSegment = (mSegment + 1) % NUM_FRAMES;
+            std::memcpy(mPtr + GetOffset(), mShadow.data(), mSize);
+        }
+        else {
+            std::memcpy(mPtr + GetOffset() + offset, mShadow.data() + offset, size);
+        }
+    }
+
+    ////////////////////////////////////////
+    void PersistentBuffer::EndFrame()
+    {
+        size_t ind{ static_cast<size_t>(sFrame % NUM_FRAMES) };
+        sFences[ind] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        ++sFrame;
+
+        // the next frame may overwrite segments read NUM_FRAMES frames ago
+        ind = static_cast<size_t>(sFrame % NUM_FRAMES);
+        if (sFences[ind]) {
+            while (glClientWaitSync(sFences[ind], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {}
+            glDeleteSync(sFences[ind]);
+            sFences[ind] = nullptr;
+        }
+    }
+
     ////////////////////////////////////////
     VertexBuffer::VertexBuffer(const std::vector<float>& vertices, unsigned mode)
         : mMode{mode}, mNumElements{vertices.size()}
@@ -198,16 +552,31 @@ namespace Poe
     }
 
     ////////////////////////////////////////
-    VertexBuffer::VertexBuffer(size_t numElements, unsigned mode)
-        : mMode{mode}, mNumElements{numElements}
+    VertexBuffer::VertexBuffer(const float* vertices, size_t numElements)
+        : mMode{GL_STATIC_DRAW}, mNumElements{numElements}
+    {
+        glCreateBuffers(1, &mId);
+        glNamedBufferStorage(mId, static_cast<GLsizeiptr>(numElements * sizeof(float)), vertices, 0);
+    }
+
+    ////////////////////////////////////////
+    VertexBuffer::VertexBuffer(size_t numElements, unsigned mode, bool isPersistent)
+        : mId{}, mMode{mode}, mNumElements{numElements}
     {
+        if (isPersistent) {
+            // the segments may also be bound as storage buffers, see InstanceCullingProgram
+            GLint alignment{};
+            glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+            mPersistentBuffer.reset(new PersistentBuffer(numElements * sizeof(float), std::max(static_cast<size_t>(alignment), sizeof(glm::vec4))));
+            return;
+        }
         glCreateBuffers(1, &mId);
         glNamedBufferData(mId, static_cast<GLsizeiptr>(numElements * sizeof(float)), nullptr, mode);
     }
 
     ////////////////////////////////////////
     VertexBuffer::VertexBuffer(VertexBuffer&& other)
-        : mId{other.mId}, mMode{other.mMode}, mNumElements{other.mNumElements}
+        : mId{other.mId}, mMode{other.mMode}, mNumElements{other.mNumElements}, mPersistentBuffer{std::move(other.mPersistentBuffer)}
     {
         other.mId = 0;
         other.mNumElements = 0;
@@ -222,6 +591,7 @@ namespace Poe
             mId = other.mId;
             mNumElements = other.mNumElements;
             mMode = other.mMode;
+            mPersistentBuffer = std::move(other.mPersistentBuffer);
 
             other.mId = 0;
             other.mNumElements = 0;
@@ -237,6 +607,14 @@ namespace Poe
         glNamedBufferData(mId, static_cast<GLsizeiptr>(indices.size() * sizeof(unsigned)), indices.data(), mode);
     }
 
+    ////////////////////////////////////////
+    IndexBuffer::IndexBuffer(const unsigned* indices, size_t numElements)
+        : mMode{GL_STATIC_DRAW}, mNumElements{numElements}
+    {
+        glCreateBuffers(1, &mId);
+        glNamedBufferStorage(mId, static_cast<GLsizeiptr>(numElements * sizeof(unsigned)), indices, 0);
+    }
+
     ////////////////////////////////////////
     IndexBuffer::IndexBuffer(size_t numElements, unsigned mode)
         : mMode{mode}, mNumElements{numElements}
@@ -270,16 +648,63 @@ namespace Poe
     }
 
     ////////////////////////////////////////
-    UniformBuffer::UniformBuffer(size_t size, unsigned mode, unsigned bindLoc)
-        : mSize{size}, mMode{mode}, mBindLoc{bindLoc}
+    IndirectBuffer::IndirectBuffer(const std::vector<DrawElementsIndirectCommand>& commands, unsigned mode)
+        : mMode{mode}, mNumElements{commands.size()}
+    {
+        glCreateBuffers(1, &mId);
+        glNamedBufferData(mId, static_cast<GLsizeiptr>(commands.size() * sizeof(DrawElementsIndirectCommand)), commands.data(), mode);
+    }
+
+    ////////////////////////////////////////
+    IndirectBuffer::IndirectBuffer(size_t numElements, unsigned mode)
+        : mMode{mode}, mNumElements{numElements}
+    {
+        glCreateBuffers(1, &mId);
+        glNamedBufferData(mId, static_cast<GLsizeiptr>(numElements * sizeof(DrawElementsIndirectCommand)), nullptr, mode);
+    }
+
+    ////////////////////////////////////////
+    IndirectBuffer::IndirectBuffer(IndirectBuffer&& other)
+        : mId{other.mId}, mMode{other.mMode}, mNumElements{other.mNumElements}
+    {
+        other.mId = 0;
+        other.mNumElements = 0;
+    }
+
+    ////////////////////////////////////////
+    IndirectBuffer& IndirectBuffer::operator=(IndirectBuffer&& other)
+    {
+        if (this != &other) {
+            glDeleteBuffers(1, &mId);
+
+            mId = other.mId;
+            mNumElements = other.mNumElements;
+            mMode = other.mMode;
+
+            other.mId = 0;
+            other.mNumElements = 0;
+        }
+        return *this;
+    }
+
+    ////////////////////////////////////////
+    UniformBuffer::UniformBuffer(size_t size, unsigned mode, unsigned bindLoc, bool isPersistent)
+        : mId{}, mSize{size}, mMode{mode}, mBindLoc{bindLoc}, mIsTurnedOn{false}
     {
+        if (isPersistent) {
+            GLint alignment{};
+            glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+            mPersistentBuffer.reset(new PersistentBuffer(size, static_cast<size_t>(std::max(alignment, 1))));
+            return;
+        }
         glCreateBuffers(1, &mId);
         glNamedBufferData(mId, static_cast<GLsizeiptr>(size), nullptr, mode);
     }
 
     ////////////////////////////////////////
     UniformBuffer::UniformBuffer(UniformBuffer&& other)
-        : mId{other.mId}, mSize{other.mSize}, mMode{other.mMode}, mBindLoc{other.mBindLoc}
+        : mId{other.mId}, mSize{other.mSize}, mMode{other.mMode}, mBindLoc{other.mBindLoc},
+          mPersistentBuffer{std::move(other.mPersistentBuffer)}, mIsTurnedOn{other.mIsTurnedOn}
     {
         other.mId = 0;
     }
@@ -290,6 +715,39 @@ namespace Poe
         if (this != &other) {
             glDeleteBuffers(1, &mId);
 
+            mId = other.mId;
+            mSize = other.mSize;
+            mMode = other.mMode;
+            mBindLoc = other.mBindLoc;
+            mPersistentBuffer = std::move(other.mPersistentBuffer);
+            mIsTurnedOn = other.mIsTurnedOn;
+
+            other.mId = 0;
+        }
+        return *this;
+    }
+
+    ////////////////////////////////////////
+    ShaderStorageBuffer::ShaderStorageBuffer(size_t size, unsigned mode, unsigned bindLoc)
+        : mSize{size}, mMode{mode}, mBindLoc{bindLoc}
+    {
+        glCreateBuffers(1, &mId);
+        glNamedBufferData(mId, static_cast<GLsizeiptr>(size), nullptr, mode);
+    }
+
+    ////////////////////////////////////////
+    ShaderStorageBuffer::ShaderStorageBuffer(ShaderStorageBuffer&& other)
+        : mId{other.mId}, mSize{other.mSize}, mMode{other.mMode}, mBindLoc{other.mBindLoc}
+    {
+        other.mId = 0;
+    }
+
+    ////////////////////////////////////////
+    ShaderStorageBuffer& ShaderStorageBuffer::operator=(ShaderStorageBuffer&& other)
+    {
+        if (this != &other) {
+            glDeleteBuffers(1, &mId);
+
             mId = other.mId;
             mSize = other.mSize;
             mMode = other.mMode;
@@ -301,8 +759,8 @@ namespace Poe
     }
 
     ////////////////////////////////////////
-    RealisticSkyboxUB::RealisticSkyboxUB()
-        : mBuffer(sizeof(RealisticSkyboxUB__DATA), GL_DYNAMIC_DRAW, UniformBuffer::REALISTIC_SKYBOX_BLOCK_BINDING)
+    RealisticSkyboxUB::RealisticSkyboxUB(bool isPersistent)
+        : mBuffer(sizeof(RealisticSkyboxUB__DATA), GL_DYNAMIC_DRAW, UniformBuffer::REALISTIC_SKYBOX_BLOCK_BINDING, isPersistent)
     {
         std::memset(&mData, 0, sizeof(RealisticSkyboxUB__DATA));
 
@@ -319,12 +777,42 @@ namespace Poe
         mData.SetMieScaleHeight(1.2e3);
         mData.SetMiePreferredScatteringDirection(0.758f);
 
-        Update();
+        mBuffer.Modify(0, sizeof(RealisticSkyboxUB__DATA), &mData);
+        std::memcpy(&mUploadedData, &mData, sizeof(RealisticSkyboxUB__DATA));
+        mAtmosphereRevision = mSkyRevision = 1;
     }
 
     ////////////////////////////////////////
-    FogUB::FogUB(const glm::vec3& color, float distance, float exponent)
-        : mBuffer(sizeof(FogUB__DATA), GL_DYNAMIC_DRAW, UniformBuffer::FOG_BLOCK_BINDING)
+    // ray origin, sun position and intensity only change what the sky looks like from the ray origin
+    static bool HasSameAtmosphere(const RealisticSkyboxUB__DATA& a, const RealisticSkyboxUB__DATA& b)
+    {
+        constexpr size_t coefficientSize{ sizeof(RealisticSkyboxUB__DATA::rayleighScatteringCoefficient) };
+        constexpr size_t paramsOffset{ offsetof(RealisticSkyboxUB__DATA, planetRadius) };
+        constexpr size_t paramsSize{ sizeof(RealisticSkyboxUB__DATA) - paramsOffset };
+
+        return std::memcmp(a.rayleighScatteringCoefficient, b.rayleighScatteringCoefficient, coefficientSize) == 0 &&
+               std::memcmp(&a.planetRadius, &b.planetRadius, paramsSize) == 0;
+    }
+
+    ////////////////////////////////////////
+    void RealisticSkyboxUB::Update() const
+    {
+        if (std::memcmp(&mData, &mUploadedData, sizeof(RealisticSkyboxUB__DATA)) == 0) {
+            return;
+        }
+
+        if (!HasSameAtmosphere(mData, mUploadedData)) {
+            ++mAtmosphereRevision;
+        }
+        ++mSkyRevision;
+
+        mBuffer.Modify(0, sizeof(RealisticSkyboxUB__DATA), &mData);
+        std::memcpy(&mUploadedData, &mData, sizeof(RealisticSkyboxUB__DATA));
+    }
+
+    ////////////////////////////////////////
+    FogUB::FogUB(const glm::vec3& color, float distance, float exponent, bool isPersistent)
+        : mBuffer(sizeof(FogUB__DATA), GL_DYNAMIC_DRAW, UniformBuffer::FOG_BLOCK_BINDING, isPersistent)
     {
         std::memset(&mData, 0, sizeof(FogUB__DATA));
         mData.SetColor(color);
@@ -334,8 +822,8 @@ namespace Poe
     }
 
     ////////////////////////////////////////
-    TransformUB::TransformUB()
-        : mBuffer(sizeof(TransformUB__DATA), GL_DYNAMIC_DRAW, UniformBuffer::TRANSFORM_BLOCK_BINDING)
+    TransformUB::TransformUB(bool isPersistent)
+        : mBuffer(sizeof(TransformUB__DATA), GL_DYNAMIC_DRAW, UniformBuffer::TRANSFORM_BLOCK_BINDING, isPersistent)
     {
         std::memset(&mData, 0, sizeof(TransformUB__DATA));
         mBuffer.Modify(0, sizeof(TransformUB__DATA), &mData);
@@ -376,8 +864,8 @@ namespace Poe
     }
 
     ////////////////////////////////////////
-    PointLightUB::PointLightUB(int numLights)
-        : mBuffer(sizeof(PointLightListElem__DATA) * static_cast<size_t>(numLights), GL_DYNAMIC_DRAW, UniformBuffer::POINT_LIGHT_BLOCK_BINDING),
+    PointLightUB::PointLightUB(int numLights, bool isPersistent)
+        : mBuffer(sizeof(PointLightListElem__DATA) * static_cast<size_t>(numLights), GL_DYNAMIC_DRAW, UniformBuffer::POINT_LIGHT_BLOCK_BINDING, isPersistent),
           mLightsData(static_cast<size_t>(numLights)),
           mNumLights{numLights}
     {
@@ -389,8 +877,8 @@ namespace Poe
         mBuffer.Modify(0, sizeof(PointLightListElem__DATA) * static_cast<size_t>(numLights), mLightsData.data());
     }
     ////////////////////////////////////////
-    SpotLightUB::SpotLightUB(int numLights)
-        : mBuffer(sizeof(SpotLightListElem__DATA) * static_cast<size_t>(numLights), GL_DYNAMIC_DRAW, UniformBuffer::SPOT_LIGHT_BLOCK_BINDING),
+    SpotLightUB::SpotLightUB(int numLights, bool isPersistent)
+        : mBuffer(sizeof(SpotLightListElem__DATA) * static_cast<size_t>(numLights), GL_DYNAMIC_DRAW, UniformBuffer::SPOT_LIGHT_BLOCK_BINDING, isPersistent),
           mLightsData(static_cast<size_t>(numLights)),
           mNumLights{numLights}
     {
@@ -403,14 +891,97 @@ namespace Poe
     }
 
     ////////////////////////////////////////
-    PostProcessUB::PostProcessUB()
-        : mBuffer(sizeof(PostProcessUB__DATA), GL_DYNAMIC_DRAW, UniformBuffer::POSTPROCESS_BLOCK_BINDING)
+    PostProcessUB::PostProcessUB(bool isPersistent)
+        : mBuffer(sizeof(PostProcessUB__DATA), GL_DYNAMIC_DRAW, UniformBuffer::POSTPROCESS_BLOCK_BINDING, isPersistent)
     {
         std::memset(&mData, 0, sizeof(PostProcessUB__DATA));
         mData.kernel[4] = 1.0f; // identity kernel
         mBuffer.Modify(0, sizeof(PostProcessUB__DATA), &mData);
     }
 
+    ////////////////////////////////////////
+    Utility::AABB ComputeVertexBounds(const std::vector<float>& vertices, const std::vector<VertexInfo>& infos)
+    {
+        Utility::AABB bounds;
+        auto info = std::ranges::find_if(infos, [](const VertexInfo& i){ return i.loc == ATTRIB_POS_LOC; });
+        if (info == infos.end() || info->dataType != GL_FLOAT) {
+            return bounds;
+        }
+
+        const size_t stride{ static_cast<size_t>(info->stride) / sizeof(float) };
+        const size_t offset{ info->offset / sizeof(float) };
+        for (size_t i = offset; i + static_cast<size_t>(info->numElements) <= vertices.size(); i += stride) {
+            glm::vec3 position(0.0f);
+            for (int j = 0; j < info->numElements && j < 3; ++j) {
+                position[j] = vertices[i + static_cast<size_t>(j)];
+            }
+            bounds.Extend(position);
+        }
+        return bounds;
+    }
+
+    ////////////////////////////////////////
+    LodView ComputeLodView(const AbstractCamera& camera, int viewportHeight, float maxPixelError, const glm::mat4& model)
+    {
+        LodView view;
+        view.mCameraPosition = glm::vec3(glm::inverse(model) * glm::inverse(camera.GetViewMatrix())[3]);
+
+        // orthographic cameras report no fovy, their levels stay at full resolution
+        const float fovy{ camera.GetFovy() };
+        if (fovy > 0.0f && maxPixelError > 0.0f && viewportHeight > 0) {
+            view.mScale = static_cast<float>(viewportHeight) / (2.0f * glm::tan(fovy * 0.5f)) / maxPixelError;
+        }
+        return view;
+    }
+
+    ////////////////////////////////////////
+    int SelectLod(const std::vector<MeshLod>& lods, const glm::vec3& center, float radius, float errorScale, const LodView& view)
+    {
+        if (view.mScale <= 0.0f) {
+            return 0;
+        }
+
+        const float distance{ std::max(glm::length(center - view.mCameraPosition) - radius, 0.0f) };
+        int lod{};
+        for (size_t i = 1; i < lods.size(); ++i) {
+            if (lods[i].mError * errorScale * view.mScale > distance) {
+                break;
+            }
+            lod = static_cast<int>(i);
+        }
+        return lod;
+    }
+
+    ////////////////////////////////////////
+    std::vector<MeshLod> AppendLodChain(const float* vertices, size_t stride, std::vector<unsigned>& indices,
+                                        unsigned firstIndex, unsigned numIndices, const Utility::AABB& bounds, int maxLods)
+    {
+        std::vector<MeshLod> lods{ { firstIndex, numIndices, 0.0f } };
+        if (!bounds.IsValid() || numIndices == 0) {
+            return lods;
+        }
+
+        // every level is clustered from the full resolution one so errors don't accumulate;
+        // a level has to drop a good share of the triangles to be worth the memory
+        const glm::vec3 size{ bounds.mMax - bounds.mMin };
+        const float longestAxis{ std::max(size.x, std::max(size.y, size.z)) };
+        for (int numCells = 64; numCells >= 4 && static_cast<int>(lods.size()) < maxLods; numCells /= 2) {
+            const float cellSize{ longestAxis / static_cast<float>(numCells) };
+            std::vector<unsigned> simplified{ Utility::SimplifyByVertexClustering(vertices, stride, indices.data() + firstIndex, numIndices, bounds, cellSize) };
+            if (simplified.empty()) {
+                break;
+            }
+            if (static_cast<float>(simplified.size()) > 0.6f * static_cast<float>(lods.back().mNumIndices)) {
+                continue;
+            }
+
+            // a vertex is replaced by another vertex of its cell, which can be as far as the cell's diagonal
+            lods.push_back({ static_cast<unsigned>(indices.size()), static_cast<unsigned>(simplified.size()), cellSize * 1.7320508f });
+            indices.insert(indices.end(), simplified.begin(), simplified.end());
+        }
+        return lods;
+    }
+
     ////////////////////////////////////////
     VAO::VAO(const VertexBuffer& vbo, const IndexBuffer& ebo, const std::vector<VertexInfo>& infos)
         : mNumIndices{static_cast<int>(ebo.GetNumElements())}
@@ -425,7 +996,7 @@ namespace Poe
 
         for (const VertexInfo& info : infos) {
             glEnableVertexArrayAttrib(mId, info.loc);
-            glVertexArrayAttribFormat(mId, info.loc, info.numElements, info.dataType, GL_FALSE, info.offset);
+            glVertexArrayAttribFormat(mId, info.loc, info.numElements, info.dataType, info.normalized ? GL_TRUE : GL_FALSE, info.offset);
             glVertexArrayAttribBinding(mId, info.loc, 0);
         }
     }
@@ -454,27 +1025,58 @@ namespace Poe
     }
 
     ////////////////////////////////////////
-    Shader::Shader(unsigned type, const std::string& source)
-        : mId{glCreateShader(type)}, mType{type}
+    // FNV-1a
+    static unsigned long long HashBytes(const void* data, size_t size, unsigned long long hash = 14695981039346656037ull)
+    {
+        const unsigned char* bytes{ static_cast<const unsigned char*>(data) };
+        for (size_t i = 0; i < size; ++i) {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    ////////////////////////////////////////
+    static unsigned long long HashString(const char* str, unsigned long long hash)
+    {
+        return str ? HashBytes(str, std::strlen(str), hash) : hash;
+    }
+
+    ////////////////////////////////////////
+    Shader::Shader(unsigned type, const std::string& source, std::shared_ptr<const ProgramBinaryCache> cache)
+        : mId{glCreateShader(type)},
+          mType{type},
+          mHash{HashBytes(source.data(), source.size(), HashBytes(&type, sizeof(type)))},
+          mSource{source},
+          mIsCompiled{false},
+          mCache{std::move(cache)}
     {
         assert(source.size() > 0);
+    }
+
+    ////////////////////////////////////////
+    void Shader::Compile() const
+    {
+        if (mIsCompiled) {
+            return;
+        }
 
-        const char* shaderSrc = source.c_str();
+        const char* shaderSrc = mSource.c_str();
         glShaderSource(mId, 1, &shaderSrc, nullptr);
         glCompileShader(mId);
 
-        int success = 0;
-        glGetShaderiv(mId, GL_COMPILE_STATUS, &success);
-        if (!success) {
-            char infolog[512];
-            glGetShaderInfoLog(mId, 512, nullptr, infolog);
-            DebugUI::PushLog(stderr, "[DEBUG] ERROR: %s\n", infolog);
-        }
+        mIsCompiled = true;
+        mSource.clear();
+        mSource.shrink_to_fit();
     }
 
     ////////////////////////////////////////
     Shader::Shader(Shader&& other)
-        : mId{other.mId}, mType{other.mType}
+        : mId{other.mId},
+          mType{other.mType},
+          mHash{other.mHash},
+          mSource{std::move(other.mSource)},
+          mIsCompiled{other.mIsCompiled},
+          mCache{std::move(other.mCache)}
     {
         other.mId = 0;
     }
@@ -487,37 +1089,242 @@ namespace Poe
 
             mId = other.mId;
             mType = other.mType;
+            mHash = other.mHash;
+            mSource = std::move(other.mSource);
+            mIsCompiled = other.mIsCompiled;
+            mCache = std::move(other.mCache);
 
             other.mId = 0;
         }
         return *this;
     }
 
+    ////////////////////////////////////////
+    // <key>.pbin in the cache directory: the header followed by the program binary
+    struct ProgramBinaryHeader
+    {
+        static constexpr std::array<char, 4> MAGIC{ 'P', 'P', 'R', 'G' };
+        static constexpr unsigned VERSION{ 1 };
+
+        std::array<char, 4> mMagic;
+        unsigned mVersion;
+        unsigned mFormat;
+        unsigned long long mKey;
+        size_t mSize;
+    };
+
+    ////////////////////////////////////////
+    int ProgramBinaryCache::NumHits{};
+    int ProgramBinaryCache::NumMisses{};
+
+    ////////////////////////////////////////
+    static std::string GetProgramBinaryPath(const std::string& directory, unsigned long long key)
+    {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.pbin", key);
+        return directory + '/' + name;
+    }
+
+    ////////////////////////////////////////
+    ProgramBinaryCache::ProgramBinaryCache(const std::string& directory)
+        : mDirectory{directory}, mDriverHash{}
+    {
+        if (directory.empty()) {
+            return;
+        }
+
+        GLint numFormats{};
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+        std::error_code ec;
+        if (numFormats <= 0 || (!std::filesystem::create_directories(directory, ec) && ec)) {
+            DebugUI::PushLog(stderr, "[DEBUG] program binary cache is disabled\n");
+            mDirectory.clear();
+            return;
+        }
+
+        // a driver update invalidates every binary
+        mDriverHash = HashString(reinterpret_cast<const char*>(glGetString(GL_VENDOR)), 14695981039346656037ull);
+        mDriverHash = HashString(reinterpret_cast<const char*>(glGetString(GL_RENDERER)), mDriverHash);
+        mDriverHash = HashString(reinterpret_cast<const char*>(glGetString(GL_VERSION)), mDriverHash);
+    }
+
+    ////////////////////////////////////////
+    unsigned long long ProgramBinaryCache::ComputeKey(std::initializer_list<std::reference_wrapper<const Shader>> shaders) const
+    {
+        unsigned long long key{ mDriverHash };
+        for (const Shader& shader : shaders) {
+            unsigned long long hash{ shader.GetHash() };
+            key = HashBytes(&hash, sizeof(hash), key);
+        }
+        return key;
+    }
+
+    ////////////////////////////////////////
+    bool ProgramBinaryCache::Load(unsigned program, unsigned long long key) const
+    {
+        if (!IsEnabled()) {
+            return false;
+        }
+
+        IO::MappedFile file(GetProgramBinaryPath(mDirectory, key));
+        ProgramBinaryHeader header;
+        if (!file.IsValid() || file.GetSize() < sizeof(header)) {
+            ++NumMisses;
+            return false;
+        }
+        std::memcpy(&header, file.GetData(), sizeof(header));
+        if (header.mMagic != ProgramBinaryHeader::MAGIC ||
+            header.mVersion != ProgramBinaryHeader::VERSION ||
+            header.mKey != key ||
+            file.GetSize() != sizeof(header) + header.mSize) {
+            ++NumMisses;
+            return false;
+        }
+
+        glProgramBinary(program, header.mFormat, file.GetData() + sizeof(header), static_cast<GLsizei>(header.mSize));
+        int success = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        success ? ++NumHits : ++NumMisses;
+        return success;
+    }
+
+    ////////////////////////////////////////
+    void ProgramBinaryCache::Save(unsigned program, unsigned long long key) const
+    {
+        if (!IsEnabled()) {
+            return;
+        }
+
+        GLint size{};
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+        if (size <= 0) {
+            return;
+        }
+
+        std::vector<unsigned char> data(sizeof(ProgramBinaryHeader) + static_cast<size_t>(size));
+        GLenum format{};
+        GLsizei written{};
+        glGetProgramBinary(program, size, &written, &format, data.data() + sizeof(ProgramBinaryHeader));
+
+        ProgramBinaryHeader header{ ProgramBinaryHeader::MAGIC, ProgramBinaryHeader::VERSION, format, key, static_cast<size_t>(written) };
+        std::memcpy(data.data(), &header, sizeof(header));
+        data.resize(sizeof(header) + static_cast<size_t>(written));
+
+        if (!IO::WriteBinaryFile(GetProgramBinaryPath(mDirectory, key), data.data(), data.size())) {
+            DebugUI::PushLog(stderr, "[DEBUG] ERROR: couldn't write the program binary %016llx\n", key);
+        }
+    }
+
     ////////////////////////////////////////
     Program::Program(std::initializer_list<std::reference_wrapper<const Shader>> shaders)
-        : mId{glCreateProgram()}
+        : mId{glCreateProgram()},
+          mCache{shaders.size() > 0 ? shaders.begin()->get().GetCache() : nullptr},
+          mCacheKey{mCache ? mCache->ComputeKey(shaders) : 0},
+          mIsResolved{false}
     {
+        if (mCache && mCache->Load(mId, mCacheKey)) {
+            mIsResolved = true;
+            return;
+        }
+
+        // every compile is issued before anything waits on one of them
         for (const Shader& shader : shaders)
+            shader.Compile();
+        for (const Shader& shader : shaders) {
             glAttachShader(mId, shader.GetId());
+            mPendingShaders.push_back(shader.GetId());
+        }
+        if (mCache && mCache->IsEnabled())
+            glProgramParameteri(mId, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
         glLinkProgram(mId);
 
+        for (const Shader& shader : shaders)
+            glDetachShader(mId, shader.GetId());
+    }
+
+    ////////////////////////////////////////
+    void Program::Resolve() const
+    {
+        mIsResolved = true;
+
         int success = 0;
         glGetProgramiv(mId, GL_LINK_STATUS, &success);
         if (!success) {
             char infolog[512];
+            for (unsigned shader : mPendingShaders) {
+                glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+                if (!success) {
+                    glGetShaderInfoLog(shader, 512, nullptr, infolog);
+                    DebugUI::PushLog(stderr, "[DEBUG] ERROR: %s\n", infolog);
+                }
+            }
             glGetProgramInfoLog(mId, 512, nullptr, infolog);
             DebugUI::PushLog(stderr, "[DEBUG] ERROR: %s\n", infolog);
         }
+        else {
+            if (mCache) {
+                mCache->Save(mId, mCacheKey);
+            }
+            ApplyInitialUniforms();
+        }
 
-        for (const Shader& shader : shaders)
-            glDetachShader(mId, shader.GetId());
+        mPendingShaders.clear();
+        mPendingShaders.shrink_to_fit();
+    }
+
+    ////////////////////////////////////////
+    void Program::ApplyInitialUniforms() const
+    {
+        for (const auto& [location, value] : mInitialInts)
+            glProgramUniform1i(mId, location, value);
+        for (const auto& [location, value] : mInitialFloats)
+            glProgramUniform1f(mId, location, value);
+        mInitialInts.clear();
+        mInitialFloats.clear();
+    }
+
+    ////////////////////////////////////////
+    void Program::SetInitialUniform(int location, int value) const
+    {
+        mInitialInts.emplace_back(location, value);
+        if (mIsResolved) {
+            ApplyInitialUniforms();
+        }
+    }
+
+    ////////////////////////////////////////
+    void Program::SetInitialUniform(int location, float value) const
+    {
+        mInitialFloats.emplace_back(location, value);
+        if (mIsResolved) {
+            ApplyInitialUniforms();
+        }
+    }
+
+    ////////////////////////////////////////
+    bool Program::IsReady() const
+    {
+        if (mIsResolved || !GLAD_GL_KHR_parallel_shader_compile) {
+            return true;
+        }
+        int isCompleted = 0;
+        glGetProgramiv(mId, GL_COMPLETION_STATUS_KHR, &isCompleted);
+        return isCompleted;
     }
 
     ////////////////////////////////////////
     Program::Program(Program&& other)
-        : mId{other.mId}, mUniforms{other.mUniforms}
+        : mId{other.mId},
+          mUniforms{other.mUniforms},
+          mPendingShaders{std::move(other.mPendingShaders)},
+          mInitialInts{std::move(other.mInitialInts)},
+          mInitialFloats{std::move(other.mInitialFloats)},
+          mCache{std::move(other.mCache)},
+          mCacheKey{other.mCacheKey},
+          mIsResolved{other.mIsResolved}
     {
         other.mId = 0;
+        other.mIsResolved = true;
     }
 
     ////////////////////////////////////////
@@ -527,7 +1334,14 @@ namespace Poe
             glDeleteProgram(mId);
             mId = other.mId;
             mUniforms = other.mUniforms;
+            mPendingShaders = std::move(other.mPendingShaders);
+            mInitialInts = std::move(other.mInitialInts);
+            mInitialFloats = std::move(other.mInitialFloats);
+            mCache = std::move(other.mCache);
+            mCacheKey = other.mCacheKey;
+            mIsResolved = other.mIsResolved;
             other.mId = 0;
+            other.mIsResolved = true;
         }
         return *this;
     }
@@ -543,24 +1357,76 @@ namespace Poe
                                   { "POE_POST_PROCESS_BLOCK_LOC", UniformBuffer::POSTPROCESS_BLOCK_BINDING } },
                                 { rootPath + "/shaders/post_processing/gamma.glsl" }) }
     {
-        mProgram.Use();
-            glUniform1i(SCREEN_TEXTURE_LOC, 0);
-        mProgram.Halt();
+        mProgram.SetInitialUniform(SCREEN_TEXTURE_LOC, 0);
     }
 
     ////////////////////////////////////////
     void StaticMesh::ReconfigureMatrixBuffer()
     {
         if (mNumInstances > 0) {
-            mModelMatrixBuffer->Bind();
-            mVao.Bind();
-            for (unsigned i = INSTANCED_MODEL_LOC; i < INSTANCED_MODEL_LOC + 4; ++i) {
-                glEnableVertexAttribArray(i);
-                glVertexAttribPointer(i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), reinterpret_cast<const void*>((i - 8) * sizeof(glm::vec4)));
-                glVertexAttribDivisor(i, 1);
+            mMatrixBufferOffset = mModelMatrixBuffer->GetOffset();
+            ConfigureMatrixBuffer(mVao, *mModelMatrixBuffer);
+            if (mPositionVao) {
+                ConfigureMatrixBuffer(*mPositionVao, *mModelMatrixBuffer);
             }
-            mVao.UnBind();
-            mModelMatrixBuffer->UnBind();
+            if (mCulledVao) {
+                // one compacted range per level of detail
+                mCulledMatrixBuffer.reset(new VertexBuffer(16 * static_cast<size_t>(mNumInstances) * mLods.size(), GL_DYNAMIC_COPY));
+                ConfigureMatrixBuffer(*mCulledVao, *mCulledMatrixBuffer);
+            }
+        }
+    }
+
+    ////////////////////////////////////////
+    void StaticMesh::ConfigureMatrixBuffer(const VAO& vao, const VertexBuffer& matrixBuffer) const
+    {
+        matrixBuffer.Bind();
+        vao.Bind();
+        for (unsigned i = INSTANCED_MODEL_LOC; i < INSTANCED_MODEL_LOC + 4; ++i) {
+            glEnableVertexAttribArray(i);
+            glVertexAttribPointer(i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), reinterpret_cast<const void*>(matrixBuffer.GetOffset() + (i - 8) * sizeof(glm::vec4)));
+            glVertexAttribDivisor(i, 1);
+        }
+        vao.UnBind();
+        matrixBuffer.UnBind();
+    }
+
+    ////////////////////////////////////////
+    void StaticMesh::EnableInstanceCulling()
+    {
+        if (mCulledVao) {
+            return;
+        }
+        mCulledVao.reset(new VAO(mVbo, mEbo, mInfos));
+        mCulledCommand.reset(new IndirectBuffer(MAX_MESH_LODS, GL_DYNAMIC_DRAW));
+        ReconfigureMatrixBuffer();
+        ResetCulledCommand();
+    }
+
+    ////////////////////////////////////////
+    void StaticMesh::EnablePersistentMatrixBuffer()
+    {
+        if (mIsMatrixBufferPersistent) {
+            return;
+        }
+        mIsMatrixBufferPersistent = true;
+
+        // one-time readback so the current instances survive the switch
+        std::shared_ptr<VertexBuffer> oldBuffer{ std::move(mModelMatrixBuffer) };
+        mModelMatrixBuffer.reset(new VertexBuffer(oldBuffer->GetNumElements(), GL_DYNAMIC_DRAW, true));
+        glGetNamedBufferSubData(oldBuffer->GetId(), 0, static_cast<GLsizeiptr>(oldBuffer->GetNumElements() * sizeof(float)), mModelMatrixBuffer->GetWritePtr());
+        mModelMatrixBuffer->Unmap();
+        ReconfigureMatrixBuffer();
+    }
+
+    ////////////////////////////////////////
+    void StaticMesh::ShareInstances(const StaticMesh& other)
+    {
+        if (mModelMatrixBuffer != other.mModelMatrixBuffer) {
+            mModelMatrixBuffer = other.mModelMatrixBuffer;
+            mIsMatrixBufferPersistent = other.mIsMatrixBufferPersistent;
+            mNumInstances = other.mNumInstances;
+            ReconfigureMatrixBuffer();
         }
     }
 
@@ -569,9 +1435,8 @@ namespace Poe
     {
         int numMatrices = static_cast<int>(modelMatrices.size());
         if (numMatrices > 0) {
-            VertexBuffer* oldBuffer = mModelMatrixBuffer.release();
-            delete oldBuffer;
-            mModelMatrixBuffer.reset(new VertexBuffer(16 * static_cast<size_t>(numMatrices), GL_DYNAMIC_DRAW));
+            mModelMatrixBuffer.reset();
+            mModelMatrixBuffer.reset(new VertexBuffer(16 * static_cast<size_t>(numMatrices), GL_DYNAMIC_DRAW, mIsMatrixBufferPersistent));
             int i{};
             for (const glm::mat4& model : modelMatrices) {
                 mModelMatrixBuffer->Modify(i * static_cast<int>(sizeof(glm::mat4)), sizeof(glm::mat4), glm::value_ptr(model));
@@ -587,9 +1452,8 @@ namespace Poe
     {
         int numMatrices = static_cast<int>(modelMatrices.size());
         if (numMatrices > 0) {
-            VertexBuffer* oldBuffer = mModelMatrixBuffer.release();
-            delete oldBuffer;
-            mModelMatrixBuffer.reset(new VertexBuffer(16 * static_cast<size_t>(numMatrices), GL_DYNAMIC_DRAW));
+            mModelMatrixBuffer.reset();
+            mModelMatrixBuffer.reset(new VertexBuffer(16 * static_cast<size_t>(numMatrices), GL_DYNAMIC_DRAW, mIsMatrixBufferPersistent));
             float* modelMatrixPtr = mModelMatrixBuffer->GetWritePtr();
             std::memcpy(modelMatrixPtr, modelMatrices.data(), modelMatrices.size() * sizeof(glm::mat4));
             assert(mModelMatrixBuffer->Unmap() == GL_TRUE);
@@ -602,14 +1466,128 @@ namespace Poe
     void StaticMesh::CreateInstances(int numInstances)
     {
         if (numInstances > 0) {
-            VertexBuffer* oldBuffer = mModelMatrixBuffer.release();
-            delete oldBuffer;
-            mModelMatrixBuffer.reset(new VertexBuffer(16 * static_cast<size_t>(numInstances), GL_DYNAMIC_DRAW));
+            mModelMatrixBuffer.reset();
+            mModelMatrixBuffer.reset(new VertexBuffer(16 * static_cast<size_t>(numInstances), GL_DYNAMIC_DRAW, mIsMatrixBufferPersistent));
             mNumInstances = numInstances;
             ReconfigureMatrixBuffer();
         }
     }
 
+    ////////////////////////////////////////
+    void StaticMesh::ReplaceIndices(const std::vector<unsigned>& indices)
+    {
+        mEbo = IndexBuffer(indices, GL_STATIC_DRAW);
+        glVertexArrayElementBuffer(mVao.GetId(), mEbo.GetId());
+        if (mCulledVao) {
+            glVertexArrayElementBuffer(mCulledVao->GetId(), mEbo.GetId());
+        }
+        if (mPositionVao) {
+            glVertexArrayElementBuffer(mPositionVao->GetId(), mEbo.GetId());
+        }
+    }
+
+    ////////////////////////////////////////
+    static unsigned GetVertexAttributeSize(const VertexInfo& info)
+    {
+        const unsigned numElements{ static_cast<unsigned>(info.numElements) };
+        switch (info.dataType) {
+            case GL_INT_2_10_10_10_REV:
+            case GL_UNSIGNED_INT_2_10_10_10_REV:
+                return 4;
+            case GL_BYTE:
+            case GL_UNSIGNED_BYTE:
+                return numElements;
+            case GL_SHORT:
+            case GL_UNSIGNED_SHORT:
+            case GL_HALF_FLOAT:
+                return 2 * numElements;
+            default:
+                return 4 * numElements;
+        }
+    }
+
+    ////////////////////////////////////////
+    void StaticMesh::CreatePositionStream(const unsigned char* vertices)
+    {
+        auto info = std::ranges::find_if(mInfos, [](const VertexInfo& i){ return i.loc == ATTRIB_POS_LOC; });
+        if (info == mInfos.end()) {
+            DebugUI::PushLog(stderr, "[DEBUG] ERROR: Position stream needs an attribute at ATTRIB_POS_LOC\n");
+            return;
+        }
+
+        // padded to whole words, the buffer is sized in floats
+        const size_t size{ GetVertexAttributeSize(*info) };
+        const size_t stride{ (size + 3) & ~size_t{ 3 } };
+        const size_t numVertices{ mVbo.GetNumElements() * sizeof(float) / static_cast<size_t>(info->stride) };
+        std::vector<float> positions(numVertices * stride / sizeof(float));
+        unsigned char* dst{ reinterpret_cast<unsigned char*>(positions.data()) };
+        for (size_t i = 0; i < numVertices; ++i) {
+            std::memcpy(dst + i * stride, vertices + i * static_cast<size_t>(info->stride) + info->offset, size);
+        }
+
+        mPositionVbo.reset(new VertexBuffer(positions.data(), positions.size()));
+        mPositionVao.reset(new VAO(*mPositionVbo, mEbo, { { info->loc, info->numElements, info->dataType, static_cast<int>(stride), 0, info->normalized } }));
+        ReconfigureMatrixBuffer();
+    }
+
+    ////////////////////////////////////////
+    void StaticMesh::EnablePositionStream()
+    {
+        if (mPositionVao) {
+            return;
+        }
+        std::vector<float> vertices(mVbo.GetNumElements());
+        glGetNamedBufferSubData(mVbo.GetId(), 0, static_cast<GLsizeiptr>(vertices.size() * sizeof(float)), vertices.data());
+        CreatePositionStream(reinterpret_cast<const unsigned char*>(vertices.data()));
+    }
+
+    ////////////////////////////////////////
+    void StaticMesh::GenerateLods(int maxLods)
+    {
+        auto info = std::ranges::find_if(mInfos, [](const VertexInfo& i){ return i.loc == ATTRIB_POS_LOC; });
+        if (info == mInfos.end() || info->dataType != GL_FLOAT || info->numElements != 3 || info->offset != 0) {
+            DebugUI::PushLog(stderr, "[DEBUG] ERROR: Levels of detail need GL_FLOAT positions at the start of each vertex\n");
+            return;
+        }
+        // one-time readback, procedural meshes don't keep their geometry around
+        std::vector<float> vertices(mVbo.GetNumElements());
+        glGetNamedBufferSubData(mVbo.GetId(), 0, static_cast<GLsizeiptr>(vertices.size() * sizeof(float)), vertices.data());
+        std::vector<unsigned> indices(mLods[0].mNumIndices);
+        glGetNamedBufferSubData(mEbo.GetId(), static_cast<GLintptr>(mLods[0].mFirstIndex * sizeof(unsigned)),
+                                static_cast<GLsizeiptr>(indices.size() * sizeof(unsigned)), indices.data());
+
+        const size_t stride{ static_cast<size_t>(info->stride) / sizeof(float) };
+        if (!mBounds.IsValid()) {
+            mBounds = ComputeVertexBounds(vertices, mInfos);
+        }
+
+        std::vector<MeshLod> lods{ AppendLodChain(vertices.data(), stride, indices, 0, static_cast<unsigned>(indices.size()), mBounds, maxLods) };
+        ReplaceIndices(indices);
+        SetLods(lods);
+    }
+
+    ////////////////////////////////////////
+    void StaticMesh::SetLods(const std::vector<MeshLod>& lods)
+    {
+        assert(!lods.empty() && lods.size() <= static_cast<size_t>(MAX_MESH_LODS));
+        mLods = lods;
+        if (mCulledVao) {
+            ReconfigureMatrixBuffer();
+            ResetCulledCommand();
+        }
+    }
+
+    ////////////////////////////////////////
+    int StaticMesh::SelectLod(const LodView& view, const glm::mat4& model) const
+    {
+        if (mLods.size() < 2 || !mBounds.IsValid()) {
+            return 0;
+        }
+        const float scale{ std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2])))) };
+        const glm::vec3 center{ model * glm::vec4(mBounds.GetCenter(), 1.0f) };
+        return Poe::SelectLod(mLods, center, glm::length(mBounds.GetExtents()) * scale, scale, view);
+    }
+
     ////////////////////////////////////////
     StaticMesh CreateColoredTriangle(int numInstances)
     {
@@ -1313,87 +2291,23 @@ namespace Poe
     }
 
     ////////////////////////////////////////
-    void StaticModel::Load()
-    {
-        assert(mPath.size() > 0);
-        Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(mPath.data(),
-                                                 aiProcess_JoinIdenticalVertices |
-                                                 aiProcess_Triangulate |
-                                                 aiProcess_GenNormals |
-                                                 aiProcess_ImproveCacheLocality |
-                                                 aiProcess_RemoveRedundantMaterials |
-                                                 aiProcess_GenUVCoords |
-                                                 aiProcess_OptimizeMeshes |
-                                                 aiProcess_OptimizeGraph |
-                                                 aiProcess_FlipUVs);
-        if (!scene || (scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE) || !scene->mRootNode) {
-            DebugUI::PushLog(stderr, "[ERROR] ASSIMP: %s\n", importer.GetErrorString());
-            return;
-        }
-        mDirectory = mPath.substr(0, mPath.find_last_of('/'));
-        LoadNode(scene->mRootNode, scene);
-#ifdef _DEBUG
-        size_t numVertices{}, numIndices{};
-        for (const StaticMesh& mesh : mMeshes) {
-            numVertices += mesh.GetNumVertices();
-            numIndices += mesh.GetNumIndices();
-        }
-        size_t numMeshes = mMeshes.size();
-        DebugUI::PushLog(stdout, "[DEBUG] Loaded %s (%d vertices, %d indices, %d mesh%s, %d texture%s)\n", mPath.c_str(), numVertices, numIndices, numMeshes, numMeshes > 1 ? "es" : "", mNumTextures, mNumTextures > 1 ? "s" : "");
-#else
-        int numMeshes = static_cast<int>(mMeshes.size());
-        DebugUI::PushLog(stdout, "[DEBUG] Loaded %s (%d mesh%s, %d texture%s)", mPath.c_str(), numMeshes, numMeshes > 1 ? "es" : "", mNumTextures, mNumTextures > 1 ? "s" : "");
-#endif
-    }
+    static const std::vector<VertexInfo> STATIC_MODEL_VERTEX_INFOS{
+        { 0, 3, GL_FLOAT, static_cast<int>(8 * sizeof(float)), 0 },
+        { 1, 2, GL_FLOAT, static_cast<int>(8 * sizeof(float)), 6 * sizeof(float) },
+        { 2, 3, GL_FLOAT, static_cast<int>(8 * sizeof(float)), 3 * sizeof(float) }
+    };
 
     ////////////////////////////////////////
-    void StaticModel::LoadNode(aiNode* node, const aiScene* scene)
-    {
-        assert(node != nullptr && scene != nullptr);
-        for (int i = 0; i < static_cast<int>(node->mNumMeshes); ++i) {
-            aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            mMeshes.push_back(LoadStaticMesh(mesh, scene));
-        }
-        for (int i = 0; i < static_cast<int>(node->mNumChildren); ++i)
-            LoadNode(node->mChildren[i], scene);
-    }
+    // see QuantizeStaticModelVertices
+    static const std::vector<VertexInfo> STATIC_MODEL_QUANTIZED_VERTEX_INFOS{
+        { 0, 3, GL_UNSIGNED_SHORT, 16, 0, true },
+        { 1, 2, GL_HALF_FLOAT, 16, 12, false },
+        { 2, 4, GL_INT_2_10_10_10_REV, 16, 8, true }
+    };
 
-    // ////////////////////////////////////////
-    StaticMesh StaticModel::LoadStaticMesh(aiMesh* mesh, const aiScene* scene)
+    ////////////////////////////////////////
+    static float* WriteStaticModelVertices(float* vboPtr, const aiMesh* mesh)
     {
-        assert(mesh != nullptr && scene != nullptr);
-
-        static std::vector<VertexInfo> infos{
-            { 0, 3, GL_FLOAT, static_cast<int>(8 * sizeof(float)), 0 },
-            { 1, 2, GL_FLOAT, static_cast<int>(8 * sizeof(float)), 6 * sizeof(float) },
-            { 2, 3, GL_FLOAT, static_cast<int>(8 * sizeof(float)), 3 * sizeof(float) }
-        };
-
-        std::vector<std::reference_wrapper<const Texture2D>> ambientTextures;
-        std::vector<std::reference_wrapper<const Texture2D>> diffuseTextures;
-        std::vector<std::reference_wrapper<const Texture2D>> specularTextures;
-
-        aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-        if (material != nullptr)
-        {
-            ambientTextures = Load2DTextures(material, aiTextureType_AMBIENT, "texture_ambient");
-            diffuseTextures = Load2DTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-            specularTextures = Load2DTextures(material, aiTextureType_SPECULAR, "texture_specular");
-        }
-
-        size_t numIndices{};
-        for (size_t i = 0; i < mesh->mNumFaces; ++i)
-            for (int j = 0; j < static_cast<int>(mesh->mFaces[i].mNumIndices); ++j)
-                ++numIndices;
-
-        StaticMesh staticMesh(mNumInstances, mesh->mNumVertices * 8, numIndices, infos);
-        std::ranges::for_each(ambientTextures, [&](const Texture2D& t){ staticMesh.AddAmbientTexture(t); });
-        std::ranges::for_each(diffuseTextures, [&](const Texture2D& t){ staticMesh.AddDiffuseTexture(t); });
-        std::ranges::for_each(specularTextures, [&](const Texture2D& t){ staticMesh.AddSpecularTexture(t); });
-
-        float* vboPtr = staticMesh.GetVboWritePtr();
-
         for (int i = 0; i < static_cast<int>(mesh->mNumVertices); ++i) {
             *vboPtr++ = mesh->mVertices[i].x;
             *vboPtr++ = mesh->mVertices[i].y;
@@ -1406,91 +2320,1019 @@ namespace Poe
             *vboPtr++ = mesh->mTextureCoords[0][i].x;
             *vboPtr++ = mesh->mTextureCoords[0][i].y;
         }
-        assert(staticMesh.UnmapVbo() == GL_TRUE);
-
-        unsigned* eboPtr = staticMesh.GetEboWritePtr();
-        for (int i = 0; i < static_cast<int>(mesh->mNumFaces); ++i) {
-            const aiFace& face = mesh->mFaces[i];
-            for (int j = 0; j < static_cast<int>(face.mNumIndices); ++j)
-                *eboPtr++ = face.mIndices[j];
-        }
-        assert(staticMesh.UnmapEbo() == GL_TRUE);
-        return staticMesh;
+        return vboPtr;
     }
 
-    ///////////////////////////////////////////
-    std::vector<std::reference_wrapper<const Texture2D>> StaticModel::Load2DTextures(aiMaterial* material, aiTextureType type, std::string_view typeName)
+    ////////////////////////////////////////
+    static Utility::AABB ComputeStaticModelBounds(const aiMesh* mesh)
     {
-        std::vector<std::reference_wrapper<const Texture2D>> textures;
-        for (size_t i = 0; i < material->GetTextureCount(type); ++i) {
-            aiString str_ai;
-            material->GetTexture(type, static_cast<unsigned>(i), &str_ai);
-            std::string str{ str_ai.C_Str() };
-
-            Texture2DParams params{};
-            const Texture2D& tex = mTexture2DLoader.Load(mDirectory + '/' + str, params);
-            textures.push_back(tex);
-            ++mNumTextures;
-        }
-        return textures;
+        Utility::AABB bounds;
+        for (int i = 0; i < static_cast<int>(mesh->mNumVertices); ++i)
+            bounds.Extend(glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z));
+        return bounds;
     }
 
     ////////////////////////////////////////
-    void StaticModel::CreateInstances(std::initializer_list<glm::mat4> modelMatrices)
+    // <model>[.merged][.q].pmesh next to the source: the header, one record per mesh, the interleaved
+    // vertices, the indices with every level of detail and the '\0' separated texture paths
+    // of every mesh
+    struct StaticModelCacheHeader
     {
-        std::ranges::for_each(mMeshes, [&](auto& m){ m.CreateInstances(modelMatrices); });
-        mNumInstances = static_cast<int>(modelMatrices.size());
+        static constexpr std::array<char, 4> MAGIC{ 'P', 'M', 'S', 'H' };
+        static constexpr unsigned VERSION{ 5 };
+
+        std::array<char, 4> mMagic;
+        unsigned mVersion;
+        unsigned mImportFlags;
+        unsigned mIsMerged;
+        unsigned mVertexFormat;
+        unsigned mReserved; // pads mSourceTime explicitly, written as 0
+        long long mSourceTime;
+        size_t mNumMeshes;
+        size_t mNumVertexElements;
+        size_t mNumIndices;
+        size_t mPathsSize;
+    };
+
+    // the header is written bytewise, padding would leak uninitialized bytes into the file
+    static_assert(std::has_unique_object_representations_v<StaticModelCacheHeader>);
+
+    ////////////////////////////////////////
+    // merged caches are sorted by material and their indices are absolute, every full
+    // resolution level comes first there. Otherwise the indices of a mesh are one block
+    // with all of its levels.
+    struct StaticModelCacheRecord
+    {
+        unsigned mFirstVertexElement;
+        unsigned mNumVertexElements;
+        unsigned mFirstIndex;
+        unsigned mNumIndices;
+        unsigned mFirstPath;
+        std::array<unsigned, 3> mNumPaths; // ambient, diffuse, specular
+        std::array<float, 6> mBounds;
+        std::array<MeshLod, MAX_MESH_LODS> mLods; // absolute index ranges
+        unsigned mNumLods;
+    };
+
+    ////////////////////////////////////////
+    static Utility::AABB GetStaticModelCacheBounds(const StaticModelCacheRecord& record)
+    {
+        return Utility::AABB{ glm::vec3(record.mBounds[0], record.mBounds[1], record.mBounds[2]),
+                              glm::vec3(record.mBounds[3], record.mBounds[4], record.mBounds[5]) };
     }
 
     ////////////////////////////////////////
-    void StaticModel::CreateInstances(const std::vector<glm::mat4>& modelMatrices)
+    // 8 floats per vertex to the four words of STATIC_MODEL_QUANTIZED_VERTEX_INFOS,
+    // positions are normalized to bounds
+    static void QuantizeStaticModelVertices(const float* vertices, size_t numVertices, const Utility::AABB& bounds, float* quantized)
     {
-        std::ranges::for_each(mMeshes, [&](auto& m){ m.CreateInstances(modelMatrices); });
-        mNumInstances = static_cast<int>(modelMatrices.size());
+        const glm::vec3 size{ glm::max(bounds.mMax - bounds.mMin, glm::vec3(std::numeric_limits<float>::min())) };
+        auto packSnorm10 = [](float value) {
+            return static_cast<unsigned>(static_cast<int>(glm::round(glm::clamp(value, -1.0f, 1.0f) * 511.0f))) & 0x3FFu;
+        };
+        for (size_t i = 0; i < numVertices; ++i) {
+            const float* vertex{ vertices + i * 8 };
+            const glm::vec3 position{ glm::clamp((glm::vec3(vertex[0], vertex[1], vertex[2]) - bounds.mMin) / size, 0.0f, 1.0f) };
+            const std::array<unsigned, 4> words{ glm::packUnorm2x16(glm::vec2(position.x, position.y)),
+                                                 glm::packUnorm2x16(glm::vec2(position.z, 0.0f)),
+                                                 packSnorm10(vertex[3]) | (packSnorm10(vertex[4]) << 10) | (packSnorm10(vertex[5]) << 20),
+                                                 glm::packHalf2x16(glm::vec2(vertex[6], vertex[7])) };
+            std::memcpy(quantized + i * 4, words.data(), sizeof(words));
+        }
     }
 
     ////////////////////////////////////////
-    void StaticModel::CreateInstances(int numInstances)
-    {
-        std::ranges::for_each(mMeshes, [&](auto& m){ m.CreateInstances(numInstances); });
-        mNumInstances = numInstances;
-    }
+    static constexpr unsigned STATIC_MODEL_IMPORT_FLAGS{ aiProcess_JoinIdenticalVertices |
+                                                         aiProcess_Triangulate |
+                                                         aiProcess_GenNormals |
+                                                         aiProcess_ImproveCacheLocality |
+                                                         aiProcess_RemoveRedundantMaterials |
+                                                         aiProcess_GenUVCoords |
+                                                         aiProcess_OptimizeMeshes |
+                                                         aiProcess_OptimizeGraph |
+                                                         aiProcess_FlipUVs };
 
     ////////////////////////////////////////
-    StaticModel LoadSponza(const std::string& rootPath, Texture2DLoader& loader)
+    static void CollectStaticModelMeshes(aiNode* node, const aiScene* scene, std::vector<aiMesh*>& meshes)
     {
-        return StaticModel(0, rootPath + "/models/Sponza/scene.gltf", loader);
+        assert(node != nullptr && scene != nullptr);
+        for (int i = 0; i < static_cast<int>(node->mNumMeshes); ++i)
+            meshes.push_back(scene->mMeshes[node->mMeshes[i]]);
+        for (int i = 0; i < static_cast<int>(node->mNumChildren); ++i)
+            CollectStaticModelMeshes(node->mChildren[i], scene, meshes);
     }
 
     ////////////////////////////////////////
-    StaticModel LoadCsItaly(const std::string& rootPath, Texture2DLoader& loader)
+    static std::array<std::vector<std::string>, 3> CollectStaticModelTexturePaths(const aiMesh* mesh, const aiScene* scene)
     {
-        return StaticModel(0, rootPath + "/models/cs_italy/scene.gltf", loader);
+        std::array<std::vector<std::string>, 3> paths;
+        const aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+        if (material != nullptr) {
+            std::array<aiTextureType, 3> types{ aiTextureType_AMBIENT, aiTextureType_DIFFUSE, aiTextureType_SPECULAR };
+            for (size_t i = 0; i < types.size(); ++i) {
+                for (unsigned j = 0; j < material->GetTextureCount(types[i]); ++j) {
+                    aiString str_ai;
+                    material->GetTexture(types[i], j, &str_ai);
+                    paths[i].emplace_back(str_ai.C_Str());
+                }
+            }
+        }
+        return paths;
     }
 
     ////////////////////////////////////////
-    StaticModel LoadDeDust(const std::string& rootPath, Texture2DLoader& loader)
+    // every layout gets its own file, so models loaded both ways don't evict each other
+    static std::string GetStaticModelCachePath(const std::string& modelPath, bool isMerged, VertexFormat vertexFormat)
     {
-        return StaticModel(0, rootPath + "/models/de_dust/scene.gltf", loader);
+        return modelPath + (isMerged ? ".merged" : "") + (vertexFormat == VertexFormat::Quantized ? ".q" : "") + ".pmesh";
     }
 
     ////////////////////////////////////////
-    Shader& ShaderLoader::Load(GLuint type, const std::string& shaderUrl)
+    static bool IsStaticModelCacheValid(const unsigned char* data, size_t size, const std::string& modelPath, bool isMerged, VertexFormat vertexFormat)
     {
-        auto iter = mShaders.find({shaderUrl, type});
-        if (iter == mShaders.end()) {
-            std::string contents = IO::ReadTextFile(shaderUrl.data());
-            std::string header = ComputeOpenGLVersionStringForShader();
-            std::string shaderType = ComputeShaderTypeStringForShader(type);
-            Shader shader(type, header + shaderType + contents);
-            auto s = mShaders.insert({std::make_pair(shaderUrl, type), std::move(shader)});
-            return s.first->second;
+        if (!data || size < sizeof(StaticModelCacheHeader)) {
+            return false;
+        }
+        StaticModelCacheHeader header;
+        std::memcpy(&header, data, sizeof(header));
+        if (header.mMagic != StaticModelCacheHeader::MAGIC ||
+            header.mVersion != StaticModelCacheHeader::VERSION ||
+            header.mImportFlags != STATIC_MODEL_IMPORT_FLAGS ||
+            header.mIsMerged != static_cast<unsigned>(isMerged) ||
+            header.mVertexFormat != static_cast<unsigned>(vertexFormat) ||
+            header.mSourceTime != IO::GetFileModificationTime(modelPath)) {
+            return false;
         }
-        return iter->second;
-    }
 
-    ////////////////////////////////////////
-    Shader& ShaderLoader::Load(GLuint type, const std::string& shaderUrl, const std::vector<std::pair<std::string, float>>& values)
+        // no count can exceed the file, so the sum below can't wrap around
+        if (header.mNumMeshes > size || header.mNumVertexElements > size || header.mNumIndices > size || header.mPathsSize > size) {
+            return false;
+        }
+        size_t expectedSize{ sizeof(StaticModelCacheHeader) +
+                             header.mNumMeshes * sizeof(StaticModelCacheRecord) +
+                             header.mNumVertexElements * sizeof(float) +
+                             header.mNumIndices * sizeof(unsigned) +
+                             header.mPathsSize };
+        if (size != expectedSize) {
+            return false;
+        }
+
+        // LoadFromCache trusts every range below
+        const unsigned char* records{ data + sizeof(StaticModelCacheHeader) };
+        const char* paths{ reinterpret_cast<const char*>(data + size - header.mPathsSize) };
+        if (header.mPathsSize > 0 && paths[header.mPathsSize - 1] != '\0') {
+            return false;
+        }
+        const size_t numPaths{ static_cast<size_t>(std::count(paths, paths + header.mPathsSize, '\0')) };
+
+        auto isInRange = [](size_t first, size_t count, size_t total) { return first <= total && count <= total - first; };
+        for (size_t i = 0; i < header.mNumMeshes; ++i) {
+            StaticModelCacheRecord record;
+            std::memcpy(&record, records + i * sizeof(StaticModelCacheRecord), sizeof(record));
+
+            const size_t recordPaths{ static_cast<size_t>(record.mNumPaths[0]) + record.mNumPaths[1] + record.mNumPaths[2] };
+            if (!isInRange(record.mFirstVertexElement, record.mNumVertexElements, header.mNumVertexElements) ||
+                !isInRange(record.mFirstIndex, record.mNumIndices, header.mNumIndices) ||
+                !isInRange(record.mFirstPath, recordPaths, numPaths) ||
+                record.mNumLods > MAX_MESH_LODS) {
+                return false;
+            }
+            for (unsigned j = 0; j < record.mNumLods; ++j) {
+                const MeshLod& lod{ record.mLods[j] };
+                // separate meshes store their levels relative to their own block
+                if (!isInRange(lod.mFirstIndex, lod.mNumIndices, header.mNumIndices) ||
+                    (!isMerged && (lod.mFirstIndex < record.mFirstIndex ||
+                                   !isInRange(lod.mFirstIndex - record.mFirstIndex, lod.mNumIndices, record.mNumIndices)))) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    ////////////////////////////////////////
+    // runs the assimp import and lays the result out exactly as it is stored on disk
+    static std::vector<unsigned char> ImportStaticModelCache(const std::string& modelPath, bool isMerged, VertexFormat vertexFormat)
+    {
+        Assimp::Importer importer;
+        const aiScene* scene = importer.ReadFile(modelPath.data(), STATIC_MODEL_IMPORT_FLAGS);
+        if (!scene || (scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE) || !scene->mRootNode) {
+            DebugUI::PushLog(stderr, "[ERROR] ASSIMP: %s\n", importer.GetErrorString());
+            return {};
+        }
+
+        std::vector<std::pair<std::array<std::vector<std::string>, 3>, aiMesh*>> entries;
+        {
+            std::vector<aiMesh*> meshes;
+            CollectStaticModelMeshes(scene->mRootNode, scene, meshes);
+            for (aiMesh* mesh : meshes) {
+                entries.emplace_back(CollectStaticModelTexturePaths(mesh, scene), mesh);
+            }
+        }
+        // sort by material so that meshes sharing textures end up in one indirect draw
+        if (isMerged) {
+            std::ranges::stable_sort(entries, {}, [](const auto& entry){ return entry.first; });
+        }
+
+        std::vector<StaticModelCacheRecord> records;
+        std::vector<float> vertices;
+        std::vector<unsigned> indices;
+        std::string paths;
+        unsigned numPaths{};
+        for (const auto& [meshPaths, mesh] : entries) {
+            StaticModelCacheRecord record{};
+            record.mFirstVertexElement = static_cast<unsigned>(vertices.size());
+            record.mNumVertexElements = mesh->mNumVertices * 8;
+            record.mFirstIndex = static_cast<unsigned>(indices.size());
+            record.mFirstPath = numPaths;
+
+            vertices.resize(vertices.size() + record.mNumVertexElements);
+            WriteStaticModelVertices(vertices.data() + record.mFirstVertexElement, mesh);
+
+            // indices of merged meshes are rebased here instead of through baseVertex,
+            // so the merged mesh stays drawable with a plain glDrawElements
+            unsigned vertexOffset{ isMerged ? record.mFirstVertexElement / 8 : 0u };
+            for (int i = 0; i < static_cast<int>(mesh->mNumFaces); ++i) {
+                const aiFace& face = mesh->mFaces[i];
+                for (int j = 0; j < static_cast<int>(face.mNumIndices); ++j) {
+                    indices.push_back(vertexOffset + face.mIndices[j]);
+                }
+            }
+            record.mNumIndices = static_cast<unsigned>(indices.size()) - record.mFirstIndex;
+
+            Utility::AABB bounds{ ComputeStaticModelBounds(mesh) };
+            record.mBounds = { bounds.mMin.x, bounds.mMin.y, bounds.mMin.z, bounds.mMax.x, bounds.mMax.y, bounds.mMax.z };
+            if (!isMerged) {
+                std::vector<MeshLod> lods{ AppendLodChain(vertices.data() + record.mFirstVertexElement, 8, indices,
+                                                          record.mFirstIndex, record.mNumIndices, bounds) };
+                std::ranges::copy(lods, record.mLods.begin());
+                record.mNumLods = static_cast<unsigned>(lods.size());
+                record.mNumIndices = static_cast<unsigned>(indices.size()) - record.mFirstIndex;
+            }
+
+            for (size_t i = 0; i < meshPaths.size(); ++i) {
+                record.mNumPaths[i] = static_cast<unsigned>(meshPaths[i].size());
+                for (const std::string& path : meshPaths[i]) {
+                    paths += path;
+                    paths += '\0';
+                    ++numPaths;
+                }
+            }
+            records.push_back(record);
+        }
+
+        // the coarser levels of merged meshes go after all full resolution ranges
+        // so that those stay one contiguous range
+        if (isMerged) {
+            for (StaticModelCacheRecord& record : records) {
+                std::vector<MeshLod> lods{ AppendLodChain(vertices.data(), 8, indices, record.mFirstIndex, record.mNumIndices,
+                                                          GetStaticModelCacheBounds(record)) };
+                std::ranges::copy(lods, record.mLods.begin());
+                record.mNumLods = static_cast<unsigned>(lods.size());
+            }
+        }
+
+        // quantized last, simplification needs the float positions; a merged model
+        // has one mesh and so decodes every position against the bounds of all records
+        if (vertexFormat == VertexFormat::Quantized) {
+            Utility::AABB mergedBounds;
+            std::ranges::for_each(records, [&](const StaticModelCacheRecord& record){ mergedBounds.Extend(GetStaticModelCacheBounds(record)); });
+
+            std::vector<float> quantized(vertices.size() / 2);
+            for (StaticModelCacheRecord& record : records) {
+                record.mFirstVertexElement /= 2;
+                record.mNumVertexElements /= 2;
+                QuantizeStaticModelVertices(vertices.data() + 2 * record.mFirstVertexElement, record.mNumVertexElements / 4,
+                                            isMerged ? mergedBounds : GetStaticModelCacheBounds(record),
+                                            quantized.data() + record.mFirstVertexElement);
+            }
+            vertices = std::move(quantized);
+        }
+
+        StaticModelCacheHeader header{ StaticModelCacheHeader::MAGIC, StaticModelCacheHeader::VERSION, STATIC_MODEL_IMPORT_FLAGS,
+                                       static_cast<unsigned>(isMerged), static_cast<unsigned>(vertexFormat), 0, IO::GetFileModificationTime(modelPath),
+                                       records.size(), vertices.size(), indices.size(), paths.size() };
+
+        std::vector<unsigned char> cache(sizeof(header) +
+                                         records.size() * sizeof(StaticModelCacheRecord) +
+                                         vertices.size() * sizeof(float) +
+                                         indices.size() * sizeof(unsigned) +
+                                         paths.size());
+        unsigned char* ptr{ cache.data() };
+        auto append = [&ptr](const void* src, size_t size) {
+            if (size > 0) {
+                std::memcpy(ptr, src, size);
+                ptr += size;
+            }
+        };
+        append(&header, sizeof(header));
+        append(records.data(), records.size() * sizeof(StaticModelCacheRecord));
+        append(vertices.data(), vertices.size() * sizeof(float));
+        append(indices.data(), indices.size() * sizeof(unsigned));
+        append(paths.data(), paths.size());
+        return cache;
+    }
+
+    ////////////////////////////////////////
+    void StaticModel::Load()
+    {
+        assert(mPath.size() > 0);
+        mDirectory = mPath.substr(0, mPath.find_last_of('/'));
+
+        std::string cachePath{ GetStaticModelCachePath(mPath, mIsMerged, mVertexFormat) };
+        IO::MappedFile cacheFile(cachePath);
+        if (IsStaticModelCacheValid(cacheFile.GetData(), cacheFile.GetSize(), mPath, mIsMerged, mVertexFormat)) {
+            LoadFromCache(cacheFile.GetData());
+        }
+        else {
+            std::vector<unsigned char> cache{ ImportStaticModelCache(mPath, mIsMerged, mVertexFormat) };
+            if (cache.empty()) {
+                return;
+            }
+            if (!IO::WriteBinaryFile(cachePath, cache.data(), cache.size())) {
+                DebugUI::PushLog(stderr, "[DEBUG] ERROR: couldn't write %s\n", cachePath.c_str());
+            }
+            LoadFromCache(cache.data());
+        }
+        mBVH = Utility::BVH(mItemBounds);
+#ifdef _DEBUG
+        size_t numVertices{}, numIndices{};
+        ForEachMesh([&](const StaticMesh& mesh) {
+            numVertices += mesh.GetNumVertices();
+            numIndices += mesh.GetNumIndices();
+        });
+        size_t numMeshes = mItemBounds.size();
+        DebugUI::PushLog(stdout, "[DEBUG] Loaded %s (%d vertices, %d indices, %d mesh%s, %d texture%s, %d draw group%s)\n", mPath.c_str(), numVertices, numIndices, numMeshes, numMeshes > 1 ? "es" : "", mNumTextures, mNumTextures > 1 ? "s" : "", static_cast<int>(mDrawGroups.size()), mDrawGroups.size() != 1 ? "s" : "");
+#else
+        int numMeshes = static_cast<int>(mItemBounds.size());
+        DebugUI::PushLog(stdout, "[DEBUG] Loaded %s (%d mesh%s, %d texture%s)", mPath.c_str(), numMeshes, numMeshes > 1 ? "es" : "", mNumTextures, mNumTextures > 1 ? "s" : "");
+#endif
+    }
+
+    ////////////////////////////////////////
+    void StaticModel::LoadFromCache(const unsigned char* cache)
+    {
+        StaticModelCacheHeader header;
+        std::memcpy(&header, cache, sizeof(header));
+
+        std::vector<StaticModelCacheRecord> records(header.mNumMeshes);
+        const unsigned char* ptr{ cache + sizeof(header) };
+        std::memcpy(records.data(), ptr, records.size() * sizeof(StaticModelCacheRecord));
+        ptr += records.size() * sizeof(StaticModelCacheRecord);
+        const float* vertices{ reinterpret_cast<const float*>(ptr) };
+        ptr += header.mNumVertexElements * sizeof(float);
+        const unsigned* indices{ reinterpret_cast<const unsigned*>(ptr) };
+        ptr += header.mNumIndices * sizeof(unsigned);
+
+        std::vector<std::string> paths;
+        const char* pathsEnd{ reinterpret_cast<const char*>(ptr) + header.mPathsSize };
+        for (const char* path{ reinterpret_cast<const char*>(ptr) }; path < pathsEnd; path += std::strlen(path) + 1) {
+            paths.emplace_back(mDirectory + '/' + path);
+        }
+
+        // every image starts decoding in parallel before the first mesh asks for one
+        std::ranges::for_each(paths, [this](const std::string& path){ mTexture2DLoader.LoadAsync(path, Texture2DParams{}); });
+
+        auto loadTextures = [&](const StaticModelCacheRecord& record) {
+            StaticMeshTextures textures;
+            const std::string* ambientPaths{ paths.data() + record.mFirstPath };
+            const std::string* diffusePaths{ ambientPaths + record.mNumPaths[0] };
+            const std::string* specularPaths{ diffusePaths + record.mNumPaths[1] };
+            textures.mAmbientTextures = Load2DTextures(ambientPaths, record.mNumPaths[0]);
+            textures.mDiffuseTextures = Load2DTextures(diffusePaths, record.mNumPaths[1]);
+            textures.mSpecularTextures = Load2DTextures(specularPaths, record.mNumPaths[2]);
+            return textures;
+        };
+        const bool isQuantized{ mVertexFormat == VertexFormat::Quantized };
+        const std::vector<VertexInfo>& infos{ isQuantized ? STATIC_MODEL_QUANTIZED_VERTEX_INFOS : STATIC_MODEL_VERTEX_INFOS };
+
+        if (!mIsMerged) {
+            for (const StaticModelCacheRecord& record : records) {
+                StaticMesh staticMesh(mNumInstances, vertices + record.mFirstVertexElement, record.mNumVertexElements,
+                                      indices + record.mFirstIndex, record.mNumIndices, infos);
+                StaticMeshTextures textures{ loadTextures(record) };
+                std::ranges::for_each(textures.mAmbientTextures, [&](const Texture2D& t){ staticMesh.AddAmbientTexture(t); });
+                std::ranges::for_each(textures.mDiffuseTextures, [&](const Texture2D& t){ staticMesh.AddDiffuseTexture(t); });
+                std::ranges::for_each(textures.mSpecularTextures, [&](const Texture2D& t){ staticMesh.AddSpecularTexture(t); });
+                const Utility::AABB bounds{ GetStaticModelCacheBounds(record) };
+                staticMesh.SetBounds(bounds);
+                if (isQuantized) {
+                    staticMesh.SetVertexDecode(bounds.mMin, bounds.mMax - bounds.mMin);
+                }
+
+                std::vector<MeshLod> lods(record.mLods.begin(), record.mLods.begin() + record.mNumLods);
+                std::ranges::for_each(lods, [&](MeshLod& lod){ lod.mFirstIndex -= record.mFirstIndex; });
+                staticMesh.SetLods(lods);
+                mMeshes.push_back(std::move(staticMesh));
+                mItemBounds.push_back(mMeshes.back().GetBounds());
+            }
+            ShareInstancesAcrossMeshes();
+            return;
+        }
+
+        if (records.empty()) {
+            return;
+        }
+        mMergedMesh.reset(new StaticMesh(mNumInstances, vertices, header.mNumVertexElements, indices, header.mNumIndices, infos));
+        mMergedMesh->SetLods({ { 0, records.back().mFirstIndex + records.back().mNumIndices, 0.0f } });
+        for (const StaticModelCacheRecord& record : records) {
+            StaticMeshTextures textures{ loadTextures(record) };
+            if (mDrawGroups.empty() || mDrawGroups.back().mTextures.GetKey() != textures.GetKey()) {
+                mDrawGroups.push_back({ std::move(textures), static_cast<int>(mDrawCommands.size()), 0 });
+            }
+            ++mDrawGroups.back().mNumCommands;
+            mDrawCommands.push_back({ record.mNumIndices, 1, record.mFirstIndex, 0, 0 });
+            mCommandLods.emplace_back(record.mLods.begin(), record.mLods.begin() + record.mNumLods);
+            mItemBounds.push_back(GetStaticModelCacheBounds(record));
+        }
+
+        Utility::AABB bounds;
+        std::ranges::for_each(mItemBounds, [&](const Utility::AABB& b){ bounds.Extend(b); });
+        mMergedMesh->SetBounds(bounds);
+        if (isQuantized) {
+            mMergedMesh->SetVertexDecode(bounds.mMin, bounds.mMax - bounds.mMin);
+        }
+
+        // first third: single instance commands, second third: same ranges with mNumInstances,
+        // last third: single instance commands rewritten by DrawVisible() every call
+        mIndirectBuffer.reset(new IndirectBuffer(3 * mDrawCommands.size(), GL_DYNAMIC_DRAW));
+        UpdateDrawCommands();
+
+        // with a material table the textured draws need neither texture binds nor one call per group
+        MaterialTableMode materialTableMode{ QueryMaterialTableMode() };
+        if (materialTableMode != MaterialTableMode::None) {
+            mMaterialTable.reset(new MaterialTable(materialTableMode, mDrawGroups, static_cast<int>(mDrawCommands.size())));
+            if (mMaterialTable->GetMode() == MaterialTableMode::None) {
+                mMaterialTable.reset();
+            }
+        }
+    }
+
+    ////////////////////////////////////////
+    void StaticModel::UpdateDrawCommands() const
+    {
+        if (!mIndirectBuffer) {
+            return;
+        }
+        std::vector<DrawElementsIndirectCommand> commands(mDrawCommands);
+        commands.insert(commands.end(), mDrawCommands.begin(), mDrawCommands.end());
+        for (size_t i = mDrawCommands.size(); i < commands.size(); ++i)
+            commands[i].instanceCount = static_cast<unsigned>(mNumInstances);
+        mIndirectBuffer->Modify(0, static_cast<int>(commands.size() * sizeof(DrawElementsIndirectCommand)), commands.data());
+    }
+
+    ////////////////////////////////////////
+    void StaticModel::DrawMerged(unsigned mode, int firstCommand, bool instanced, bool textured, const std::vector<bool>* visible) const
+    {
+        if (!mMergedMesh) {
+            return;
+        }
+
+        auto multiDraw = [&](int first, int count) {
+            if (instanced) {
+                mMergedMesh->MultiDrawInstancedIndirect(firstCommand + first, count, mode);
+            }
+            else {
+                mMergedMesh->MultiDrawIndirect(firstCommand + first, count, mode);
+            }
+        };
+
+        if (textured) {
+            mMergedMesh->Bind();
+        }
+        else {
+            mMergedMesh->BindPositions();
+        }
+        mIndirectBuffer->Bind();
+        if (textured && mMaterialTable) {
+            mMaterialTable->Bind();
+        }
+        else if (textured) {
+            for (const StaticModelDrawGroup& group : mDrawGroups) {
+                // culled commands have zero instances, whole groups can be skipped though
+                if (visible && std::none_of(visible->begin() + group.mFirstCommand,
+                                            visible->begin() + group.mFirstCommand + group.mNumCommands,
+                                            [](bool v){ return v; })) {
+                    continue;
+                }
+                group.mTextures.Bind();
+                multiDraw(group.mFirstCommand, group.mNumCommands);
+            }
+            return;
+        }
+        multiDraw(0, GetNumDrawCommands());
+    }
+
+    ////////////////////////////////////////
+    void StaticModel::DrawVisible(const Utility::Frustum& frustum, unsigned mode, bool textured) const
+    {
+        std::vector<bool>& visible{ mVisibleItems };
+        visible.assign(mItemBounds.size(), false);
+        int numVisible{};
+        mBVH.Query(frustum, [&](int item) {
+            visible[static_cast<size_t>(item)] = true;
+            ++numVisible;
+        });
+        RuntimeStats::NumVisibleMeshes += numVisible;
+        RuntimeStats::NumCulledMeshes += static_cast<int>(visible.size()) - numVisible;
+
+        if (!mIsMerged) {
+            for (size_t i = 0; i < mMeshes.size(); ++i) {
+                if (!visible[i]) {
+                    continue;
+                }
+                if (textured) {
+                    mMeshes[i].Bind();
+                    mMeshes[i].BindTextures();
+                }
+                else {
+                    mMeshes[i].BindPositions();
+                }
+                mMeshes[i].DrawLod(mMeshes[i].SelectLod(mLodView), mode);
+            }
+            return;
+        }
+
+        if (numVisible == 0) {
+            return;
+        }
+
+        // culled commands keep their slot so gl_DrawID still maps to the material table
+        std::vector<DrawElementsIndirectCommand>& commands{ mVisibleCommands };
+        commands.assign(mDrawCommands.begin(), mDrawCommands.end());
+        for (size_t i = 0; i < commands.size(); ++i) {
+            if (!visible[i]) {
+                commands[i].instanceCount = 0;
+                continue;
+            }
+            const Utility::AABB& bounds{ mItemBounds[i] };
+            int lod{ Poe::SelectLod(mCommandLods[i], bounds.GetCenter(), glm::length(bounds.GetExtents()), 1.0f, mLodView) };
+            commands[i].firstIndex = mCommandLods[i][static_cast<size_t>(lod)].mFirstIndex;
+            commands[i].count = mCommandLods[i][static_cast<size_t>(lod)].mNumIndices;
+        }
+        const int firstCommand{ 2 * GetNumDrawCommands() };
+        mIndirectBuffer->Modify(firstCommand * static_cast<int>(sizeof(DrawElementsIndirectCommand)),
+                                static_cast<int>(commands.size() * sizeof(DrawElementsIndirectCommand)),
+                                commands.data());
+        DrawMerged(mode, firstCommand, false, textured, &visible);
+    }
+
+    ////////////////////////////////////////
+    MaterialTableMode QueryMaterialTableMode()
+    {
+        if (!GLAD_GL_ARB_shader_draw_parameters) {
+            return MaterialTableMode::None;
+        }
+        return GLAD_GL_ARB_bindless_texture ? MaterialTableMode::Bindless : MaterialTableMode::TextureArray;
+    }
+
+    ////////////////////////////////////////
+    MaterialTable::MaterialTable(MaterialTableMode mode, const std::vector<StaticModelDrawGroup>& groups, int numCommands)
+        : mMode{mode},
+          mMaterials(std::max<size_t>(groups.size(), 1) * sizeof(MaterialTableElem__DATA), GL_STATIC_DRAW, ShaderStorageBuffer::MATERIAL_TABLE_BLOCK_BINDING),
+          mMaterialIndices(static_cast<size_t>(std::max(numCommands, 1)) * sizeof(unsigned), GL_STATIC_DRAW, ShaderStorageBuffer::MATERIAL_INDEX_BLOCK_BINDING)
+    {
+        std::vector<MaterialTableElem__DATA> elems;
+        switch (mMode) {
+            case MaterialTableMode::Bindless:
+                elems = CreateBindlessElems(groups);
+                break;
+            case MaterialTableMode::TextureArray:
+                elems = CreateTextureArrayElems(groups);
+                break;
+            case MaterialTableMode::None:
+                break;
+        }
+        if (mMode == MaterialTableMode::None) {
+            return;
+        }
+        mMaterials.Modify(0, static_cast<int>(elems.size() * sizeof(MaterialTableElem__DATA)), elems.data());
+
+        // gl_DrawID restarts at zero for every indirect call, so one index per command is enough
+        std::vector<unsigned> materialIndices(static_cast<size_t>(numCommands));
+        for (size_t i = 0; i < groups.size(); ++i) {
+            for (int j = 0; j < groups[i].mNumCommands; ++j) {
+                materialIndices[static_cast<size_t>(groups[i].mFirstCommand + j)] = static_cast<unsigned>(i);
+            }
+        }
+        mMaterialIndices.Modify(0, static_cast<int>(materialIndices.size() * sizeof(unsigned)), materialIndices.data());
+    }
+
+    ////////////////////////////////////////
+    MaterialTable::~MaterialTable()
+    {
+        for (GLuint64 handle : mResidentHandles) {
+            glMakeTextureHandleNonResidentARB(handle);
+        }
+    }
+
+    ////////////////////////////////////////
+    std::vector<MaterialTableElem__DATA> MaterialTable::CreateBindlessElems(const std::vector<StaticModelDrawGroup>& groups)
+    {
+        std::vector<MaterialTableElem__DATA> elems(groups.size());
+        for (size_t i = 0; i < groups.size(); ++i) {
+            std::array<const Texture2D*, 3> slots{ groups[i].mTextures.GetSlots() };
+            for (size_t j = 0; j < slots.size(); ++j) {
+                elems[i].arrays[j] = -1;
+                elems[i].layers[j] = 0;
+                elems[i].handles[j] = 0;
+                if (!slots[j]) {
+                    continue;
+                }
+
+                // handles are shared between models using the same Texture2DLoader,
+                // only the table that made a handle resident releases it
+                GLuint64 handle{ glGetTextureHandleARB(slots[j]->GetId()) };
+                if (!glIsTextureHandleResidentARB(handle)) {
+                    glMakeTextureHandleResidentARB(handle);
+                    mResidentHandles.push_back(handle);
+                }
+                elems[i].handles[j] = handle;
+            }
+        }
+        return elems;
+    }
+
+    ////////////////////////////////////////
+    std::vector<MaterialTableElem__DATA> MaterialTable::CreateTextureArrayElems(const std::vector<StaticModelDrawGroup>& groups)
+    {
+        auto isCompatible = [](const Texture2D& a, const Texture2D& b) {
+            return a.GetWidth() == b.GetWidth() &&
+                   a.GetHeight() == b.GetHeight() &&
+                   a.GetInternalFormat() == b.GetInternalFormat() &&
+                   a.GetNumMipmaps() == b.GetNumMipmaps();
+        };
+
+        // same-sized textures of the same format share an array, one layer each
+        std::vector<std::vector<const Texture2D*>> buckets;
+        std::map<unsigned, std::pair<int, int>> locations;
+        for (const StaticModelDrawGroup& group : groups) {
+            for (const Texture2D* texture : group.mTextures.GetSlots()) {
+                if (!texture || locations.contains(texture->GetId())) {
+                    continue;
+                }
+                auto bucket = std::ranges::find_if(buckets, [&](const auto& b){ return isCompatible(*b.front(), *texture); });
+                if (bucket == buckets.end()) {
+                    bucket = buckets.insert(buckets.end(), std::vector<const Texture2D*>{});
+                }
+                locations[texture->GetId()] = std::make_pair(static_cast<int>(bucket - buckets.begin()), static_cast<int>(bucket->size()));
+                bucket->push_back(texture);
+            }
+        }
+
+        if (buckets.size() > static_cast<size_t>(MAX_TEXTURE_ARRAYS)) {
+            DebugUI::PushLog(stderr, "[DEBUG] ERROR: material table needs %zu texture arrays, at most %d are supported\n", buckets.size(), MAX_TEXTURE_ARRAYS);
+            mMode = MaterialTableMode::None;
+            return {};
+        }
+
+        for (const std::vector<const Texture2D*>& bucket : buckets) {
+            const Texture2D& front = *bucket.front();
+
+            Texture2DArrayParams params;
+            params.textureFormat = front.GetTextureFormat();
+            params.internalFormat = front.GetInternalFormat();
+            params.generateMipmaps = front.HasMipmaps();
+            params.maxAnisotropy = front.GetMaxAnisotropy();
+            params.wrapS = front.GetWrapS();
+            params.wrapT = front.GetWrapT();
+            params.minF = front.GetMinF();
+            params.magF = front.GetMagF();
+            params.type = front.GetType();
+
+            Texture2DArray textureArray(front.GetWidth(), front.GetHeight(), static_cast<int>(bucket.size()), front.GetNumChannels(), params);
+            assert(textureArray.GetNumMipmaps() == front.GetNumMipmaps());
+            for (size_t layer = 0; layer < bucket.size(); ++layer) {
+                for (int level = 0; level < front.GetNumMipmaps(); ++level) {
+                    glCopyImageSubData(bucket[layer]->GetId(), GL_TEXTURE_2D, level, 0, 0, 0,
+                                       textureArray.GetId(), GL_TEXTURE_2D_ARRAY, level, 0, 0, static_cast<int>(layer),
+                                       glm::max(front.GetWidth() >> level, 1), glm::max(front.GetHeight() >> level, 1), 1);
+                }
+            }
+            mTextureArrays.push_back(std::move(textureArray));
+        }
+
+        std::vector<MaterialTableElem__DATA> elems(groups.size());
+        for (size_t i = 0; i < groups.size(); ++i) {
+            std::array<const Texture2D*, 3> slots{ groups[i].mTextures.GetSlots() };
+            for (size_t j = 0; j < slots.size(); ++j) {
+                elems[i].handles[j] = 0;
+                elems[i].arrays[j] = -1;
+                elems[i].layers[j] = 0;
+                if (slots[j]) {
+                    std::tie(elems[i].arrays[j], elems[i].layers[j]) = locations[slots[j]->GetId()];
+                }
+            }
+        }
+        return elems;
+    }
+
+    ///////////////////////////////////////////
+    std::vector<std::reference_wrapper<const Texture2D>> StaticModel::Load2DTextures(const std::string* paths, unsigned numPaths)
+    {
+        std::vector<std::reference_wrapper<const Texture2D>> textures;
+        for (unsigned i = 0; i < numPaths; ++i) {
+            // material tables of merged models copy or reference the final textures,
+            // the other meshes draw with the placeholder until the loader uploads the image
+            Texture2DParams params{};
+            const Texture2D& tex = mIsMerged ? mTexture2DLoader.Load(paths[i], params)
+                                             : mTexture2DLoader.LoadAsync(paths[i], params);
+            textures.push_back(tex);
+            ++mNumTextures;
+        }
+        return textures;
+    }
+
+    ////////////////////////////////////////
+    void StaticModel::ShareInstancesAcrossMeshes()
+    {
+        if (!mIsMerged) {
+            for (size_t i = 1; i < mMeshes.size(); ++i) {
+                mMeshes[i].ShareInstances(mMeshes.front());
+            }
+        }
+    }
+
+    ////////////////////////////////////////
+    void StaticModel::CreateInstances(std::initializer_list<glm::mat4> modelMatrices)
+    {
+        CreateInstances(std::vector<glm::mat4>(modelMatrices));
+    }
+
+    ////////////////////////////////////////
+    void StaticModel::CreateInstances(const std::vector<glm::mat4>& modelMatrices)
+    {
+        if (StaticMesh* source = GetInstanceSource()) {
+            source->CreateInstances(modelMatrices);
+            ShareInstancesAcrossMeshes();
+        }
+        mNumInstances = static_cast<int>(modelMatrices.size());
+        UpdateDrawCommands();
+    }
+
+    ////////////////////////////////////////
+    void StaticModel::CreateInstances(int numInstances)
+    {
+        if (StaticMesh* source = GetInstanceSource()) {
+            source->CreateInstances(numInstances);
+            ShareInstancesAcrossMeshes();
+        }
+        mNumInstances = numInstances;
+        UpdateDrawCommands();
+    }
+
+    ////////////////////////////////////////
+    StaticModel LoadSponza(const std::string& rootPath, Texture2DLoader& loader, bool isMerged, VertexFormat vertexFormat)
+    {
+        return StaticModel(0, rootPath + "/models/Sponza/scene.gltf", loader, isMerged, vertexFormat);
+    }
+
+    ////////////////////////////////////////
+    StaticModel LoadCsItaly(const std::string& rootPath, Texture2DLoader& loader, bool isMerged, VertexFormat vertexFormat)
+    {
+        return StaticModel(0, rootPath + "/models/cs_italy/scene.gltf", loader, isMerged, vertexFormat);
+    }
+
+    ////////////////////////////////////////
+    StaticModel LoadDeDust(const std::string& rootPath, Texture2DLoader& loader, bool isMerged, VertexFormat vertexFormat)
+    {
+        return StaticModel(0, rootPath + "/models/de_dust/scene.gltf", loader, isMerged, vertexFormat);
+    }
+
+    ////////////////////////////////////////
+    unsigned long long RenderQueue::ComputeKey(const RenderItem& item)
+    {
+        static_assert(1 + PROGRAM_BITS + TEXTURES_BITS + MATERIAL_BITS + MESH_BITS + DEPTH_BITS == 64);
+
+        // indices past a field's range wrap around, which only costs some binds
+        auto field = [](unsigned long long value, int numBits) {
+            return value & ((1ull << numBits) - 1ull);
+        };
+        auto indexOf = [this](auto& indices, unsigned& numStates, const auto& state) {
+            StateIndex& index{ indices.try_emplace(state, StateIndex{}).first->second };
+            if (index.mFrame != mFrame) {
+                index = { mFrame, numStates++ };
+            }
+            return index.mIndex;
+        };
+
+        const std::array<unsigned, 3> textureIds{ item.mTextures ? item.mTextures->GetKey() : std::array<unsigned, 3>{} };
+        const unsigned long long program{ indexOf(mProgramIndices, mNumStates[0], item.mProgram->GetId()) };
+        const unsigned long long textures{ indexOf(mTextureIndices, mNumStates[1],
+                                                   std::make_pair((static_cast<unsigned long long>(textureIds[0]) << 32) | textureIds[1],
+                                                                  textureIds[2])) };
+        const unsigned long long mesh{ indexOf(mMeshIndices, mNumStates[2], item.mMesh) };
+
+        unsigned long long key{ field(program, PROGRAM_BITS) };
+        key = (key << TEXTURES_BITS) | field(textures, TEXTURES_BITS);
+        key = (key << MATERIAL_BITS) | field(item.mMaterialId, MATERIAL_BITS);
+        key = (key << MESH_BITS) | field(mesh, MESH_BITS);
+
+        // non-negative floats compare like their bits
+        const glm::vec4 center{ mViewMatrix * item.mModel * glm::vec4(item.mMesh->GetBounds().GetCenter(), 1.0f) };
+        const float depth{ std::max(-center.z, 0.0f) };
+        unsigned depthBits{};
+        std::memcpy(&depthBits, &depth, sizeof(depthBits));
+        const unsigned long long depthKey{ depthBits >> (32 - DEPTH_BITS) };
+
+        if (item.mIsTransparent) {
+            constexpr int STATE_BITS{ PROGRAM_BITS + TEXTURES_BITS + MATERIAL_BITS + MESH_BITS };
+            return (1ull << 63) | (field(~depthKey, DEPTH_BITS) << STATE_BITS) | key;
+        }
+        return (key << DEPTH_BITS) | depthKey;
+    }
+
+    ////////////////////////////////////////
+    void RenderQueue::Begin(const AbstractCamera& camera, bool isCulling)
+    {
+        for (ThreadBucket& bucket : mBuckets) {
+            bucket.mItems.clear();
+            bucket.mModelItems.clear();
+            bucket.mNumVisible = 0;
+            bucket.mNumCulled = 0;
+        }
+        mEntries.clear();
+        mNumStates = {};
+
+        // 0 is the frame of the entries that were just inserted
+        mFrame = mFrame == std::numeric_limits<unsigned>::max() ? 1 : mFrame + 1;
+
+        mViewMatrix = camera.GetViewMatrix();
+        mProjViewMatrix = camera.GetProjectionMatrix() * mViewMatrix;
+        mIsCulling = isCulling;
+    }
+
+    ////////////////////////////////////////
+    bool RenderQueue::Push(const RenderItem& item)
+    {
+        assert(item.mProgram && item.mMesh);
+
+        ThreadBucket& bucket{ mBuckets[static_cast<size_t>(Utility::JobSystem::Get().GetThreadIndex())] };
+
+        // the bounds are of a single instance
+        if (mIsCulling && !item.mIsInstanced) {
+            if (!Utility::ComputeFrustum(mProjViewMatrix * item.mModel).Intersects(item.mMesh->GetBounds())) {
+                ++bucket.mNumCulled;
+                return false;
+            }
+            ++bucket.mNumVisible;
+        }
+
+        bucket.mItems.push_back(item);
+        bucket.mItems.back().mLod = std::clamp(item.mLod, 0, item.mMesh->GetNumLods() - 1);
+        return true;
+    }
+
+    ////////////////////////////////////////
+    void RenderQueue::Push(const StaticModel& model, const RenderItem& item)
+    {
+        assert(!model.IsMerged());
+
+        // the callbacks are copied once, the per mesh items point back to them
+        ThreadBucket& bucket{ mBuckets[static_cast<size_t>(Utility::JobSystem::Get().GetThreadIndex())] };
+        const RenderItem& shared{ bucket.mModelItems.emplace_back(item) };
+
+        const std::span<const StaticMesh> meshes{ model.GetMeshes() };
+        Utility::ParallelFor(meshes.size(), [&](size_t i) {
+            const StaticMesh& mesh{ meshes[i] };
+            Push({ shared.mProgram,
+                   &mesh,
+                   &mesh.GetTextures(),
+                   shared.mModel,
+                   shared.mMaterialId,
+                   {},              // set material
+                   {},              // set uniforms
+                   shared.mMode,
+                   mesh.SelectLod(model.GetLodView()),
+                   shared.mIsInstanced,
+                   shared.mIsTransparent,
+                   &shared });
+        }, 64);
+    }
+
+    ////////////////////////////////////////
+    void RenderQueue::Submit()
+    {
+        // the state indices are assigned here, in a deterministic order
+        mEntries.clear();
+        for (size_t i = 0; i < mBuckets.size(); ++i) {
+            ThreadBucket& bucket{ mBuckets[i] };
+            RuntimeStats::NumVisibleMeshes += bucket.mNumVisible;
+            RuntimeStats::NumCulledMeshes += bucket.mNumCulled;
+            for (size_t j = 0; j < bucket.mItems.size(); ++j) {
+                mEntries.push_back({ ComputeKey(bucket.mItems[j]), static_cast<unsigned>(i), static_cast<unsigned>(j) });
+            }
+            bucket.mNumVisible = 0;
+            bucket.mNumCulled = 0;
+        }
+
+        std::sort(mEntries.begin(), mEntries.end(), [](const SortEntry& a, const SortEntry& b) {
+            return a.mKey < b.mKey;
+        });
+
+        unsigned program{};
+        const StaticMesh* mesh{ nullptr };
+        std::array<unsigned, 3> textures{};
+        unsigned material{};
+        bool isBlending{ false };
+        for (const SortEntry& entry : mEntries) {
+            const RenderItem& item{ mBuckets[entry.mBucket].mItems[entry.mIndex] };
+
+            // transparent draws are sorted last
+            if (item.mIsTransparent && !isBlending) {
+                glEnable(GL_BLEND);
+                glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+                glDepthMask(GL_FALSE);
+                isBlending = true;
+            }
+
+            const bool isProgramChanged{ item.mProgram->GetId() != program };
+            if (isProgramChanged) {
+                item.mProgram->Use();
+                program = item.mProgram->GetId();
+            }
+            else {
+                ++RuntimeStats::NumSavedProgramBinds;
+            }
+
+            if (item.mMesh != mesh) {
+                item.mMesh->Bind();
+                mesh = item.mMesh;
+            }
+            else {
+                ++RuntimeStats::NumSavedVAOBinds;
+            }
+
+            if (item.mTextures) {
+                const std::array<const Texture2D*, 3> slots{ item.mTextures->GetSlots() };
+                for (size_t i = 0; i < slots.size(); ++i) {
+                    if (!slots[i]) {
+                        continue;
+                    }
+                    if (slots[i]->GetId() == textures[i]) {
+                        ++RuntimeStats::NumSavedTextureBinds;
+                        continue;
+                    }
+                    slots[i]->Bind(static_cast<unsigned>(i));
+                    textures[i] = slots[i]->GetId();
+                }
+            }
+
+            // uniforms are program state, a program switch has to set them again
+            const RenderItem& callbacks{ item.mCallbacks ? *item.mCallbacks : item };
+            if (callbacks.mSetMaterial && (isProgramChanged || item.mMaterialId != material)) {
+                callbacks.mSetMaterial();
+            }
+            material = item.mMaterialId;
+
+            if (callbacks.mSetUniforms) {
+                callbacks.mSetUniforms(item);
+            }
+
+            if (item.mIsInstanced) {
+                item.mMesh->DrawInstancedLod(item.mLod, item.mMode);
+            }
+            else {
+                item.mMesh->DrawLod(item.mLod, item.mMode);
+            }
+        }
+
+        if (isBlending) {
+            glDepthMask(GL_TRUE);
+            glDisable(GL_BLEND);
+        }
+    }
+
+    ////////////////////////////////////////
+    ShaderLoader::ShaderLoader(const std::string& programCacheDirectory)
+        : mProgramCache{std::make_shared<const ProgramBinaryCache>(programCacheDirectory)}
+    {
+        // the driver picks the number of threads
+        if (GLAD_GL_KHR_parallel_shader_compile) {
+            glMaxShaderCompilerThreadsKHR(0xffffffffu);
+        }
+        else if (GLAD_GL_ARB_parallel_shader_compile) {
+            glMaxShaderCompilerThreadsARB(0xffffffffu);
+        }
+    }
+
+    ////////////////////////////////////////
+    Shader& ShaderLoader::Load(GLuint type, const std::string& shaderUrl)
+    {
+        auto iter = mShaders.find({shaderUrl, type});
+        if (iter == mShaders.end()) {
+            std::string contents = IO::ReadTextFile(shaderUrl.data());
+            std::string header = ComputeOpenGLVersionStringForShader();
+            std::string shaderType = ComputeShaderTypeStringForShader(type);
+            Shader shader(type, header + shaderType + contents, mProgramCache);
+            auto s = mShaders.insert({std::make_pair(shaderUrl, type), std::move(shader)});
+            return s.first->second;
+        }
+        return iter->second;
+    }
+
+    ////////////////////////////////////////
+    Shader& ShaderLoader::Load(GLuint type, const std::string& shaderUrl, const std::vector<std::pair<std::string, float>>& values)
     {
         std::stringstream valuesStr;
         for (const auto& [ name, value ] : values) {
@@ -1509,7 +3351,7 @@ namespace Poe
                 }
                 return ss.str();
             }();
-            Shader shader(type, header + shaderType + valuesAsString + contents);
+            Shader shader(type, header + shaderType + valuesAsString + contents, mProgramCache);
             auto s = mShaders.insert({std::make_pair(shaderUrl + valuesStr.str(), type), std::move(shader)});
             return s.first->second;
         }
@@ -1546,7 +3388,7 @@ namespace Poe
                 }
                 return ss.str();
             }();
-            Shader shader(type, header + shaderType + valuesAsString + additionalHeaders + contents);
+            Shader shader(type, header + shaderType + valuesAsString + additionalHeaders + contents, mProgramCache);
             auto s = mShaders.insert({std::make_pair(shaderUrl + valuesStr.str(), type), std::move(shader)});
             return s.first->second;
         }
@@ -1558,7 +3400,24 @@ namespace Poe
     void Texture2D::Create(T* data)
     {
         glCreateTextures(GL_TEXTURE_2D, 1, &mId);
+        ApplyParameters();
+
+        if (mParams.generateMipmaps) {
+            mNumMipmaps = static_cast<int>(glm::floor(glm::log2(glm::max(mWidth, mHeight)))) + 1;
+        }
+        else {
+            mNumMipmaps = 1;
+        }
+        glTextureStorage2D(mId, mNumMipmaps, mParams.internalFormat, mWidth, mHeight);
+        glTextureSubImage2D(mId, 0, 0, 0, mWidth, mHeight, mParams.textureFormat, mParams.type, data);
+
+        if (mParams.generateMipmaps) glGenerateTextureMipmap(mId);
+        DebugUI::PushLog(stdout, "[DEBUG] Loaded 2D texture %s (%d:%d:%d, %d mipmaps)\n", mUrl.c_str(), mWidth, mHeight, mNumChannels, mNumMipmaps);
+    }
 
+    ////////////////////////////////////////
+    void Texture2D::ApplyParameters()
+    {
         glTextureParameteri(mId, GL_TEXTURE_WRAP_S, mParams.wrapS);
         glTextureParameteri(mId, GL_TEXTURE_WRAP_T, mParams.wrapT);
         glTextureParameteri(mId, GL_TEXTURE_MIN_FILTER, mParams.minF);
@@ -1568,63 +3427,249 @@ namespace Poe
             glTextureParameterfv(mId, GL_TEXTURE_BORDER_COLOR, glm::value_ptr(mBorderColor));
         }
 
-        if (!Utility::FloatEquals(mParams.maxAnisotropy, 0.0f) && GLAD_GL_EXT_texture_filter_anisotropic) {
-            float gpuMaxAnisotropy;
-            glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY, &gpuMaxAnisotropy);
-            glTextureParameterf(mId, GL_TEXTURE_MAX_ANISOTROPY, mParams.maxAnisotropy <= gpuMaxAnisotropy ? mParams.maxAnisotropy : gpuMaxAnisotropy);
+        if (!Utility::FloatEquals(mParams.maxAnisotropy, 0.0f) && GLAD_GL_EXT_texture_filter_anisotropic) {
+            float gpuMaxAnisotropy;
+            glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY, &gpuMaxAnisotropy);
+            glTextureParameterf(mId, GL_TEXTURE_MAX_ANISOTROPY, mParams.maxAnisotropy <= gpuMaxAnisotropy ? mParams.maxAnisotropy : gpuMaxAnisotropy);
+        }
+
+        if (mParams.textureFormat == GL_DEPTH_COMPONENT) {
+            glTextureParameteri(mId, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+            glTextureParameteri(mId, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+        }
+    }
+
+    ////////////////////////////////////////
+    static void SetFormatFromChannels(Texture2DParams& params, int numChannels)
+    {
+        switch (numChannels) {
+            case 1:
+                params.textureFormat = GL_RED;
+                params.internalFormat = GL_R8;
+                break;
+            case 2:
+                params.internalFormat = GL_RG8;
+                params.textureFormat = GL_RG;
+                break;
+            case 3:
+                params.textureFormat = GL_RGB;
+                params.internalFormat = GL_RGB8;
+                break;
+            case 4:
+                params.textureFormat = GL_RGBA;
+                params.internalFormat = GL_RGBA8;
+                break;
+        }
+    }
+
+    ////////////////////////////////////////
+    Texture2D::Texture2D(const std::string& url, const Texture2DParams& params)
+        : mUrl{url}, mParams{params}
+    {
+        assert(url.size() > 0);
+
+        unsigned char* data = stbi_load(url.c_str(), &mWidth, &mHeight, &mNumChannels, 0);
+        if (!data) {
+            DebugUI::PushLog(stderr, "[DEBUG] ERROR: couldn't load %s\n", url.c_str());
+            return;
+        }
+
+        SetFormatFromChannels(mParams, mNumChannels);
+        Create(data);
+        stbi_image_free(data);
+    }
+
+    ////////////////////////////////////////
+    Texture2D::Texture2D(const std::string& url, unsigned char* data, int width, int height, int numChannels, const Texture2DParams& params)
+        : mWidth{width}, mHeight{height}, mNumChannels{numChannels}, mUrl{url}, mParams{params}
+    {
+        assert(data != nullptr);
+        SetFormatFromChannels(mParams, mNumChannels);
+        Create(data);
+    }
+
+    ////////////////////////////////////////
+    Texture2D::Texture2D(const std::string& url, const unsigned char* cache, size_t cacheSize, const Texture2DParams& params)
+        : mUrl{url}, mParams{params}
+    {
+        assert(IsCompressedTextureValid(cache, cacheSize));
+
+        CompressedTextureHeader header;
+        std::memcpy(&header, cache, sizeof(header));
+        mWidth = header.mWidth;
+        mHeight = header.mHeight;
+        mNumChannels = header.mNumChannels;
+        SetFormatFromChannels(mParams, mNumChannels);
+        mParams.internalFormat = header.mInternalFormat;
+        mNumMipmaps = mParams.generateMipmaps ? header.mNumMipmaps : 1;
+
+        glCreateTextures(GL_TEXTURE_2D, 1, &mId);
+        ApplyParameters();
+        glTextureStorage2D(mId, mNumMipmaps, mParams.internalFormat, mWidth, mHeight);
+
+        const unsigned char* levelSizes{ cache + sizeof(CompressedTextureHeader) };
+        const unsigned char* levelData{ levelSizes + static_cast<size_t>(header.mNumMipmaps) * sizeof(unsigned) };
+        for (int level = 0; level < mNumMipmaps; ++level) {
+            unsigned levelSize;
+            std::memcpy(&levelSize, levelSizes + static_cast<size_t>(level) * sizeof(unsigned), sizeof(unsigned));
+            glCompressedTextureSubImage2D(mId, level, 0, 0, glm::max(mWidth >> level, 1), glm::max(mHeight >> level, 1),
+                                          mParams.internalFormat, static_cast<int>(levelSize), levelData);
+            levelData += levelSize;
+        }
+        DebugUI::PushLog(stdout, "[DEBUG] Loaded compressed 2D texture %s (%d:%d:%d, %d mipmaps)\n", mUrl.c_str(), mWidth, mHeight, mNumChannels, mNumMipmaps);
+    }
+
+    ////////////////////////////////////////
+    unsigned GetCompressedFormat(int numChannels)
+    {
+        switch (numChannels) {
+            case 1: return GL_COMPRESSED_RED_RGTC1;
+            case 2: return GL_COMPRESSED_RG_RGTC2;
+            case 3: return GLAD_GL_EXT_texture_compression_s3tc ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_BPTC_UNORM;
+            default: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+        }
+    }
+
+    ////////////////////////////////////////
+    // RGTC and BPTC are core since 4.2, S3TC is an extension
+    static bool IsCompressedFormatSupported(unsigned internalFormat)
+    {
+        return internalFormat != GL_COMPRESSED_RGB_S3TC_DXT1_EXT || GLAD_GL_EXT_texture_compression_s3tc;
+    }
+
+    ////////////////////////////////////////
+    // bytes of a 4x4 block, 0 for the formats GetCompressedFormat never picks
+    static size_t GetCompressedBlockSize(unsigned internalFormat)
+    {
+        switch (internalFormat) {
+            case GL_COMPRESSED_RED_RGTC1:
+            case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+                return 8;
+            case GL_COMPRESSED_RG_RGTC2:
+            case GL_COMPRESSED_RGBA_BPTC_UNORM:
+                return 16;
+            default:
+                return 0;
+        }
+    }
+
+    ////////////////////////////////////////
+    bool IsCompressedTextureValid(const unsigned char* data, size_t size)
+    {
+        if (!data || size < sizeof(CompressedTextureHeader)) {
+            return false;
+        }
+        CompressedTextureHeader header;
+        std::memcpy(&header, data, sizeof(header));
+        if (header.mMagic != CompressedTextureHeader::MAGIC ||
+            header.mVersion != CompressedTextureHeader::VERSION ||
+            header.mWidth <= 0 || header.mHeight <= 0 || header.mNumMipmaps <= 0 ||
+            !IsCompressedFormatSupported(header.mInternalFormat)) {
+            return false;
         }
 
-        if (mParams.textureFormat == GL_DEPTH_COMPONENT) {
-            glTextureParameteri(mId, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
-            glTextureParameteri(mId, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+        const size_t blockSize{ GetCompressedBlockSize(header.mInternalFormat) };
+        if (blockSize == 0) {
+            return false;
         }
 
-        if (mParams.generateMipmaps) {
-            mNumMipmaps = static_cast<int>(glm::floor(glm::log2(glm::max(mWidth, mHeight)))) + 1;
+        // floor(log2(max(width, height))) + 1 levels at most
+        int maxMipmaps{ 1 };
+        while ((glm::max(header.mWidth, header.mHeight) >> maxMipmaps) > 0) {
+            ++maxMipmaps;
         }
-        else {
-            mNumMipmaps = 1;
+        if (header.mNumMipmaps > maxMipmaps) {
+            return false;
         }
-        glTextureStorage2D(mId, mNumMipmaps, mParams.internalFormat, mWidth, mHeight);
-        glTextureSubImage2D(mId, 0, 0, 0, mWidth, mHeight, mParams.textureFormat, mParams.type, data);
 
-        if (mParams.generateMipmaps) glGenerateTextureMipmap(mId);
-        DebugUI::PushLog(stdout, "[DEBUG] Loaded 2D texture %s (%d:%d:%d, %d mipmaps)\n", mUrl.c_str(), mWidth, mHeight, mNumChannels, mNumMipmaps);
+        size_t expectedSize{ sizeof(CompressedTextureHeader) + static_cast<size_t>(header.mNumMipmaps) * sizeof(unsigned) };
+        if (size < expectedSize) {
+            return false;
+        }
+        for (int level = 0; level < header.mNumMipmaps; ++level) {
+            unsigned levelSize;
+            std::memcpy(&levelSize, data + sizeof(CompressedTextureHeader) + static_cast<size_t>(level) * sizeof(unsigned), sizeof(unsigned));
+            const size_t numBlocksX{ static_cast<size_t>(glm::max(header.mWidth >> level, 1) + 3) / 4 };
+            const size_t numBlocksY{ static_cast<size_t>(glm::max(header.mHeight >> level, 1) + 3) / 4 };
+            if (levelSize != numBlocksX * numBlocksY * blockSize) {
+                return false;
+            }
+            expectedSize += levelSize;
+        }
+        return size == expectedSize;
     }
 
     ////////////////////////////////////////
-    Texture2D::Texture2D(const std::string& url, const Texture2DParams& params)
-        : mUrl{url}, mParams{params}
+    bool BakeCompressedTexture(const std::string& url)
     {
-        assert(url.size() > 0);
-
-        unsigned char* data = stbi_load(url.c_str(), &mWidth, &mHeight, &mNumChannels, 0);
+        int width, height, numChannels;
+        unsigned char* data = stbi_load(url.c_str(), &width, &height, &numChannels, 0);
         if (!data) {
             DebugUI::PushLog(stderr, "[DEBUG] ERROR: couldn't load %s\n", url.c_str());
-            return;
+            return false;
         }
 
-        switch (mNumChannels) {
-            case 1:
-                mParams.textureFormat = GL_RED;
-                mParams.internalFormat = GL_R8;
-                break;
-            case 2:
-                mParams.internalFormat = GL_RG8;
-                mParams.textureFormat = GL_RG;
-                break;
-            case 3:
-                mParams.textureFormat = GL_RGB;
-                mParams.internalFormat = GL_RGB8;
-                break;
-            case 4:
-                mParams.textureFormat = GL_RGBA;
-                mParams.internalFormat = GL_RGBA8;
-                break;
+        const unsigned internalFormat{ GetCompressedFormat(numChannels) };
+        if (!IsCompressedFormatSupported(internalFormat)) {
+            DebugUI::PushLog(stderr, "[DEBUG] ERROR: compressed format 0x%x of %s isn't supported\n", internalFormat, url.c_str());
+            stbi_image_free(data);
+            return false;
         }
 
-        Create(data);
+        // the rows of 1 and 3 channel images are tightly packed, for the upload of source too
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+        // mips are filtered from the uncompressed image, then every level is
+        // handed to the driver again with a compressed internal format
+        Texture2DParams params{};
+        params.maxAnisotropy = 0.0f;
+        Texture2D source(url, data, width, height, numChannels, params);
         stbi_image_free(data);
+
+        CompressedTextureHeader header{ CompressedTextureHeader::MAGIC, CompressedTextureHeader::VERSION,
+                                        internalFormat, width, height, numChannels, source.GetNumMipmaps() };
+
+        unsigned compressed;
+        glCreateTextures(GL_TEXTURE_2D, 1, &compressed);
+        glTextureStorage2D(compressed, header.mNumMipmaps, header.mInternalFormat, width, height);
+
+        std::vector<unsigned> levelSizes;
+        std::vector<unsigned char> levelData;
+        std::vector<unsigned char> pixels;
+        for (int level = 0; level < header.mNumMipmaps; ++level) {
+            int levelWidth{ glm::max(width >> level, 1) };
+            int levelHeight{ glm::max(height >> level, 1) };
+            pixels.resize(static_cast<size_t>(levelWidth * levelHeight * numChannels));
+            glGetTextureImage(source.GetId(), level, source.GetTextureFormat(), GL_UNSIGNED_BYTE, static_cast<int>(pixels.size()), pixels.data());
+            glTextureSubImage2D(compressed, level, 0, 0, levelWidth, levelHeight,
+                                source.GetTextureFormat(), GL_UNSIGNED_BYTE, pixels.data());
+
+            int levelSize{};
+            glGetTextureLevelParameteriv(compressed, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &levelSize);
+            size_t offset{ levelData.size() };
+            levelData.resize(offset + static_cast<size_t>(levelSize));
+            glGetCompressedTextureImage(compressed, level, levelSize, levelData.data() + offset);
+            levelSizes.push_back(static_cast<unsigned>(levelSize));
+        }
+
+        glDeleteTextures(1, &compressed);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+        std::vector<unsigned char> file(sizeof(header) + levelSizes.size() * sizeof(unsigned) + levelData.size());
+        std::memcpy(file.data(), &header, sizeof(header));
+        std::memcpy(file.data() + sizeof(header), levelSizes.data(), levelSizes.size() * sizeof(unsigned));
+        std::memcpy(file.data() + sizeof(header) + levelSizes.size() * sizeof(unsigned), levelData.data(), levelData.size());
+
+        std::string cachePath{ GetCompressedTexturePath(url) };
+        if (!IO::WriteBinaryFile(cachePath, file.data(), file.size())) {
+            DebugUI::PushLog(stderr, "[DEBUG] ERROR: couldn't write %s\n", cachePath.c_str());
+            return false;
+        }
+        DebugUI::PushLog(stdout, "[DEBUG] Baked %s (%zu -> %zu bytes)\n", cachePath.c_str(),
+                         static_cast<size_t>(width * height * numChannels), levelData.size());
+        return true;
     }
 
     ////////////////////////////////////////
@@ -1736,18 +3781,164 @@ namespace Poe
         return Texture2DArray(data, width, height, 1, params, glm::vec4(1.0f));
     }
 
+    ////////////////////////////////////////
+    Texture2DLoader::~Texture2DLoader()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStopWorkers = true;
+        }
+        mRequestAvailable.notify_all();
+        for (std::thread& worker : mWorkers) {
+            worker.join();
+        }
+        for (DecodedImage& image : mDecodedImages) {
+            stbi_image_free(image.mData);
+        }
+    }
+
+    ////////////////////////////////////////
+    void Texture2DLoader::StartWorkers()
+    {
+        if (mWorkers.empty()) {
+            for (int i = 0; i < mNumWorkers; ++i) {
+                mWorkers.emplace_back(&Texture2DLoader::RunWorker, this);
+            }
+        }
+    }
+
+    ////////////////////////////////////////
+    void Texture2DLoader::RunWorker()
+    {
+        for (;;) {
+            std::pair<std::string, Texture2DParams> request;
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mRequestAvailable.wait(lock, [this]{ return mStopWorkers || !mRequests.empty(); });
+                if (mStopWorkers) {
+                    return;
+                }
+                request = std::move(mRequests.front());
+                mRequests.pop_front();
+            }
+
+            DecodedImage image{ request.first, request.second, nullptr, 0, 0, 0 };
+            image.mData = stbi_load(image.mUrl.c_str(), &image.mWidth, &image.mHeight, &image.mNumChannels, 0);
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mDecodedImages.push_back(std::move(image));
+            }
+            mImageDecoded.notify_all();
+        }
+    }
+
+    ////////////////////////////////////////
+    void Texture2DLoader::Upload(DecodedImage& image)
+    {
+        if (!image.mData) {
+            DebugUI::PushLog(stderr, "[DEBUG] ERROR: couldn't load %s\n", image.mUrl.c_str());
+        }
+        else {
+            // move-assigning keeps every reference handed out by LoadAsync valid
+            mTextures.at(image.mUrl) = Texture2D(image.mUrl, image.mData, image.mWidth, image.mHeight, image.mNumChannels, image.mParams);
+            stbi_image_free(image.mData);
+        }
+        mInFlight.erase(image.mUrl);
+    }
+
+    ////////////////////////////////////////
+    Texture2D* Texture2DLoader::LoadCompressed(const std::string& url, const Texture2DParams& params)
+    {
+        std::string cachePath{ GetCompressedTexturePath(url) };
+        if (!mUseCompressedCache || !IO::IsFileUpToDate(cachePath, url)) {
+            return nullptr;
+        }
+        IO::MappedFile file(cachePath);
+        if (!IsCompressedTextureValid(file.GetData(), file.GetSize())) {
+            DebugUI::PushLog(stderr, "[DEBUG] ERROR: %s is not a valid compressed texture\n", cachePath.c_str());
+            return nullptr;
+        }
+        auto t = mTextures.insert(std::make_pair(url, Texture2D(url, file.GetData(), file.GetSize(), params)));
+        return &t.first->second;
+    }
+
     ////////////////////////////////////////
     Texture2D& Texture2DLoader::Load(const std::string& url, const Texture2DParams& params)
     {
         auto iter = mTextures.find(url);
         if (iter == mTextures.end()) {
+            if (Texture2D* compressed = LoadCompressed(url, params)) {
+                return *compressed;
+            }
             Texture2D texture(url, params);
             auto t = mTextures.insert(std::make_pair(url, std::move(texture)));
             return t.first->second;
         }
+        if (mInFlight.contains(url)) {
+            DecodedImage image;
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                auto isDecoded = [&]{ return std::ranges::find(mDecodedImages, url, &DecodedImage::mUrl) != mDecodedImages.end(); };
+                mImageDecoded.wait(lock, isDecoded);
+                auto decoded = std::ranges::find(mDecodedImages, url, &DecodedImage::mUrl);
+                image = std::move(*decoded);
+                mDecodedImages.erase(decoded);
+            }
+            Upload(image);
+        }
+        return iter->second;
+    }
+
+    ////////////////////////////////////////
+    Texture2D& Texture2DLoader::LoadAsync(const std::string& url, const Texture2DParams& params)
+    {
+        auto iter = mTextures.find(url);
+        if (iter == mTextures.end()) {
+            if (Texture2D* compressed = LoadCompressed(url, params)) {
+                return *compressed;
+            }
+            StartWorkers();
+            mInFlight.insert(url);
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mRequests.emplace_back(url, params);
+            }
+            mRequestAvailable.notify_one();
+            auto t = mTextures.insert(std::make_pair(url, CreateCheckerboardTexture2D()));
+            return t.first->second;
+        }
         return iter->second;
     }
 
+    ////////////////////////////////////////
+    int Texture2DLoader::Update(int maxUploads)
+    {
+        std::vector<DecodedImage> images;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            size_t numImages{ std::min(mDecodedImages.size(), static_cast<size_t>(std::max(maxUploads, 0))) };
+            images.assign(std::make_move_iterator(mDecodedImages.begin()), std::make_move_iterator(mDecodedImages.begin() + static_cast<std::ptrdiff_t>(numImages)));
+            mDecodedImages.erase(mDecodedImages.begin(), mDecodedImages.begin() + static_cast<std::ptrdiff_t>(numImages));
+        }
+        for (DecodedImage& image : images) {
+            Upload(image);
+        }
+        return static_cast<int>(images.size());
+    }
+
+    ////////////////////////////////////////
+    void Texture2DLoader::Finish()
+    {
+        while (!mInFlight.empty()) {
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mImageDecoded.wait(lock, [this]{ return !mDecodedImages.empty(); });
+            }
+            Update(std::numeric_limits<int>::max());
+        }
+    }
+
+
     ////////////////////////////////////////
     Texture2DArray::Texture2DArray(const std::vector<std::string>& urls, const Texture2DArrayParams& params)
         : mDepth{static_cast<int>(urls.size())}, mUrls{urls}, mParams{params}
@@ -1826,7 +4017,7 @@ namespace Poe
             glTextureSubImage3D(mId, 0, 0, 0, i, mWidth, mHeight, 1, mParams.textureFormat, mParams.type, data[static_cast<size_t>(i)]);
         }
 
-        if (mParams.generateMipmaps) glGenerateTextureMipmap(mId);
+        if (mParams.generateMipmaps && !data.empty()) glGenerateTextureMipmap(mId);
 
         for (int i = 0; i < mDepth; ++i) {
             DebugUI::PushLog(stdout, "[DEBUG] Loaded %dth texture of 2D texture array (%d:%d:%d:%d, %d mipmaps)\n", i, mWidth, mHeight, mDepth, mNumChannels, mNumMipmaps);
@@ -1865,6 +4056,16 @@ namespace Poe
         Create(data);
     }
 
+    ////////////////////////////////////////
+    Texture2DArray::Texture2DArray(int width, int height, int depth, int numChannels, const Texture2DArrayParams& params)
+        : mWidth{width}, mHeight{height}, mDepth{depth}, mNumChannels{numChannels}, mParams{params}, mBorderColor{0.0f}
+    {
+        for (int i = 0; i < depth; ++i) {
+            mUrls.push_back("<None>");
+        }
+        Create(std::vector<unsigned char*>{});
+    }
+
     ////////////////////////////////////////
     Texture2DArray::Texture2DArray(Texture2DArray&& other)
         : mId{other.mId}, mWidth{other.mWidth}, mHeight{other.mHeight}, mDepth{other.mDepth}, mNumChannels{other.mNumChannels}, mUrls{std::move(other.mUrls)}, mParams{other.mParams}, mNumMipmaps{other.mNumMipmaps}
@@ -2091,7 +4292,8 @@ namespace Poe
     {
         glCreateFramebuffers(1, &mId);
         glNamedFramebufferTexture(mId, attachmentType, attachment.GetId(), 0);
-        if (attachmentType == GL_DEPTH_ATTACHMENT && attachment.GetTextureFormat() == GL_DEPTH_COMPONENT) {
+        if ((attachmentType == GL_DEPTH_ATTACHMENT && attachment.GetTextureFormat() == GL_DEPTH_COMPONENT) ||
+            (attachmentType == GL_DEPTH_STENCIL_ATTACHMENT && attachment.GetTextureFormat() == GL_DEPTH_STENCIL)) {
             glNamedFramebufferDrawBuffer(mId, GL_NONE);
             glNamedFramebufferReadBuffer(mId, GL_NONE);
         }
@@ -2110,6 +4312,18 @@ namespace Poe
         Check();
     }
 
+    ////////////////////////////////////////
+    Framebuffer::Framebuffer(const Texture2DArray& attachment, unsigned attachmentType)
+    {
+        glCreateFramebuffers(1, &mId);
+        glNamedFramebufferTexture(mId, attachmentType, attachment.GetId(), 0);
+        if (attachmentType == GL_DEPTH_ATTACHMENT && attachment.GetTextureFormat() == GL_DEPTH_COMPONENT) {
+            glNamedFramebufferDrawBuffer(mId, GL_NONE);
+            glNamedFramebufferReadBuffer(mId, GL_NONE);
+        }
+        Check();
+    }
+
     ////////////////////////////////////////
     Framebuffer::Framebuffer(const Cubemap& attachment, unsigned attachmentType)
     {
@@ -2139,6 +4353,22 @@ namespace Poe
         Check();
     }
 
+    ////////////////////////////////////////
+    Framebuffer::Framebuffer(const std::vector<std::reference_wrapper<const Texture2D>>& colorAttachments, const Texture2D& depthStencil)
+    {
+        glCreateFramebuffers(1, &mId);
+
+        std::vector<unsigned> drawBuffers;
+        for (size_t i = 0; i < colorAttachments.size(); ++i) {
+            const unsigned attachment{ GL_COLOR_ATTACHMENT0 + static_cast<unsigned>(i) };
+            glNamedFramebufferTexture(mId, attachment, colorAttachments[i].get().GetId(), 0);
+            drawBuffers.push_back(attachment);
+        }
+        glNamedFramebufferDrawBuffers(mId, static_cast<int>(drawBuffers.size()), drawBuffers.data());
+        glNamedFramebufferTexture(mId, GL_DEPTH_STENCIL_ATTACHMENT, depthStencil.GetId(), 0);
+        Check();
+    }
+
     ////////////////////////////////////////
     Framebuffer::Framebuffer(Framebuffer&& other)
         : mId{other.mId}
@@ -2230,13 +4460,15 @@ namespace Poe
                                        int width, int height,
                                        int numSamples, ShaderLoader& loader)
         : mWidth{width}, mHeight{height}, mOutputWidth{width}, mOutputHeight{height}, mNumSamples{numSamples},
+          mRenderScale{1.0f}, mRenderWidth{width}, mRenderHeight{height},
           mProgram(shaderRootPath, loader),
           mRboMS(GL_DEPTH24_STENCIL8, mWidth, mHeight, mNumSamples),
           mColor0MS(mWidth, mHeight, GL_RGBA16F, mNumSamples),
           mFboMS(mColor0MS, mRboMS),
           mColor0{CreateFramebufferTexture2D(mOutputWidth, mOutputHeight)},
           mRbo(GL_DEPTH24_STENCIL8, mWidth, mHeight),
-          mFbo(mColor0)
+          mFbo(mColor0),
+          mChain(shaderRootPath, mWidth, mHeight, mNumSamples, loader)
     {
         assert(numSamples > 1);
 
@@ -2251,13 +4483,15 @@ namespace Poe
                                        int outputWidth, int outputHeight,
                                        int numSamples, ShaderLoader& loader)
         : mWidth{width}, mHeight{height}, mOutputWidth{outputWidth}, mOutputHeight{outputHeight}, mNumSamples{numSamples},
+          mRenderScale{1.0f}, mRenderWidth{width}, mRenderHeight{height},
           mProgram(shaderRootPath, loader),
           mRboMS(GL_DEPTH24_STENCIL8, mWidth, mHeight, mNumSamples),
           mColor0MS(mWidth, mHeight, GL_RGBA16F, mNumSamples),
           mFboMS(mColor0MS, mRboMS),
           mColor0{CreateFramebufferTexture2D(mOutputWidth, mOutputHeight)},
           mRbo(GL_DEPTH24_STENCIL8, mWidth, mHeight),
-          mFbo(mColor0)
+          mFbo(mColor0),
+          mChain(shaderRootPath, mWidth, mHeight, mNumSamples, loader)
     {
         assert(numSamples > 1);
 
@@ -2271,13 +4505,15 @@ namespace Poe
                                        int width, int height,
                                        ShaderLoader& loader)
         : mWidth{width}, mHeight{height}, mOutputWidth{width}, mOutputHeight{height}, mNumSamples{1},
+          mRenderScale{1.0f}, mRenderWidth{width}, mRenderHeight{height},
           mProgram(shaderRootPath, loader),
           mRboMS(GL_DEPTH24_STENCIL8, mWidth, mHeight, mNumSamples),
           mColor0MS(mWidth, mHeight, GL_RGBA16F, mNumSamples),
           mFboMS(mColor0MS, mRboMS),
           mColor0{CreateFramebufferTexture2D(mOutputWidth, mOutputHeight)},
           mRbo(GL_DEPTH24_STENCIL8, mWidth, mHeight),
-          mFbo(mColor0, mRbo)
+          mFbo(mColor0, mRbo),
+          mChain(shaderRootPath, mWidth, mHeight, mNumSamples, loader)
     {
         mBlock.SetExposure(PP_DEFAULT_EXPOSURE);
         mBlock.SetGamma(PP_DEFAULT_GAMMA);
@@ -2285,30 +4521,316 @@ namespace Poe
     }
 
     ////////////////////////////////////////
-    AbstractEmissiveColorProgram::AbstractEmissiveColorProgram(const std::string& rootPath, ShaderLoader& loader, bool isInstanced)
-        : mProgram{ loader.Load(GL_VERTEX_SHADER,
+    void PostProcessStack::SetRenderScale(float scale)
+    {
+        mRenderScale = std::clamp(scale, MIN_RENDER_SCALE, 1.0f);
+        mRenderWidth = std::clamp(static_cast<int>(glm::round(static_cast<float>(mWidth) * mRenderScale)), 1, mWidth);
+        mRenderHeight = std::clamp(static_cast<int>(glm::round(static_cast<float>(mHeight) * mRenderScale)), 1, mHeight);
+    }
+
+    ////////////////////////////////////////
+    void DynamicResolution::Update(PostProcessStack& stack)
+    {
+        // the measurement lags the scale by the frames in flight
+        const unsigned long long numFrames{ Profiler::GetNumResolvedFrames() };
+        if (numFrames == mNumFrames) {
+            return;
+        }
+        mNumFrames = numFrames;
+
+        const float frameTime{ Profiler::GetFrameGpuTime() };
+        if (frameTime <= 0.0f) {
+            return;
+        }
+        mFrameTime = mFrameTime > 0.0f ? glm::mix(mFrameTime, frameTime, mSmoothing) : frameTime;
+
+        const float scale{ stack.GetRenderScale() };
+        if (glm::abs(mFrameTime / mTargetFrameTime - 1.0f) > mTolerance) {
+            // the cost grows with the number of pixels, the square of the scale
+            const float idealScale{ scale * glm::sqrt(mTargetFrameTime / mFrameTime) };
+            stack.SetRenderScale(glm::clamp(glm::mix(scale, idealScale, mGain), mMinScale, mMaxScale));
+        }
+        else {
+            stack.SetRenderScale(glm::clamp(scale, mMinScale, mMaxScale));
+        }
+    }
+
+    ////////////////////////////////////////
+    const Texture2D& TexturePool::Acquire(int width, int height, unsigned internalFormat, bool hasMipmaps)
+    {
+        for (Entry& entry : mEntries) {
+            const Texture2D& texture{ *entry.mTexture };
+            if (!entry.mIsInUse &&
+                texture.GetWidth() == width &&
+                texture.GetHeight() == height &&
+                texture.GetInternalFormat() == internalFormat &&
+                texture.HasMipmaps() == hasMipmaps) {
+                entry.mIsInUse = true;
+                return texture;
+            }
+        }
+
+        Texture2DParams params{};
+        params.internalFormat = internalFormat;
+        params.textureFormat = GL_RGBA;
+        params.type = GL_FLOAT;
+        params.generateMipmaps = hasMipmaps;
+        params.maxAnisotropy = 0.0f;
+        params.wrapS = params.wrapT = GL_CLAMP_TO_EDGE;
+        params.minF = hasMipmaps ? GL_LINEAR_MIPMAP_NEAREST : GL_LINEAR;
+        params.magF = GL_LINEAR;
+
+        float* data{ nullptr };
+        mEntries.push_back({ std::make_unique<Texture2D>(data, width, height, 4, params), true });
+        return *mEntries.back().mTexture;
+    }
+
+    ////////////////////////////////////////
+    void TexturePool::Release(const Texture2D& texture)
+    {
+        for (Entry& entry : mEntries) {
+            if (entry.mTexture.get() == &texture) {
+                entry.mIsInUse = false;
+                return;
+            }
+        }
+        assert(false);
+    }
+
+    ////////////////////////////////////////
+    int TexturePool::GetNumTexturesInUse() const
+    {
+        return static_cast<int>(std::count_if(mEntries.begin(), mEntries.end(), [](const Entry& entry){ return entry.mIsInUse; }));
+    }
+
+    ////////////////////////////////////////
+    static Texture2D CreatePostProcessOutput(int width, int height)
+    {
+        Texture2DParams params{};
+        params.minF = params.magF = GL_NEAREST;
+        params.wrapS = params.wrapT = GL_CLAMP_TO_EDGE;
+        params.generateMipmaps = false;
+        params.maxAnisotropy = 0.0f;
+        params.internalFormat = GL_RGBA8;
+        params.textureFormat = GL_RGBA;
+        unsigned char* data = nullptr;
+        return Texture2D(data, width, height, 4, params);
+    }
+
+    ////////////////////////////////////////
+    PostProcessChain::PostProcessChain(const std::string& shaderRootPath, int width, int height, int numSamples, ShaderLoader& loader)
+        : mWidth{width}, mHeight{height},
+          mCompositeProgram{ loader.Load(GL_COMPUTE_SHADER,
+                                         shaderRootPath + "/shaders/post_processing/composite.glsl",
+                                         { { "POE_WORK_GROUP_SIZE", WORK_GROUP_SIZE },
+                                           { "POE_NUM_SAMPLES", numSamples },
+                                           { "POE_USCENE_TEXTURE_LOC", SCENE_TEXTURE_LOC },
+                                           { "POE_UBLOOM_TEXTURE_LOC", BLOOM_TEXTURE_LOC },
+                                           { "POE_UBLOOM_INTENSITY_LOC", BLOOM_INTENSITY_LOC },
+                                           { "POE_UBLOOM_UV_SCALE_LOC", BLOOM_UV_SCALE_LOC },
+                                           { "POE_USCENE_SIZE_LOC", SCENE_SIZE_LOC },
+                                           { "POE_UOUTPUT_IMAGE_LOC", OUTPUT_IMAGE_LOC },
+                                           { "POE_POST_PROCESS_BLOCK_LOC", UniformBuffer::POSTPROCESS_BLOCK_BINDING } },
+                                         { shaderRootPath + "/shaders/post_processing/resolve.glsl",
+                                           shaderRootPath + "/shaders/post_processing/gamma.glsl" }) },
+          mBloomPrefilterProgram{ loader.Load(GL_COMPUTE_SHADER,
+                                              shaderRootPath + "/shaders/post_processing/bloom.glsl",
+                                              { { "POE_BLOOM_PASS", 0 },
+                                                { "POE_WORK_GROUP_SIZE", WORK_GROUP_SIZE },
+                                                { "POE_NUM_SAMPLES", numSamples },
+                                                { "POE_USCENE_TEXTURE_LOC", SCENE_TEXTURE_LOC },
+                                                { "POE_UBLOOM_THRESHOLD_LOC", BLOOM_THRESHOLD_LOC },
+                                                { "POE_USCENE_SIZE_LOC", SCENE_SIZE_LOC },
+                                                { "POE_UOUTPUT_REGION_LOC", OUTPUT_REGION_LOC },
+                                                { "POE_UOUTPUT_IMAGE_LOC", OUTPUT_IMAGE_LOC } },
+                                              { shaderRootPath + "/shaders/post_processing/resolve.glsl" }) },
+          mBloomDownsampleProgram{ loader.Load(GL_COMPUTE_SHADER,
+                                               shaderRootPath + "/shaders/post_processing/bloom.glsl",
+                                               { { "POE_BLOOM_PASS", 1 },
+                                                 { "POE_WORK_GROUP_SIZE", WORK_GROUP_SIZE },
+                                                 { "POE_USOURCE_TEXTURE_LOC", SOURCE_TEXTURE_LOC },
+                                                 { "POE_USOURCE_LEVEL_LOC", SOURCE_LEVEL_LOC },
+                                                 { "POE_USOURCE_UV_MAX_LOC", SOURCE_UV_MAX_LOC },
+                                                 { "POE_UOUTPUT_REGION_LOC", OUTPUT_REGION_LOC },
+                                                 { "POE_UOUTPUT_IMAGE_LOC", OUTPUT_IMAGE_LOC } }) },
+          mBloomUpsampleProgram{ loader.Load(GL_COMPUTE_SHADER,
+                                             shaderRootPath + "/shaders/post_processing/bloom.glsl",
+                                             { { "POE_BLOOM_PASS", 2 },
+                                               { "POE_WORK_GROUP_SIZE", WORK_GROUP_SIZE },
+                                               { "POE_USOURCE_TEXTURE_LOC", SOURCE_TEXTURE_LOC },
+                                               { "POE_USOURCE_LEVEL_LOC", SOURCE_LEVEL_LOC },
+                                               { "POE_UUPSAMPLE_TEXTURE_LOC", UPSAMPLE_TEXTURE_LOC },
+                                               { "POE_UBLOOM_RADIUS_LOC", BLOOM_RADIUS_LOC },
+                                               { "POE_USOURCE_UV_MAX_LOC", SOURCE_UV_MAX_LOC },
+                                               { "POE_UOUTPUT_REGION_LOC", OUTPUT_REGION_LOC },
+                                               { "POE_UOUTPUT_IMAGE_LOC", OUTPUT_IMAGE_LOC } }) },
+          mOutput{CreatePostProcessOutput(width, height)},
+          mOutputFbo(mOutput)
+    {
+        Init();
+    }
+
+    ////////////////////////////////////////
+    void PostProcessChain::Init() const
+    {
+        // texture and image units match the uniform locations
+        mCompositeProgram.SetInitialUniform(SCENE_TEXTURE_LOC, SCENE_TEXTURE_LOC);
+        mCompositeProgram.SetInitialUniform(BLOOM_TEXTURE_LOC, BLOOM_TEXTURE_LOC);
+        mCompositeProgram.SetInitialUniform(OUTPUT_IMAGE_LOC, OUTPUT_IMAGE_LOC);
+
+        mBloomPrefilterProgram.SetInitialUniform(SCENE_TEXTURE_LOC, SCENE_TEXTURE_LOC);
+        mBloomPrefilterProgram.SetInitialUniform(OUTPUT_IMAGE_LOC, OUTPUT_IMAGE_LOC);
+
+        mBloomDownsampleProgram.SetInitialUniform(SOURCE_TEXTURE_LOC, SOURCE_TEXTURE_LOC);
+        mBloomDownsampleProgram.SetInitialUniform(OUTPUT_IMAGE_LOC, OUTPUT_IMAGE_LOC);
+
+        mBloomUpsampleProgram.SetInitialUniform(SOURCE_TEXTURE_LOC, SOURCE_TEXTURE_LOC);
+        mBloomUpsampleProgram.SetInitialUniform(UPSAMPLE_TEXTURE_LOC, UPSAMPLE_TEXTURE_LOC);
+        mBloomUpsampleProgram.SetInitialUniform(OUTPUT_IMAGE_LOC, OUTPUT_IMAGE_LOC);
+    }
+
+    ////////////////////////////////////////
+    static void DispatchPostProcess(int width, int height)
+    {
+        constexpr int groupSize{ PostProcessChain::WORK_GROUP_SIZE };
+        glDispatchCompute(static_cast<unsigned>((width + groupSize - 1) / groupSize),
+                          static_cast<unsigned>((height + groupSize - 1) / groupSize), 1);
+    }
+
+    ////////////////////////////////////////
+    const Texture2D& PostProcessChain::Bloom(unsigned sceneTextureId, const glm::ivec2& sceneSize,
+                                             const Texture2D& down, const Texture2D& up, int numLevels) const
+    {
+        // the chain is allocated for the largest scene, only the lower left part of a level is valid
+        const glm::ivec2 topRegion{ std::max(sceneSize.x / 2, 1), std::max(sceneSize.y / 2, 1) };
+        const auto levelRegion = [&topRegion](int level){
+            return glm::ivec2(std::max(topRegion.x >> level, 1), std::max(topRegion.y >> level, 1));
+        };
+        const auto levelUvMax = [&down, &levelRegion](int level){
+            const glm::ivec2 region{ levelRegion(level) };
+            return glm::vec2(static_cast<float>(region.x) / static_cast<float>(std::max(down.GetWidth() >> level, 1)),
+                             static_cast<float>(region.y) / static_cast<float>(std::max(down.GetHeight() >> level, 1)));
+        };
+
+        mBloomPrefilterProgram.Use();
+            glBindTextureUnit(SCENE_TEXTURE_LOC, sceneTextureId);
+            glBindImageTexture(OUTPUT_IMAGE_LOC, down.GetId(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+            glUniform2f(BLOOM_THRESHOLD_LOC, mConfig.mBloomThreshold, mConfig.mBloomKnee);
+            glUniform2i(SCENE_SIZE_LOC, sceneSize.x, sceneSize.y);
+            glUniform2i(OUTPUT_REGION_LOC, topRegion.x, topRegion.y);
+            DispatchPostProcess(topRegion.x, topRegion.y);
+            glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+        mBloomDownsampleProgram.Use();
+            down.Bind(SOURCE_TEXTURE_LOC);
+            for (int level = 1; level < numLevels; ++level) {
+                const glm::ivec2 region{ levelRegion(level) };
+                glUniform1i(SOURCE_LEVEL_LOC, level - 1);
+                glUniform2fv(SOURCE_UV_MAX_LOC, 1, glm::value_ptr(levelUvMax(level - 1)));
+                glUniform2i(OUTPUT_REGION_LOC, region.x, region.y);
+                glBindImageTexture(OUTPUT_IMAGE_LOC, down.GetId(), level, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+                DispatchPostProcess(region.x, region.y);
+                glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+            }
+
+        if (numLevels == 1) {
+            mBloomDownsampleProgram.Halt();
+            return down;
+        }
+
+        // the smallest level starts the upsampled chain as it is
+        mBloomUpsampleProgram.Use();
+            down.Bind(SOURCE_TEXTURE_LOC);
+            glUniform1f(BLOOM_RADIUS_LOC, mConfig.mBloomRadius);
+            for (int level = numLevels - 2; level >= 0; --level) {
+                const glm::ivec2 region{ levelRegion(level) };
+                (level == numLevels - 2 ? down : up).Bind(UPSAMPLE_TEXTURE_LOC);
+                glUniform1i(SOURCE_LEVEL_LOC, level);
+                glUniform2fv(SOURCE_UV_MAX_LOC, 1, glm::value_ptr(levelUvMax(level + 1)));
+                glUniform2i(OUTPUT_REGION_LOC, region.x, region.y);
+                glBindImageTexture(OUTPUT_IMAGE_LOC, up.GetId(), level, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+                DispatchPostProcess(region.x, region.y);
+                glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+            }
+        mBloomUpsampleProgram.Halt();
+        return up;
+    }
+
+    ////////////////////////////////////////
+    void PostProcessChain::Execute(unsigned sceneTextureId, int width, int height, int outputWidth, int outputHeight) const
+    {
+        assert(width <= mWidth && height <= mHeight);
+
+        const Texture2D* down{ nullptr };
+        const Texture2D* up{ nullptr };
+        const Texture2D* bloom{ nullptr };
+        glm::vec2 bloomUvScale{ 1.0f };
+        if (mConfig.mEnableBloom) {
+            const int maxWidth{ std::max(mWidth / 2, 1) };
+            const int maxHeight{ std::max(mHeight / 2, 1) };
+            down = &mPool.Acquire(maxWidth, maxHeight, GL_RGBA16F, true);
+            up = &mPool.Acquire(maxWidth, maxHeight, GL_RGBA16F, true);
+
+            const int numLevels{ std::clamp(mConfig.mNumBloomLevels, 1, std::min(MAX_BLOOM_LEVELS, down->GetNumMipmaps())) };
+            bloom = &Bloom(sceneTextureId, glm::ivec2(width, height), *down, *up, numLevels);
+            bloomUvScale = glm::vec2(static_cast<float>(std::max(width / 2, 1)) / static_cast<float>(maxWidth),
+                                     static_cast<float>(std::max(height / 2, 1)) / static_cast<float>(maxHeight));
+        }
+
+        mCompositeProgram.Use();
+            glBindTextureUnit(SCENE_TEXTURE_LOC, sceneTextureId);
+            if (bloom) {
+                bloom->Bind(BLOOM_TEXTURE_LOC);
+            }
+            glUniform1f(BLOOM_INTENSITY_LOC, bloom ? mConfig.mBloomIntensity : 0.0f);
+            glUniform2fv(BLOOM_UV_SCALE_LOC, 1, glm::value_ptr(bloomUvScale));
+            glUniform2i(SCENE_SIZE_LOC, width, height);
+            glBindImageTexture(OUTPUT_IMAGE_LOC, mOutput.GetId(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+            DispatchPostProcess(width, height);
+            glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT);
+        mCompositeProgram.Halt();
+
+        if (down) {
+            mPool.Release(*down);
+            mPool.Release(*up);
+        }
+
+        // upscales to the output
+        mOutputFbo.UnBind();
+        glViewport(0, 0, outputWidth, outputHeight);
+        mOutputFbo.Blit(width, height, outputWidth, outputHeight);
+    }
+
+    ////////////////////////////////////////
+    AbstractEmissiveColorProgram::AbstractEmissiveColorProgram(const std::string& rootPath, ShaderLoader& loader, bool isInstanced, bool isTransparent)
+        : mIsTransparent{isTransparent},
+          mProgram{ loader.Load(GL_VERTEX_SHADER,
                                 rootPath + "/shaders/emissive_color.glsl",
                                 { { "POE_APOS_LOC", ATTRIB_POS_LOC },
                                   { "POE_TRANSFORM_BLOCK_LOC", UniformBuffer::TRANSFORM_BLOCK_BINDING },
                                   { "POE_UMODEL_LOC", AbstractEmissiveColorProgram::MODEL_LOC },
                                   { "POE_AMODEL_LOC", INSTANCED_MODEL_LOC },
-                                  { "POE_INSTANCED", isInstanced ? 1 : 0 } }),
+                                  { "POE_VERTEX_DECODE_BLOCK_LOC", UniformBuffer::VERTEX_DECODE_BLOCK_BINDING },
+                                  { "POE_INSTANCED", isInstanced ? 1 : 0 } },
+                                { rootPath + "/shaders/vertex_decode.glsl" }),
                     loader.Load(GL_FRAGMENT_SHADER,
                                 rootPath + "/shaders/emissive_color.glsl",
                                 { { "POE_UCOLOR_LOC", AbstractEmissiveColorProgram::COLOR_LOC },
-                                  { "POE_FOG_BLOCK_LOC", UniformBuffer::FOG_BLOCK_BINDING } },
-                                { rootPath + "/shaders/post_processing/fog.glsl" }) } {}
+                                  { "POE_FOG_BLOCK_LOC", UniformBuffer::FOG_BLOCK_BINDING },
+                                  { "POE_WEIGHTED_BLENDED", isTransparent ? 1 : 0 } },
+                                { rootPath + "/shaders/post_processing/fog.glsl",
+                                  rootPath + "/shaders/transparency/weighted_blended.glsl" }) } {}
 
     ////////////////////////////////////////
-    EmissiveColorProgramInstanced::EmissiveColorProgramInstanced(const std::string& rootPath, ShaderLoader& loader)
-        : AbstractEmissiveColorProgram(rootPath, loader, true) {}
+    EmissiveColorProgramInstanced::EmissiveColorProgramInstanced(const std::string& rootPath, ShaderLoader& loader, bool isTransparent)
+        : AbstractEmissiveColorProgram(rootPath, loader, true, isTransparent) {}
 
     ////////////////////////////////////////
-    EmissiveColorProgram::EmissiveColorProgram(const std::string& rootPath, ShaderLoader& loader)
-        : AbstractEmissiveColorProgram(rootPath, loader, false) {}
+    EmissiveColorProgram::EmissiveColorProgram(const std::string& rootPath, ShaderLoader& loader, bool isTransparent)
+        : AbstractEmissiveColorProgram(rootPath, loader, false, isTransparent) {}
 
     ////////////////////////////////////////
-    AbstractEmissiveTextureProgram::AbstractEmissiveTextureProgram(const std::string& rootPath, ShaderLoader& loader, bool isInstanced)
+    AbstractEmissiveTextureProgram::AbstractEmissiveTextureProgram(const std::string& rootPath, ShaderLoader& loader, bool isInstanced, MaterialTableMode materialTableMode)
         : mProgram{ loader.Load(GL_VERTEX_SHADER,
                                 rootPath + "/shaders/emissive_texture.glsl",
                                 { { "POE_APOS_LOC", ATTRIB_POS_LOC },
@@ -2316,36 +4838,47 @@ namespace Poe
                                   { "POE_UMODEL_LOC", AbstractEmissiveTextureProgram::MODEL_LOC },
                                   { "POE_AMODEL_LOC", INSTANCED_MODEL_LOC },
                                   { "POE_TRANSFORM_BLOCK_LOC", UniformBuffer::TRANSFORM_BLOCK_BINDING },
-                                  { "POE_INSTANCED", isInstanced ? 1 : 0 } }),
+                                  { "POE_MATERIAL_INDEX_BLOCK_LOC", ShaderStorageBuffer::MATERIAL_INDEX_BLOCK_BINDING },
+                                  { "POE_MATERIAL_TABLE", static_cast<int>(materialTableMode) },
+                                  { "POE_VERTEX_DECODE_BLOCK_LOC", UniformBuffer::VERTEX_DECODE_BLOCK_BINDING },
+                                  { "POE_INSTANCED", isInstanced ? 1 : 0 } },
+                                { rootPath + "/shaders/materials/material_table.glsl",
+                                  rootPath + "/shaders/vertex_decode.glsl" }),
                     loader.Load(GL_FRAGMENT_SHADER,
                                 rootPath + "/shaders/emissive_texture.glsl",
                                 { { "POE_UEMISSIVE_TEXTURE_LOC", EMISSIVE_TEXTURE_LOC },
                                   { "POE_UTILE_MULTIPLIER_LOC", TILE_MULTIPLIER_LOC },
                                   { "POE_UTILE_OFFSET_LOC", TILE_OFFSET_LOC },
                                   { "POE_POST_PROCESS_BLOCK_LOC", UniformBuffer::POSTPROCESS_BLOCK_BINDING },
-                                  { "POE_FOG_BLOCK_LOC", UniformBuffer::FOG_BLOCK_BINDING } },
-                                { rootPath + "/shaders/post_processing/fog.glsl",
+                                  { "POE_FOG_BLOCK_LOC", UniformBuffer::FOG_BLOCK_BINDING },
+                                  { "POE_MATERIAL_TABLE_BLOCK_LOC", ShaderStorageBuffer::MATERIAL_TABLE_BLOCK_BINDING },
+                                  { "POE_UMATERIAL_TEXTURE_ARRAYS_LOC", MATERIAL_TEXTURE_ARRAYS_LOC },
+                                  { "POE_MAX_MATERIAL_TEXTURE_ARRAYS", MaterialTable::MAX_TEXTURE_ARRAYS },
+                                  { "POE_MATERIAL_TABLE", static_cast<int>(materialTableMode) } },
+                                { rootPath + "/shaders/materials/material_table.glsl",
+                                  rootPath + "/shaders/post_processing/fog.glsl",
                                   rootPath + "/shaders/post_processing/gamma.glsl" }) }
     {
-        mProgram.Use();
-            glUniform1i(EMISSIVE_TEXTURE_LOC, 0);
-        mProgram.Halt();
+        if (materialTableMode == MaterialTableMode::None) {
+            mProgram.SetInitialUniform(EMISSIVE_TEXTURE_LOC, 0);
+        }
+        else if (materialTableMode == MaterialTableMode::TextureArray) {
+            SetMaterialTextureArraySamplers(mProgram, MATERIAL_TEXTURE_ARRAYS_LOC);
+        }
     }
 
     ////////////////////////////////////////
-    EmissiveTextureProgramInstanced::EmissiveTextureProgramInstanced(const std::string& rootPath, ShaderLoader& loader)
-        : AbstractEmissiveTextureProgram(rootPath, loader, true) {}
+    EmissiveTextureProgramInstanced::EmissiveTextureProgramInstanced(const std::string& rootPath, ShaderLoader& loader, MaterialTableMode materialTableMode)
+        : AbstractEmissiveTextureProgram(rootPath, loader, true, materialTableMode) {}
 
     ////////////////////////////////////////
-    EmissiveTextureProgram::EmissiveTextureProgram(const std::string& rootPath, ShaderLoader& loader)
-        : AbstractEmissiveTextureProgram(rootPath, loader, false) {}
+    EmissiveTextureProgram::EmissiveTextureProgram(const std::string& rootPath, ShaderLoader& loader, MaterialTableMode materialTableMode)
+        : AbstractEmissiveTextureProgram(rootPath, loader, false, materialTableMode) {}
 
     ////////////////////////////////////////
     void TexturedSkyboxProgram::Init()
     {
-        mProgram.Use();
-        glUniform1i(SKYBOX_LOC, 0);
-        mProgram.Halt();
+        mProgram.SetInitialUniform(SKYBOX_LOC, 0);
     }
 
     ////////////////////////////////////////
@@ -2599,10 +5132,13 @@ namespace Poe
                                                          int numCascades,
                                                          float shadowBiasMin,
                                                          float shadowBiasMax,
-                                                         float pointShadowBias)
+                                                         float pointShadowBias,
+                                                         MaterialTableMode materialTableMode,
+                                                         bool clusteredLights,
+                                                         bool isTransparent)
         :  mNumDirLights{numDirLights}, mNumPointLights{numPointLights}, mNumSpotLights{numSpotLights},
            mNumCascades{numCascades}, mShadowBiasMin{shadowBiasMin}, mShadowBiasMax{shadowBiasMax},
-           mPointShadowBias{pointShadowBias},
+           mPointShadowBias{pointShadowBias}, mIsClustered{clusteredLights}, mIsTransparent{isTransparent},
            mProgram{ loader.Load(GL_VERTEX_SHADER,
                                 rootPath + "/shaders/blinn_phong.glsl",
                                 { { "NUM_DIR_LIGHTS", numDirLights },
@@ -2613,7 +5149,6 @@ namespace Poe
                                   { "POE_ATEXCOORD_LOC", ATTRIB_TEXCOORD_LOC },
                                   { "POE_ANORM_LOC", ATTRIB_NORMAL_LOC },
                                   { "POE_AMODEL_LOC", INSTANCED_MODEL_LOC },
-                                  { "POE_ANORM_MAT_LOC", INSTANCED_NORMAL_LOC },
                                   { "POE_TRANSFORM_BLOCK_LOC", UniformBuffer::TRANSFORM_BLOCK_BINDING },
                                   { "POE_UMODEL_LOC", MODEL_MATRIX_LOC },
                                   { "POE_UNORM_LOC", NORMAL_MATRIX_LOC },
@@ -2622,8 +5157,13 @@ namespace Poe
                                   { "POE_DIR_LIGHT_BLOCK_LOC", UniformBuffer::DIR_LIGHT_BLOCK_BINDING },
                                   { "POE_POINT_LIGHT_BLOCK_LOC", UniformBuffer::POINT_LIGHT_BLOCK_BINDING },
                                   { "POE_SPOT_LIGHT_BLOCK_LOC", UniformBuffer::SPOT_LIGHT_BLOCK_BINDING },
+                                  { "POE_MATERIAL_INDEX_BLOCK_LOC", ShaderStorageBuffer::MATERIAL_INDEX_BLOCK_BINDING },
+                                  { "POE_MATERIAL_TABLE", static_cast<int>(materialTableMode) },
+                                  { "POE_VERTEX_DECODE_BLOCK_LOC", UniformBuffer::VERTEX_DECODE_BLOCK_BINDING },
                                   { "POE_INSTANCED", isInstanced ? 1 : 0 } },
-                                { rootPath + "/shaders/lights/directional.glsl",
+                                { rootPath + "/shaders/materials/material_table.glsl",
+                                  rootPath + "/shaders/vertex_decode.glsl",
+                                  rootPath + "/shaders/lights/directional.glsl",
                                   rootPath + "/shaders/lights/point.glsl",
                                   rootPath + "/shaders/lights/spot.glsl" }),
                     loader.Load(GL_FRAGMENT_SHADER,
@@ -2649,25 +5189,49 @@ namespace Poe
                                   { "POE_UAMBIENT_FACTOR_LOC", AMBIENT_FACTOR_LOC },
                                   { "POE_UDIR_LIGHT_DEPTH_MAP_LOC", DIR_LIGHT_DEPTH_MAP },
                                   { "POE_UPOINT_LIGHT_DEPTH_MAP_LOC", POINT_LIGHT_DEPTH_MAP },
-                                  { "POE_USPOT_LIGHT_DEPTH_MAP_LOC", SPOT_LIGHT_DEPTH_MAP } },
-                                { rootPath + "/shaders/lights/directional.glsl",
+                                  { "POE_USPOT_LIGHT_DEPTH_MAP_LOC", SPOT_LIGHT_DEPTH_MAP },
+                                  { "POE_UAMBIENT_OCCLUSION_MAP_LOC", AMBIENT_OCCLUSION_MAP_LOC },
+                                  { "POE_UAMBIENT_OCCLUSION_LOC", AMBIENT_OCCLUSION_LOC },
+                                  { "POE_UOPACITY_LOC", OPACITY_LOC },
+                                  { "POE_MATERIAL_TABLE_BLOCK_LOC", ShaderStorageBuffer::MATERIAL_TABLE_BLOCK_BINDING },
+                                  { "POE_UMATERIAL_TEXTURE_ARRAYS_LOC", MATERIAL_TEXTURE_ARRAYS_LOC },
+                                  { "POE_MAX_MATERIAL_TEXTURE_ARRAYS", MaterialTable::MAX_TEXTURE_ARRAYS },
+                                  { "POE_MATERIAL_TABLE", static_cast<int>(materialTableMode) },
+                                  { "POE_CLUSTERED_LIGHTS", clusteredLights ? 1 : 0 },
+                                  { "POE_CLUSTER_GRID_X", ClusteredLightingStack::GRID_X },
+                                  { "POE_CLUSTER_GRID_Y", ClusteredLightingStack::GRID_Y },
+                                  { "POE_CLUSTER_GRID_Z", ClusteredLightingStack::GRID_Z },
+                                  { "POE_POINT_LIGHT_LIST_BLOCK_LOC", ShaderStorageBuffer::POINT_LIGHT_LIST_BLOCK_BINDING },
+                                  { "POE_SPOT_LIGHT_LIST_BLOCK_LOC", ShaderStorageBuffer::SPOT_LIGHT_LIST_BLOCK_BINDING },
+                                  { "POE_LIGHT_CLUSTER_BLOCK_LOC", ShaderStorageBuffer::LIGHT_CLUSTER_BLOCK_BINDING },
+                                  { "POE_LIGHT_INDEX_BLOCK_LOC", ShaderStorageBuffer::LIGHT_INDEX_BLOCK_BINDING },
+                                  { "POE_WEIGHTED_BLENDED", isTransparent ? 1 : 0 } },
+                                { rootPath + "/shaders/materials/material_table.glsl",
+                                  rootPath + "/shaders/lights/directional.glsl",
                                   rootPath + "/shaders/lights/point.glsl",
                                   rootPath + "/shaders/lights/spot.glsl",
+                                  rootPath + "/shaders/lights/clustered.glsl",
                                   rootPath + "/shaders/post_processing/gamma.glsl",
                                   rootPath + "/shaders/post_processing/fog.glsl",
                                   rootPath + "/shaders/shadows/directional.glsl",
                                   rootPath + "/shaders/shadows/point.glsl",
-                                  rootPath + "/shaders/shadows/spot.glsl" }) }
+                                  rootPath + "/shaders/shadows/spot.glsl",
+                                  rootPath + "/shaders/transparency/weighted_blended.glsl" }) }
     {
-        mProgram.Use();
-            glUniform1i(MATERIAL_AMBIENT_TEXTURE_LOC, 0);
-            glUniform1i(MATERIAL_DIFFUSE_TEXTURE_LOC, 1);
-            glUniform1i(MATERIAL_SPECULAR_TEXTURE_LOC, 2);
+        if (materialTableMode == MaterialTableMode::None) {
+            mProgram.SetInitialUniform(MATERIAL_AMBIENT_TEXTURE_LOC, 0);
+            mProgram.SetInitialUniform(MATERIAL_DIFFUSE_TEXTURE_LOC, 1);
+            mProgram.SetInitialUniform(MATERIAL_SPECULAR_TEXTURE_LOC, 2);
+        }
+        else if (materialTableMode == MaterialTableMode::TextureArray) {
+            SetMaterialTextureArraySamplers(mProgram, MATERIAL_TEXTURE_ARRAYS_LOC);
+        }
 
-            glUniform1i(DIR_LIGHT_DEPTH_MAP, DIR_LIGHT_DEPTH_MAP_BIND_POINT);
-            glUniform1i(POINT_LIGHT_DEPTH_MAP, POINT_LIGHT_DEPTH_MAP_BIND_POINT);
-            glUniform1i(SPOT_LIGHT_DEPTH_MAP, SPOT_LIGHT_DEPTH_MAP_BIND_POINT);
-        mProgram.Halt();
+        mProgram.SetInitialUniform(DIR_LIGHT_DEPTH_MAP, DIR_LIGHT_DEPTH_MAP_BIND_POINT);
+        mProgram.SetInitialUniform(POINT_LIGHT_DEPTH_MAP, POINT_LIGHT_DEPTH_MAP_BIND_POINT);
+        mProgram.SetInitialUniform(SPOT_LIGHT_DEPTH_MAP, SPOT_LIGHT_DEPTH_MAP_BIND_POINT);
+        mProgram.SetInitialUniform(AMBIENT_OCCLUSION_MAP_LOC, AMBIENT_OCCLUSION_MAP_BIND_POINT);
+        mProgram.SetInitialUniform(OPACITY_LOC, 1.0f);
     }
 
     ////////////////////////////////////////
@@ -2679,8 +5243,11 @@ namespace Poe
                                          int numCascades,
                                          float shadowBiasMin,
                                          float shadowBiasMax,
-                                         float pointShadowBias)
-        : AbstractBlinnPhongProgram(rootPath, loader, false, numDirLights, numPointLights, numSpotLights, numCascades, shadowBiasMin, shadowBiasMax, pointShadowBias) {}
+                                         float pointShadowBias,
+                                         MaterialTableMode materialTableMode,
+                                         bool clusteredLights,
+                                         bool isTransparent)
+        : AbstractBlinnPhongProgram(rootPath, loader, false, numDirLights, numPointLights, numSpotLights, numCascades, shadowBiasMin, shadowBiasMax, pointShadowBias, materialTableMode, clusteredLights, isTransparent) {}
 
     ////////////////////////////////////////
     BlinnPhongProgramInstanced::BlinnPhongProgramInstanced(const std::string& rootPath,
@@ -2691,27 +5258,590 @@ namespace Poe
                                                            int numCascades,
                                                            float shadowBiasMin,
                                                            float shadowBiasMax,
-                                                           float pointShadowBias)
-        : AbstractBlinnPhongProgram(rootPath, loader, false, numDirLights, numPointLights, numSpotLights, numCascades, shadowBiasMin, shadowBiasMax, pointShadowBias) {}
+                                                           float pointShadowBias,
+                                                           MaterialTableMode materialTableMode,
+                                                           bool clusteredLights,
+                                                           bool isTransparent)
+        : AbstractBlinnPhongProgram(rootPath, loader, true, numDirLights, numPointLights, numSpotLights, numCascades, shadowBiasMin, shadowBiasMax, pointShadowBias, materialTableMode, clusteredLights, isTransparent) {}
 
     ////////////////////////////////////////
-    AbstractDepthProgram::AbstractDepthProgram(const std::string& rootPath,
-                                               ShaderLoader& loader,
-                                               bool isInstanced,
-                                               bool isOmni)
+    AbstractGBufferProgram::AbstractGBufferProgram(const std::string& rootPath,
+                                                   ShaderLoader& loader,
+                                                   bool isInstanced,
+                                                   MaterialTableMode materialTableMode)
         : mProgram{ loader.Load(GL_VERTEX_SHADER,
-                                rootPath + "/shaders/depth.glsl",
+                                rootPath + "/shaders/deferred/gbuffer.glsl",
                                 { { "POE_APOS_LOC", ATTRIB_POS_LOC },
-                                  { "POE_ULIGHT_MATRIX_LOC", LIGHT_MATRIX_LOC },
-                                  { "POE_UMODEL_LOC", MODEL_MATRIX_LOC },
+                                  { "POE_ATEXCOORD_LOC", ATTRIB_TEXCOORD_LOC },
+                                  { "POE_ANORM_LOC", ATTRIB_NORMAL_LOC },
                                   { "POE_AMODEL_LOC", INSTANCED_MODEL_LOC },
-                                  { "POE_INSTANCED", isInstanced ? 1 : 0 },
-                                  { "POE_OMNI", isOmni ? 1 : 0 } }),
+                                  { "POE_ANORM_MAT_LOC", INSTANCED_NORMAL_LOC },
+                                  { "POE_TRANSFORM_BLOCK_LOC", UniformBuffer::TRANSFORM_BLOCK_BINDING },
+                                  { "POE_UMODEL_LOC", MODEL_MATRIX_LOC },
+                                  { "POE_UNORM_LOC", NORMAL_MATRIX_LOC },
+                                  { "POE_UTEX_OFFSET_LOC", TEX_OFFSET_LOC },
+                                  { "POE_UTEX_MULTIPLIER_LOC", TEX_MULTIPLIER_LOC },
+                                  { "POE_MATERIAL_INDEX_BLOCK_LOC", ShaderStorageBuffer::MATERIAL_INDEX_BLOCK_BINDING },
+                                  { "POE_MATERIAL_TABLE", static_cast<int>(materialTableMode) },
+                                  { "POE_VERTEX_DECODE_BLOCK_LOC", UniformBuffer::VERTEX_DECODE_BLOCK_BINDING },
+                                  { "POE_INSTANCED", isInstanced ? 1 : 0 } },
+                                { rootPath + "/shaders/materials/material_table.glsl",
+                                  rootPath + "/shaders/vertex_decode.glsl" }),
                     loader.Load(GL_FRAGMENT_SHADER,
-                                rootPath + "/shaders/depth.glsl",
-                                { { "POE_UFAR_PLANE_LOC", FAR_PLANE_LOC },
-                                  { "POE_ULIGHT_POS_LOC", LIGHT_POS_LOC },
-                                  { "POE_OMNI", isOmni ? 1 : 0 } }) } {}
+                                rootPath + "/shaders/deferred/gbuffer.glsl",
+                                { { "POE_FOG_BLOCK_LOC", UniformBuffer::FOG_BLOCK_BINDING },
+                                  { "POE_BLINN_PHONG_MATERIAL_BLOCK_LOC", UniformBuffer::BLINN_PHONG_MATERIAL_BLOCK_BINDING },
+                                  { "POE_POST_PROCESS_BLOCK_LOC", UniformBuffer::POSTPROCESS_BLOCK_BINDING },
+                                  { "POE_UMATERIAL_AMBIENT_TEXTURE_LOC", MATERIAL_AMBIENT_TEXTURE_LOC },
+                                  { "POE_UMATERIAL_DIFFUSE_TEXTURE_LOC", MATERIAL_DIFFUSE_TEXTURE_LOC },
+                                  { "POE_UMATERIAL_SPECULAR_TEXTURE_LOC", MATERIAL_SPECULAR_TEXTURE_LOC },
+                                  { "POE_UAMBIENT_FACTOR_LOC", AMBIENT_FACTOR_LOC },
+                                  { "POE_MATERIAL_TABLE_BLOCK_LOC", ShaderStorageBuffer::MATERIAL_TABLE_BLOCK_BINDING },
+                                  { "POE_UMATERIAL_TEXTURE_ARRAYS_LOC", MATERIAL_TEXTURE_ARRAYS_LOC },
+                                  { "POE_MAX_MATERIAL_TEXTURE_ARRAYS", MaterialTable::MAX_TEXTURE_ARRAYS },
+                                  { "POE_MATERIAL_TABLE", static_cast<int>(materialTableMode) } },
+                                { rootPath + "/shaders/materials/material_table.glsl",
+                                  rootPath + "/shaders/deferred/encoding.glsl",
+                                  rootPath + "/shaders/post_processing/gamma.glsl",
+                                  rootPath + "/shaders/post_processing/fog.glsl" }) }
+    {
+        if (materialTableMode == MaterialTableMode::None) {
+            mProgram.SetInitialUniform(MATERIAL_AMBIENT_TEXTURE_LOC, 0);
+            mProgram.SetInitialUniform(MATERIAL_DIFFUSE_TEXTURE_LOC, 1);
+            mProgram.SetInitialUniform(MATERIAL_SPECULAR_TEXTURE_LOC, 2);
+        }
+        else if (materialTableMode == MaterialTableMode::TextureArray) {
+            SetMaterialTextureArraySamplers(mProgram, MATERIAL_TEXTURE_ARRAYS_LOC);
+        }
+    }
+
+    ////////////////////////////////////////
+    GBufferProgram::GBufferProgram(const std::string& rootPath, ShaderLoader& loader, MaterialTableMode materialTableMode)
+        : AbstractGBufferProgram(rootPath, loader, false, materialTableMode) {}
+
+    ////////////////////////////////////////
+    GBufferProgramInstanced::GBufferProgramInstanced(const std::string& rootPath, ShaderLoader& loader, MaterialTableMode materialTableMode)
+        : AbstractGBufferProgram(rootPath, loader, true, materialTableMode) {}
+
+    ////////////////////////////////////////
+    static Texture2D CreateGBufferTexture(int width, int height, unsigned internalFormat, unsigned textureFormat, unsigned type)
+    {
+        Texture2DParams params{};
+        params.minF = params.magF = GL_NEAREST;
+        params.wrapS = params.wrapT = GL_CLAMP_TO_EDGE;
+        params.generateMipmaps = false;
+        params.maxAnisotropy = 0.0f;
+        params.internalFormat = internalFormat;
+        params.textureFormat = textureFormat;
+        params.type = type;
+        unsigned char* data = nullptr;
+        return Texture2D(data, width, height, 4, params);
+    }
+
+    ////////////////////////////////////////
+    // lightType 0: directional, 1: point, 2: spot, 3: stencil marking of a light volume
+    static Program CreateDeferredLightProgram(const std::string& rootPath,
+                                              ShaderLoader& loader,
+                                              int lightType,
+                                              int numDirLights,
+                                              int numPointLights,
+                                              int numSpotLights,
+                                              int numCascades,
+                                              float shadowBiasMin,
+                                              float shadowBiasMax,
+                                              float pointShadowBias)
+    {
+        Program program{ loader.Load(GL_VERTEX_SHADER,
+                                     rootPath + "/shaders/deferred/lighting.glsl",
+                                     { { "NUM_DIR_LIGHTS", numDirLights },
+                                       { "NUM_POINT_LIGHTS", numPointLights },
+                                       { "NUM_SPOT_LIGHTS", numSpotLights },
+                                       { "NUM_CASCADES", numCascades },
+                                       { "POE_LIGHT_VOLUME", lightType == 0 ? 0 : 1 },
+                                       { "POE_TRANSFORM_BLOCK_LOC", UniformBuffer::TRANSFORM_BLOCK_BINDING },
+                                       { "POE_SPHERE_SEGMENTS", GBufferStack::SPHERE_VOLUME_SEGMENTS },
+                                       { "POE_SPHERE_RINGS", GBufferStack::SPHERE_VOLUME_RINGS },
+                                       { "POE_UVOLUME_SPHERE_LOC", GBufferStack::VOLUME_SPHERE_LOC } }),
+                         loader.Load(GL_FRAGMENT_SHADER,
+                                     rootPath + "/shaders/deferred/lighting.glsl",
+                                     { { "NUM_DIR_LIGHTS", numDirLights },
+                                       { "NUM_POINT_LIGHTS", numPointLights },
+                                       { "NUM_SPOT_LIGHTS", numSpotLights },
+                                       { "NUM_CASCADES", numCascades },
+                                       { "SHADOW_BIAS_MIN", shadowBiasMin },
+                                       { "SHADOW_BIAS_MAX", shadowBiasMax },
+                                       { "POINT_SHADOW_BIAS", pointShadowBias },
+                                       { "POE_LIGHT_TYPE", lightType },
+                                       { "POE_FOG_BLOCK_LOC", UniformBuffer::FOG_BLOCK_BINDING },
+                                       { "POE_DIR_LIGHT_BLOCK_LOC", UniformBuffer::DIR_LIGHT_BLOCK_BINDING },
+                                       { "POE_POINT_LIGHT_BLOCK_LOC", UniformBuffer::POINT_LIGHT_BLOCK_BINDING },
+                                       { "POE_SPOT_LIGHT_BLOCK_LOC", UniformBuffer::SPOT_LIGHT_BLOCK_BINDING },
+                                       { "POE_UALBEDO_TEXTURE_LOC", GBufferStack::ALBEDO_TEXTURE_LOC },
+                                       { "POE_UNORMAL_TEXTURE_LOC", GBufferStack::NORMAL_TEXTURE_LOC },
+                                       { "POE_UMATERIAL_TEXTURE_LOC", GBufferStack::MATERIAL_TEXTURE_LOC },
+                                       { "POE_UDEPTH_TEXTURE_LOC", GBufferStack::DEPTH_TEXTURE_LOC },
+                                       { "POE_UINVERSE_PROJECTION_LOC", GBufferStack::INVERSE_PROJECTION_LOC },
+                                       { "POE_UINVERSE_VIEW_LOC", GBufferStack::INVERSE_VIEW_LOC },
+                                       { "POE_ULIGHT_INDEX_LOC", GBufferStack::LIGHT_INDEX_LOC },
+                                       { "POE_UDIR_LIGHT_DEPTH_MAP_LOC", GBufferStack::DIR_LIGHT_DEPTH_MAP },
+                                       { "POE_UPOINT_LIGHT_DEPTH_MAP_LOC", GBufferStack::POINT_LIGHT_DEPTH_MAP },
+                                       { "POE_USPOT_LIGHT_DEPTH_MAP_LOC", GBufferStack::SPOT_LIGHT_DEPTH_MAP } },
+                                     { rootPath + "/shaders/lights/directional.glsl",
+                                       rootPath + "/shaders/lights/point.glsl",
+                                       rootPath + "/shaders/lights/spot.glsl",
+                                       rootPath + "/shaders/deferred/encoding.glsl",
+                                       rootPath + "/shaders/post_processing/fog.glsl",
+                                       rootPath + "/shaders/shadows/directional.glsl",
+                                       rootPath + "/shaders/shadows/point.glsl",
+                                       rootPath + "/shaders/shadows/spot.glsl" }) };
+
+        if (lightType != 3) {
+            program.SetInitialUniform(GBufferStack::ALBEDO_TEXTURE_LOC, 0);
+            program.SetInitialUniform(GBufferStack::NORMAL_TEXTURE_LOC, 1);
+            program.SetInitialUniform(GBufferStack::MATERIAL_TEXTURE_LOC, 2);
+            program.SetInitialUniform(GBufferStack::DEPTH_TEXTURE_LOC, 3);
+            program.SetInitialUniform(GBufferStack::DIR_LIGHT_DEPTH_MAP, DIR_LIGHT_DEPTH_MAP_BIND_POINT);
+            program.SetInitialUniform(GBufferStack::POINT_LIGHT_DEPTH_MAP, POINT_LIGHT_DEPTH_MAP_BIND_POINT);
+            program.SetInitialUniform(GBufferStack::SPOT_LIGHT_DEPTH_MAP, SPOT_LIGHT_DEPTH_MAP_BIND_POINT);
+        }
+        return program;
+    }
+
+    ////////////////////////////////////////
+    GBufferStack::GBufferStack(const std::string& rootPath,
+                               int width, int height,
+                               int numDirLights,
+                               int numPointLights,
+                               int numSpotLights,
+                               int numCascades,
+                               float shadowBiasMin,
+                               float shadowBiasMax,
+                               float pointShadowBias,
+                               ShaderLoader& loader)
+        : mWidth{width}, mHeight{height},
+          mAlbedo{CreateGBufferTexture(width, height, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE)},
+          mNormal{CreateGBufferTexture(width, height, GL_RG16, GL_RG, GL_UNSIGNED_SHORT)},
+          mMaterial{CreateGBufferTexture(width, height, GL_RG8, GL_RG, GL_UNSIGNED_BYTE)},
+          mLight{CreateGBufferTexture(width, height, GL_RGBA16F, GL_RGBA, GL_FLOAT)},
+          mDepthStencil{CreateGBufferTexture(width, height, GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8)},
+          mGeometryFbo({ mAlbedo, mNormal, mMaterial, mLight }, mDepthStencil),
+          mLightFbo({ mLight }, mDepthStencil),
+          mDirLightProgram{CreateDeferredLightProgram(rootPath, loader, 0, numDirLights, numPointLights, numSpotLights, numCascades, shadowBiasMin, shadowBiasMax, pointShadowBias)},
+          mPointLightProgram{CreateDeferredLightProgram(rootPath, loader, 1, numDirLights, numPointLights, numSpotLights, numCascades, shadowBiasMin, shadowBiasMax, pointShadowBias)},
+          mSpotLightProgram{CreateDeferredLightProgram(rootPath, loader, 2, numDirLights, numPointLights, numSpotLights, numCascades, shadowBiasMin, shadowBiasMax, pointShadowBias)},
+          mStencilProgram{CreateDeferredLightProgram(rootPath, loader, 3, numDirLights, numPointLights, numSpotLights, numCascades, shadowBiasMin, shadowBiasMax, pointShadowBias)},
+          mNumDirLights{numDirLights}
+    {}
+
+    ////////////////////////////////////////
+    void GBufferStack::DrawLightVolume(const Program& program, int lightIndex, const glm::vec4& sphere) const
+    {
+        // marks the pixels whose surface lies inside the volume: back faces behind the
+        // surface increment, front faces behind it decrement
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glEnable(GL_DEPTH_TEST);
+        glDisable(GL_CULL_FACE);
+        glStencilFunc(GL_ALWAYS, 0, 0);
+        glStencilOpSeparate(GL_BACK, GL_KEEP, GL_INCR_WRAP, GL_KEEP);
+        glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_DECR_WRAP, GL_KEEP);
+
+        mStencilProgram.Use();
+            glUniform4fv(VOLUME_SPHERE_LOC, 1, glm::value_ptr(sphere));
+            glDrawArrays(GL_TRIANGLES, 0, SPHERE_VOLUME_NUM_VERTICES);
+            ++RuntimeStats::NumDrawCalls;
+
+        // back faces still rasterize when the camera is inside of the volume
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        glDisable(GL_DEPTH_TEST);
+        glEnable(GL_CULL_FACE);
+        glCullFace(GL_FRONT);
+        glStencilFunc(GL_NOTEQUAL, 0, 0xFF);
+
+        // the shading draw covers every marked pixel, so it also leaves the stencil
+        // cleared for the next volume
+        glStencilOp(GL_KEEP, GL_ZERO, GL_ZERO);
+
+        program.Use();
+            glUniform1i(LIGHT_INDEX_LOC, lightIndex);
+            glUniform4fv(VOLUME_SPHERE_LOC, 1, glm::value_ptr(sphere));
+            glDrawArrays(GL_TRIANGLES, 0, SPHERE_VOLUME_NUM_VERTICES);
+            ++RuntimeStats::NumDrawCalls;
+    }
+
+    ////////////////////////////////////////
+    void GBufferStack::LightingPass(const AbstractCamera& camera,
+                                    const PointLightList& pointLights,
+                                    const SpotLightList& spotLights) const
+    {
+        glViewport(0, 0, mWidth, mHeight);
+        mLightFbo.Bind();
+
+        mAlbedo.Bind(0);
+        mNormal.Bind(1);
+        mMaterial.Bind(2);
+        mDepthStencil.Bind(3);
+
+        const glm::mat4 inverseProjection{ glm::inverse(camera.GetProjectionMatrix()) };
+        const glm::mat4 inverseView{ glm::inverse(camera.GetViewMatrix()) };
+        for (const Program* program : { &mDirLightProgram, &mPointLightProgram, &mSpotLightProgram }) {
+            program->Use();
+                glUniformMatrix4fv(INVERSE_PROJECTION_LOC, 1, GL_FALSE, glm::value_ptr(inverseProjection));
+                glUniformMatrix4fv(INVERSE_VIEW_LOC, 1, GL_FALSE, glm::value_ptr(inverseView));
+        }
+
+        glDepthMask(GL_FALSE);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+
+        if (mNumDirLights > 0) {
+            glDisable(GL_DEPTH_TEST);
+            glDisable(GL_STENCIL_TEST);
+            mDirLightProgram.Use();
+                glDrawArrays(GL_TRIANGLES, 0, 3);
+                ++RuntimeStats::NumDrawCalls;
+        }
+
+        // depth clamping keeps the volumes from being clipped by the near and far planes,
+        // which would leave marked pixels that the shading draw doesn't reset
+        const GLboolean isCullFaceEnabled{ glIsEnabled(GL_CULL_FACE) };
+        glEnable(GL_STENCIL_TEST);
+        glEnable(GL_DEPTH_CLAMP);
+        glClear(GL_STENCIL_BUFFER_BIT);
+
+        // the view space frustum rejects the volumes that can't touch a pixel
+        const Utility::Frustum frustum{ Utility::ComputeFrustum(camera.GetProjectionMatrix()) };
+        auto isVisible = [&frustum](const glm::vec4& sphere) {
+            const glm::vec3 center{ sphere };
+            return frustum.Intersects(Utility::AABB{ center - glm::vec3(sphere.w), center + glm::vec3(sphere.w) });
+        };
+
+        for (size_t i = 0; i < pointLights.size(); ++i) {
+            const PointLight& light{ pointLights[i].get() };
+            const glm::vec4 sphere{ light.mViewPosition, light.mRadius };
+            if (isVisible(sphere)) {
+                DrawLightVolume(mPointLightProgram, static_cast<int>(i), sphere);
+            }
+        }
+
+        for (size_t i = 0; i < spotLights.size(); ++i) {
+            const SpotLight& light{ spotLights[i].get() };
+            const glm::vec4 sphere{ glm::vec3(camera.GetViewMatrix() * glm::vec4(light.mPosition, 1.0f)), light.mRadius };
+            if (isVisible(sphere)) {
+                DrawLightVolume(mSpotLightProgram, static_cast<int>(i), sphere);
+            }
+        }
+        mSpotLightProgram.Halt();
+
+        if (isCullFaceEnabled) {
+            glEnable(GL_CULL_FACE);
+        }
+        else {
+            glDisable(GL_CULL_FACE);
+        }
+        glCullFace(GL_BACK);
+        glStencilFunc(GL_ALWAYS, 0, 0xFF);
+        glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+        glDisable(GL_STENCIL_TEST);
+        glDisable(GL_DEPTH_CLAMP);
+        glDisable(GL_BLEND);
+        glEnable(GL_DEPTH_TEST);
+        glDepthMask(GL_TRUE);
+    }
+
+    ////////////////////////////////////////
+    void GBufferStack::BlitTo(const Framebuffer& target) const
+    {
+        glBlitNamedFramebuffer(mLightFbo.GetId(), target.GetId(), 0, 0, mWidth, mHeight, 0, 0, mWidth, mHeight,
+                               GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT, GL_NEAREST);
+    }
+
+    ////////////////////////////////////////
+    static Texture2D CreateAmbientOcclusionTexture(int width, int height, unsigned internalFormat, bool hasMipmaps)
+    {
+        Texture2DParams params{};
+        params.minF = hasMipmaps ? GL_NEAREST_MIPMAP_NEAREST : GL_NEAREST;
+        params.magF = GL_NEAREST;
+        params.wrapS = params.wrapT = GL_CLAMP_TO_EDGE;
+        params.generateMipmaps = hasMipmaps;
+        params.maxAnisotropy = 0.0f;
+        params.internalFormat = internalFormat;
+        params.textureFormat = GL_RED;
+        params.type = GL_FLOAT;
+        float* data = nullptr;
+        return Texture2D(data, width, height, 1, params);
+    }
+
+    ////////////////////////////////////////
+    static Program CreateAmbientOcclusionProgram(const std::string& rootPath, ShaderLoader& loader, int pass)
+    {
+        return Program{ loader.Load(GL_COMPUTE_SHADER,
+                                    rootPath + "/shaders/ambient_occlusion/ssao.glsl",
+                                    { { "POE_SSAO_PASS", pass },
+                                      { "POE_WORK_GROUP_SIZE", AmbientOcclusionStack::WORK_GROUP_SIZE },
+                                      { "POE_UDEPTH_TEXTURE_LOC", AmbientOcclusionStack::DEPTH_TEXTURE_LOC },
+                                      { "POE_USOURCE_TEXTURE_LOC", AmbientOcclusionStack::SOURCE_TEXTURE_LOC },
+                                      { "POE_UOUTPUT_IMAGE_LOC", AmbientOcclusionStack::OUTPUT_IMAGE_LOC },
+                                      { "POE_UOUTPUT_REGION_LOC", AmbientOcclusionStack::OUTPUT_REGION_LOC },
+                                      { "POE_USOURCE_REGION_LOC", AmbientOcclusionStack::SOURCE_REGION_LOC },
+                                      { "POE_USOURCE_LEVEL_LOC", AmbientOcclusionStack::SOURCE_LEVEL_LOC },
+                                      { "POE_UPROJECTION_LOC", AmbientOcclusionStack::PROJECTION_LOC },
+                                      { "POE_URADIUS_LOC", AmbientOcclusionStack::RADIUS_LOC },
+                                      { "POE_UINTENSITY_LOC", AmbientOcclusionStack::INTENSITY_LOC },
+                                      { "POE_UBIAS_LOC", AmbientOcclusionStack::BIAS_LOC },
+                                      { "POE_UNUM_SAMPLES_LOC", AmbientOcclusionStack::NUM_SAMPLES_LOC },
+                                      { "POE_UNUM_LEVELS_LOC", AmbientOcclusionStack::NUM_LEVELS_LOC },
+                                      { "POE_UBLUR_DIRECTION_LOC", AmbientOcclusionStack::BLUR_DIRECTION_LOC },
+                                      { "POE_USHARPNESS_LOC", AmbientOcclusionStack::SHARPNESS_LOC } }) };
+    }
+
+    ////////////////////////////////////////
+    AmbientOcclusionStack::AmbientOcclusionStack(const std::string& rootPath, int width, int height, ShaderLoader& loader)
+        : mWidth{width}, mHeight{height},
+          mLinearizeProgram{CreateAmbientOcclusionProgram(rootPath, loader, 0)},
+          mDownsampleProgram{CreateAmbientOcclusionProgram(rootPath, loader, 1)},
+          mOcclusionProgram{CreateAmbientOcclusionProgram(rootPath, loader, 2)},
+          mBlurProgram{CreateAmbientOcclusionProgram(rootPath, loader, 3)},
+          mUpsampleProgram{CreateAmbientOcclusionProgram(rootPath, loader, 4)},
+          mDepth{CreateGBufferTexture(width, height, GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8)},
+          mDepthFbo(mDepth, GL_DEPTH_STENCIL_ATTACHMENT),
+          mPyramid{CreateAmbientOcclusionTexture(std::max((width + 1) / 2, 1), std::max((height + 1) / 2, 1), GL_R32F, true)},
+          mOcclusion{CreateAmbientOcclusionTexture(mPyramid.GetWidth(), mPyramid.GetHeight(), GL_RG16F, false)},
+          mBlurred{CreateAmbientOcclusionTexture(mPyramid.GetWidth(), mPyramid.GetHeight(), GL_RG16F, false)},
+          mOutput{CreateAmbientOcclusionTexture(width, height, GL_R8, false)}
+    {
+        Init();
+        mOutput.Bind(AMBIENT_OCCLUSION_MAP_BIND_POINT);
+    }
+
+    ////////////////////////////////////////
+    void AmbientOcclusionStack::Init() const
+    {
+        // texture and image units match the uniform locations
+        mLinearizeProgram.SetInitialUniform(DEPTH_TEXTURE_LOC, DEPTH_TEXTURE_LOC);
+        mLinearizeProgram.SetInitialUniform(OUTPUT_IMAGE_LOC, OUTPUT_IMAGE_LOC);
+
+        for (const Program* program : { &mDownsampleProgram, &mOcclusionProgram, &mBlurProgram }) {
+            program->SetInitialUniform(SOURCE_TEXTURE_LOC, SOURCE_TEXTURE_LOC);
+            program->SetInitialUniform(OUTPUT_IMAGE_LOC, OUTPUT_IMAGE_LOC);
+        }
+
+        mUpsampleProgram.SetInitialUniform(DEPTH_TEXTURE_LOC, DEPTH_TEXTURE_LOC);
+        mUpsampleProgram.SetInitialUniform(SOURCE_TEXTURE_LOC, SOURCE_TEXTURE_LOC);
+        mUpsampleProgram.SetInitialUniform(OUTPUT_IMAGE_LOC, OUTPUT_IMAGE_LOC);
+    }
+
+    ////////////////////////////////////////
+    static void DispatchAmbientOcclusion(int width, int height)
+    {
+        constexpr int groupSize{ AmbientOcclusionStack::WORK_GROUP_SIZE };
+        glDispatchCompute(static_cast<unsigned>((width + groupSize - 1) / groupSize),
+                          static_cast<unsigned>((height + groupSize - 1) / groupSize), 1);
+    }
+
+    ////////////////////////////////////////
+    void AmbientOcclusionStack::Execute(const Framebuffer& target, const AbstractCamera& camera, int width, int height) const
+    {
+        assert(width <= mWidth && height <= mHeight);
+
+        // resolves a multisampled target too, the formats of the two match
+        glBlitNamedFramebuffer(target.GetId(), mDepthFbo.GetId(), 0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+        const glm::mat4 projection{ camera.GetProjectionMatrix() };
+        const glm::vec4 projectionParams{ projection[0][0], projection[1][1], projection[2][2], projection[3][2] };
+
+        const int halfWidth{ std::max((width + 1) / 2, 1) };
+        const int halfHeight{ std::max((height + 1) / 2, 1) };
+        const int numLevels{ std::min(MAX_PYRAMID_LEVELS, mPyramid.GetNumMipmaps()) };
+
+        mLinearizeProgram.Use();
+            mDepth.Bind(DEPTH_TEXTURE_LOC);
+            glUniform4fv(PROJECTION_LOC, 1, glm::value_ptr(projectionParams));
+            glUniform2i(SOURCE_REGION_LOC, width, height);
+            glUniform2i(OUTPUT_REGION_LOC, halfWidth, halfHeight);
+            glBindImageTexture(OUTPUT_IMAGE_LOC, mPyramid.GetId(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+            DispatchAmbientOcclusion(halfWidth, halfHeight);
+            glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+        mDownsampleProgram.Use();
+            mPyramid.Bind(SOURCE_TEXTURE_LOC);
+            for (int level = 1; level < numLevels; ++level) {
+                const int sourceWidth{ std::max(halfWidth >> (level - 1), 1) };
+                const int sourceHeight{ std::max(halfHeight >> (level - 1), 1) };
+                const int levelWidth{ std::max(halfWidth >> level, 1) };
+                const int levelHeight{ std::max(halfHeight >> level, 1) };
+                glUniform1i(SOURCE_LEVEL_LOC, level - 1);
+                glUniform2i(SOURCE_REGION_LOC, sourceWidth, sourceHeight);
+                glUniform2i(OUTPUT_REGION_LOC, levelWidth, levelHeight);
+                glBindImageTexture(OUTPUT_IMAGE_LOC, mPyramid.GetId(), level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+                DispatchAmbientOcclusion(levelWidth, levelHeight);
+                glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+            }
+
+        mOcclusionProgram.Use();
+            mPyramid.Bind(SOURCE_TEXTURE_LOC);
+            glUniform4fv(PROJECTION_LOC, 1, glm::value_ptr(projectionParams));
+            glUniform1f(RADIUS_LOC, mConfig.mRadius);
+            glUniform1f(INTENSITY_LOC, mConfig.mIntensity);
+            glUniform1f(BIAS_LOC, mConfig.mBias);
+            glUniform1i(NUM_SAMPLES_LOC, std::clamp(mConfig.mNumSamples, 1, MAX_SAMPLES));
+            glUniform1i(NUM_LEVELS_LOC, numLevels);
+            glUniform2i(OUTPUT_REGION_LOC, halfWidth, halfHeight);
+            glBindImageTexture(OUTPUT_IMAGE_LOC, mOcclusion.GetId(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RG16F);
+            DispatchAmbientOcclusion(halfWidth, halfHeight);
+            glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+        // horizontally into mBlurred, then vertically back
+        mBlurProgram.Use();
+            glUniform1f(SHARPNESS_LOC, mConfig.mSharpness);
+            glUniform2i(SOURCE_REGION_LOC, halfWidth, halfHeight);
+            glUniform2i(OUTPUT_REGION_LOC, halfWidth, halfHeight);
+            for (int i = 0; i < 2; ++i) {
+                const Texture2D& source{ i == 0 ? mOcclusion : mBlurred };
+                const Texture2D& output{ i == 0 ? mBlurred : mOcclusion };
+                source.Bind(SOURCE_TEXTURE_LOC);
+                glUniform2i(BLUR_DIRECTION_LOC, i == 0 ? 1 : 0, i == 0 ? 0 : 1);
+                glBindImageTexture(OUTPUT_IMAGE_LOC, output.GetId(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RG16F);
+                DispatchAmbientOcclusion(halfWidth, halfHeight);
+                glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+            }
+
+        mUpsampleProgram.Use();
+            mDepth.Bind(DEPTH_TEXTURE_LOC);
+            mOcclusion.Bind(SOURCE_TEXTURE_LOC);
+            glUniform4fv(PROJECTION_LOC, 1, glm::value_ptr(projectionParams));
+            glUniform2i(SOURCE_REGION_LOC, halfWidth, halfHeight);
+            glUniform2i(OUTPUT_REGION_LOC, width, height);
+            glBindImageTexture(OUTPUT_IMAGE_LOC, mOutput.GetId(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R8);
+            DispatchAmbientOcclusion(width, height);
+            glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+        mUpsampleProgram.Halt();
+    }
+
+    ////////////////////////////////////////
+    TransparencyStack::TransparencyStack(const std::string& rootPath, int width, int height, ShaderLoader& loader)
+        : mAccumulation{CreateGBufferTexture(width, height, GL_RGBA16F, GL_RGBA, GL_FLOAT)},
+          mRevealage{CreateGBufferTexture(width, height, GL_R8, GL_RED, GL_UNSIGNED_BYTE)},
+          mDepth{CreateGBufferTexture(width, height, GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8)},
+          mFbo({ mAccumulation, mRevealage }, mDepth),
+          mCompositeProgram{ loader.Load(GL_VERTEX_SHADER, rootPath + "/shaders/transparency/composite.glsl"),
+                             loader.Load(GL_FRAGMENT_SHADER,
+                                         rootPath + "/shaders/transparency/composite.glsl",
+                                         { { "POE_UACCUMULATION_TEXTURE_LOC", ACCUMULATION_TEXTURE_LOC },
+                                           { "POE_UREVEALAGE_TEXTURE_LOC", REVEALAGE_TEXTURE_LOC } }) }
+    {
+        // texture units match the uniform locations
+        mCompositeProgram.SetInitialUniform(ACCUMULATION_TEXTURE_LOC, ACCUMULATION_TEXTURE_LOC);
+        mCompositeProgram.SetInitialUniform(REVEALAGE_TEXTURE_LOC, REVEALAGE_TEXTURE_LOC);
+    }
+
+    ////////////////////////////////////////
+    void TransparencyStack::Begin(const Framebuffer& target, int width, int height) const
+    {
+        assert(width <= mAccumulation.GetWidth() && height <= mAccumulation.GetHeight());
+
+        // resolves a multisampled target too, the formats of the two match
+        glBlitNamedFramebuffer(target.GetId(), mFbo.GetId(), 0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+        constexpr float noAccumulation[]{ 0.0f, 0.0f, 0.0f, 0.0f };
+        constexpr float fullRevealage[]{ 1.0f, 0.0f, 0.0f, 0.0f };
+        glClearNamedFramebufferfv(mFbo.GetId(), GL_COLOR, 0, noAccumulation);
+        glClearNamedFramebufferfv(mFbo.GetId(), GL_COLOR, 1, fullRevealage);
+
+        mFbo.Bind();
+        glDepthMask(GL_FALSE);
+        glEnable(GL_BLEND);
+        glBlendFunci(0, GL_ONE, GL_ONE);
+        glBlendFunci(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+    }
+
+    ////////////////////////////////////////
+    void TransparencyStack::Composite(const Framebuffer& target) const
+    {
+        target.Bind();
+        glDisable(GL_DEPTH_TEST);
+        glBlendFunc(GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA);
+
+        mCompositeProgram.Use();
+            mAccumulation.Bind(ACCUMULATION_TEXTURE_LOC);
+            mRevealage.Bind(REVEALAGE_TEXTURE_LOC);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+            ++RuntimeStats::NumDrawCalls;
+        mCompositeProgram.Halt();
+
+        glDisable(GL_BLEND);
+        glEnable(GL_DEPTH_TEST);
+        glDepthMask(GL_TRUE);
+    }
+
+    ////////////////////////////////////////
+    LayeredShadowMode QueryLayeredShadowMode()
+    {
+        return GLAD_GL_ARB_shader_viewport_layer_array ? LayeredShadowMode::VertexShader : LayeredShadowMode::GeometryShader;
+    }
+
+    ////////////////////////////////////////
+    static Program CreateDepthProgram(const std::string& rootPath,
+                                      ShaderLoader& loader,
+                                      bool isInstanced,
+                                      bool isOmni,
+                                      LayeredShadowMode layeredMode,
+                                      int numLayers)
+    {
+        int layered{};
+        switch (layeredMode) {
+            case LayeredShadowMode::None:
+                layered = 0;
+                break;
+            case LayeredShadowMode::GeometryShader:
+                layered = 1;
+                break;
+            case LayeredShadowMode::VertexShader:
+                layered = 2;
+                break;
+        }
+
+        const Shader& vertexShader{ loader.Load(GL_VERTEX_SHADER,
+                                                rootPath + "/shaders/depth.glsl",
+                                                { { "POE_APOS_LOC", ATTRIB_POS_LOC },
+                                                  { "POE_ULIGHT_MATRIX_LOC", AbstractDepthProgram::LIGHT_MATRIX_LOC },
+                                                  { "POE_ULIGHT_MATRICES_LOC", AbstractDepthProgram::LIGHT_MATRICES_LOC },
+                                                  { "POE_ULAYER_MASK_LOC", AbstractDepthProgram::LAYER_MASK_LOC },
+                                                  { "POE_UMODEL_LOC", AbstractDepthProgram::MODEL_MATRIX_LOC },
+                                                  { "POE_AMODEL_LOC", INSTANCED_MODEL_LOC },
+                                                  { "POE_VERTEX_DECODE_BLOCK_LOC", UniformBuffer::VERTEX_DECODE_BLOCK_BINDING },
+                                                  { "POE_INSTANCED", isInstanced ? 1 : 0 },
+                                                  { "POE_OMNI", isOmni ? 1 : 0 },
+                                                  { "POE_LAYERED", layered },
+                                                  { "POE_NUM_LAYERS", numLayers } }) };
+        const Shader& fragmentShader{ loader.Load(GL_FRAGMENT_SHADER,
+                                                  rootPath + "/shaders/depth.glsl",
+                                                  { { "POE_UFAR_PLANE_LOC", AbstractDepthProgram::FAR_PLANE_LOC },
+                                                    { "POE_ULIGHT_POS_LOC", AbstractDepthProgram::LIGHT_POS_LOC },
+                                                    { "POE_OMNI", isOmni ? 1 : 0 } }) };
+
+        if (layeredMode != LayeredShadowMode::GeometryShader) {
+            return Program{ vertexShader, fragmentShader };
+        }
+
+        const Shader& geometryShader{ loader.Load(GL_GEOMETRY_SHADER,
+                                                  rootPath + "/shaders/depth.glsl",
+                                                  { { "POE_ULIGHT_MATRICES_LOC", AbstractDepthProgram::LIGHT_MATRICES_LOC },
+                                                    { "POE_ULAYER_MASK_LOC", AbstractDepthProgram::LAYER_MASK_LOC },
+                                                    { "POE_OMNI", isOmni ? 1 : 0 },
+                                                    { "POE_NUM_LAYERS", numLayers } }) };
+        return Program{ vertexShader, geometryShader, fragmentShader };
+    }
+
+    ////////////////////////////////////////
+    AbstractDepthProgram::AbstractDepthProgram(const std::string& rootPath,
+                                               ShaderLoader& loader,
+                                               bool isInstanced,
+                                               bool isOmni,
+                                               LayeredShadowMode layeredMode,
+                                               int numLayers)
+        : mProgram{ CreateDepthProgram(rootPath, loader, isInstanced, isOmni, layeredMode, numLayers) },
+          mLayeredMode{layeredMode},
+          mNumLayers{numLayers} {}
 
     ////////////////////////////////////////
     DepthProgram::DepthProgram(const std::string& rootPath, ShaderLoader& loader)
@@ -2729,16 +5859,352 @@ namespace Poe
     DepthOmniProgramInstanced::DepthOmniProgramInstanced(const std::string& rootPath, ShaderLoader& loader)
         : AbstractDepthProgram(rootPath, loader, true, true) {}
 
+    ////////////////////////////////////////
+    DepthProgramLayered::DepthProgramLayered(const std::string& rootPath, ShaderLoader& loader, LayeredShadowMode layeredMode, int numLayers)
+        : AbstractDepthProgram(rootPath, loader, false, false, layeredMode, numLayers) {}
+
+    ////////////////////////////////////////
+    DepthOmniProgramLayered::DepthOmniProgramLayered(const std::string& rootPath, ShaderLoader& loader, LayeredShadowMode layeredMode)
+        : AbstractDepthProgram(rootPath, loader, false, true, layeredMode, 6) {}
+
+    ////////////////////////////////////////
+    DepthPrepass::DepthPrepass(const std::string& rootPath, ShaderLoader& loader)
+        : mProgram(rootPath, loader),
+          mProgramInstanced(rootPath, loader)
+    {}
+
+    ////////////////////////////////////////
+    void DepthPrepass::Begin(const AbstractCamera& camera) const
+    {
+        // same product as TransformUB::Set, the passes must agree on every bit
+        const glm::mat4 projView{ camera.GetProjectionMatrix() * camera.GetViewMatrix() };
+        mProgramInstanced.Use();
+        mProgramInstanced.SetLightMatrix(projView);
+        mProgram.Use();
+        mProgram.SetLightMatrix(projView);
+
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glDepthMask(GL_TRUE);
+        glDepthFunc(GL_LEQUAL);
+    }
+
+    ////////////////////////////////////////
+    InstanceCullingProgram::InstanceCullingProgram(const std::string& rootPath, ShaderLoader& loader)
+        : mProgram{ loader.Load(GL_COMPUTE_SHADER,
+                                rootPath + "/shaders/culling/instance_culling.glsl",
+                                { { "POE_WORK_GROUP_SIZE", WORK_GROUP_SIZE },
+                                  { "POE_INSTANCE_INPUT_BLOCK_LOC", ShaderStorageBuffer::INSTANCE_INPUT_BLOCK_BINDING },
+                                  { "POE_INSTANCE_OUTPUT_BLOCK_LOC", ShaderStorageBuffer::INSTANCE_OUTPUT_BLOCK_BINDING },
+                                  { "POE_INSTANCE_COMMAND_BLOCK_LOC", ShaderStorageBuffer::INSTANCE_COMMAND_BLOCK_BINDING },
+                                  { "POE_UFRUSTUM_PLANES_LOC", FRUSTUM_PLANES_LOC },
+                                  { "POE_UBOUNDING_SPHERE_LOC", BOUNDING_SPHERE_LOC },
+                                  { "POE_UNUM_INSTANCES_LOC", NUM_INSTANCES_LOC },
+                                  { "POE_UCAMERA_POS_LOC", CAMERA_POS_LOC },
+                                  { "POE_ULOD_SCALE_LOC", LOD_SCALE_LOC },
+                                  { "POE_UNUM_LODS_LOC", NUM_LODS_LOC },
+                                  { "POE_ULOD_ERRORS_LOC", LOD_ERRORS_LOC },
+                                  { "POE_MAX_LODS", MAX_MESH_LODS } }) }
+    {}
+
+    ////////////////////////////////////////
+    void InstanceCullingProgram::Cull(const StaticMesh& mesh, const Utility::Frustum& frustum, const LodView& view) const
+    {
+        assert(mesh.IsInstanceCullingEnabled());
+        mesh.ResetCulledCommand();
+
+        const int numInstances{ mesh.GetNumInstances() };
+        if (numInstances <= 0) {
+            return;
+        }
+
+        // meshes without bounds are never culled
+        const Utility::AABB bounds{ mesh.GetBounds() };
+        const glm::vec4 sphere{ bounds.IsValid() ? glm::vec4(bounds.GetCenter(), glm::length(bounds.GetExtents()))
+                                                 : glm::vec4(0.0f, 0.0f, 0.0f, std::numeric_limits<float>::max()) };
+
+        mProgram.Use();
+            glUniform4fv(FRUSTUM_PLANES_LOC, 6, glm::value_ptr(frustum.mPlanes[0]));
+            glUniform4fv(BOUNDING_SPHERE_LOC, 1, glm::value_ptr(sphere));
+            glUniform1ui(NUM_INSTANCES_LOC, static_cast<unsigned>(numInstances));
+
+            std::array<float, MAX_MESH_LODS> errors{};
+            const std::vector<MeshLod>& lods{ mesh.GetLods() };
+            for (size_t i = 0; i < lods.size(); ++i) {
+                errors[i] = lods[i].mError;
+            }
+            glUniform3fv(CAMERA_POS_LOC, 1, glm::value_ptr(view.mCameraPosition));
+            glUniform1f(LOD_SCALE_LOC, bounds.IsValid() ? view.mScale : 0.0f);
+            glUniform1ui(NUM_LODS_LOC, static_cast<unsigned>(lods.size()));
+            glUniform1fv(LOD_ERRORS_LOC, MAX_MESH_LODS, errors.data());
+
+            glBindBufferRange(GL_SHADER_STORAGE_BUFFER, ShaderStorageBuffer::INSTANCE_INPUT_BLOCK_BINDING, mesh.GetModelMatrixBufferId(),
+                              static_cast<GLintptr>(mesh.GetModelMatrixBufferOffset()), static_cast<GLsizeiptr>(mesh.GetModelMatrixBufferSize()));
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ShaderStorageBuffer::INSTANCE_OUTPUT_BLOCK_BINDING, mesh.GetCulledMatrixBufferId());
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ShaderStorageBuffer::INSTANCE_COMMAND_BLOCK_BINDING, mesh.GetCulledCommandId());
+
+            glDispatchCompute(static_cast<unsigned>((numInstances + WORK_GROUP_SIZE - 1) / WORK_GROUP_SIZE), 1, 1);
+            glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+        mProgram.Halt();
+    }
+
+    ////////////////////////////////////////
+    ClusteredLightingStack::ClusteredLightingStack(const std::string& rootPath, ShaderLoader& loader, int maxPointLights, int maxSpotLights)
+        : mProgram{ loader.Load(GL_COMPUTE_SHADER,
+                                rootPath + "/shaders/culling/light_clustering.glsl",
+                                { { "POE_WORK_GROUP_SIZE", WORK_GROUP_SIZE },
+                                  { "POE_CLUSTER_GRID_X", GRID_X },
+                                  { "POE_CLUSTER_GRID_Y", GRID_Y },
+                                  { "POE_CLUSTER_GRID_Z", GRID_Z },
+                                  { "POE_MAX_LIGHTS_PER_CLUSTER", MAX_LIGHTS_PER_CLUSTER },
+                                  { "POE_POINT_LIGHT_LIST_BLOCK_LOC", ShaderStorageBuffer::POINT_LIGHT_LIST_BLOCK_BINDING },
+                                  { "POE_SPOT_LIGHT_LIST_BLOCK_LOC", ShaderStorageBuffer::SPOT_LIGHT_LIST_BLOCK_BINDING },
+                                  { "POE_LIGHT_CLUSTER_BLOCK_LOC", ShaderStorageBuffer::LIGHT_CLUSTER_BLOCK_BINDING },
+                                  { "POE_LIGHT_INDEX_BLOCK_LOC", ShaderStorageBuffer::LIGHT_INDEX_BLOCK_BINDING },
+                                  { "POE_UINVERSE_PROJECTION_LOC", INVERSE_PROJECTION_LOC },
+                                  { "POE_UNUM_POINT_LIGHTS_LOC", NUM_POINT_LIGHTS_LOC },
+                                  { "POE_UNUM_SPOT_LIGHTS_LOC", NUM_SPOT_LIGHTS_LOC } },
+                                { rootPath + "/shaders/lights/point.glsl",
+                                  rootPath + "/shaders/lights/spot.glsl" }) },
+          mPointLightBuffer(sizeof(PointLightListElem__DATA) * static_cast<size_t>(std::max(maxPointLights, 1)),
+                            GL_DYNAMIC_DRAW, ShaderStorageBuffer::POINT_LIGHT_LIST_BLOCK_BINDING),
+          mSpotLightBuffer(sizeof(SpotLightListElem__DATA) * static_cast<size_t>(std::max(maxSpotLights, 1)),
+                           GL_DYNAMIC_DRAW, ShaderStorageBuffer::SPOT_LIGHT_LIST_BLOCK_BINDING),
+          mClusterBuffer(sizeof(glm::vec4) + sizeof(glm::uvec4) * static_cast<size_t>(NUM_CLUSTERS),
+                         GL_DYNAMIC_COPY, ShaderStorageBuffer::LIGHT_CLUSTER_BLOCK_BINDING),
+          mLightIndexBuffer(sizeof(unsigned) * static_cast<size_t>(NUM_CLUSTERS * MAX_LIGHTS_PER_CLUSTER),
+                            GL_DYNAMIC_COPY, ShaderStorageBuffer::LIGHT_INDEX_BLOCK_BINDING),
+          mPointLights(static_cast<size_t>(std::max(maxPointLights, 0))),
+          mSpotLights(static_cast<size_t>(std::max(maxSpotLights, 0))),
+          mNumPointLights{}, mNumSpotLights{}
+    {}
+
+    ////////////////////////////////////////
+    void ClusteredLightingStack::SetPointLight(int ind, const PointLight& pl)
+    {
+        PointLightListElem__DATA& light{ mPointLights[static_cast<size_t>(ind)] };
+        light.SetColor(pl.mColor);
+        light.SetWorldPosition(pl.mWorldPosition);
+        light.SetViewPosition(pl.mViewPosition);
+        light.SetRadius(pl.mRadius);
+        light.SetIntensity(pl.mIntensity);
+        light.SetNearPlane(pl.mNearPlane);
+        light.SetFarPlane(pl.mFarPlane);
+    }
+
+    ////////////////////////////////////////
+    void ClusteredLightingStack::SetSpotLight(int ind, const glm::mat4& viewMatrix, const SpotLight& sp)
+    {
+        SpotLightListElem__DATA& light{ mSpotLights[static_cast<size_t>(ind)] };
+        light.SetColor(sp.mColor);
+        light.SetDirection(viewMatrix, sp.mDirection);
+        light.SetPosition(viewMatrix, sp.mPosition);
+        light.SetInnerCutoff(sp.mInnerCutoff);
+        light.SetOuterCutoff(sp.mOuterCutoff);
+        light.SetRadius(sp.mRadius);
+        light.SetIntensity(sp.mIntensity);
+        light.SetLightMatrix(sp.mLightMatrix);
+    }
+
+    ////////////////////////////////////////
+    void ClusteredLightingStack::SetNumPointLights(int numLights)
+    {
+        mNumPointLights = std::clamp(numLights, 0, GetMaxPointLights());
+    }
+
+    ////////////////////////////////////////
+    void ClusteredLightingStack::SetNumSpotLights(int numLights)
+    {
+        mNumSpotLights = std::clamp(numLights, 0, GetMaxSpotLights());
+    }
+
+    ////////////////////////////////////////
+    void ClusteredLightingStack::Update(const AbstractCamera& camera, int width, int height) const
+    {
+        if (mNumPointLights > 0) {
+            mPointLightBuffer.Modify(0, static_cast<int>(sizeof(PointLightListElem__DATA) * static_cast<size_t>(mNumPointLights)), mPointLights.data());
+        }
+        if (mNumSpotLights > 0) {
+            mSpotLightBuffer.Modify(0, static_cast<int>(sizeof(SpotLightListElem__DATA) * static_cast<size_t>(mNumSpotLights)), mSpotLights.data());
+        }
+
+        // read back by the fragment shader to find the cluster of a fragment
+        const glm::vec4 params{ camera.GetNear(), camera.GetFar(), static_cast<float>(width), static_cast<float>(height) };
+        mClusterBuffer.Modify(0, static_cast<int>(sizeof(glm::vec4)), glm::value_ptr(params));
+
+        mProgram.Use();
+            glUniformMatrix4fv(INVERSE_PROJECTION_LOC, 1, GL_FALSE, glm::value_ptr(glm::inverse(camera.GetProjectionMatrix())));
+            glUniform1ui(NUM_POINT_LIGHTS_LOC, static_cast<unsigned>(mNumPointLights));
+            glUniform1ui(NUM_SPOT_LIGHTS_LOC, static_cast<unsigned>(mNumSpotLights));
+
+            Bind();
+
+            glDispatchCompute(static_cast<unsigned>((NUM_CLUSTERS + WORK_GROUP_SIZE - 1) / WORK_GROUP_SIZE), 1, 1);
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        mProgram.Halt();
+    }
+
+    ////////////////////////////////////////
+    void ClusteredLightingStack::Bind() const
+    {
+        mPointLightBuffer.TurnOn();
+        mSpotLightBuffer.TurnOn();
+        mClusterBuffer.TurnOn();
+        mLightIndexBuffer.TurnOn();
+    }
+
+    ////////////////////////////////////////
+    static Cubemap CreateSkyCubemap(int size)
+    {
+        CubemapParams params;
+        params.internalFormat = GL_RGBA16F;
+        params.textureFormat = GL_RGBA;
+        params.type = GL_FLOAT;
+        params.wrapS = params.wrapT = params.wrapR = GL_CLAMP_TO_EDGE;
+        params.maxAnisotropy = 0.0f;
+        return Cubemap(size, size, params);
+    }
+
     ////////////////////////////////////////
     RealisticSkyboxProgram::RealisticSkyboxProgram(const std::string& rootPath,
                                                    ShaderLoader& loader,
-                                                   float shaderPi, float iSteps, float jSteps)
+                                                   float shaderPi, float iSteps, float jSteps, int cubemapSize)
         : mProgram{ loader.Load(GL_VERTEX_SHADER,
                                 rootPath + "/shaders/realistic_skybox.glsl",
                                 { { "POE_TRANSFORM_BLOCK_LOC", UniformBuffer::TRANSFORM_BLOCK_BINDING } }),
                     loader.Load(GL_FRAGMENT_SHADER,
                                 rootPath + "/shaders/realistic_skybox.glsl",
-                                { { "PI", shaderPi }, { "I_STEPS", iSteps }, { "J_STEPS", jSteps },
-                                  { "POE_REALISTIC_SKYBOX_BLOCK_LOC", UniformBuffer::REALISTIC_SKYBOX_BLOCK_BINDING } }) },
-         mShaderPI {shaderPi}, mShaderISteps{iSteps}, mShaderJSteps{jSteps} {}
+                                { { "POE_USKYBOX_LOC", SKYBOX_LOC } }) },
+          mTransmittanceProgram{ loader.Load(GL_COMPUTE_SHADER,
+                                             rootPath + "/shaders/sky/transmittance_lut.glsl",
+                                             { { "PI", shaderPi }, { "J_STEPS", jSteps },
+                                               { "POE_WORK_GROUP_SIZE", WORK_GROUP_SIZE },
+                                               { "POE_UOUTPUT_IMAGE_LOC", OUTPUT_IMAGE_LOC },
+                                               { "POE_REALISTIC_SKYBOX_BLOCK_LOC", UniformBuffer::REALISTIC_SKYBOX_BLOCK_BINDING } },
+                                             { rootPath + "/shaders/sky/atmosphere.glsl" }) },
+          mMultiScatteringProgram{ loader.Load(GL_COMPUTE_SHADER,
+                                               rootPath + "/shaders/sky/multi_scattering_lut.glsl",
+                                               { { "PI", shaderPi },
+                                                 { "POE_SQRT_SAMPLES", MULTI_SCATTERING_SQRT_SAMPLES },
+                                                 { "POE_STEPS", MULTI_SCATTERING_STEPS },
+                                                 { "POE_WORK_GROUP_SIZE", WORK_GROUP_SIZE },
+                                                 { "POE_UOUTPUT_IMAGE_LOC", OUTPUT_IMAGE_LOC },
+                                                 { "POE_UTRANSMITTANCE_LUT_LOC", TRANSMITTANCE_LUT_LOC },
+                                                 { "POE_REALISTIC_SKYBOX_BLOCK_LOC", UniformBuffer::REALISTIC_SKYBOX_BLOCK_BINDING } },
+                                               { rootPath + "/shaders/sky/atmosphere.glsl" }) },
+          mCubemapProgram{ loader.Load(GL_COMPUTE_SHADER,
+                                       rootPath + "/shaders/sky/sky_cubemap.glsl",
+                                       { { "PI", shaderPi }, { "I_STEPS", iSteps },
+                                         { "POE_WORK_GROUP_SIZE", WORK_GROUP_SIZE },
+                                         { "POE_UOUTPUT_IMAGE_LOC", OUTPUT_IMAGE_LOC },
+                                         { "POE_UTRANSMITTANCE_LUT_LOC", TRANSMITTANCE_LUT_LOC },
+                                         { "POE_UMULTI_SCATTERING_LUT_LOC", MULTI_SCATTERING_LUT_LOC },
+                                         { "POE_REALISTIC_SKYBOX_BLOCK_LOC", UniformBuffer::REALISTIC_SKYBOX_BLOCK_BINDING } },
+                                       { rootPath + "/shaders/sky/atmosphere.glsl" }) },
+          mTransmittanceLut{ CreateFramebufferTexture2D(TRANSMITTANCE_LUT_WIDTH, TRANSMITTANCE_LUT_HEIGHT) },
+          mMultiScatteringLut{ CreateFramebufferTexture2D(MULTI_SCATTERING_LUT_SIZE, MULTI_SCATTERING_LUT_SIZE) },
+          mCubemap{ CreateSkyCubemap(cubemapSize) },
+          mShaderPI {shaderPi}, mShaderISteps{iSteps}, mShaderJSteps{jSteps},
+          mAtmosphereRevision{}, mSkyRevision{}
+    {
+        Init();
+    }
+
+    ////////////////////////////////////////
+    void RealisticSkyboxProgram::Init() const
+    {
+        // texture and image units match the uniform locations
+        mProgram.SetInitialUniform(SKYBOX_LOC, SKYBOX_LOC);
+
+        mTransmittanceProgram.SetInitialUniform(OUTPUT_IMAGE_LOC, OUTPUT_IMAGE_LOC);
+
+        mMultiScatteringProgram.SetInitialUniform(OUTPUT_IMAGE_LOC, OUTPUT_IMAGE_LOC);
+        mMultiScatteringProgram.SetInitialUniform(TRANSMITTANCE_LUT_LOC, TRANSMITTANCE_LUT_LOC);
+
+        mCubemapProgram.SetInitialUniform(OUTPUT_IMAGE_LOC, OUTPUT_IMAGE_LOC);
+        mCubemapProgram.SetInitialUniform(TRANSMITTANCE_LUT_LOC, TRANSMITTANCE_LUT_LOC);
+        mCubemapProgram.SetInitialUniform(MULTI_SCATTERING_LUT_LOC, MULTI_SCATTERING_LUT_LOC);
+    }
+
+    ////////////////////////////////////////
+    void RealisticSkyboxProgram::BakeLuts() const
+    {
+        mTransmittanceProgram.Use();
+            glBindImageTexture(OUTPUT_IMAGE_LOC, mTransmittanceLut.GetId(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+            glDispatchCompute(static_cast<unsigned>((TRANSMITTANCE_LUT_WIDTH + WORK_GROUP_SIZE - 1) / WORK_GROUP_SIZE),
+                              static_cast<unsigned>((TRANSMITTANCE_LUT_HEIGHT + WORK_GROUP_SIZE - 1) / WORK_GROUP_SIZE), 1);
+            glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+        mMultiScatteringProgram.Use();
+            mTransmittanceLut.Bind(TRANSMITTANCE_LUT_LOC);
+            glBindImageTexture(OUTPUT_IMAGE_LOC, mMultiScatteringLut.GetId(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+            glDispatchCompute(static_cast<unsigned>((MULTI_SCATTERING_LUT_SIZE + WORK_GROUP_SIZE - 1) / WORK_GROUP_SIZE),
+                              static_cast<unsigned>((MULTI_SCATTERING_LUT_SIZE + WORK_GROUP_SIZE - 1) / WORK_GROUP_SIZE), 1);
+            glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+        mMultiScatteringProgram.Halt();
+
+        DebugUI::PushLog(stdout, "[DEBUG] Baked atmosphere LUTs\n");
+    }
+
+    ////////////////////////////////////////
+    void RealisticSkyboxProgram::BakeCubemap() const
+    {
+        const int size{ mCubemap.GetWidth() };
+
+        mCubemapProgram.Use();
+            mTransmittanceLut.Bind(TRANSMITTANCE_LUT_LOC);
+            mMultiScatteringLut.Bind(MULTI_SCATTERING_LUT_LOC);
+            glBindImageTexture(OUTPUT_IMAGE_LOC, mCubemap.GetId(), 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+            glDispatchCompute(static_cast<unsigned>((size + WORK_GROUP_SIZE - 1) / WORK_GROUP_SIZE),
+                              static_cast<unsigned>((size + WORK_GROUP_SIZE - 1) / WORK_GROUP_SIZE), 6);
+            glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+        mCubemapProgram.Halt();
+
+        if (mCubemap.GetGenerateMipmaps()) {
+            glGenerateTextureMipmap(mCubemap.GetId());
+        }
+    }
+
+    ////////////////////////////////////////
+    void RealisticSkyboxProgram::Update(const RealisticSkyboxUB& block) const
+    {
+        if (mAtmosphereRevision != block.GetAtmosphereRevision()) {
+            BakeLuts();
+            mAtmosphereRevision = block.GetAtmosphereRevision();
+            mSkyRevision = 0;
+        }
+        if (mSkyRevision != block.GetSkyRevision()) {
+            BakeCubemap();
+            mSkyRevision = block.GetSkyRevision();
+        }
+    }
+}
+
+#ifdef POE_COUNT_ALLOCATIONS
+////////////////////////////////////////
+static void* AllocateCounted(std::size_t size, std::size_t alignment)
+{
+    Poe::RuntimeStats::sNumAllocations.fetch_add(1, std::memory_order_relaxed);
+    void* ptr{ alignment > alignof(std::max_align_t)
+               ? std::aligned_alloc(alignment, (std::max<std::size_t>(size, 1) + alignment - 1) / alignment * alignment)
+               : std::malloc(std::max<std::size_t>(size, 1)) };
+    if (!ptr) {
+        std::abort();
+    }
+    return ptr;
 }
+
+////////////////////////////////////////
+void* operator new(std::size_t size) { return AllocateCounted(size, 0); }
+void* operator new[](std::size_t size) { return AllocateCounted(size, 0); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return AllocateCounted(size, static_cast<std::size_t>(alignment)); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return AllocateCounted(size, static_cast<std::size_t>(alignment)); }
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+#endif
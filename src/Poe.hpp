@@ -48,13 +48,21 @@ ENABLE_WARNINGS()
 #include <assimp/postprocess.h>
 
 #include <vector>
+#include <array>
 #include <initializer_list>
 #include <unordered_map>
 #include <string>
 #include <string_view>
+#include <span>
 #include <functional>
 #include <utility>
 #include <memory>
+#include <deque>
+#include <unordered_set>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 
 #include <cstring>
 
@@ -70,6 +78,21 @@ namespace Poe
         static int NumInstancedDrawCalls;
         static int NumVAOBinds;
         static int NumTextureBinds;
+        static int NumVisibleMeshes;
+        static int NumCulledMeshes;
+        static int NumVisibleShadowCasters;
+        static int NumCulledShadowCasters;
+
+        // binds a RenderQueue skipped because the state was already bound
+        static int NumSavedProgramBinds;
+        static int NumSavedVAOBinds;
+        static int NumSavedTextureBinds;
+
+        // heap allocations of every thread since the last Reset()
+        static std::atomic<unsigned long long> sNumAllocations;
+        static unsigned long long sNumAllocationsAtReset;
+        static int GetNumAllocations()
+        { return static_cast<int>(sNumAllocations.load(std::memory_order_relaxed) - sNumAllocationsAtReset); }
 
         static void Reset();
 
@@ -77,6 +100,154 @@ namespace Poe
         static int GetQueryResult(GLuint query);
     };
 
+    ////////////////////////////////////////
+    // cpu and gpu timings of nested, named scopes. The gpu side uses GL_TIMESTAMP
+    // queries (GL_TIME_ELAPSED queries can't nest) kept in a ring of NUM_FRAMES frames,
+    // a frame is read back once its queries are available, so the results lag a few
+    // frames behind instead of stalling the pipeline. EndFrame() has to be called once
+    // per frame, outside of every scope.
+    struct Profiler
+    {
+        static constexpr int NUM_FRAMES{ 4 };
+        static constexpr int MAX_SCOPES{ 128 };  // per frame, the rest is not recorded
+        static constexpr int MAX_DEPTH{ 16 };
+        static constexpr int NUM_SAMPLES{ 128 }; // rolling window of the statistics
+
+        // milliseconds over the last NUM_SAMPLES frames the scope was recorded in
+        struct ScopeStats
+        {
+            std::string mName;
+            int mDepth;
+            std::array<float, NUM_SAMPLES> mGpuSamples;
+            std::array<float, NUM_SAMPLES> mCpuSamples;
+            int mNumSamples;
+            int mNextSample;
+            unsigned long long mLastFrame;
+
+            float GetGpuAverage() const { return ComputeAverage(mGpuSamples); }
+            float GetCpuAverage() const { return ComputeAverage(mCpuSamples); }
+
+            // percentile in [0, 100]
+            float GetGpuPercentile(float percentile) const { return ComputePercentile(mGpuSamples, percentile); }
+            float GetCpuPercentile(float percentile) const { return ComputePercentile(mCpuSamples, percentile); }
+
+        private:
+            float ComputeAverage(const std::array<float, NUM_SAMPLES>& samples) const;
+            float ComputePercentile(const std::array<float, NUM_SAMPLES>& samples, float percentile) const;
+        };
+
+    private:
+        struct ScopeRecord
+        {
+            const char* mName;
+            int mIndex;
+            int mParent;
+            double mCpuBegin;
+            double mCpuEnd;
+        };
+
+        static bool sIsInitialized;
+        static unsigned long long sFrame;
+        static std::array<std::array<GLuint, 2 * MAX_SCOPES>, NUM_FRAMES> sQueries;
+        static std::array<std::vector<ScopeRecord>, NUM_FRAMES> sRecords;
+        static std::array<GLuint, NUM_FRAMES> sLastQueries;
+        static std::array<unsigned long long, NUM_FRAMES> sRecordFrames;
+        static std::array<int, MAX_DEPTH> sOpenScopes;
+        static int sDepth;
+
+        // a scope is told apart by its name pointer, index and parent stats, so that
+        // resolving a frame only builds a name string for scopes it hasn't seen before
+        struct ScopeKey
+        {
+            const char* mName;
+            int mIndex;
+            size_t mParent;
+        };
+
+        static std::vector<ScopeStats> sStats;
+        static std::vector<std::pair<ScopeKey, size_t>> sStatsIndices; // sorted by key
+        static std::vector<size_t> sRecordStats; // scratch of Resolve, only grows
+        static std::vector<size_t> sFrameScopes;
+        static float sFrameGpuTime;
+        static unsigned long long sNumResolvedFrames;
+
+        static bool Resolve(size_t slot);
+
+    public:
+        Profiler() = delete;
+
+        // name has to outlive the profiler, e.g. a string literal, index >= 0 is appended to it
+        static void BeginScope(const char* name, int index = -1);
+        static void EndScope();
+
+        static void EndFrame();
+
+        // the scopes of the most recently resolved frame, in the order they began
+        static const std::vector<size_t>& GetFrameScopes() { return sFrameScopes; }
+        static const ScopeStats& GetScopeStats(size_t ind) { return sStats[ind]; }
+
+        // milliseconds the top level scopes of the most recently resolved frame took on the GPU
+        static float GetFrameGpuTime() { return sFrameGpuTime; }
+        static unsigned long long GetNumResolvedFrames() { return sNumResolvedFrames; }
+
+        static void Reset();
+    };
+
+    ////////////////////////////////////////
+    struct ProfileScope
+    {
+        explicit ProfileScope(const char* name, int index = -1) { Profiler::BeginScope(name, index); }
+        ~ProfileScope() { Profiler::EndScope(); }
+
+        ProfileScope(const ProfileScope&) = delete;
+        ProfileScope& operator=(const ProfileScope&) = delete;
+    };
+
+    ////////////////////////////////////////
+    // persistently mapped storage with one segment per frame in flight. The first write of
+    // a frame moves to the next segment, so the data must be written at most once per frame
+    // and bindings have to follow GetOffset(). EndFrame() has to be called once per frame.
+    struct PersistentBuffer
+    {
+    public:
+        static constexpr int NUM_FRAMES{ 3 };
+
+    private:
+        unsigned mId;
+        size_t mSize;
+        size_t mSegmentSize;
+        unsigned char* mPtr;
+        std::vector<unsigned char> mShadow;
+        unsigned long long mWriteFrame;
+        int mSegment;
+
+        static unsigned long long sFrame;
+        static std::array<GLsync, NUM_FRAMES> sFences;
+
+    public:
+        PersistentBuffer(size_t size, size_t alignment);
+
+        ~PersistentBuffer();
+
+        PersistentBuffer(const PersistentBuffer&) = delete;
+        PersistentBuffer& operator=(const PersistentBuffer&) = delete;
+
+        PersistentBuffer(PersistentBuffer&&);
+        PersistentBuffer& operator=(PersistentBuffer&&);
+
+        void Write(size_t offset, size_t size, const void* data);
+
+        // modify the cpu copy, then publish it with Flush()
+        unsigned char* GetShadowPtr() { return mShadow.data(); }
+        void Flush() { Write(0, mSize, mShadow.data()); }
+
+        unsigned GetId() const { return mId; }
+        size_t GetSize() const { return mSize; }
+        size_t GetOffset() const { return static_cast<size_t>(mSegment) * mSegmentSize; }
+
+        static void EndFrame();
+    };
+
     ////////////////////////////////////////
     struct VertexBuffer
     {
@@ -84,11 +255,15 @@ namespace Poe
         unsigned mId;
         unsigned mMode;
         size_t mNumElements;
+        std::unique_ptr<PersistentBuffer> mPersistentBuffer;
 
     public:
-        VertexBuffer(size_t numElements, unsigned mode);
+        VertexBuffer(size_t numElements, unsigned mode, bool isPersistent = false);
         VertexBuffer(const std::vector<float>& vertices, unsigned mode);
 
+        // immutable storage filled once from vertices, it can't be mapped or modified afterwards
+        VertexBuffer(const float* vertices, size_t numElements);
+
         ~VertexBuffer() { glDeleteBuffers(1, &mId); }
 
         VertexBuffer(const VertexBuffer&) = delete;
@@ -97,20 +272,40 @@ namespace Poe
         VertexBuffer(VertexBuffer&&);
         VertexBuffer& operator=(VertexBuffer&&);
 
-        void Bind() const { glBindBuffer(GL_ARRAY_BUFFER, mId); }
+        void Bind() const { glBindBuffer(GL_ARRAY_BUFFER, GetId()); }
         void UnBind() const { glBindBuffer(GL_ARRAY_BUFFER, 0); }
 
-        unsigned GetId() const { return mId; }
+        unsigned GetId() const { return mPersistentBuffer ? mPersistentBuffer->GetId() : mId; }
         unsigned GetMode() const { return mMode; }
         size_t GetNumElements() const { return mNumElements; }
 
+        // byte offset of the data the next draws read, only moves for persistent buffers
+        size_t GetOffset() const { return mPersistentBuffer ? mPersistentBuffer->GetOffset() : 0; }
+        bool IsPersistent() const { return static_cast<bool>(mPersistentBuffer); }
+
         float* GetWritePtr() const
-        { return reinterpret_cast<float*>(glMapNamedBuffer(mId, GL_WRITE_ONLY)); }
+        {
+            if (mPersistentBuffer)
+                return reinterpret_cast<float*>(mPersistentBuffer->GetShadowPtr());
+            return reinterpret_cast<float*>(glMapNamedBuffer(mId, GL_WRITE_ONLY));
+        }
 
-        int Unmap() const { return glUnmapNamedBuffer(mId); }
+        int Unmap() const
+        {
+            if (mPersistentBuffer) {
+                mPersistentBuffer->Flush();
+                return GL_TRUE;
+            }
+            return glUnmapNamedBuffer(mId);
+        }
 
         void Modify(int offset, int size, const void* data) const
-        { glNamedBufferSubData(mId, offset, size, data); }
+        {
+            if (mPersistentBuffer)
+                mPersistentBuffer->Write(static_cast<size_t>(offset), static_cast<size_t>(size), data);
+            else
+                glNamedBufferSubData(mId, offset, size, data);
+        }
     };
 
     ////////////////////////////////////////
@@ -125,6 +320,9 @@ namespace Poe
         IndexBuffer(size_t numElements, unsigned mode);
         IndexBuffer(const std::vector<unsigned>& indices, unsigned mode);
 
+        // immutable storage filled once from indices, it can't be mapped or modified afterwards
+        IndexBuffer(const unsigned* indices, size_t numElements);
+
         ~IndexBuffer() { glDeleteBuffers(1, &mId); }
 
         IndexBuffer(const IndexBuffer&) = delete;
@@ -149,6 +347,48 @@ namespace Poe
         { glNamedBufferSubData(mId, offset, size, data); }
     };
 
+    ////////////////////////////////////////
+    // layout mandated by glMultiDrawElementsIndirect
+    struct DrawElementsIndirectCommand
+    {
+        unsigned count;
+        unsigned instanceCount;
+        unsigned firstIndex;
+        int baseVertex;
+        unsigned baseInstance;
+    };
+
+    ////////////////////////////////////////
+    struct IndirectBuffer
+    {
+    private:
+        unsigned mId;
+        unsigned mMode;
+        size_t mNumElements;
+
+    public:
+        IndirectBuffer(size_t numElements, unsigned mode);
+        IndirectBuffer(const std::vector<DrawElementsIndirectCommand>& commands, unsigned mode);
+
+        ~IndirectBuffer() { glDeleteBuffers(1, &mId); }
+
+        IndirectBuffer(const IndirectBuffer&) = delete;
+        IndirectBuffer& operator=(const IndirectBuffer&) = delete;
+
+        IndirectBuffer(IndirectBuffer&&);
+        IndirectBuffer& operator=(IndirectBuffer&&);
+
+        void Bind() const { glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mId); }
+        void UnBind() const { glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0); }
+
+        unsigned GetId() const { return mId; }
+        unsigned GetMode() const { return mMode; }
+        size_t GetNumElements() const { return mNumElements; }
+
+        void Modify(int offset, int size, const void* data) const
+        { glNamedBufferSubData(mId, offset, size, data); }
+    };
+
     ////////////////////////////////////////
     struct UniformBuffer
     {
@@ -157,6 +397,8 @@ namespace Poe
         size_t mSize;
         unsigned mMode;
         unsigned mBindLoc;
+        std::unique_ptr<PersistentBuffer> mPersistentBuffer;
+        mutable bool mIsTurnedOn;
 
     public:
         static constexpr int FOG_BLOCK_BINDING{ 0 };
@@ -168,8 +410,10 @@ namespace Poe
         static constexpr int POINT_LIGHT_BLOCK_BINDING{ 6 };
         static constexpr int SPOT_LIGHT_BLOCK_BINDING{ 7 };
         static constexpr int REALISTIC_SKYBOX_BLOCK_BINDING{ 8 };
+        static constexpr int VERTEX_DECODE_BLOCK_BINDING{ 9 };
 
-        UniformBuffer(size_t size, unsigned mode, unsigned bindLoc);
+        // persistent buffers are meant for blocks updated at most once per frame
+        UniformBuffer(size_t size, unsigned mode, unsigned bindLoc, bool isPersistent = false);
 
         ~UniformBuffer() { glDeleteBuffers(1, &mId); }
 
@@ -179,11 +423,79 @@ namespace Poe
         UniformBuffer(UniformBuffer&&);
         UniformBuffer& operator=(UniformBuffer&&);
 
-        void Bind() const { glBindBuffer(GL_UNIFORM_BUFFER, mId); }
+        void Bind() const { glBindBuffer(GL_UNIFORM_BUFFER, GetId()); }
         void UnBind() const { glBindBuffer(GL_UNIFORM_BUFFER, 0); }
 
-        void TurnOn() const { glBindBufferBase(GL_UNIFORM_BUFFER, mBindLoc, mId); }
-        void TurnOff() const { glBindBufferBase(GL_UNIFORM_BUFFER, mBindLoc, 0); }
+        void TurnOn() const
+        {
+            if (mPersistentBuffer)
+                glBindBufferRange(GL_UNIFORM_BUFFER, mBindLoc, mPersistentBuffer->GetId(), static_cast<GLintptr>(mPersistentBuffer->GetOffset()), static_cast<GLsizeiptr>(mSize));
+            else
+                glBindBufferBase(GL_UNIFORM_BUFFER, mBindLoc, mId);
+            mIsTurnedOn = true;
+        }
+
+        void TurnOff() const
+        {
+            glBindBufferBase(GL_UNIFORM_BUFFER, mBindLoc, 0);
+            mIsTurnedOn = false;
+        }
+
+        void Modify(int offset, int size, const void* data) const
+        {
+            if (mPersistentBuffer) {
+                size_t oldOffset{ mPersistentBuffer->GetOffset() };
+                mPersistentBuffer->Write(static_cast<size_t>(offset), static_cast<size_t>(size), data);
+                if (mIsTurnedOn && oldOffset != mPersistentBuffer->GetOffset())
+                    TurnOn();
+            }
+            else
+                glNamedBufferSubData(mId, offset, size, data);
+        }
+
+        bool IsPersistent() const { return static_cast<bool>(mPersistentBuffer); }
+
+        unsigned GetId() const { return mPersistentBuffer ? mPersistentBuffer->GetId() : mId; }
+        size_t GetSize() const { return mSize; }
+        unsigned GetMode() const { return mMode; }
+        unsigned GetBindLoc() const { return mBindLoc; }
+    };
+
+    ////////////////////////////////////////
+    struct ShaderStorageBuffer
+    {
+    private:
+        unsigned mId;
+        size_t mSize;
+        unsigned mMode;
+        unsigned mBindLoc;
+
+    public:
+        static constexpr int MATERIAL_TABLE_BLOCK_BINDING{ 0 };
+        static constexpr int MATERIAL_INDEX_BLOCK_BINDING{ 1 };
+        static constexpr int INSTANCE_INPUT_BLOCK_BINDING{ 2 };
+        static constexpr int INSTANCE_OUTPUT_BLOCK_BINDING{ 3 };
+        static constexpr int INSTANCE_COMMAND_BLOCK_BINDING{ 4 };
+        static constexpr int POINT_LIGHT_LIST_BLOCK_BINDING{ 5 };
+        static constexpr int SPOT_LIGHT_LIST_BLOCK_BINDING{ 6 };
+        static constexpr int LIGHT_CLUSTER_BLOCK_BINDING{ 7 };
+        static constexpr int LIGHT_INDEX_BLOCK_BINDING{ 8 };
+
+        ShaderStorageBuffer(size_t size, unsigned mode, unsigned bindLoc);
+
+        ~ShaderStorageBuffer() { glDeleteBuffers(1, &mId); }
+
+        ShaderStorageBuffer(const ShaderStorageBuffer&) = delete;
+        ShaderStorageBuffer& operator=(const ShaderStorageBuffer&) = delete;
+
+        ShaderStorageBuffer(ShaderStorageBuffer&&);
+        ShaderStorageBuffer& operator=(ShaderStorageBuffer&&);
+
+        void Bind() const { glBindBuffer(GL_SHADER_STORAGE_BUFFER, mId); }
+        void UnBind() const { glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0); }
+
+        void TurnOn() const { glBindBufferBase(GL_SHADER_STORAGE_BUFFER, mBindLoc, mId); }
+        void TurnOff() const { glBindBufferBase(GL_SHADER_STORAGE_BUFFER, mBindLoc, 0); }
 
         void Modify(int offset, int size, const void* data) const
         { glNamedBufferSubData(mId, offset, size, data); }
@@ -305,11 +617,21 @@ namespace Poe
         UniformBuffer mBuffer;
         RealisticSkyboxUB__DATA mData;
 
+        // what the buffer holds, Update skips the upload if nothing changed
+        mutable RealisticSkyboxUB__DATA mUploadedData;
+        mutable unsigned mAtmosphereRevision;
+        mutable unsigned mSkyRevision;
+
     public:
-        RealisticSkyboxUB(); // default is earth atmosphere
+        explicit RealisticSkyboxUB(bool isPersistent = false); // default is earth atmosphere
 
         const UniformBuffer& Buffer() const { return mBuffer; }
 
+        // bumped by Update when the planet or the atmosphere changed,
+        // the sky revision is bumped by any change, see RealisticSkyboxProgram::Update
+        unsigned GetAtmosphereRevision() const { return mAtmosphereRevision; }
+        unsigned GetSkyRevision() const { return mSkyRevision; }
+
         void SetRayleighScatteringCoefficient(const glm::vec3& v)
         { mData.SetRayleighScatteringCoefficient(v); }
 
@@ -362,7 +684,7 @@ namespace Poe
 
         RealisticSkyboxMaterial Get() const { return mData.Get(); }
 
-        void Update() const { mBuffer.Modify(0, sizeof(RealisticSkyboxUB__DATA), &mData); }
+        void Update() const;
     };
 
     ////////////////////////////////////////
@@ -384,7 +706,7 @@ namespace Poe
         FogUB__DATA mData;
 
     public:
-        FogUB(const glm::vec3& color, float distance, float exponent);
+        FogUB(const glm::vec3& color, float distance, float exponent, bool isPersistent = false);
 
         const UniformBuffer& Buffer() const { return mBuffer; }
 
@@ -417,7 +739,7 @@ namespace Poe
         PostProcessUB__DATA mData;
 
     public:
-        PostProcessUB();
+        explicit PostProcessUB(bool isPersistent = false);
 
         const UniformBuffer& Buffer() const { return mBuffer; }
 
@@ -510,7 +832,7 @@ namespace Poe
         TransformUB__DATA mData;
 
     public:
-        TransformUB();
+        explicit TransformUB(bool isPersistent = false);
         const UniformBuffer& Buffer() const { return mBuffer; }
 
         void SetProjectionMatrix(const glm::mat4& projectionMatrix)
@@ -796,11 +1118,11 @@ namespace Poe
 
         float GetFarPlane() const { return data.farPlane; }
 
-        std::vector<float> GetCascadeRanges() const
+        std::array<float, static_cast<size_t>(NumCascades)> GetCascadeRanges() const
         {
-            std::vector<float> buffer;
-            for (int i = 0; i < NumCascades; ++i) {
-                buffer.push_back(data.cascadeRanges[i * 4]);
+            std::array<float, static_cast<size_t>(NumCascades)> buffer;
+            for (size_t i = 0; i < buffer.size(); ++i) {
+                buffer[i] = data.cascadeRanges[i * 4];
             }
             return buffer;
         }
@@ -939,7 +1261,7 @@ namespace Poe
         int mNumLights;
 
     public:
-        explicit DirLightUB(int numLights);
+        explicit DirLightUB(int numLights, bool isPersistent = false);
         const UniformBuffer& Buffer() const { return mBuffer; }
 
         void SetColor(int ind, const glm::vec3& color)
@@ -995,35 +1317,43 @@ namespace Poe
         glm::mat4 GetLightMatrix(int ind, int cascade) const
         { return mLightsData[static_cast<size_t>(ind)].GetLightMatrix(cascade); }
 
-        std::vector<glm::mat4> GetLightMatrices(int ind) const
+        std::array<glm::mat4, static_cast<size_t>(NumCascades + 1)> GetLightMatrices(int ind) const
         {
-            std::vector<glm::mat4> buffer;
-            for (int i = 0; i <= NumCascades; ++i) {
-                buffer.push_back(mLightsData[static_cast<size_t>(ind)].GetLightMatrix(i));
+            std::array<glm::mat4, static_cast<size_t>(NumCascades + 1)> buffer;
+            for (size_t i = 0; i < buffer.size(); ++i) {
+                buffer[i] = mLightsData[static_cast<size_t>(ind)].GetLightMatrix(static_cast<int>(i));
             }
             return buffer;
         }
 
-        std::vector<float> GetCascadeRanges(int ind) const
+        std::array<float, static_cast<size_t>(NumCascades)> GetCascadeRanges(int ind) const
         { return mLightsData[static_cast<size_t>(ind)].GetCascadeRanges(); }
 
-        DirLight Get(int ind) const
+        // reuses the vectors of dl, they only allocate when they are too small
+        void Get(int ind, DirLight& dl) const
         {
-            DirLight dl{};
             dl.mColor = GetColor(ind);
             dl.mDirection = GetDirection(ind);
             dl.mIntensity = GetIntensity(ind);
             dl.mFarPlane = GetFarPlane(ind);
-            dl.mLightMatrices = GetLightMatrices(ind);
-            dl.mCascadeRanges = GetCascadeRanges(ind);
+            const std::array<glm::mat4, static_cast<size_t>(NumCascades + 1)> lightMatrices{ GetLightMatrices(ind) };
+            const std::array<float, static_cast<size_t>(NumCascades)> cascadeRanges{ GetCascadeRanges(ind) };
+            dl.mLightMatrices.assign(lightMatrices.begin(), lightMatrices.end());
+            dl.mCascadeRanges.assign(cascadeRanges.begin(), cascadeRanges.end());
+        }
+
+        DirLight Get(int ind) const
+        {
+            DirLight dl{};
+            Get(ind, dl);
             return dl;
         }
     };
 
     ////////////////////////////////////////
     template <int NumCascades>
-    DirLightUB<NumCascades>::DirLightUB(int numLights)
-        : mBuffer(sizeof(DirLightListElem__DATA<NumCascades>) * static_cast<size_t>(numLights), GL_DYNAMIC_DRAW, UniformBuffer::DIR_LIGHT_BLOCK_BINDING),
+    DirLightUB<NumCascades>::DirLightUB(int numLights, bool isPersistent)
+        : mBuffer(sizeof(DirLightListElem__DATA<NumCascades>) * static_cast<size_t>(numLights), GL_DYNAMIC_DRAW, UniformBuffer::DIR_LIGHT_BLOCK_BINDING, isPersistent),
           mLightsData(static_cast<size_t>(numLights)),
           mNumLights{numLights}
     {
@@ -1040,7 +1370,7 @@ namespace Poe
         int mNumLights;
 
     public:
-        explicit PointLightUB(int numLights);
+        explicit PointLightUB(int numLights, bool isPersistent = false);
         const UniformBuffer& Buffer() const { return mBuffer; }
 
         void SetColor(int ind, const glm::vec3& color)
@@ -1121,7 +1451,7 @@ namespace Poe
         int mNumLights;
 
     public:
-        explicit SpotLightUB(int numLights);
+        explicit SpotLightUB(int numLights, bool isPersistent = false);
         const UniformBuffer& Buffer() const { return mBuffer; }
 
         void SetColor(int ind, const glm::vec3& color)
@@ -1209,8 +1539,18 @@ namespace Poe
         unsigned dataType;
         int stride;
         unsigned offset;
+        bool normalized{ false }; // integers are fetched as floats in [0, 1] or [-1, 1]
     };
 
+    ////////////////////////////////////////
+    // Float: 32 bytes per vertex. Quantized: 16 bytes per vertex, with 16 bit positions
+    // normalized to the mesh bounds, 2_10_10_10 normals and half float texcoords.
+    enum class VertexFormat { Float, Quantized };
+
+    ////////////////////////////////////////
+    // bounds of the attribute at ATTRIB_POS_LOC, assumes GL_FLOAT positions
+    Utility::AABB ComputeVertexBounds(const std::vector<float>& vertices, const std::vector<VertexInfo>& infos);
+
     ////////////////////////////////////////
     struct VAO
     {
@@ -1249,19 +1589,85 @@ namespace Poe
             glDrawElementsInstanced(mode, mNumIndices, GL_UNSIGNED_INT, nullptr, numInstances);
         }
 
+        void DrawRange(unsigned mode, unsigned firstIndex, int numIndices) const
+        {
+            ++RuntimeStats::NumDrawCalls;
+            glDrawElements(mode, numIndices, GL_UNSIGNED_INT, reinterpret_cast<const void*>(static_cast<size_t>(firstIndex) * sizeof(unsigned)));
+        }
+
+        void DrawInstancedRange(unsigned mode, unsigned firstIndex, int numIndices, int numInstances) const
+        {
+            ++RuntimeStats::NumInstancedDrawCalls;
+            glDrawElementsInstanced(mode, numIndices, GL_UNSIGNED_INT, reinterpret_cast<const void*>(static_cast<size_t>(firstIndex) * sizeof(unsigned)), numInstances);
+        }
+
+        // expects an IndirectBuffer to be bound to GL_DRAW_INDIRECT_BUFFER
+        void MultiDrawIndirect(unsigned mode, int firstCommand, int numCommands) const
+        {
+            ++RuntimeStats::NumDrawCalls;
+            glMultiDrawElementsIndirect(mode, GL_UNSIGNED_INT,
+                                        reinterpret_cast<const void*>(static_cast<size_t>(firstCommand) * sizeof(DrawElementsIndirectCommand)),
+                                        numCommands, 0);
+        }
+
+        void MultiDrawInstancedIndirect(unsigned mode, int firstCommand, int numCommands) const
+        {
+            ++RuntimeStats::NumInstancedDrawCalls;
+            glMultiDrawElementsIndirect(mode, GL_UNSIGNED_INT,
+                                        reinterpret_cast<const void*>(static_cast<size_t>(firstCommand) * sizeof(DrawElementsIndirectCommand)),
+                                        numCommands, 0);
+        }
+
         unsigned GetId() const { return mId; }
         int GetNumIndices() const { return mNumIndices; }
     };
 
     ////////////////////////////////////////
+    struct Shader;
+
+    ////////////////////////////////////////
+    // linked programs on disk, keyed by the preprocessed sources of their shaders and by
+    // the driver. Every ShaderLoader owns one, binaries the driver rejects are compiled
+    // again and replaced
+    struct ProgramBinaryCache
+    {
+    private:
+        std::string mDirectory;
+        unsigned long long mDriverHash;
+
+    public:
+        // of every cache
+        static int NumHits;
+        static int NumMisses;
+
+        // an empty directory disables the cache
+        explicit ProgramBinaryCache(const std::string& directory);
+
+        const std::string& GetDirectory() const { return mDirectory; }
+        bool IsEnabled() const { return !mDirectory.empty(); }
+
+        unsigned long long ComputeKey(std::initializer_list<std::reference_wrapper<const Shader>> shaders) const;
+
+        // false if there is no binary for key or the driver rejects it
+        bool Load(unsigned program, unsigned long long key) const;
+        void Save(unsigned program, unsigned long long key) const;
+    };
+
+    ////////////////////////////////////////
+    // compiled by the first program that isn't restored from the cache of its ShaderLoader
     struct Shader
     {
     private:
         unsigned mId;
         unsigned mType;
+        unsigned long long mHash;
+        mutable std::string mSource;
+        mutable bool mIsCompiled;
+        std::shared_ptr<const ProgramBinaryCache> mCache;
 
     public:
-        Shader(unsigned type, const std::string& source);
+        // without a cache the programs using the shader are always linked
+        Shader(unsigned type, const std::string& source, std::shared_ptr<const ProgramBinaryCache> cache = {});
 
         ~Shader() { glDeleteShader(mId); }
 
@@ -1271,19 +1677,43 @@ namespace Poe
         Shader(Shader&&);
         Shader& operator=(Shader&&);
 
+        // issues the compile without waiting for it
+        void Compile() const;
+
         unsigned GetId() const { return mId; }
         unsigned GetType() const { return mType; }
+
+        // of the type and the preprocessed source
+        unsigned long long GetHash() const { return mHash; }
+
+        const std::shared_ptr<const ProgramBinaryCache>& GetCache() const { return mCache; }
     };
 
     ////////////////////////////////////////
+    // the link is checked on first use, so programs constructed back to back
+    // compile in parallel where GL_KHR_parallel_shader_compile is available.
+    // Uniforms that only have to be set once, like texture units, go through
+    // SetInitialUniform, which doesn't wait for the link
     struct Program
     {
     private:
         unsigned mId;
         std::unordered_map<std::string, int> mUniforms;
+        mutable std::vector<unsigned> mPendingShaders;
+        mutable std::vector<std::pair<int, int>> mInitialInts;
+        mutable std::vector<std::pair<int, float>> mInitialFloats;
+        std::shared_ptr<const ProgramBinaryCache> mCache; // of the first shader
+        unsigned long long mCacheKey;
+        mutable bool mIsResolved;
+
+        // waits for the link, logs its errors, stores the binary and sets the initial uniforms
+        void Resolve() const;
+
+        void ApplyInitialUniforms() const;
 
         int FindUniform(std::string_view name)
         {
+            if (!mIsResolved) Resolve();
             auto iter = mUniforms.find(name.data());
             if (iter == mUniforms.end()) {
                 int loc = glGetUniformLocation(mId, name.data());
@@ -1308,9 +1738,21 @@ namespace Poe
         Program(Program&&);
         Program& operator=(Program&&);
 
-        void Use() const { glUseProgram(mId); }
+        void Use() const
+        {
+            if (!mIsResolved) Resolve();
+            glUseProgram(mId);
+        }
+
         void Halt() const { glUseProgram(0); }
 
+        // true once Use() won't wait for the driver
+        bool IsReady() const;
+
+        // set once the program is linked, values set after Use() take precedence
+        void SetInitialUniform(int location, int value) const;
+        void SetInitialUniform(int location, float value) const;
+
         void Uniform(std::string_view name, int x)
         { glUniform1i(FindUniform(name), x); }
 
@@ -1350,7 +1792,11 @@ namespace Poe
         void Uniform(std::string_view name, const glm::mat4& m)
         { glUniformMatrix4fv(FindUniform(name), 1, GL_FALSE, glm::value_ptr(m)); }
 
-        unsigned GetId() const { return mId; }
+        unsigned GetId() const
+        {
+            if (!mIsResolved) Resolve();
+            return mId;
+        }
     };
 
     ////////////////////////////////////////
@@ -1359,8 +1805,14 @@ namespace Poe
     private:
         // key: path+type, data: shader content
         std::unordered_map<std::pair<std::string, GLuint>, Shader, Utility::PairHash> mShaders;
+        std::shared_ptr<const ProgramBinaryCache> mProgramCache;
 
     public:
+        // programs of its shaders are cached in programCacheDirectory unless it's empty, see ProgramBinaryCache
+        explicit ShaderLoader(const std::string& programCacheDirectory = "");
+
+        const ProgramBinaryCache& GetProgramCache() const { return *mProgramCache; }
+
         Shader& Load(GLuint type, const std::string& shaderUrl);
         Shader& Load(GLuint type, const std::string& shaderUrl,
                      const std::vector<std::pair<std::string, float>>& values);
@@ -1405,6 +1857,33 @@ namespace Poe
         unsigned type = GL_UNSIGNED_BYTE;
     };
 
+    ////////////////////////////////////////
+    // <image>.ptex next to the source image: the header, one size per mip level,
+    // then the block-compressed levels from the largest down
+    struct CompressedTextureHeader
+    {
+        static constexpr std::array<char, 4> MAGIC{ 'P', 'T', 'E', 'X' };
+        static constexpr unsigned VERSION{ 1 };
+
+        std::array<char, 4> mMagic;
+        unsigned mVersion;
+        unsigned mInternalFormat;
+        int mWidth;
+        int mHeight;
+        int mNumChannels;
+        int mNumMipmaps;
+    };
+
+    ////////////////////////////////////////
+    inline std::string GetCompressedTexturePath(const std::string& url) { return url + ".ptex"; }
+
+    // BC4 for one channel, BC5 for two, BC1 for three and BC7 for four
+    unsigned GetCompressedFormat(int numChannels);
+    bool IsCompressedTextureValid(const unsigned char* data, size_t size);
+
+    // needs a current context, the driver does the block compression
+    bool BakeCompressedTexture(const std::string& url);
+
     ////////////////////////////////////////
     struct Texture2D
     {
@@ -1420,6 +1899,7 @@ namespace Poe
 
         template <typename T>
         void Create(T* data);
+        void ApplyParameters();
 
         int mNumMipmaps;
         glm::vec4 mBorderColor;
@@ -1427,6 +1907,12 @@ namespace Poe
     public:
         Texture2D(const std::string& url, const Texture2DParams&);
 
+        // data was decoded from url, the format is picked from numChannels
+        Texture2D(const std::string& url, unsigned char* data, int width, int height, int numChannels, const Texture2DParams&);
+
+        // cache holds a validated .ptex file, its mip chain replaces generateMipmaps
+        Texture2D(const std::string& url, const unsigned char* cache, size_t cacheSize, const Texture2DParams&);
+
         template <typename T>
         Texture2D(T* data, int width, int height, int numChannels, const Texture2DParams&);
 
@@ -1477,13 +1963,63 @@ namespace Poe
     Texture2D CreateDepthMap(int width, int height);
 
     ////////////////////////////////////////
+    // images are decoded by a pool of worker threads, uploads stay on the thread owning the context
     struct Texture2DLoader
     {
     private:
+        struct DecodedImage
+        {
+            std::string mUrl;
+            Texture2DParams mParams;
+            unsigned char* mData;
+            int mWidth;
+            int mHeight;
+            int mNumChannels;
+        };
+
         std::unordered_map<std::string, Texture2D> mTextures;
 
+        int mNumWorkers;
+        std::vector<std::thread> mWorkers;
+        std::mutex mMutex;
+        std::condition_variable mRequestAvailable;
+        std::condition_variable mImageDecoded;
+        std::deque<std::pair<std::string, Texture2DParams>> mRequests;
+        std::vector<DecodedImage> mDecodedImages;
+        std::unordered_set<std::string> mInFlight;
+        bool mStopWorkers;
+        bool mUseCompressedCache;
+
+        Texture2D* LoadCompressed(const std::string& url, const Texture2DParams& params);
+        void StartWorkers();
+        void RunWorker();
+        void Upload(DecodedImage& image);
+
     public:
+        explicit Texture2DLoader(int numWorkers = std::max(static_cast<int>(std::thread::hardware_concurrency()) - 1, 1))
+            : mNumWorkers{numWorkers}, mStopWorkers{false}, mUseCompressedCache{true} {}
+        ~Texture2DLoader();
+
+        Texture2DLoader(const Texture2DLoader&) = delete;
+        Texture2DLoader& operator=(const Texture2DLoader&) = delete;
+
+        // blocks until the texture is resident, waits on the workers if it is in flight
         Texture2D& Load(const std::string& url, const Texture2DParams&);
+
+        // returns a checkerboard until Update uploads the decoded image into the same object
+        Texture2D& LoadAsync(const std::string& url, const Texture2DParams&);
+
+        // uploads at most maxUploads decoded images, returns how many were uploaded
+        int Update(int maxUploads = 4);
+
+        // blocks until every requested texture is resident
+        void Finish();
+
+        int GetNumInFlight() const { return static_cast<int>(mInFlight.size()); }
+
+        // an up-to-date .ptex next to the image is mapped and uploaded instead of decoding it
+        void SetCompressedCache(bool enable) { mUseCompressedCache = enable; }
+        bool IsCompressedCache() const { return mUseCompressedCache; }
     };
 
     ////////////////////////////////////////
@@ -1523,6 +2059,9 @@ namespace Poe
     public:
         Texture2DArray(const std::vector<std::string>& urls, const Texture2DArrayParams&);
 
+        // allocates storage only, layers are expected to be filled with glCopyImageSubData
+        Texture2DArray(int width, int height, int depth, int numChannels, const Texture2DArrayParams&);
+
         template <typename T>
         Texture2DArray(const std::vector<T*>& data, int width, int height, int numChannels, const Texture2DArrayParams&);
 
@@ -1755,9 +2294,12 @@ namespace Poe
         explicit Framebuffer(const Texture2D&);
         Framebuffer(const Texture2D&, unsigned attachmentType);
         Framebuffer(const Texture2DArray&, unsigned attachmentType, int layer);
+        Framebuffer(const Texture2DArray&, unsigned attachmentType);
         Framebuffer(const Cubemap&, unsigned attachmentType);
         Framebuffer(const Texture2D&, const Renderbuffer&);
         Framebuffer(const Texture2DMultiSample&, const RenderbufferMultiSample&);
+        // every color attachment is drawn to, depthStencil is a GL_DEPTH24_STENCIL8 texture
+        Framebuffer(const std::vector<std::reference_wrapper<const Texture2D>>& colorAttachments, const Texture2D& depthStencil);
 
         ~Framebuffer() { glDeleteFramebuffers(1, &mId); }
 
@@ -1774,11 +2316,15 @@ namespace Poe
         void Blit(int width, int height) const
         { glBlitNamedFramebuffer(mId, 0, 0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST); }
 
+        // the scaled blits filter linearly, dynamic resolution upscales through them
+        void Blit(int width, int height, int outputWidth, int outputHeight) const
+        { glBlitNamedFramebuffer(mId, 0, 0, 0, width, height, 0, 0, outputWidth, outputHeight, GL_COLOR_BUFFER_BIT, GL_LINEAR); }
+
         void Blit(const Framebuffer& fb, int width, int height) const
         { glBlitNamedFramebuffer(mId, fb.GetId(), 0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST); }
 
         void Blit(const Framebuffer& fb, int width, int height, int outputWidth, int outputHeight) const
-        { glBlitNamedFramebuffer(mId, fb.GetId(), 0, 0, width, height, 0, 0, outputWidth, outputHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST); }
+        { glBlitNamedFramebuffer(mId, fb.GetId(), 0, 0, width, height, 0, 0, outputWidth, outputHeight, GL_COLOR_BUFFER_BIT, GL_LINEAR); }
 
         unsigned GetId() const { return mId; }
 
@@ -1787,107 +2333,387 @@ namespace Poe
     };
 
     ////////////////////////////////////////
-    struct StaticMesh
+    struct StaticMeshTextures
     {
-    private:
-        VertexBuffer mVbo;
-        IndexBuffer mEbo;
-        VAO mVao;
-        std::unique_ptr<VertexBuffer> mModelMatrixBuffer;
-        int mNumInstances;
-
         std::vector<std::reference_wrapper<const Texture2D>> mAmbientTextures;
         std::vector<std::reference_wrapper<const Texture2D>> mDiffuseTextures;
         std::vector<std::reference_wrapper<const Texture2D>> mSpecularTextures;
 
-        void ReconfigureMatrixBuffer();
-
-    public:
-        StaticMesh(int numInstances,
-                   const std::vector<float>& vertices,
-                   const std::vector<unsigned>& indices,
-                   const std::vector<VertexInfo>& infos)
-            : mVbo(vertices, GL_STATIC_DRAW),
-              mEbo(indices, GL_STATIC_DRAW),
-              mVao(mVbo, mEbo, infos),
-              mModelMatrixBuffer{new VertexBuffer(16, GL_DYNAMIC_DRAW)},
-              mNumInstances{numInstances}
-        { CreateInstances(mNumInstances); }
-
-        StaticMesh(int numInstances,
-                   size_t numVertices,
-                   size_t numIndices,
-                   const std::vector<VertexInfo>& infos)
-            : mVbo(numVertices, GL_STATIC_DRAW),
-              mEbo(numIndices, GL_STATIC_DRAW),
-              mVao(mVbo, mEbo, infos),
-              mModelMatrixBuffer{new VertexBuffer(16, GL_DYNAMIC_DRAW)},
-              mNumInstances{numInstances}
-        { CreateInstances(mNumInstances); }
-
-        void Bind() const { mVao.Bind(); }
-        void UnBind() const { mVao.UnBind(); }
-
-        void Draw(unsigned mode = GL_TRIANGLES) const
-        { mVao.Draw(mode); }
-
-        void DrawInstanced(unsigned mode = GL_TRIANGLES) const
-        { mVao.DrawInstanced(mode, mNumInstances); }
-
-        void AddAmbientTexture(const Texture2D& t)
-        { mAmbientTextures.push_back(t); }
-
-        void AddDiffuseTexture(const Texture2D& t)
-        { mDiffuseTextures.push_back(t); }
-
-        void AddSpecularTexture(const Texture2D& t)
-        { mSpecularTextures.push_back(t); }
-
-        void BindTextures() const
+        // textures sampled from units 0, 1 and 2; missing ones fall back to the diffuse texture
+        std::array<const Texture2D*, 3> GetSlots() const
         {
+            auto first = [](const std::vector<std::reference_wrapper<const Texture2D>>& textures) {
+                return &static_cast<const Texture2D&>(textures[0]);
+            };
+
             if (mAmbientTextures.size() > 0 && mDiffuseTextures.size() > 0 && mSpecularTextures.size() > 0)
-            {
-                static_cast<const Texture2D&>(mAmbientTextures[0]).Bind(0);
-                static_cast<const Texture2D&>(mDiffuseTextures[0]).Bind(1);
-                static_cast<const Texture2D&>(mSpecularTextures[0]).Bind(2);
-            }
+                return { first(mAmbientTextures), first(mDiffuseTextures), first(mSpecularTextures) };
             else if (mDiffuseTextures.size() > 0 && mSpecularTextures.size() > 0)
-            {
-                static_cast<const Texture2D&>(mDiffuseTextures[0]).Bind(0);
-                static_cast<const Texture2D&>(mDiffuseTextures[0]).Bind(1);
-                static_cast<const Texture2D&>(mSpecularTextures[0]).Bind(2);
-            }
+                return { first(mDiffuseTextures), first(mDiffuseTextures), first(mSpecularTextures) };
             else if (mDiffuseTextures.size() > 0)
-            {
-                static_cast<const Texture2D&>(mDiffuseTextures[0]).Bind(0);
-                static_cast<const Texture2D&>(mDiffuseTextures[0]).Bind(1);
-                static_cast<const Texture2D&>(mDiffuseTextures[0]).Bind(2);
-            }
+                return { first(mDiffuseTextures), first(mDiffuseTextures), first(mDiffuseTextures) };
+            return { nullptr, nullptr, nullptr };
         }
 
-        void UnbindTextures() const
+        // texture ids of the slots actually used by Bind(), for grouping meshes by material
+        std::array<unsigned, 3> GetKey() const
         {
-            if (mAmbientTextures.size() > 0 && mDiffuseTextures.size() > 0 && mSpecularTextures.size() > 0)
-            {
-                static_cast<const Texture2D&>(mAmbientTextures[0]).UnBind(0);
-                static_cast<const Texture2D&>(mDiffuseTextures[0]).UnBind(1);
-                static_cast<const Texture2D&>(mSpecularTextures[0]).UnBind(2);
-            }
-            else if (mDiffuseTextures.size() > 0 && mSpecularTextures.size() > 0)
-            {
-                static_cast<const Texture2D&>(mDiffuseTextures[0]).UnBind(0);
-                static_cast<const Texture2D&>(mDiffuseTextures[0]).UnBind(1);
-                static_cast<const Texture2D&>(mSpecularTextures[0]).UnBind(2);
-            }
-            else if (mDiffuseTextures.size() > 0)
-            {
-                static_cast<const Texture2D&>(mDiffuseTextures[0]).UnBind(0);
-                static_cast<const Texture2D&>(mDiffuseTextures[0]).UnBind(1);
-                static_cast<const Texture2D&>(mDiffuseTextures[0]).UnBind(2);
+            std::array<unsigned, 3> key{};
+            std::array<const Texture2D*, 3> slots{ GetSlots() };
+            for (size_t i = 0; i < slots.size(); ++i)
+                key[i] = slots[i] ? slots[i]->GetId() : 0u;
+            return key;
+        }
+
+        void Bind() const
+        {
+            std::array<const Texture2D*, 3> slots{ GetSlots() };
+            for (size_t i = 0; i < slots.size(); ++i) {
+                if (slots[i]) slots[i]->Bind(static_cast<unsigned>(i));
             }
         }
 
-        size_t GetNumVertices() const { return mVbo.GetNumElements(); }
+        void UnBind() const
+        {
+            std::array<const Texture2D*, 3> slots{ GetSlots() };
+            for (size_t i = 0; i < slots.size(); ++i) {
+                if (slots[i]) slots[i]->UnBind(static_cast<unsigned>(i));
+            }
+        }
+    };
+
+    ////////////////////////////////////////
+    // index range of one level of detail, mError bounds how far its surface
+    // strays from the full resolution one in the mesh's local units
+    struct MeshLod
+    {
+        unsigned mFirstIndex;
+        unsigned mNumIndices;
+        float mError;
+    };
+
+    ////////////////////////////////////////
+    // camera position and the pixels one unit of error covers at distance one,
+    // a zero scale keeps every mesh at its full resolution
+    struct LodView
+    {
+        glm::vec3 mCameraPosition{ 0.0f };
+        float mScale{ 0.0f };
+    };
+
+    ////////////////////////////////////////
+    // in the local space of model like AbstractCamera::GetFrustum, errors above
+    // maxPixelError pixels pick a finer level
+    LodView ComputeLodView(const AbstractCamera& camera, int viewportHeight, float maxPixelError = 1.0f, const glm::mat4& model = glm::mat4(1.0f));
+
+    // coarsest level that is still within the error budget of view, the bounding
+    // sphere and view have to be in the same space
+    int SelectLod(const std::vector<MeshLod>& lods, const glm::vec3& center, float radius, float errorScale, const LodView& view);
+
+    // simplifies indices[firstIndex, firstIndex + numIndices) by vertex clustering, the coarser
+    // levels are appended to indices and the returned chain starts with the given range
+    std::vector<MeshLod> AppendLodChain(const float* vertices, size_t stride, std::vector<unsigned>& indices,
+                                        unsigned firstIndex, unsigned numIndices, const Utility::AABB& bounds,
+                                        int maxLods = MAX_MESH_LODS);
+
+    ////////////////////////////////////////
+    // func(i, numInstances) -> glm::mat4 written to modelMatrices[i], large counts are
+    // computed in parallel, modelMatrices has to hold numInstances matrices
+    template <typename Func>
+    void ComputeInstanceMatrices(std::span<glm::mat4> modelMatrices, int numInstances, Func func)
+    {
+        assert(modelMatrices.size() == static_cast<size_t>(std::max(numInstances, 0)));
+        Utility::ParallelFor(modelMatrices.size(), [&](size_t ind) {
+            modelMatrices[ind] = func(static_cast<int>(ind), numInstances);
+        });
+    }
+
+    ////////////////////////////////////////
+    // func(i, j, numInstances) -> glm::mat4, applied on top of a translation on the xz grid
+    template <typename Func>
+    void ComputeInstanceMatrices(std::span<glm::mat4> modelMatrices, int numXMeshes, int numZMeshes, float xOffset, float zOffset, float yPos, Func func)
+    {
+        const int numInstances{ numXMeshes * numZMeshes };
+        const float negNumXMeshesHalf = (xOffset) * static_cast<float>(-numXMeshes) * 0.5f;
+        const float negNumZMeshesHalf = (zOffset) * static_cast<float>(-numZMeshes) * 0.5f;
+        assert(modelMatrices.size() == static_cast<size_t>(std::max(numInstances, 0)));
+        Utility::ParallelFor(modelMatrices.size(), [&](size_t ind) {
+            const int i{ static_cast<int>(ind) / numZMeshes };
+            const int j{ static_cast<int>(ind) % numZMeshes };
+            float xPos = negNumXMeshesHalf + static_cast<float>(i) * xOffset;
+            float zPos = negNumZMeshesHalf + static_cast<float>(j) * zOffset;
+            modelMatrices[ind] = glm::translate(glm::mat4(1.0f), glm::vec3(xPos, yPos, zPos)) * func(i, j, numInstances);
+        });
+    }
+
+    ////////////////////////////////////////
+    // func(i, j, k, numInstances) -> glm::mat4, applied on top of a translation on the xyz grid
+    template <typename Func>
+    void ComputeInstanceMatrices(std::span<glm::mat4> modelMatrices, int numXMeshes, int numYMeshes, int numZMeshes, float xOffset, float yOffset, float zOffset, Func func)
+    {
+        const int numInstances{ numXMeshes * numYMeshes * numZMeshes };
+        const float negNumXMeshesHalf = (xOffset) * static_cast<float>(-numXMeshes) * 0.5f;
+        const float negNumYMeshesHalf = (yOffset) * static_cast<float>(-numYMeshes) * 0.5f;
+        const float negNumZMeshesHalf = (zOffset) * static_cast<float>(-numZMeshes) * 0.5f;
+        assert(modelMatrices.size() == static_cast<size_t>(std::max(numInstances, 0)));
+        Utility::ParallelFor(modelMatrices.size(), [&](size_t ind) {
+            const int i{ static_cast<int>(ind) / (numYMeshes * numZMeshes) };
+            const int j{ static_cast<int>(ind) / numZMeshes % numYMeshes };
+            const int k{ static_cast<int>(ind) % numZMeshes };
+            float xPos = negNumXMeshesHalf + static_cast<float>(i) * xOffset;
+            float yPos = negNumYMeshesHalf + static_cast<float>(j) * yOffset;
+            float zPos = negNumZMeshesHalf + static_cast<float>(k) * zOffset;
+            auto defaultTransform = glm::translate(glm::mat4(1.0f), glm::vec3(xPos, yPos, zPos));
+            modelMatrices[ind] = defaultTransform * func(i, j, k, numInstances);
+        });
+    }
+
+    ////////////////////////////////////////
+    struct StaticMesh
+    {
+    private:
+        VertexBuffer mVbo;
+        IndexBuffer mEbo;
+        VAO mVao;
+        std::shared_ptr<VertexBuffer> mModelMatrixBuffer;
+        int mNumInstances;
+        bool mIsMatrixBufferPersistent;
+        size_t mMatrixBufferOffset;
+
+        StaticMeshTextures mTextures;
+        Utility::AABB mBounds;
+        std::vector<VertexInfo> mInfos;
+
+        // every level lives in mEbo, the first one is the full resolution mesh
+        std::vector<MeshLod> mLods;
+
+        // bound with the vao, see SetVertexDecode
+        UniformBuffer mDecodeBuffer;
+
+        // depth only passes fetch just the positions, see EnablePositionStream
+        std::unique_ptr<VertexBuffer> mPositionVbo;
+        std::unique_ptr<VAO> mPositionVao;
+
+        // gpu instance culling: compacted matrices are sourced by a second vao
+        std::unique_ptr<VAO> mCulledVao;
+        std::unique_ptr<VertexBuffer> mCulledMatrixBuffer;
+        std::unique_ptr<IndirectBuffer> mCulledCommand;
+
+        // ApplyToAllInstances computes non persistent matrix buffers here, only grows
+        std::vector<glm::mat4> mInstanceMatrixScratch;
+
+        void ReconfigureMatrixBuffer();
+        void ConfigureMatrixBuffer(const VAO& vao, const VertexBuffer& matrixBuffer) const;
+        void ReplaceIndices(const std::vector<unsigned>& indices);
+        void CreatePositionStream(const unsigned char* vertices);
+
+    public:
+        // a persistent matrix buffer moves to another segment on the first write of a frame;
+        // DSA keeps the currently bound vao untouched. Meshes sharing the buffer call it after
+        // the write went through another mesh.
+        void SyncMatrixBufferOffset()
+        {
+            if (mMatrixBufferOffset != mModelMatrixBuffer->GetOffset()) {
+                mMatrixBufferOffset = mModelMatrixBuffer->GetOffset();
+                for (unsigned i = INSTANCED_MODEL_LOC; i < INSTANCED_MODEL_LOC + 4; ++i) {
+                    glVertexArrayVertexBuffer(mVao.GetId(), i, mModelMatrixBuffer->GetId(),
+                                              static_cast<GLintptr>(mMatrixBufferOffset + (i - INSTANCED_MODEL_LOC) * sizeof(glm::vec4)),
+                                              sizeof(glm::mat4));
+                    if (mPositionVao) {
+                        glVertexArrayVertexBuffer(mPositionVao->GetId(), i, mModelMatrixBuffer->GetId(),
+                                                  static_cast<GLintptr>(mMatrixBufferOffset + (i - INSTANCED_MODEL_LOC) * sizeof(glm::vec4)),
+                                                  sizeof(glm::mat4));
+                    }
+                }
+            }
+        }
+
+        StaticMesh(int numInstances,
+                   const std::vector<float>& vertices,
+                   const std::vector<unsigned>& indices,
+                   const std::vector<VertexInfo>& infos)
+            : mVbo(vertices, GL_STATIC_DRAW),
+              mEbo(indices, GL_STATIC_DRAW),
+              mVao(mVbo, mEbo, infos),
+              mModelMatrixBuffer{new VertexBuffer(16, GL_DYNAMIC_DRAW)},
+              mNumInstances{numInstances},
+              mIsMatrixBufferPersistent{false},
+              mMatrixBufferOffset{},
+              mBounds{ComputeVertexBounds(vertices, infos)},
+              mInfos{infos},
+              mLods{ { 0, static_cast<unsigned>(indices.size()), 0.0f } },
+              mDecodeBuffer(2 * sizeof(glm::vec4), GL_STATIC_DRAW, UniformBuffer::VERTEX_DECODE_BLOCK_BINDING)
+        {
+            SetVertexDecode(glm::vec3(0.0f), glm::vec3(1.0f));
+            CreateInstances(mNumInstances);
+        }
+
+        // vertices are written through GetVboWritePtr(), bounds have to be set with SetBounds()
+        StaticMesh(int numInstances,
+                   size_t numVertices,
+                   size_t numIndices,
+                   const std::vector<VertexInfo>& infos)
+            : mVbo(numVertices, GL_STATIC_DRAW),
+              mEbo(numIndices, GL_STATIC_DRAW),
+              mVao(mVbo, mEbo, infos),
+              mModelMatrixBuffer{new VertexBuffer(16, GL_DYNAMIC_DRAW)},
+              mNumInstances{numInstances},
+              mIsMatrixBufferPersistent{false},
+              mMatrixBufferOffset{},
+              mInfos{infos},
+              mLods{ { 0, static_cast<unsigned>(numIndices), 0.0f } },
+              mDecodeBuffer(2 * sizeof(glm::vec4), GL_STATIC_DRAW, UniformBuffer::VERTEX_DECODE_BLOCK_BINDING)
+        {
+            SetVertexDecode(glm::vec3(0.0f), glm::vec3(1.0f));
+            CreateInstances(mNumInstances);
+        }
+
+        // geometry is copied straight into immutable buffers, e.g. from a mapped cache file;
+        // bounds have to be set with SetBounds()
+        StaticMesh(int numInstances,
+                   const float* vertices,
+                   size_t numVertices,
+                   const unsigned* indices,
+                   size_t numIndices,
+                   const std::vector<VertexInfo>& infos)
+            : mVbo(vertices, numVertices),
+              mEbo(indices, numIndices),
+              mVao(mVbo, mEbo, infos),
+              mModelMatrixBuffer{new VertexBuffer(16, GL_DYNAMIC_DRAW)},
+              mNumInstances{numInstances},
+              mIsMatrixBufferPersistent{false},
+              mMatrixBufferOffset{},
+              mInfos{infos},
+              mLods{ { 0, static_cast<unsigned>(numIndices), 0.0f } },
+              mDecodeBuffer(2 * sizeof(glm::vec4), GL_STATIC_DRAW, UniformBuffer::VERTEX_DECODE_BLOCK_BINDING)
+        {
+            SetVertexDecode(glm::vec3(0.0f), glm::vec3(1.0f));
+            CreateInstances(mNumInstances);
+        }
+
+        void Bind() const
+        {
+            mVao.Bind();
+            mDecodeBuffer.TurnOn();
+        }
+
+        // for depth only passes, falls back to the full vao without a position stream;
+        // every Draw* but DrawInstancedCulled works with it
+        void BindPositions() const
+        {
+            if (mPositionVao) {
+                mPositionVao->Bind();
+                mDecodeBuffer.TurnOn();
+            }
+            else {
+                Bind();
+            }
+        }
+
+        // copies the positions into a buffer of their own, through a one-time readback
+        void EnablePositionStream();
+        bool HasPositionStream() const { return mPositionVao != nullptr; }
+
+        // quantized positions are decoded as position * scale + offset by the vertex shaders,
+        // see shaders/vertex_decode.glsl
+        void SetVertexDecode(const glm::vec3& offset, const glm::vec3& scale)
+        {
+            std::array<glm::vec4, 2> data{ glm::vec4(scale, 0.0f), glm::vec4(offset, 0.0f) };
+            mDecodeBuffer.Modify(0, sizeof(data), data.data());
+        }
+        void UnBind() const { mVao.UnBind(); }
+
+        void Draw(unsigned mode = GL_TRIANGLES) const
+        { DrawLod(0, mode); }
+
+        void DrawInstanced(unsigned mode = GL_TRIANGLES) const
+        { DrawInstancedLod(0, mode); }
+
+        void DrawLod(int lod, unsigned mode = GL_TRIANGLES) const
+        {
+            const MeshLod& l{ mLods[static_cast<size_t>(lod)] };
+            mVao.DrawRange(mode, l.mFirstIndex, static_cast<int>(l.mNumIndices));
+        }
+
+        void DrawInstancedLod(int lod, unsigned mode = GL_TRIANGLES) const
+        {
+            const MeshLod& l{ mLods[static_cast<size_t>(lod)] };
+            mVao.DrawInstancedRange(mode, l.mFirstIndex, static_cast<int>(l.mNumIndices), mNumInstances);
+        }
+
+        // one instance per layer, see DepthProgramLayered
+        void DrawLayered(int numLayers, unsigned mode = GL_TRIANGLES) const
+        { mVao.DrawInstancedRange(mode, mLods[0].mFirstIndex, static_cast<int>(mLods[0].mNumIndices), numLayers); }
+
+        // draws the instances that survived the last InstanceCullingProgram::Cull,
+        // with one indirect command per level of detail
+        void DrawInstancedCulled(unsigned mode = GL_TRIANGLES) const
+        {
+            assert(IsInstanceCullingEnabled());
+            mCulledVao->Bind();
+            mDecodeBuffer.TurnOn();
+            mCulledCommand->Bind();
+            mCulledVao->MultiDrawInstancedIndirect(mode, 0, GetNumLods());
+        }
+
+        void EnableInstanceCulling();
+        bool IsInstanceCullingEnabled() const { return mCulledCommand != nullptr; }
+
+        // instances of level i are compacted into [i * mNumInstances, (i + 1) * mNumInstances)
+        void ResetCulledCommand() const
+        {
+            std::array<DrawElementsIndirectCommand, MAX_MESH_LODS> commands{};
+            for (size_t i = 0; i < mLods.size(); ++i) {
+                commands[i] = { mLods[i].mNumIndices, 0, mLods[i].mFirstIndex, 0, static_cast<unsigned>(i) * static_cast<unsigned>(mNumInstances) };
+            }
+            mCulledCommand->Modify(0, static_cast<int>(mLods.size() * sizeof(DrawElementsIndirectCommand)), commands.data());
+        }
+
+        // simplifies the full resolution level, reads the geometry back once
+        void GenerateLods(int maxLods = MAX_MESH_LODS);
+        void SetLods(const std::vector<MeshLod>& lods);
+        const std::vector<MeshLod>& GetLods() const { return mLods; }
+        int GetNumLods() const { return static_cast<int>(mLods.size()); }
+
+        // view has to be in the space model transforms to
+        int SelectLod(const LodView& view, const glm::mat4& model = glm::mat4(1.0f)) const;
+
+        unsigned GetModelMatrixBufferId() const { return mModelMatrixBuffer->GetId(); }
+        size_t GetModelMatrixBufferOffset() const { return mModelMatrixBuffer->GetOffset(); }
+        size_t GetModelMatrixBufferSize() const { return mModelMatrixBuffer->GetNumElements() * sizeof(float); }
+
+        // instance matrices written at most once per frame avoid implicit syncs this way,
+        // see PersistentBuffer
+        void EnablePersistentMatrixBuffer();
+        bool IsMatrixBufferPersistent() const { return mIsMatrixBufferPersistent; }
+        unsigned GetCulledMatrixBufferId() const { return mCulledMatrixBuffer ? mCulledMatrixBuffer->GetId() : 0; }
+        unsigned GetCulledCommandId() const { return mCulledCommand ? mCulledCommand->GetId() : 0; }
+
+        void MultiDrawIndirect(int firstCommand, int numCommands, unsigned mode = GL_TRIANGLES) const
+        { mVao.MultiDrawIndirect(mode, firstCommand, numCommands); }
+
+        void MultiDrawInstancedIndirect(int firstCommand, int numCommands, unsigned mode = GL_TRIANGLES) const
+        { mVao.MultiDrawInstancedIndirect(mode, firstCommand, numCommands); }
+
+        void AddAmbientTexture(const Texture2D& t)
+        { mTextures.mAmbientTextures.push_back(t); }
+
+        void AddDiffuseTexture(const Texture2D& t)
+        { mTextures.mDiffuseTextures.push_back(t); }
+
+        void AddSpecularTexture(const Texture2D& t)
+        { mTextures.mSpecularTextures.push_back(t); }
+
+        void BindTextures() const { mTextures.Bind(); }
+        void UnbindTextures() const { mTextures.UnBind(); }
+
+        const StaticMeshTextures& GetTextures() const { return mTextures; }
+
+        // local space bounds of a single instance
+        const Utility::AABB& GetBounds() const { return mBounds; }
+        void SetBounds(const Utility::AABB& bounds) { mBounds = bounds; }
+
+        size_t GetNumVertices() const { return mVbo.GetNumElements(); }
         size_t GetNumIndices() const { return mEbo.GetNumElements(); }
 
         float* GetVboWritePtr() const { return mVbo.GetWritePtr(); }
@@ -1908,18 +2734,52 @@ namespace Poe
         int GetNumInstances() const { return mNumInstances; }
 
         void SetInstanceMatrix(const glm::mat4& modelMatrix, int instance = 0)
-        { mModelMatrixBuffer->Modify(instance * static_cast<int>(sizeof(glm::mat4)), sizeof(glm::mat4), glm::value_ptr(modelMatrix)); }
+        {
+            mModelMatrixBuffer->Modify(instance * static_cast<int>(sizeof(glm::mat4)), sizeof(glm::mat4), glm::value_ptr(modelMatrix));
+            SyncMatrixBufferOffset();
+        }
 
         void CreateInstances(std::initializer_list<glm::mat4> modelMatrices);
         void CreateInstances(const std::vector<glm::mat4>& modelMatrices);
         void CreateInstances(int numInstances);
 
+        // uploads every instance matrix in a single call
+        void SetInstanceMatrices(std::span<const glm::mat4> modelMatrices)
+        {
+            assert(static_cast<int>(modelMatrices.size()) == mNumInstances);
+            mModelMatrixBuffer->Modify(0, static_cast<int>(modelMatrices.size_bytes()), modelMatrices.data());
+            SyncMatrixBufferOffset();
+        }
+
+        // compute(span) fills every instance matrix, a persistent buffer is written in place
+        // through its shadow, otherwise the matrices go through mInstanceMatrixScratch
+        template <typename Compute>
+        void WriteInstanceMatrices(Compute compute)
+        {
+            const size_t numInstances{ static_cast<size_t>(std::max(mNumInstances, 0)) };
+            if (mModelMatrixBuffer->IsPersistent()) {
+                compute(std::span<glm::mat4>(reinterpret_cast<glm::mat4*>(mModelMatrixBuffer->GetWritePtr()), numInstances));
+                mModelMatrixBuffer->Unmap();
+                SyncMatrixBufferOffset();
+                return;
+            }
+            if (mInstanceMatrixScratch.size() < numInstances)
+                mInstanceMatrixScratch.resize(numInstances);
+            const std::span<glm::mat4> modelMatrices(mInstanceMatrixScratch.data(), numInstances);
+            compute(modelMatrices);
+            SetInstanceMatrices(modelMatrices);
+        }
+
+        // sources the instance matrices from other's buffer, a write through either mesh is seen by both
+        void ShareInstances(const StaticMesh& other);
+
         ////////////////////////////////////////
         template <typename Func>
         void ApplyToAllInstances(Func func)
         {
-            for (int i = 0; i < mNumInstances; ++i)
-                mModelMatrixBuffer->Modify(i * sizeof(glm::mat4), sizeof(glm::mat4), glm::value_ptr(func(i, mNumInstances)));
+            WriteInstanceMatrices([&](std::span<glm::mat4> modelMatrices) {
+                ComputeInstanceMatrices(modelMatrices, mNumInstances, func);
+            });
         }
 
         ////////////////////////////////////////
@@ -1927,24 +2787,9 @@ namespace Poe
         void ApplyToAllInstances(int numXMeshes, int numZMeshes, float xOffset, float zOffset, float yPos, Func func)
         {
             assert(numXMeshes * numZMeshes == mNumInstances);
-            const float negNumXMeshesHalf = (xOffset) * static_cast<float>(-numXMeshes) * 0.5f;
-            const float negNumZMeshesHalf = (zOffset) * static_cast<float>(-numZMeshes) * 0.5f;
-            float* modelMatrixPtr = mModelMatrixBuffer->GetWritePtr();
-            int cnt{};
-            for (int i = 0; i < numXMeshes; ++i) {
-                float xPos = negNumXMeshesHalf + static_cast<float>(i) * xOffset;
-                for (int j = 0; j < numZMeshes; ++j) {
-                    float zPos = negNumZMeshesHalf + static_cast<float>(j) * zOffset;
-                    auto transform = glm::translate(glm::mat4(1.0f), glm::vec3(xPos, yPos, zPos)) * func(i, j, mNumInstances);
-                    std::memcpy(modelMatrixPtr + cnt * sizeof(glm::vec4), glm::value_ptr(transform), sizeof(glm::mat4));
-                    ++cnt;
-                }
-            }
-#ifdef _DEBUG
-            assert(GL_TRUE == mModelMatrixBuffer->Unmap());
-#else
-            mModelMatrixBuffer->Unmap();
-#endif
+            WriteInstanceMatrices([&](std::span<glm::mat4> modelMatrices) {
+                ComputeInstanceMatrices(modelMatrices, numXMeshes, numZMeshes, xOffset, zOffset, yPos, func);
+            });
         }
 
         ////////////////////////////////////////
@@ -1952,29 +2797,9 @@ namespace Poe
         void ApplyToAllInstances(int numXMeshes, int numYMeshes, int numZMeshes, float xOffset, float yOffset, float zOffset, Func func)
         {
             assert(numXMeshes * numYMeshes * numZMeshes == mNumInstances);
-            const float negNumXMeshesHalf = (xOffset) * static_cast<float>(-numXMeshes) * 0.5f;
-            const float negNumYMeshesHalf = (yOffset) * static_cast<float>(-numYMeshes) * 0.5f;
-            const float negNumZMeshesHalf = (zOffset) * static_cast<float>(-numZMeshes) * 0.5f;
-            float* modelMatrixPtr = mModelMatrixBuffer->GetWritePtr();
-            int cnt{};
-            for (int i = 0; i < numXMeshes; ++i) {
-                float xPos = negNumXMeshesHalf + static_cast<float>(i) * xOffset;
-                for (int j = 0; j < numYMeshes; ++j) {
-                    float yPos = negNumYMeshesHalf + static_cast<float>(j) * yOffset;
-                    for (int k = 0; k < numZMeshes; ++k) {
-                        float zPos = negNumZMeshesHalf + static_cast<float>(k) * zOffset;
-                        auto defaultTransform = glm::translate(glm::mat4(1.0f), glm::vec3(xPos, yPos, zPos));
-                        auto res = defaultTransform * func(i, j, k, mNumInstances);
-                        std::memcpy(modelMatrixPtr + cnt * 16, glm::value_ptr(res), 64);
-                        ++cnt;
-                    }
-                }
-            }
-#ifdef _DEBUG
-            assert(GL_TRUE == mModelMatrixBuffer->Unmap());
-#else
-            mModelMatrixBuffer->Unmap();
-#endif
+            WriteInstanceMatrices([&](std::span<glm::mat4> modelMatrices) {
+                ComputeInstanceMatrices(modelMatrices, numXMeshes, numYMeshes, numZMeshes, xOffset, yOffset, zOffset, func);
+            });
         }
     };
 
@@ -1993,6 +2818,74 @@ namespace Poe
     StaticMesh CreateUVSphere(int numStacks, int numSectors, int numInstances);
     StaticMesh CreateIcoSphere(int numSubdivisions, int numInstances);
 
+    ////////////////////////////////////////
+    struct StaticModelDrawGroup
+    {
+        StaticMeshTextures mTextures;
+        int mFirstCommand;
+        int mNumCommands;
+    };
+
+    ////////////////////////////////////////
+    enum class MaterialTableMode { None, Bindless, TextureArray };
+
+    ////////////////////////////////////////
+    MaterialTableMode QueryMaterialTableMode();
+
+    ////////////////////////////////////////
+    struct MaterialTableElem__DATA
+    {
+        alignas(8) GLuint64 handles[3];
+        int arrays[3];
+        int layers[3];
+    };
+
+    ////////////////////////////////////////
+    // per-material records indexed through gl_DrawID, so a merged model is
+    // drawn with a single indirect call and no per-mesh texture binds
+    struct MaterialTable
+    {
+    private:
+        MaterialTableMode mMode;
+        ShaderStorageBuffer mMaterials;
+        ShaderStorageBuffer mMaterialIndices;
+        std::vector<Texture2DArray> mTextureArrays;
+        std::vector<GLuint64> mResidentHandles;
+
+        std::vector<MaterialTableElem__DATA> CreateBindlessElems(const std::vector<StaticModelDrawGroup>& groups);
+        std::vector<MaterialTableElem__DATA> CreateTextureArrayElems(const std::vector<StaticModelDrawGroup>& groups);
+
+    public:
+        static constexpr int MAX_TEXTURE_ARRAYS{ 8 };
+
+        MaterialTable(MaterialTableMode mode, const std::vector<StaticModelDrawGroup>& groups, int numCommands);
+
+        ~MaterialTable();
+
+        MaterialTable(const MaterialTable&) = delete;
+        MaterialTable& operator=(const MaterialTable&) = delete;
+
+        // None if the textures couldn't be placed in the table
+        MaterialTableMode GetMode() const { return mMode; }
+        int GetNumTextureArrays() const { return static_cast<int>(mTextureArrays.size()); }
+
+        void Bind() const
+        {
+            mMaterials.TurnOn();
+            mMaterialIndices.TurnOn();
+            for (size_t i = 0; i < mTextureArrays.size(); ++i)
+                mTextureArrays[i].Bind(static_cast<unsigned>(i));
+        }
+
+        void UnBind() const
+        {
+            mMaterials.TurnOff();
+            mMaterialIndices.TurnOff();
+            for (size_t i = 0; i < mTextureArrays.size(); ++i)
+                mTextureArrays[i].UnBind(static_cast<unsigned>(i));
+        }
+    };
+
     ////////////////////////////////////////
     struct StaticModel
     {
@@ -2003,27 +2896,98 @@ namespace Poe
         Texture2DLoader& mTexture2DLoader;
         int mNumTextures;
         int mNumInstances;
-
+        VertexFormat mVertexFormat;
+
+        // merged mode: every mesh lives in one shared vbo/ebo/vao and the model is
+        // drawn with one glMultiDrawElementsIndirect per group of meshes sharing textures
+        bool mIsMerged;
+        std::unique_ptr<StaticMesh> mMergedMesh;
+        std::unique_ptr<IndirectBuffer> mIndirectBuffer;
+        std::vector<DrawElementsIndirectCommand> mDrawCommands;
+        std::vector<std::vector<MeshLod>> mCommandLods;
+        std::vector<StaticModelDrawGroup> mDrawGroups;
+        std::unique_ptr<MaterialTable> mMaterialTable;
+
+        // items are meshes, or draw commands in merged mode
+        std::vector<Utility::AABB> mItemBounds;
+        Utility::BVH mBVH;
+
+        // scratch of DrawVisible(), kept so that the culled draws don't allocate every frame
+        mutable std::vector<bool> mVisibleItems;
+        mutable std::vector<DrawElementsIndirectCommand> mVisibleCommands;
+
+        // levels of detail picked by the culled draws, full resolution by default
+        LodView mLodView;
+
+        // the assimp import runs only when <model>.pmesh is missing or stale
         void Load();
-        void LoadNode(aiNode* node, const aiScene* scene);
-        StaticMesh LoadStaticMesh(aiMesh* mesh, const aiScene* scene);
-        std::vector<std::reference_wrapper<const Texture2D>> Load2DTextures(aiMaterial* material, aiTextureType type, std::string_view typeName);
+        void LoadFromCache(const unsigned char* cache);
+        std::vector<std::reference_wrapper<const Texture2D>> Load2DTextures(const std::string* paths, unsigned numPaths);
+
+        void UpdateDrawCommands() const;
+        void ShareInstancesAcrossMeshes();
+        void DrawMerged(unsigned mode, int firstCommand, bool instanced, bool textured, const std::vector<bool>* visible = nullptr) const;
+        void DrawVisible(const Utility::Frustum& frustum, unsigned mode, bool textured) const;
+
+        ////////////////////////////////////////
+        template <typename Func>
+        void ForEachMesh(Func func)
+        {
+            if (mIsMerged) {
+                if (mMergedMesh) {
+                    func(*mMergedMesh);
+                }
+            }
+            else {
+                std::ranges::for_each(mMeshes, func);
+            }
+        }
+
+        // every mesh sources its instance matrices from this one's buffer
+        StaticMesh* GetInstanceSource()
+        {
+            if (mIsMerged) {
+                return mMergedMesh.get();
+            }
+            return mMeshes.empty() ? nullptr : &mMeshes.front();
+        }
+
+        ////////////////////////////////////////
+        template <typename Func>
+        void WriteInstances(Func func)
+        {
+            if (StaticMesh* source = GetInstanceSource()) {
+                func(*source);
+                ForEachMesh([](auto& m){ m.SyncMatrixBufferOffset(); });
+            }
+        }
 
     public:
         StaticModel(const std::string& modelPath, Texture2DLoader& texture2DLoader)
             : mPath{modelPath},
               mTexture2DLoader{texture2DLoader},
               mNumTextures{},
-              mNumInstances{} { Load(); }
-
-        StaticModel(int numInstances, const std::string& modelPath, Texture2DLoader& texture2DLoader)
+              mNumInstances{},
+              mVertexFormat{VertexFormat::Float},
+              mIsMerged{false} { Load(); }
+
+        // quantized models have to be drawn with programs that decode their positions,
+        // which every program sourcing POE_APOS_LOC does
+        StaticModel(int numInstances, const std::string& modelPath, Texture2DLoader& texture2DLoader, bool isMerged = false,
+                    VertexFormat vertexFormat = VertexFormat::Float)
             : mPath{modelPath},
               mTexture2DLoader{texture2DLoader},
               mNumTextures{},
-              mNumInstances{numInstances} { Load(); }
+              mNumInstances{numInstances},
+              mVertexFormat{vertexFormat},
+              mIsMerged{isMerged} { Load(); }
 
         void Draw(unsigned mode = GL_TRIANGLES) const
         {
+            if (mIsMerged) {
+                DrawMerged(mode, 0, false, true);
+                return;
+            }
             for (const StaticMesh& staticMesh : mMeshes) {
                 staticMesh.Bind();
                 staticMesh.BindTextures();
@@ -2033,6 +2997,10 @@ namespace Poe
 
         void DrawInstanced(unsigned mode = GL_TRIANGLES) const
         {
+            if (mIsMerged) {
+                DrawMerged(mode, GetNumDrawCommands(), true, true);
+                return;
+            }
             for (const StaticMesh& staticMesh : mMeshes) {
                 staticMesh.Bind();
                 staticMesh.BindTextures();
@@ -2040,29 +3008,61 @@ namespace Poe
             }
         }
 
+        // untextured draws fetch just the positions when EnablePositionStreams was called,
+        // they are meant for depth-only and emissive color programs
         void DrawUntextured(unsigned mode = GL_TRIANGLES) const
         {
+            if (mIsMerged) {
+                DrawMerged(mode, 0, false, false);
+                return;
+            }
             for (const StaticMesh& staticMesh : mMeshes) {
-                staticMesh.Bind();
+                staticMesh.BindPositions();
                 staticMesh.Draw(mode);
             }
         }
 
         void DrawInstancedUntextured(unsigned mode = GL_TRIANGLES) const
         {
+            if (mIsMerged) {
+                DrawMerged(mode, GetNumDrawCommands(), true, false);
+                return;
+            }
             for (const StaticMesh& staticMesh : mMeshes) {
-                staticMesh.Bind();
+                staticMesh.BindPositions();
                 staticMesh.DrawInstanced(mode);
             }
         }
 
+        // frustum has to be in the model's local space, see AbstractCamera::GetFrustum
+        void DrawCulled(const Utility::Frustum& frustum, unsigned mode = GL_TRIANGLES) const
+        { DrawVisible(frustum, mode, true); }
+
+        void DrawUntexturedCulled(const Utility::Frustum& frustum, unsigned mode = GL_TRIANGLES) const
+        { DrawVisible(frustum, mode, false); }
+
+        // view has to be in the model's local space like the frustum, see ComputeLodView
+        void SetLodView(const LodView& view) { mLodView = view; }
+        const LodView& GetLodView() const { return mLodView; }
+
+        Utility::AABB GetBounds() const { return mBVH.GetBounds(); }
+        const Utility::BVH& GetBVH() const { return mBVH; }
+
         std::string GetPath() const { return mPath; }
         std::string GetDirectory() const { return mDirectory; }
         int GetNumTextures() const { return mNumTextures; }
         int GetNumInstances() const { return mNumInstances; }
+        bool IsMerged() const { return mIsMerged; }
+        VertexFormat GetVertexFormat() const { return mVertexFormat; }
+        int GetNumDrawCommands() const { return static_cast<int>(mDrawCommands.size()); }
+        int GetNumDrawGroups() const { return static_cast<int>(mDrawGroups.size()); }
+
+        // programs drawing this model have to be built with the same mode
+        MaterialTableMode GetMaterialTableMode() const
+        { return mMaterialTable ? mMaterialTable->GetMode() : MaterialTableMode::None; }
 
         void SetInstanceMatrix(const glm::mat4& modelMatrix, int instance = 0)
-        { std::ranges::for_each(mMeshes, [&](auto& m){ m.SetInstanceMatrix(modelMatrix, instance); }); }
+        { WriteInstances([&](auto& m){ m.SetInstanceMatrix(modelMatrix, instance); }); }
 
         void CreateInstances(std::initializer_list<glm::mat4> modelMatrices);
         void CreateInstances(const std::vector<glm::mat4>& modelMatrices);
@@ -2071,21 +3071,36 @@ namespace Poe
         ////////////////////////////////////////
         template <typename Func>
         void ApplyToAllInstances(Func func)
-        { std::ranges::for_each(mMeshes, [&](auto& m){ m.ApplyToAllInstances(func); }); }
+        { WriteInstances([&](auto& m){ m.ApplyToAllInstances(func); }); }
 
         ////////////////////////////////////////
         template <typename Func>
         void ApplyToAllInstances(int numXMeshes, int numZMeshes, float xOffset, float zOffset, float yPos, Func func)
-        { std::ranges::for_each(mMeshes, [&](auto& m){ m.ApplyToAllInstances(numXMeshes, numZMeshes, xOffset, zOffset, yPos, func); }); }
+        { WriteInstances([&](auto& m){ m.ApplyToAllInstances(numXMeshes, numZMeshes, xOffset, zOffset, yPos, func); }); }
 
         ////////////////////////////////////////
         template <typename Func>
         void ApplyToAllInstances(int numXMeshes, int numYMeshes, int numZMeshes, float xOffset, float yOffset, float zOffset, Func func)
-        { std::ranges::for_each(mMeshes, [&](auto& m){ m.ApplyToAllInstances(numXMeshes, numYMeshes, numZMeshes, xOffset, yOffset, zOffset, func); }); }
+        { WriteInstances([&](auto& m){ m.ApplyToAllInstances(numXMeshes, numYMeshes, numZMeshes, xOffset, yOffset, zOffset, func); }); }
+
+        // shadow and depth passes of the extracted meshes then fetch just the positions
+        void EnablePositionStreams()
+        { ForEachMesh([](StaticMesh& m){ m.EnablePositionStream(); }); }
 
+        // the separate meshes, empty in merged mode
+        std::span<const StaticMesh> GetMeshes() const { return mMeshes; }
+
+        // in merged mode the shared mesh is returned; its indices are absolute so
+        // it can be drawn with a single glDrawElements by depth-only passes
         std::vector<std::reference_wrapper<const StaticMesh>> ExtractMeshes() const
         {
             std::vector<std::reference_wrapper<const StaticMesh>> meshList;
+            if (mIsMerged) {
+                if (mMergedMesh) {
+                    meshList.push_back(*mMergedMesh);
+                }
+                return meshList;
+            }
             for (const StaticMesh& mesh : mMeshes)
                 meshList.push_back(mesh);
             return meshList;
@@ -2093,9 +3108,204 @@ namespace Poe
     };
 
     ////////////////////////////////////////
-    StaticModel LoadCsItaly(const std::string& rootPath, Texture2DLoader&);
-    StaticModel LoadSponza(const std::string& rootPath, Texture2DLoader&);
-    StaticModel LoadDeDust(const std::string& rootPath, Texture2DLoader&);
+    StaticModel LoadCsItaly(const std::string& rootPath, Texture2DLoader&, bool isMerged = false, VertexFormat vertexFormat = VertexFormat::Float);
+    StaticModel LoadSponza(const std::string& rootPath, Texture2DLoader&, bool isMerged = false, VertexFormat vertexFormat = VertexFormat::Float);
+    StaticModel LoadDeDust(const std::string& rootPath, Texture2DLoader&, bool isMerged = false, VertexFormat vertexFormat = VertexFormat::Float);
+
+    ////////////////////////////////////////
+    // one draw of a RenderQueue. mSetMaterial runs only when the program or mMaterialId
+    // differs from the previous draw's, mSetUniforms runs for every draw with the program in use
+    struct RenderItem
+    {
+        const Program* mProgram{ nullptr };
+        const StaticMesh* mMesh{ nullptr };
+        const StaticMeshTextures* mTextures{ nullptr }; // bound to units 0, 1 and 2, untextured if null
+        glm::mat4 mModel{ 1.0f };
+        unsigned mMaterialId{};
+        std::function<void()> mSetMaterial;
+        std::function<void(const RenderItem&)> mSetUniforms;
+        unsigned mMode{ GL_TRIANGLES };
+        int mLod{};
+        bool mIsInstanced{ false };
+        bool mIsTransparent{ false };
+        const RenderItem* mCallbacks{ nullptr }; // set by RenderQueue, mSetMaterial and mSetUniforms are called from it
+    };
+
+    ////////////////////////////////////////
+    // collects the draws of a frame and submits them sorted by a 64 bit key: opaque
+    // draws grouped by program, textures, material and mesh, then front to back for
+    // early-z; transparent draws back to front. Binds matching the previous draw's
+    // are skipped and counted in RuntimeStats. Push() may be called from the threads of
+    // Utility::JobSystem::Get(), every thread records into its own bucket.
+    struct RenderQueue
+    {
+    private:
+        struct SortEntry
+        {
+            unsigned long long mKey;
+            unsigned mBucket;
+            unsigned mIndex;
+        };
+
+        // a cache line each, the threads write to them at the same time
+        struct alignas(64) ThreadBucket
+        {
+            std::vector<RenderItem> mItems;
+            std::deque<RenderItem> mModelItems; // the callbacks of Push(model, item), stable addresses
+            int mNumVisible{};
+            int mNumCulled{};
+        };
+
+        std::vector<ThreadBucket> mBuckets;
+        std::vector<SortEntry> mEntries;
+
+        // dense indices of this frame's states, they fit the key better than gl names.
+        // The maps are never cleared so that known states don't allocate, an index
+        // left from an earlier frame is renumbered on first use
+        struct StateIndex
+        {
+            unsigned mFrame;
+            unsigned mIndex;
+        };
+
+        std::unordered_map<unsigned, StateIndex> mProgramIndices;
+        std::unordered_map<std::pair<unsigned long long, unsigned>, StateIndex, Utility::PairHash> mTextureIndices;
+        std::unordered_map<const StaticMesh*, StateIndex> mMeshIndices;
+        std::array<unsigned, 3> mNumStates;
+        unsigned mFrame;
+
+        glm::mat4 mViewMatrix;
+        glm::mat4 mProjViewMatrix;
+        bool mIsCulling;
+
+        unsigned long long ComputeKey(const RenderItem& item);
+
+    public:
+        static constexpr int PROGRAM_BITS{ 8 };
+        static constexpr int TEXTURES_BITS{ 12 };
+        static constexpr int MATERIAL_BITS{ 10 };
+        static constexpr int MESH_BITS{ 9 };
+        static constexpr int DEPTH_BITS{ 24 };
+
+        RenderQueue()
+            : mBuckets(static_cast<size_t>(Utility::JobSystem::Get().GetNumThreads())),
+              mNumStates{},
+              mFrame{},
+              mViewMatrix{1.0f},
+              mProjViewMatrix{1.0f},
+              mIsCulling{false} {}
+
+        // clears the queue, non-instanced draws outside the camera's frustum are dropped if isCulling
+        void Begin(const AbstractCamera& camera, bool isCulling = true);
+
+        // returns false if the draw was culled
+        bool Push(const RenderItem& item);
+
+        // one draw per mesh with the mesh's own textures, culled and recorded in parallel;
+        // merged models are already batched by StaticModel::Draw
+        void Push(const StaticModel& model, const RenderItem& item);
+
+        // replays the buckets on the thread owning the context, after every Push returned
+        void Submit();
+
+        int GetNumItems() const { return static_cast<int>(mEntries.size()); }
+    };
+
+    ////////////////////////////////////////
+    // intermediate targets of the post-process passes, kept across frames
+    // and handed out again to any pass asking for the same size and format
+    struct TexturePool
+    {
+    private:
+        struct Entry
+        {
+            std::unique_ptr<Texture2D> mTexture;
+            bool mIsInUse;
+        };
+
+        std::vector<Entry> mEntries;
+
+    public:
+        // linear filtering, clamped to the edges; a full mip chain if hasMipmaps
+        const Texture2D& Acquire(int width, int height, unsigned internalFormat, bool hasMipmaps = false);
+        void Release(const Texture2D&);
+
+        void Clear() { mEntries.clear(); }
+
+        int GetNumTextures() const { return static_cast<int>(mEntries.size()); }
+        int GetNumTexturesInUse() const;
+    };
+
+    ////////////////////////////////////////
+    struct PostProcessChainConfig
+    {
+        bool mEnableBloom{ false };
+        int mNumBloomLevels{ 5 };       // levels of the half resolution chain
+        float mBloomThreshold{ 1.0f };  // brightness before exposure
+        float mBloomKnee{ 0.5f };       // width of the soft threshold
+        float mBloomIntensity{ 0.05f };
+        float mBloomRadius{ 1.0f };     // of the tent filter, in texels of the larger level
+    };
+
+    ////////////////////////////////////////
+    // Compute replacement of SecondPass and PostProcessProgram. The scene is resolved
+    // while it is filtered and tonemapped, so it is read once at full resolution and
+    // written once to the output before the blit to the default framebuffer.
+    // Bloom runs on a half resolution mip chain drawn from the pool.
+    struct PostProcessChain
+    {
+    private:
+        int mWidth;
+        int mHeight;
+
+        Program mCompositeProgram;
+        Program mBloomPrefilterProgram;
+        Program mBloomDownsampleProgram;
+        Program mBloomUpsampleProgram;
+
+        Texture2D mOutput;
+        Framebuffer mOutputFbo;
+
+        mutable TexturePool mPool;
+        PostProcessChainConfig mConfig;
+
+        void Init() const;
+
+        // returns the top level of the bloom chain, both textures go back to the pool afterwards
+        const Texture2D& Bloom(unsigned sceneTextureId, const glm::ivec2& sceneSize,
+                               const Texture2D& down, const Texture2D& up, int numLevels) const;
+
+    public:
+        static constexpr int SCENE_TEXTURE_LOC{ 0 };
+        static constexpr int SOURCE_TEXTURE_LOC{ 0 };
+        static constexpr int BLOOM_TEXTURE_LOC{ 1 };
+        static constexpr int UPSAMPLE_TEXTURE_LOC{ 1 };
+        static constexpr int OUTPUT_IMAGE_LOC{ 2 };
+        static constexpr int BLOOM_INTENSITY_LOC{ 3 };
+        static constexpr int BLOOM_THRESHOLD_LOC{ 4 };
+        static constexpr int BLOOM_RADIUS_LOC{ 5 };
+        static constexpr int SOURCE_LEVEL_LOC{ 6 };
+        static constexpr int SCENE_SIZE_LOC{ 7 };
+        static constexpr int BLOOM_UV_SCALE_LOC{ 8 };
+        static constexpr int OUTPUT_REGION_LOC{ 9 };
+        static constexpr int SOURCE_UV_MAX_LOC{ 10 };
+
+        static constexpr int MAX_BLOOM_LEVELS{ 8 };
+        static constexpr int WORK_GROUP_SIZE{ 16 };
+
+        // largest width and height of the scene, numSamples of the texture it is rendered into
+        PostProcessChain(const std::string& shaderRootPath, int width, int height, int numSamples, ShaderLoader&);
+
+        PostProcessChainConfig& GetConfig() { return mConfig; }
+        const PostProcessChainConfig& GetConfig() const { return mConfig; }
+
+        const TexturePool& GetPool() const { return mPool; }
+        const Texture2D& GetOutput() const { return mOutput; }
+
+        // post-processes the lower left width by height texels of the scene texture into the
+        // default framebuffer, which is bound with an outputWidth by outputHeight viewport afterwards
+        void Execute(unsigned sceneTextureId, int width, int height, int outputWidth, int outputHeight) const;
+    };
 
     ////////////////////////////////////////
     struct PostProcessStack
@@ -2107,6 +3317,11 @@ namespace Poe
         int mOutputHeight;
         int mNumSamples;
 
+        // the targets keep the size of the full resolution, only their lower left part is rendered to
+        float mRenderScale;
+        int mRenderWidth;
+        int mRenderHeight;
+
         PostProcessProgram mProgram;
 
         RenderbufferMultiSample mRboMS;
@@ -2119,6 +3334,8 @@ namespace Poe
 
         PostProcessUB mBlock;
 
+        PostProcessChain mChain;
+
     public:
         PostProcessStack(const std::string& shaderRootPath,
                          int width, int height,
@@ -2133,9 +3350,11 @@ namespace Poe
                          int width, int height,
                          ShaderLoader&);
 
+        static constexpr float MIN_RENDER_SCALE{ 0.25f };
+
         void FirstPass() const
         {
-            glViewport(0, 0, mWidth, mHeight);
+            glViewport(0, 0, mRenderWidth, mRenderHeight);
 
             if (mNumSamples > 1) {
                 mFboMS.Bind();
@@ -2150,7 +3369,7 @@ namespace Poe
         void SecondPass() const
         {
             if (mNumSamples > 1) {
-                mFboMS.Blit(mFbo, mWidth, mHeight);
+                mFboMS.Blit(mFbo, mRenderWidth, mRenderHeight);
             }
 
             mFbo.UnBind();
@@ -2160,6 +3379,20 @@ namespace Poe
 
         void BindColor0() const { mColor0.Bind(); }
 
+        // replaces SecondPass, BindColor0, Use and Draw, see PostProcessChain
+        void Execute() const
+        {
+            mChain.Execute(mNumSamples > 1 ? mColor0MS.GetId() : mColor0.GetId(), mRenderWidth, mRenderHeight, mOutputWidth, mOutputHeight);
+
+            glClear(GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+        }
+
+        PostProcessChain& GetChain() { return mChain; }
+        const PostProcessChain& GetChain() const { return mChain; }
+
+        // the target of FirstPass
+        const Framebuffer& GetFramebuffer() const { return mNumSamples > 1 ? mFboMS : mFbo; }
+
         PostProcessProgram& Program() { return mProgram; }
         const PostProcessProgram& Program() const { return mProgram; }
 
@@ -2169,20 +3402,52 @@ namespace Poe
         int GetOutputHeight() const { return mOutputHeight; }
         int GetNumSamples() const { return mNumSamples; }
 
+        // fraction of the width and height that FirstPass renders at, in [MIN_RENDER_SCALE, 1];
+        // the targets are never reallocated and the final pass upscales to the output
+        void SetRenderScale(float scale);
+        float GetRenderScale() const { return mRenderScale; }
+        int GetRenderWidth() const { return mRenderWidth; }
+        int GetRenderHeight() const { return mRenderHeight; }
+
         PostProcessUB& GetBlock() { return mBlock; }
 
         void Use() const
         {
             mProgram.Use();
 
-            float widthRatio{ static_cast<float>(mWidth) / static_cast<float>(mOutputWidth) };
-            float heightRatio{ static_cast<float>(mHeight) / static_cast<float>(mOutputHeight) };
+            float widthRatio{ static_cast<float>(mRenderWidth) / static_cast<float>(mOutputWidth) };
+            float heightRatio{ static_cast<float>(mRenderHeight) / static_cast<float>(mOutputHeight) };
             glUniform2f(PostProcessProgram::TEXELSTRETCH_LOC, widthRatio, heightRatio);
         }
 
         void Draw() const { mProgram.Draw(); }
     };
 
+    ////////////////////////////////////////
+    // Picks the render scale of a PostProcessStack that holds a target GPU frame time.
+    // The frame times come from the Profiler, whose top level scopes have to enclose
+    // all the GPU work of a frame.
+    struct DynamicResolution
+    {
+        float mTargetFrameTime{ 1000.0f / 60.0f }; // milliseconds
+        float mMinScale{ 0.5f };
+        float mMaxScale{ 1.0f };
+        float mTolerance{ 0.05f }; // relative error of the frame time that is left alone
+        float mSmoothing{ 0.1f };  // weight of the newest frame time
+        float mGain{ 0.25f };      // part of the correction applied per frame
+
+    private:
+        float mFrameTime{};
+        unsigned long long mNumFrames{};
+
+    public:
+        // call once per frame after Profiler::EndFrame
+        void Update(PostProcessStack&);
+
+        // smoothed milliseconds, 0 before the first measurement
+        float GetFrameTime() const { return mFrameTime; }
+    };
+
     ////////////////////////////////////////
     struct EmissiveColorMaterial
     {
@@ -2193,10 +3458,11 @@ namespace Poe
     struct AbstractEmissiveColorProgram
     {
     protected:
+        bool mIsTransparent;
         Program mProgram;
 
     public:
-        AbstractEmissiveColorProgram(const std::string& rootPath, ShaderLoader&, bool);
+        AbstractEmissiveColorProgram(const std::string& rootPath, ShaderLoader&, bool isInstanced, bool isTransparent);
 
         virtual ~AbstractEmissiveColorProgram() {}
 
@@ -2206,16 +3472,21 @@ namespace Poe
         void SetMaterial(const EmissiveColorMaterial& m) const
         { glUniform4fv(COLOR_LOC, 1, glm::value_ptr(m.mColor)); }
 
+        // writes the alpha of the color to the targets of TransparencyStack
+        bool IsTransparent() const { return mIsTransparent; }
+
         virtual void SetModelMatrix(const glm::mat4& model) const = 0;
 
         void Use() const { mProgram.Use(); }
         void Halt() const { mProgram.Halt(); }
+
+        const Program& GetProgram() const { return mProgram; }
     };
 
     ////////////////////////////////////////
     struct EmissiveColorProgramInstanced : public AbstractEmissiveColorProgram
     {
-        EmissiveColorProgramInstanced(const std::string& rootPath, ShaderLoader&);
+        EmissiveColorProgramInstanced(const std::string& rootPath, ShaderLoader&, bool isTransparent = false);
 
         void SetModelMatrix(const glm::mat4& model) const override {}
     };
@@ -2223,7 +3494,7 @@ namespace Poe
     ////////////////////////////////////////
     struct EmissiveColorProgram : public AbstractEmissiveColorProgram
     {
-        EmissiveColorProgram(const std::string& rootPath, ShaderLoader&);
+        EmissiveColorProgram(const std::string& rootPath, ShaderLoader&, bool isTransparent = false);
 
         void SetModelMatrix(const glm::mat4& model) const override
         { glUniformMatrix4fv(MODEL_LOC, 1, GL_FALSE, glm::value_ptr(model)); }
@@ -2243,7 +3514,7 @@ namespace Poe
         Program mProgram;
 
     public:
-        AbstractEmissiveTextureProgram(const std::string& rootPath, ShaderLoader&, bool);
+        AbstractEmissiveTextureProgram(const std::string& rootPath, ShaderLoader&, bool, MaterialTableMode);
 
         virtual ~AbstractEmissiveTextureProgram() {}
 
@@ -2251,6 +3522,7 @@ namespace Poe
         static constexpr int TILE_MULTIPLIER_LOC = 1;
         static constexpr int TILE_OFFSET_LOC = 2;
         static constexpr int MODEL_LOC = 3;
+        static constexpr int MATERIAL_TEXTURE_ARRAYS_LOC = 4;
 
         void SetMaterial(const EmissiveTextureMaterial& m) const
         {
@@ -2262,12 +3534,14 @@ namespace Poe
 
         void Use() const { mProgram.Use(); }
         void Halt() const { mProgram.Halt(); }
+
+        const Program& GetProgram() const { return mProgram; }
     };
 
     ////////////////////////////////////////
     struct EmissiveTextureProgramInstanced : public AbstractEmissiveTextureProgram
     {
-        EmissiveTextureProgramInstanced(const std::string& rootPath, ShaderLoader&);
+        EmissiveTextureProgramInstanced(const std::string& rootPath, ShaderLoader&, MaterialTableMode materialTableMode = MaterialTableMode::None);
 
         void SetModelMatrix(const glm::mat4& model) const override {}
     };
@@ -2275,7 +3549,7 @@ namespace Poe
     ////////////////////////////////////////
     struct EmissiveTextureProgram : public AbstractEmissiveTextureProgram
     {
-        EmissiveTextureProgram(const std::string& rootPath, ShaderLoader&);
+        EmissiveTextureProgram(const std::string& rootPath, ShaderLoader&, MaterialTableMode materialTableMode = MaterialTableMode::None);
 
         void SetModelMatrix(const glm::mat4& model) const override
         { glUniformMatrix4fv(MODEL_LOC, 1, GL_FALSE, glm::value_ptr(model)); }
@@ -2345,6 +3619,8 @@ namespace Poe
         float mShadowBiasMin;
         float mShadowBiasMax;
         float mPointShadowBias;
+        bool mIsClustered;
+        bool mIsTransparent;
 
         Program mProgram;
 
@@ -2358,7 +3634,10 @@ namespace Poe
                                   int numCascades,
                                   float shadowBiasMin,
                                   float shadowBiasMax,
-                                  float pointShadowBias);
+                                  float pointShadowBias,
+                                  MaterialTableMode materialTableMode,
+                                  bool clusteredLights,
+                                  bool isTransparent);
 
         virtual ~AbstractBlinnPhongProgram() {}
 
@@ -2372,6 +3651,12 @@ namespace Poe
         float GetShadowBiasMax() const { return mShadowBiasMax; }
         float GetPointShadowBias() const { return mPointShadowBias; }
 
+        // shades ClusteredLightingStack lights on top of the light blocks
+        bool IsClustered() const { return mIsClustered; }
+
+        // writes to the targets of TransparencyStack, with the alpha of the diffuse texture times the opacity
+        bool IsTransparent() const { return mIsTransparent; }
+
         static constexpr int MODEL_MATRIX_LOC{ 0 };
         static constexpr int NORMAL_MATRIX_LOC{ 1 };
         static constexpr int TEX_OFFSET_LOC{ 2 };
@@ -2385,67 +3670,264 @@ namespace Poe
         static constexpr int POINT_LIGHT_DEPTH_MAP{ 9 };
         static constexpr int SPOT_LIGHT_DEPTH_MAP{ 10 };
 
+        static constexpr int MATERIAL_TEXTURE_ARRAYS_LOC{ 11 };
+
+        // after the locations taken by the texture arrays
+        static constexpr int AMBIENT_OCCLUSION_MAP_LOC{ MATERIAL_TEXTURE_ARRAYS_LOC + MaterialTable::MAX_TEXTURE_ARRAYS };
+        static constexpr int AMBIENT_OCCLUSION_LOC{ AMBIENT_OCCLUSION_MAP_LOC + 1 };
+        static constexpr int OPACITY_LOC{ AMBIENT_OCCLUSION_LOC + 1 };
+
         void Use() const { mProgram.Use(); }
         void Halt() const { mProgram.Halt(); }
+        const Program& GetProgram() const { return mProgram; }
 
         virtual void SetModelMatrix(const glm::mat4& modelMatrix) const = 0;
         virtual void SetNormalMatrix(const glm::mat3& normalMatrix) const = 0;
 
-        void SetTexOffset(const glm::vec2& texOffset) const
-        { glUniform2fv(TEX_OFFSET_LOC, 1, glm::value_ptr(texOffset)); }
+        void SetTexOffset(const glm::vec2& texOffset) const
+        { glUniform2fv(TEX_OFFSET_LOC, 1, glm::value_ptr(texOffset)); }
+
+        void SetTexMultiplier(const glm::vec2& texMultiplier) const
+        { glUniform2fv(TEX_MULTIPLIER_LOC, 1, glm::value_ptr(texMultiplier)); }
+
+        void SetAmbientFactor(float factor) const
+        { glUniform1f(AMBIENT_FACTOR_LOC, factor); }
+
+        // scales the ambient term by the map of an AmbientOcclusionStack
+        void SetAmbientOcclusion(bool isEnabled) const
+        { glUniform1i(AMBIENT_OCCLUSION_LOC, isEnabled ? 1 : 0); }
+
+        // only read when IsTransparent, 1 by default
+        void SetOpacity(float opacity) const
+        { glUniform1f(OPACITY_LOC, opacity); }
+    };
+
+    ////////////////////////////////////////
+    struct BlinnPhongProgram : public AbstractBlinnPhongProgram
+    {
+        BlinnPhongProgram(const std::string& rootPath,
+                          ShaderLoader&,
+                          int numDirLights,
+                          int numPointLights,
+                          int numSpotLights,
+                          int numCascades,
+                          float shadowBiasMin,
+                          float shadowBiasMax,
+                          float pointShadowBias,
+                          MaterialTableMode materialTableMode = MaterialTableMode::None,
+                          bool clusteredLights = false,
+                          bool isTransparent = false);
+
+        void SetModelMatrix(const glm::mat4& modelMatrix) const override
+        { glUniformMatrix4fv(MODEL_MATRIX_LOC, 1, GL_FALSE, glm::value_ptr(modelMatrix)); }
+
+        void SetNormalMatrix(const glm::mat3& normalMatrix) const override
+        { glUniformMatrix3fv(NORMAL_MATRIX_LOC, 1, GL_FALSE, glm::value_ptr(normalMatrix)); }
+    };
+
+    ////////////////////////////////////////
+    struct BlinnPhongProgramInstanced : public AbstractBlinnPhongProgram
+    {
+        BlinnPhongProgramInstanced(const std::string& rootPath,
+                                   ShaderLoader&,
+                                   int numDirLights,
+                                   int numPointLights,
+                                   int numSpotLights,
+                                   int numCascades,
+                                   float shadowBiasMin,
+                                   float shadowBiasMax,
+                                   float pointShadowBias,
+                                   MaterialTableMode materialTableMode = MaterialTableMode::None,
+                                   bool clusteredLights = false,
+                                   bool isTransparent = false);
+
+        void SetModelMatrix(const glm::mat4& modelMatrix) const override {}
+        void SetNormalMatrix(const glm::mat3& normalMatrix) const override {}
+    };
+
+    ////////////////////////////////////////
+    // fills the G-buffer of GBufferStack with the Blinn-Phong material of the drawn meshes,
+    // uniform locations and texture units match AbstractBlinnPhongProgram
+    struct AbstractGBufferProgram
+    {
+    protected:
+        Program mProgram;
+
+    public:
+        AbstractGBufferProgram(const std::string& rootPath,
+                               ShaderLoader&,
+                               bool isInstanced,
+                               MaterialTableMode materialTableMode);
+
+        virtual ~AbstractGBufferProgram() {}
+
+        static constexpr int MODEL_MATRIX_LOC{ 0 };
+        static constexpr int NORMAL_MATRIX_LOC{ 1 };
+        static constexpr int TEX_OFFSET_LOC{ 2 };
+        static constexpr int TEX_MULTIPLIER_LOC{ 3 };
+        static constexpr int MATERIAL_AMBIENT_TEXTURE_LOC{ 4 };
+        static constexpr int MATERIAL_DIFFUSE_TEXTURE_LOC{ 5 };
+        static constexpr int MATERIAL_SPECULAR_TEXTURE_LOC{ 6 };
+        static constexpr int AMBIENT_FACTOR_LOC{ 7 };
+        static constexpr int MATERIAL_TEXTURE_ARRAYS_LOC{ 11 };
+
+        void Use() const { mProgram.Use(); }
+        void Halt() const { mProgram.Halt(); }
+
+        virtual void SetModelMatrix(const glm::mat4& modelMatrix) const = 0;
+        virtual void SetNormalMatrix(const glm::mat3& normalMatrix) const = 0;
+
+        void SetTexOffset(const glm::vec2& texOffset) const
+        { glUniform2fv(TEX_OFFSET_LOC, 1, glm::value_ptr(texOffset)); }
+
+        void SetTexMultiplier(const glm::vec2& texMultiplier) const
+        { glUniform2fv(TEX_MULTIPLIER_LOC, 1, glm::value_ptr(texMultiplier)); }
+
+        void SetAmbientFactor(float factor) const
+        { glUniform1f(AMBIENT_FACTOR_LOC, factor); }
+    };
+
+    ////////////////////////////////////////
+    struct GBufferProgram : public AbstractGBufferProgram
+    {
+        GBufferProgram(const std::string& rootPath,
+                       ShaderLoader&,
+                       MaterialTableMode materialTableMode = MaterialTableMode::None);
+
+        void SetModelMatrix(const glm::mat4& modelMatrix) const override
+        { glUniformMatrix4fv(MODEL_MATRIX_LOC, 1, GL_FALSE, glm::value_ptr(modelMatrix)); }
+
+        void SetNormalMatrix(const glm::mat3& normalMatrix) const override
+        { glUniformMatrix3fv(NORMAL_MATRIX_LOC, 1, GL_FALSE, glm::value_ptr(normalMatrix)); }
+    };
+
+    ////////////////////////////////////////
+    struct GBufferProgramInstanced : public AbstractGBufferProgram
+    {
+        GBufferProgramInstanced(const std::string& rootPath,
+                                ShaderLoader&,
+                                MaterialTableMode materialTableMode = MaterialTableMode::None);
+
+        void SetModelMatrix(const glm::mat4& modelMatrix) const override {}
+        void SetNormalMatrix(const glm::mat3& normalMatrix) const override {}
+    };
+
+    ////////////////////////////////////////
+    // Deferred Blinn-Phong shading. The geometry pass writes
+    //     0: RGBA8  diffuse color, specular intensity
+    //     1: RG16   octahedral view space normal
+    //     2: RG8    log2 shininess, occlusion
+    //     3: RGBA16F ambient term, the lights accumulate on top of it
+    // and the view space position is reconstructed from depth. Directional lights are
+    // applied by one fullscreen pass, every point and spot light by a sphere volume
+    // whose stencil mask limits the shading to the pixels inside of it.
+    // Shadows and light blocks are the ones of LightingStack; multisampling is not supported.
+    struct GBufferStack
+    {
+    private:
+        using PointLightList = std::vector<std::reference_wrapper<const PointLight>>;
+        using SpotLightList = std::vector<std::reference_wrapper<const SpotLight>>;
+
+        int mWidth;
+        int mHeight;
+
+        Texture2D mAlbedo;
+        Texture2D mNormal;
+        Texture2D mMaterial;
+        Texture2D mLight;
+        Texture2D mDepthStencil;
+
+        Framebuffer mGeometryFbo;
+        Framebuffer mLightFbo;
+
+        Program mDirLightProgram;
+        Program mPointLightProgram;
+        Program mSpotLightProgram;
+        Program mStencilProgram;
+
+        int mNumDirLights;
+
+        void DrawLightVolume(const Program& program, int lightIndex, const glm::vec4& sphere) const;
+
+    public:
+        GBufferStack(const std::string& rootPath,
+                     int width, int height,
+                     int numDirLights,
+                     int numPointLights,
+                     int numSpotLights,
+                     int numCascades,
+                     float shadowBiasMin,
+                     float shadowBiasMax,
+                     float pointShadowBias,
+                     ShaderLoader&);
+
+        static constexpr int ALBEDO_TEXTURE_LOC{ 0 };
+        static constexpr int NORMAL_TEXTURE_LOC{ 1 };
+        static constexpr int MATERIAL_TEXTURE_LOC{ 2 };
+        static constexpr int DEPTH_TEXTURE_LOC{ 3 };
+        static constexpr int INVERSE_PROJECTION_LOC{ 4 };
+        static constexpr int INVERSE_VIEW_LOC{ 5 };
+        static constexpr int LIGHT_INDEX_LOC{ 6 };
+        static constexpr int VOLUME_SPHERE_LOC{ 7 };
+        static constexpr int DIR_LIGHT_DEPTH_MAP{ 8 };
+        static constexpr int POINT_LIGHT_DEPTH_MAP{ 9 };
+        static constexpr int SPOT_LIGHT_DEPTH_MAP{ 10 };
+
+        static constexpr int SPHERE_VOLUME_SEGMENTS{ 16 };
+        static constexpr int SPHERE_VOLUME_RINGS{ 8 };
+        static constexpr int SPHERE_VOLUME_NUM_VERTICES{ SPHERE_VOLUME_SEGMENTS * SPHERE_VOLUME_RINGS * 6 };
 
-        void SetTexMultiplier(const glm::vec2& texMultiplier) const
-        { glUniform2fv(TEX_MULTIPLIER_LOC, 1, glm::value_ptr(texMultiplier)); }
+        // draw the opaque meshes with a GBufferProgram(Instanced) afterwards
+        void GeometryPass() const
+        {
+            glViewport(0, 0, mWidth, mHeight);
+            mGeometryFbo.Bind();
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+        }
 
-        void SetAmbientFactor(float factor) const
-        { glUniform1f(AMBIENT_FACTOR_LOC, factor); }
-    };
+        // lights are in the order they were uploaded to the light blocks, their
+        // view positions have to be in sync with the camera like for the forward path
+        void LightingPass(const AbstractCamera& camera,
+                          const PointLightList& pointLights,
+                          const SpotLightList& spotLights) const;
 
-    ////////////////////////////////////////
-    struct BlinnPhongProgram : public AbstractBlinnPhongProgram
-    {
-        BlinnPhongProgram(const std::string& rootPath,
-                          ShaderLoader&,
-                          int numDirLights,
-                          int numPointLights,
-                          int numSpotLights,
-                          int numCascades,
-                          float shadowBiasMin,
-                          float shadowBiasMax,
-                          float pointShadowBias);
+        // copies the lit image and the depth into the target so that sky, emissive and
+        // transparent geometry can be drawn forward on top, the target must not be multisampled
+        void BlitTo(const Framebuffer& target) const;
 
-        void SetModelMatrix(const glm::mat4& modelMatrix) const override
-        { glUniformMatrix4fv(MODEL_MATRIX_LOC, 1, GL_FALSE, glm::value_ptr(modelMatrix)); }
+        void BindLight(unsigned loc = 0) const { mLight.Bind(loc); }
 
-        void SetNormalMatrix(const glm::mat3& normalMatrix) const override
-        { glUniformMatrix3fv(NORMAL_MATRIX_LOC, 1, GL_FALSE, glm::value_ptr(normalMatrix)); }
+        int GetWidth() const { return mWidth; }
+        int GetHeight() const { return mHeight; }
     };
 
     ////////////////////////////////////////
-    struct BlinnPhongProgramInstanced : public AbstractBlinnPhongProgram
+    // how a layered depth program routes primitives to the layers of its target
+    enum class LayeredShadowMode
     {
-        BlinnPhongProgramInstanced(const std::string& rootPath,
-                                   ShaderLoader&,
-                                   int numDirLights,
-                                   int numPointLights,
-                                   int numSpotLights,
-                                   int numCascades,
-                                   float shadowBiasMin,
-                                   float shadowBiasMax,
-                                   float pointShadowBias);
-
-        void SetModelMatrix(const glm::mat4& modelMatrix) const override {}
-        void SetNormalMatrix(const glm::mat3& normalMatrix) const override {}
+        None,
+        GeometryShader,
+        VertexShader
     };
 
+    ////////////////////////////////////////
+    LayeredShadowMode QueryLayeredShadowMode();
+
     ////////////////////////////////////////
     struct AbstractDepthProgram
     {
     protected:
         Program mProgram;
+        LayeredShadowMode mLayeredMode;
+        int mNumLayers;
 
     public:
-        AbstractDepthProgram(const std::string& rootPath, ShaderLoader&, bool isInstanced, bool isOmni);
+        AbstractDepthProgram(const std::string& rootPath,
+                             ShaderLoader&,
+                             bool isInstanced,
+                             bool isOmni,
+                             LayeredShadowMode layeredMode = LayeredShadowMode::None,
+                             int numLayers = 1);
 
         virtual ~AbstractDepthProgram() {}
 
@@ -2453,15 +3935,38 @@ namespace Poe
         static constexpr int MODEL_MATRIX_LOC{ 1 };
         static constexpr int FAR_PLANE_LOC{ 2 };
         static constexpr int LIGHT_POS_LOC{ 3 };
+        static constexpr int LAYER_MASK_LOC{ 4 };
+        static constexpr int LIGHT_MATRICES_LOC{ 5 };
 
         void Use() const { mProgram.Use(); }
         void Halt() const { mProgram.Halt(); }
 
+        LayeredShadowMode GetLayeredMode() const { return mLayeredMode; }
+        int GetNumLayers() const { return mNumLayers; }
+
         virtual void SetModelMatrix(const glm::mat4& modelMatrix) const = 0;
 
         void SetLightMatrix(const glm::mat4& lightMatrix) const
         { glUniformMatrix4fv(LIGHT_MATRIX_LOC, 1, GL_FALSE, glm::value_ptr(lightMatrix)); }
 
+        // one matrix per layer, only used by the layered variants
+        void SetLightMatrices(const glm::mat4* lightMatrices) const
+        { glUniformMatrix4fv(LIGHT_MATRICES_LOC, mNumLayers, GL_FALSE, glm::value_ptr(lightMatrices[0])); }
+
+        // layers whose bit is clear are left untouched by the layered variants
+        void SetLayerMask(unsigned layerMask) const
+        { glUniform1ui(LAYER_MASK_LOC, layerMask); }
+
+        // submits the mesh once, covering every layer of the bound framebuffer
+        void DrawLayered(const StaticMesh& mesh) const
+        {
+            mesh.BindPositions();
+            if (mLayeredMode == LayeredShadowMode::VertexShader)
+                mesh.DrawLayered(mNumLayers);
+            else
+                mesh.Draw();
+        }
+
         virtual void SetFarPlane(float farPlane) const = 0;
         virtual void SetLightPositionInWorldSpace(const glm::vec3& lightPos) const = 0;
     };
@@ -2529,28 +4034,337 @@ namespace Poe
     };
 
     ////////////////////////////////////////
+    // renders every cascade of a Texture2DArray in a single pass
+    struct DepthProgramLayered : public AbstractDepthProgram
+    {
+        DepthProgramLayered(const std::string& rootPath, ShaderLoader&, LayeredShadowMode, int numLayers);
+
+        void SetModelMatrix(const glm::mat4& modelMatrix) const override
+        { glUniformMatrix4fv(MODEL_MATRIX_LOC, 1, GL_FALSE, glm::value_ptr(modelMatrix)); }
+
+        void SetFarPlane(float farPlane) const override {}
+        void SetLightPositionInWorldSpace(const glm::vec3& lightPos) const override {}
+    };
+
+    ////////////////////////////////////////
+    // renders the six faces of a Cubemap in a single pass
+    struct DepthOmniProgramLayered : public AbstractDepthProgram
+    {
+        DepthOmniProgramLayered(const std::string& rootPath, ShaderLoader&, LayeredShadowMode);
+
+        void SetModelMatrix(const glm::mat4& modelMatrix) const override
+        {
+            glUniformMatrix4fv(MODEL_MATRIX_LOC, 1, GL_FALSE, glm::value_ptr(modelMatrix));
+        }
+
+        void SetFarPlane(float farPlane) const override
+        {
+            glUniform1f(FAR_PLANE_LOC, farPlane);
+        }
+
+        void SetLightPositionInWorldSpace(const glm::vec3& lightPos) const override
+        {
+            glUniform3fv(LIGHT_POS_LOC, 1, glm::value_ptr(lightPos));
+        }
+    };
+
+    ////////////////////////////////////////
+    // fills the depth buffer before the forward pass so that every pixel is shaded once:
+    //     prepass.Begin(camera);   draw the opaque geometry untextured
+    //     prepass.EndPrepass();    draw it again with the lit programs
+    //     prepass.EndMainPass();
+    // the lit vertex shaders transform like depth.glsl and declare gl_Position invariant,
+    // both passes have to pick the same levels of detail. Alpha tested surfaces
+    // would occlude what is behind their holes, leave them out of the prepass
+    struct DepthPrepass
+    {
+    private:
+        DepthProgram mProgram;
+        DepthProgramInstanced mProgramInstanced;
+
+    public:
+        DepthPrepass(const std::string& rootPath, ShaderLoader&);
+
+        // binds the non-instanced program, switch with ProgramInstanced().Use()
+        void Begin(const AbstractCamera& camera) const;
+
+        // the main pass only shades the fragments that won the prepass
+        void EndPrepass() const
+        {
+            glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+            glDepthMask(GL_FALSE);
+            glDepthFunc(GL_EQUAL);
+        }
+
+        // restores the state the demos render with
+        void EndMainPass() const
+        {
+            glDepthMask(GL_TRUE);
+            glDepthFunc(GL_LEQUAL);
+        }
+
+        const DepthProgram& Program() const { return mProgram; }
+        const DepthProgramInstanced& ProgramInstanced() const { return mProgramInstanced; }
+    };
+
+    ////////////////////////////////////////
+    struct AmbientOcclusionConfig
+    {
+        float mRadius{ 1.0f };      // world units
+        float mIntensity{ 1.0f };
+        float mBias{ 0.01f };       // keeps flat surfaces from occluding themselves
+        float mSharpness{ 8.0f };   // of the blur, neighbours this many times farther apart relative to the depth are ignored
+        int mNumSamples{ 12 };
+    };
+
+    ////////////////////////////////////////
+    // Scalable ambient obscurance at half resolution. The depth written by the prepass is
+    // linearized into a pyramid, taps far from a pixel read its smaller levels so a wide
+    // radius costs as much as a narrow one. Normals are reconstructed from the depth.
+    // The result is blurred and upsampled with depth aware weights into a full resolution
+    // texture bound at AMBIENT_OCCLUSION_MAP_BIND_POINT, which BlinnPhongProgram(s) and
+    // PbrLightProgram(s) sample once SetAmbientOcclusion is on. Supports perspective cameras.
+    struct AmbientOcclusionStack
+    {
+    private:
+        int mWidth;
+        int mHeight;
+
+        Program mLinearizeProgram;
+        Program mDownsampleProgram;
+        Program mOcclusionProgram;
+        Program mBlurProgram;
+        Program mUpsampleProgram;
+
+        Texture2D mDepth;       // copied from the target, which may be multisampled
+        Framebuffer mDepthFbo;
+        Texture2D mPyramid;     // linear depth at half resolution
+        Texture2D mOcclusion;   // obscurance and linear depth at half resolution
+        Texture2D mBlurred;
+        Texture2D mOutput;
+
+        AmbientOcclusionConfig mConfig;
+
+        void Init() const;
+
+    public:
+        static constexpr int DEPTH_TEXTURE_LOC{ 0 };
+        static constexpr int SOURCE_TEXTURE_LOC{ 1 };
+        static constexpr int OUTPUT_IMAGE_LOC{ 2 };
+        static constexpr int OUTPUT_REGION_LOC{ 3 };
+        static constexpr int SOURCE_REGION_LOC{ 4 };
+        static constexpr int SOURCE_LEVEL_LOC{ 5 };
+        static constexpr int PROJECTION_LOC{ 6 };
+        static constexpr int RADIUS_LOC{ 7 };
+        static constexpr int INTENSITY_LOC{ 8 };
+        static constexpr int BIAS_LOC{ 9 };
+        static constexpr int NUM_SAMPLES_LOC{ 10 };
+        static constexpr int NUM_LEVELS_LOC{ 11 };
+        static constexpr int BLUR_DIRECTION_LOC{ 12 };
+        static constexpr int SHARPNESS_LOC{ 13 };
+
+        static constexpr int MAX_PYRAMID_LEVELS{ 5 };
+        static constexpr int MAX_SAMPLES{ 32 };
+        static constexpr int WORK_GROUP_SIZE{ 8 };
+
+        // largest width and height of the target, whose depth is GL_DEPTH24_STENCIL8
+        AmbientOcclusionStack(const std::string& rootPath, int width, int height, ShaderLoader&);
+
+        AmbientOcclusionConfig& GetConfig() { return mConfig; }
+        const AmbientOcclusionConfig& GetConfig() const { return mConfig; }
+
+        const Texture2D& GetOutput() const { return mOutput; }
+
+        // call after the prepass with its target and the camera it was drawn with, only the lower
+        // left width by height texels are processed; the bindings of texture units 0 and 1 change
+        void Execute(const Framebuffer& target, const AbstractCamera& camera, int width, int height) const;
+    };
+
+    ////////////////////////////////////////
+    // weighted blended order-independent transparency, see McGuire and Bavoil 2013:
+    //     transparency.Begin(target, width, height);   draw with the programs created with isTransparent, in any order
+    //     transparency.Composite(target);
+    // the surfaces are tested against a copy of the opaque depth and blended into an accumulation
+    // and a revealage target, the cost doesn't depend on their number and nothing is sorted.
+    // A multisampled target is resolved by the copy, transparent edges get one sample per pixel
+    struct TransparencyStack
+    {
+    private:
+        Texture2D mAccumulation;    // weighted premultiplied color and alpha
+        Texture2D mRevealage;       // product of one minus the alphas
+        Texture2D mDepth;           // copied from the target
+        Framebuffer mFbo;
+
+        Program mCompositeProgram;
+
+    public:
+        static constexpr int ACCUMULATION_TEXTURE_LOC{ 0 };
+        static constexpr int REVEALAGE_TEXTURE_LOC{ 1 };
+
+        // largest width and height of the target, whose depth is GL_DEPTH24_STENCIL8
+        TransparencyStack(const std::string& rootPath, int width, int height, ShaderLoader&);
+
+        const Texture2D& GetAccumulation() const { return mAccumulation; }
+        const Texture2D& GetRevealage() const { return mRevealage; }
+
+        // call after the opaque geometry, only the lower left width by height texels are used;
+        // leaves depth writes off and blending on
+        void Begin(const Framebuffer& target, int width, int height) const;
+
+        // blends the transparent surfaces over target, which stays bound, and turns depth writes
+        // back on and blending off; the bindings of texture units 0 and 1 change
+        void Composite(const Framebuffer& target) const;
+    };
+
+    ////////////////////////////////////////
+    // compacts the instances of a StaticMesh whose bounding sphere
+    // intersects the frustum into the range of their level of detail,
+    // see StaticMesh::DrawInstancedCulled
+    struct InstanceCullingProgram
+    {
+    private:
+        Program mProgram;
+
+    public:
+        InstanceCullingProgram(const std::string& rootPath, ShaderLoader&);
+
+        static constexpr int FRUSTUM_PLANES_LOC{ 0 };
+        static constexpr int BOUNDING_SPHERE_LOC{ 6 };
+        static constexpr int NUM_INSTANCES_LOC{ 7 };
+        static constexpr int CAMERA_POS_LOC{ 8 };
+        static constexpr int LOD_SCALE_LOC{ 9 };
+        static constexpr int NUM_LODS_LOC{ 10 };
+        static constexpr int LOD_ERRORS_LOC{ 11 };
+
+        static constexpr int WORK_GROUP_SIZE{ 64 };
+
+        // frustum and view in world space, instance matrices map to world space;
+        // the default view keeps every instance at full resolution
+        void Cull(const StaticMesh& mesh, const Utility::Frustum& frustum, const LodView& view = {}) const;
+    };
+
+    ////////////////////////////////////////
+    // Bins point and spot lights into a froxel grid of the view frustum so that
+    // BlinnPhongProgram(s) created with clusteredLights shade each fragment with the
+    // lights of its cluster only. Supports perspective cameras; lights are shadowless.
+    struct ClusteredLightingStack
+    {
+    private:
+        Program mProgram;
+
+        ShaderStorageBuffer mPointLightBuffer;
+        ShaderStorageBuffer mSpotLightBuffer;
+        ShaderStorageBuffer mClusterBuffer;
+        ShaderStorageBuffer mLightIndexBuffer;
+
+        std::vector<PointLightListElem__DATA> mPointLights;
+        std::vector<SpotLightListElem__DATA> mSpotLights;
+
+        int mNumPointLights;
+        int mNumSpotLights;
+
+    public:
+        static constexpr int GRID_X{ 16 };
+        static constexpr int GRID_Y{ 9 };
+        static constexpr int GRID_Z{ 24 };
+        static constexpr int NUM_CLUSTERS{ GRID_X * GRID_Y * GRID_Z };
+        static constexpr int MAX_LIGHTS_PER_CLUSTER{ 64 };
+
+        static constexpr int INVERSE_PROJECTION_LOC{ 0 };
+        static constexpr int NUM_POINT_LIGHTS_LOC{ 4 };
+        static constexpr int NUM_SPOT_LIGHTS_LOC{ 5 };
+
+        static constexpr int WORK_GROUP_SIZE{ 64 };
+
+        ClusteredLightingStack(const std::string& rootPath, ShaderLoader&, int maxPointLights, int maxSpotLights);
+
+        // same conventions as PointLightUB::Set and SpotLightUB::Set
+        void SetPointLight(int ind, const PointLight& pl);
+        void SetSpotLight(int ind, const glm::mat4& viewMatrix, const SpotLight& sp);
+
+        // lights past these counts are ignored
+        void SetNumPointLights(int numLights);
+        void SetNumSpotLights(int numLights);
+
+        int GetNumPointLights() const { return mNumPointLights; }
+        int GetNumSpotLights() const { return mNumSpotLights; }
+        int GetMaxPointLights() const { return static_cast<int>(mPointLights.size()); }
+        int GetMaxSpotLights() const { return static_cast<int>(mSpotLights.size()); }
+
+        // uploads the lights and rebuilds the clusters, call once per frame
+        // after the lights were set with the view matrix of the camera
+        void Update(const AbstractCamera& camera, int width, int height) const;
+
+        // binds the light lists and the clusters for shading
+        void Bind() const;
+    };
+
+    ////////////////////////////////////////
+    // Bakes the sky into a low resolution cubemap from a transmittance and a multi-scattering
+    // LUT, both rebuilt only when the atmosphere changes. Draw samples the cubemap, whose
+    // mips can feed image-based lighting.
     struct RealisticSkyboxProgram
     {
     private:
         Program mProgram;
+        Program mTransmittanceProgram;
+        Program mMultiScatteringProgram;
+        Program mCubemapProgram;
+
+        Texture2D mTransmittanceLut;
+        Texture2D mMultiScatteringLut;
+        Cubemap mCubemap;
 
         float mShaderPI;
         float mShaderISteps;
         float mShaderJSteps;
 
+        // revisions of RealisticSkyboxUB the textures were baked from
+        mutable unsigned mAtmosphereRevision;
+        mutable unsigned mSkyRevision;
+
+        void Init() const;
+        void BakeLuts() const;
+        void BakeCubemap() const;
+
     public:
+        static constexpr int SKYBOX_LOC{ 0 };
+
+        static constexpr int OUTPUT_IMAGE_LOC{ 0 };
+        static constexpr int TRANSMITTANCE_LUT_LOC{ 1 };
+        static constexpr int MULTI_SCATTERING_LUT_LOC{ 2 };
+
+        static constexpr int TRANSMITTANCE_LUT_WIDTH{ 256 };
+        static constexpr int TRANSMITTANCE_LUT_HEIGHT{ 64 };
+        static constexpr int MULTI_SCATTERING_LUT_SIZE{ 32 };
+        static constexpr int MULTI_SCATTERING_SQRT_SAMPLES{ 8 };
+        static constexpr int MULTI_SCATTERING_STEPS{ 20 };
+
+        static constexpr int WORK_GROUP_SIZE{ 8 };
+
+        // iSteps march the view rays into the cubemap, jSteps the rays towards the sun into the transmittance LUT
         RealisticSkyboxProgram(const std::string& rootPath,
                                ShaderLoader&,
                                float shaderPi = 3.1415926f,
                                float shaderISteps = 16,
-                               float shaderJSteps = 8);
+                               float shaderJSteps = 40,
+                               int cubemapSize = 128);
 
         void Use() const { mProgram.Use(); }
         void Halt() const { mProgram.Halt(); }
 
+        // rebakes whatever the block changed since the last call, call after RealisticSkyboxUB::Update;
+        // the block has to be bound
+        void Update(const RealisticSkyboxUB& block) const;
+
+        const Cubemap& GetCubemap() const { return mCubemap; }
+        const Texture2D& GetTransmittanceLut() const { return mTransmittanceLut; }
+        const Texture2D& GetMultiScatteringLut() const { return mMultiScatteringLut; }
+
         void Draw() const
         {
             mProgram.Use();
+            mCubemap.Bind(SKYBOX_LOC);
             glDrawArrays(GL_TRIANGLES, 0, 36);
             ++RuntimeStats::NumDrawCalls;
         }
@@ -2565,8 +4379,14 @@ namespace Poe
     public:
         PbrLightProgramInstanced(const std::string& rootPath, ShaderLoader&);
 
+        static constexpr int AMBIENT_OCCLUSION_LOC = 1;
+
         void Use() const { mProgram.Use(); }
         void Halt() const { mProgram.Halt(); }
+
+        // scales the ambient term by the map of an AmbientOcclusionStack
+        void SetAmbientOcclusion(bool isEnabled) const
+        { glUniform1i(AMBIENT_OCCLUSION_LOC, isEnabled ? 1 : 0); }
     };
 
     ////////////////////////////////////////
@@ -2579,21 +4399,43 @@ namespace Poe
         PbrLightProgram(const std::string& rootPath, ShaderLoader&);
 
         static constexpr int MODEL_LOC = 0;
+        static constexpr int AMBIENT_OCCLUSION_LOC = 1;
 
         void Use() const { mProgram.Use(); }
         void Halt() const { mProgram.Halt(); }
 
         void SetModelMatrix(const glm::mat4& model) const
         { glUniformMatrix4fv(MODEL_LOC, 1, GL_FALSE, glm::value_ptr(model)); }
+
+        // scales the ambient term by the map of an AmbientOcclusionStack
+        void SetAmbientOcclusion(bool isEnabled) const
+        { glUniform1i(AMBIENT_OCCLUSION_LOC, isEnabled ? 1 : 0); }
     };
 
+    ////////////////////////////////////////
+    // casters between the light and the near plane of its ortho volume still
+    // throw shadows into it, so only the side and far planes are tested
+    inline bool IsShadowCasterVisible(const glm::mat4& lightModelMatrix, const Utility::AABB& bounds)
+    {
+        Utility::Frustum frustum{ Utility::ComputeFrustum(lightModelMatrix) };
+        frustum.mPlanes[4] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        return frustum.Intersects(bounds);
+    }
+
     ////////////////////////////////////////
     template <int NumCascades>
     struct LightingStack
     {
     private:
+        using ModelMatrixList = std::vector<std::reference_wrapper<const glm::mat4>>;
+        using MeshList = std::vector<std::reference_wrapper<const StaticMesh>>;
+
+        static constexpr unsigned ALL_CASCADES_MASK{ (1u << (NumCascades + 1)) - 1u };
+
         DepthProgram mDepthProgram;
         DepthOmniProgram mDepthOmniProgram;
+        DepthProgramLayered mDepthProgramLayered;
+        DepthOmniProgramLayered mDepthOmniProgramLayered;
 
         DirLightUB<NumCascades> mDirLightBlock;
         PointLightUB mPointLightBlock;
@@ -2601,18 +4443,74 @@ namespace Poe
 
         Texture2DArray mDirLightDepthMap;
         std::vector<Framebuffer> mDirLightDepthFBOs;
+        Framebuffer mDirLightLayeredFBO;
 
         Cubemap mPointLightDepthMap;
         Framebuffer mPointLightDepthFBO;
+        Framebuffer mPointLightLayeredFBO;
 
         Texture2D mSpotLightDepthMap;
         Framebuffer mSpotLightDepthFBO;
 
+        // depth of the static casters only, copied back instead of re-rendering them
+        Texture2DArray mDirLightStaticDepthMap;
+        Cubemap mPointLightStaticDepthMap;
+
+        std::array<glm::mat4, static_cast<size_t>(NumCascades + 1)> mCachedLightMatrices;
+        std::array<glm::vec3, static_cast<size_t>(NumCascades + 1)> mCachedFrustumCenters;
+        std::array<int, static_cast<size_t>(NumCascades + 1)> mCascadeAges;
+        glm::vec3 mCachedLightDirection;
+        bool mDirShadowCacheValid;
+
+        glm::vec3 mCachedPointLightPosition;
+        float mCachedPointLightNearPlane;
+        float mCachedPointLightFarPlane;
+        bool mPointShadowCacheValid;
+
         int mNumDirLights;
         int mNumPointLights;
         int mNumSpotLights;
 
         int mShadowSize;
+        bool mLayeredShadows;
+
+        bool mShadowCaching;
+        int mFirstCachedCascade;
+        int mCascadeRefreshInterval;
+        float mCascadeRefreshTexelThreshold;
+
+        void DrawDirectionalShadowCasters(const DirLight& light,
+                                          unsigned cascadeMask,
+                                          const ModelMatrixList& modelMatrices,
+                                          const MeshList& meshes);
+
+        void DrawOmnidirectionalShadowCasters(const PointLight& light,
+                                              const glm::mat4 (&lightMatrices)[6],
+                                              const ModelMatrixList& modelMatrices,
+                                              const MeshList& meshes);
+
+        void CopyCascade(const Texture2DArray& src, const Texture2DArray& dst, int cascade) const
+        {
+            glCopyImageSubData(src.GetId(), GL_TEXTURE_2D_ARRAY, 0, 0, 0, cascade,
+                               dst.GetId(), GL_TEXTURE_2D_ARRAY, 0, 0, 0, cascade,
+                               src.GetWidth(), src.GetHeight(), 1);
+        }
+
+        void CopyCubemap(const Cubemap& src, const Cubemap& dst) const
+        {
+            glCopyImageSubData(src.GetId(), GL_TEXTURE_CUBE_MAP, 0, 0, 0, 0,
+                               dst.GetId(), GL_TEXTURE_CUBE_MAP, 0, 0, 0, 0,
+                               src.GetWidth(), src.GetHeight(), 6);
+        }
+
+        // how many whole texels the cascade's center moved since its depth was cached
+        float ComputeCascadeTexelShift(int cascade, const glm::vec3& frustumCenter) const
+        {
+            size_t ind{ static_cast<size_t>(cascade) };
+            glm::vec4 cachedCenter{ mCachedLightMatrices[ind] * glm::vec4(mCachedFrustumCenters[ind], 1.0f) };
+            glm::vec4 center{ mCachedLightMatrices[ind] * glm::vec4(frustumCenter, 1.0f) };
+            return glm::floor(glm::length(glm::vec2(center) - glm::vec2(cachedCenter)) * 0.5f * static_cast<float>(mShadowSize));
+        }
 
     public:
 
@@ -2621,7 +4519,8 @@ namespace Poe
                       int numSpotLights,
                       int shadowSize,
                       const std::string& rootPath,
-                      ShaderLoader& loader);
+                      ShaderLoader& loader,
+                      bool usePersistentBuffers = false);
 
         int GetNumDirLights() const { return mNumDirLights; }
         int GetNumPointLights() const { return mNumPointLights; }
@@ -2629,21 +4528,52 @@ namespace Poe
 
         int GetShadowSize() const { return mShadowSize; }
 
+        // submits the scene once per light instead of once per cascade or cube face
+        void SetLayeredShadows(bool layeredShadows) { mLayeredShadows = layeredShadows; }
+        bool IsLayeredShadows() const { return mLayeredShadows; }
+
+        // caches the depth of the static casters for the far cascades and stationary point lights;
+        // only the first shadow casting light of each kind is cached since they share a depth map.
+        // Off by default, moving casters have to go in the dynamic lists of the prepasses once it is on
+        void SetShadowCaching(bool shadowCaching) { mShadowCaching = shadowCaching; }
+        bool IsShadowCaching() const { return mShadowCaching; }
+
+        void SetFirstCachedCascade(int cascade) { mFirstCachedCascade = cascade; }
+        int GetFirstCachedCascade() const { return mFirstCachedCascade; }
+
+        void SetCascadeRefreshInterval(int numFrames) { mCascadeRefreshInterval = numFrames; }
+        int GetCascadeRefreshInterval() const { return mCascadeRefreshInterval; }
+
+        void SetCascadeRefreshTexelThreshold(float numTexels) { mCascadeRefreshTexelThreshold = numTexels; }
+        float GetCascadeRefreshTexelThreshold() const { return mCascadeRefreshTexelThreshold; }
+
+        // call when the static casters change
+        void InvalidateShadowCache()
+        {
+            mDirShadowCacheValid = false;
+            mPointShadowCacheValid = false;
+        }
+
         void PrepareState() const { glDisable(GL_CULL_FACE); }
         void ResetState() const { glEnable(GL_CULL_FACE); }
 
+        // with shadow caching enabled meshes are treated as static casters, dynamicMeshes are redrawn every frame
         void DirectionalShadowPrepass(const AbstractCamera& camera,
                                       const std::vector<std::reference_wrapper<DirLight>>& lights,
-                                      const std::vector<std::reference_wrapper<const glm::mat4>>& modelMatrices,
-                                      const std::vector<std::reference_wrapper<const StaticMesh>>& meshes);
+                                      const ModelMatrixList& modelMatrices,
+                                      const MeshList& meshes,
+                                      const ModelMatrixList& dynamicModelMatrices = {},
+                                      const MeshList& dynamicMeshes = {});
 
         void OmnidirectionalShadowPrepass(const std::vector<std::reference_wrapper<const PointLight>>& lights,
-                                          const std::vector<std::reference_wrapper<const glm::mat4>>& modelMatrices,
-                                          const std::vector<std::reference_wrapper<const StaticMesh>>& meshes);
+                                          const ModelMatrixList& modelMatrices,
+                                          const MeshList& meshes,
+                                          const ModelMatrixList& dynamicModelMatrices = {},
+                                          const MeshList& dynamicMeshes = {});
 
         void PerspectiveShadowPrepass(const std::vector<std::reference_wrapper<const SpotLight>>& lights,
-                                      const std::vector<std::reference_wrapper<const glm::mat4>>& modelMatrices,
-                                      const std::vector<std::reference_wrapper<const StaticMesh>>& meshes);
+                                      const ModelMatrixList& modelMatrices,
+                                      const MeshList& meshes);
     };
 
     ////////////////////////////////////////
@@ -2653,21 +4583,42 @@ namespace Poe
                                               int numSpotLights,
                                               int shadowSize,
                                               const std::string& rootPath,
-                                              ShaderLoader& loader)
+                                              ShaderLoader& loader,
+                                              bool usePersistentBuffers)
         : mDepthProgram(rootPath, loader),
           mDepthOmniProgram(rootPath, loader),
-          mDirLightBlock(numDirLights),
-          mPointLightBlock(numPointLights),
-          mSpotLightBlock(numSpotLights),
+          mDepthProgramLayered(rootPath, loader, QueryLayeredShadowMode(), NumCascades + 1),
+          mDepthOmniProgramLayered(rootPath, loader, QueryLayeredShadowMode()),
+          mDirLightBlock(numDirLights, usePersistentBuffers),
+          mPointLightBlock(numPointLights, usePersistentBuffers),
+          mSpotLightBlock(numSpotLights, usePersistentBuffers),
           mDirLightDepthMap{ CreateCascadedDepthMap(shadowSize, shadowSize, NumCascades + 1) },
+          mDirLightLayeredFBO(mDirLightDepthMap, GL_DEPTH_ATTACHMENT),
           mPointLightDepthMap{ CreateDepthCubemap(shadowSize, shadowSize) },
           mPointLightDepthFBO(mPointLightDepthMap, GL_DEPTH_ATTACHMENT),
+          mPointLightLayeredFBO(mPointLightDepthMap, GL_DEPTH_ATTACHMENT),
           mSpotLightDepthMap{ CreateDepthMap(shadowSize, shadowSize) },
           mSpotLightDepthFBO(mSpotLightDepthMap, GL_DEPTH_ATTACHMENT),
+          mDirLightStaticDepthMap{ CreateCascadedDepthMap(shadowSize, shadowSize, NumCascades + 1) },
+          mPointLightStaticDepthMap{ CreateDepthCubemap(shadowSize, shadowSize) },
+          mCachedLightMatrices{},
+          mCachedFrustumCenters{},
+          mCascadeAges{},
+          mCachedLightDirection{},
+          mDirShadowCacheValid{false},
+          mCachedPointLightPosition{},
+          mCachedPointLightNearPlane{},
+          mCachedPointLightFarPlane{},
+          mPointShadowCacheValid{false},
           mNumDirLights{numDirLights},
           mNumPointLights{numPointLights},
           mNumSpotLights{numSpotLights},
-          mShadowSize{shadowSize}
+          mShadowSize{shadowSize},
+          mLayeredShadows{true},
+          mShadowCaching{false},
+          mFirstCachedCascade{(NumCascades + 1) / 2},
+          mCascadeRefreshInterval{8},
+          mCascadeRefreshTexelThreshold{4.0f}
     {
         for (int i = 0; i <= NumCascades; ++i) {
             mDirLightDepthFBOs.push_back(Framebuffer(mDirLightDepthMap, GL_DEPTH_ATTACHMENT, i));
@@ -2682,53 +4633,175 @@ namespace Poe
         mSpotLightDepthMap.Bind(SPOT_LIGHT_DEPTH_MAP_BIND_POINT);
     }
 
+    ////////////////////////////////////////
+    template <int NumCascades>
+    void LightingStack<NumCascades>::DrawDirectionalShadowCasters(const DirLight& light,
+                                                                  unsigned cascadeMask,
+                                                                  const ModelMatrixList& modelMatrices,
+                                                                  const MeshList& meshes)
+    {
+        if (cascadeMask == 0 || meshes.empty()) {
+            return;
+        }
+
+        if (mLayeredShadows) {
+            mDirLightLayeredFBO.Bind();
+            mDepthProgramLayered.SetLightMatrices(light.mLightMatrices.data());
+            mDepthProgramLayered.SetLayerMask(cascadeMask);
+
+            for (size_t i = 0; i < meshes.size(); ++i) {
+                const glm::mat4& modelMatrix{ modelMatrices.size() == meshes.size() ? modelMatrices[i] : modelMatrices[modelMatrices.size() - 1] };
+                const StaticMesh& mesh{ meshes[i].get() };
+
+                // a single submission covers every cascade, so the mesh is kept if any of them sees it
+                bool isVisible{ !mesh.GetBounds().IsValid() };
+                for (int j = 0; j <= NumCascades && !isVisible; ++j) {
+                    isVisible = (cascadeMask & (1u << j)) != 0 &&
+                                IsShadowCasterVisible(light.mLightMatrices[static_cast<size_t>(j)] * modelMatrix, mesh.GetBounds());
+                }
+                if (!isVisible) {
+                    ++RuntimeStats::NumCulledShadowCasters;
+                    continue;
+                }
+                ++RuntimeStats::NumVisibleShadowCasters;
+
+                mDepthProgramLayered.SetModelMatrix(modelMatrix);
+                mDepthProgramLayered.DrawLayered(mesh);
+            }
+            return;
+        }
+
+        for (int j = 0; j <= NumCascades; ++j) {
+            if ((cascadeMask & (1u << j)) == 0) {
+                continue;
+            }
+            ProfileScope cascadeScope("Cascade", j);
+            const glm::mat4& lightMatrix{ light.mLightMatrices[static_cast<size_t>(j)] };
+            mDirLightDepthFBOs[static_cast<size_t>(j)].Bind();
+            mDepthProgram.SetLightMatrix(lightMatrix);
+
+            for (size_t i = 0; i < meshes.size(); ++i) {
+                const glm::mat4& modelMatrix{ modelMatrices.size() == meshes.size() ? modelMatrices[i] : modelMatrices[modelMatrices.size() - 1] };
+                const StaticMesh& mesh{ meshes[i].get() };
+                if (mesh.GetBounds().IsValid() && !IsShadowCasterVisible(lightMatrix * modelMatrix, mesh.GetBounds())) {
+                    ++RuntimeStats::NumCulledShadowCasters;
+                    continue;
+                }
+                ++RuntimeStats::NumVisibleShadowCasters;
+
+                mDepthProgram.SetModelMatrix(modelMatrix);
+                mesh.BindPositions();
+                mesh.Draw();
+            }
+        }
+    }
+
     ////////////////////////////////////////
     template <int NumCascades>
     void LightingStack<NumCascades>::DirectionalShadowPrepass(const AbstractCamera& camera,
                                                               const std::vector<std::reference_wrapper<DirLight>>& lights,
-                                                              const std::vector<std::reference_wrapper<const glm::mat4>>& modelMatrices,
-                                                              const std::vector<std::reference_wrapper<const StaticMesh>>& meshes)
+                                                              const ModelMatrixList& modelMatrices,
+                                                              const MeshList& meshes,
+                                                              const ModelMatrixList& dynamicModelMatrices,
+                                                              const MeshList& dynamicMeshes)
     {
-        for (const Framebuffer& fbo : mDirLightDepthFBOs) {
-            fbo.Bind();
+        ProfileScope scope("Directional Shadows");
+        if (mLayeredShadows) {
+            mDirLightLayeredFBO.Bind();
             glViewport(0, 0, mDirLightDepthMap.GetWidth(), mDirLightDepthMap.GetHeight());
             glClear(GL_DEPTH_BUFFER_BIT);
+            mDepthProgramLayered.Use();
+        }
+        else {
+            for (const Framebuffer& fbo : mDirLightDepthFBOs) {
+                fbo.Bind();
+                glViewport(0, 0, mDirLightDepthMap.GetWidth(), mDirLightDepthMap.GetHeight());
+                glClear(GL_DEPTH_BUFFER_BIT);
+            }
+            mDepthProgram.Use();
         }
 
-        mDepthProgram.Use();
+        if (!mShadowCaching) {
+            mDirShadowCacheValid = false;
+        }
 
         int lightIndex{};
+        bool isCacheUsed{};
         for (DirLight& light : lights) {
             if (light.mCastShadows) {
+                ProfileScope lightScope("Light", lightIndex);
                 assert(light.mCascadeRanges.size() == NumCascades);
+                bool useCache{ mShadowCaching && !isCacheUsed };
+                bool isCacheStale{ !mDirShadowCacheValid || glm::distance(mCachedLightDirection, light.mDirection) > 0.0001f };
+
+                // every slice is fitted in one batch, on the stack
+                std::array<Utility::FrustumCorners, static_cast<size_t>(NumCascades + 1)> frustumCorners;
+                std::array<glm::vec3, static_cast<size_t>(NumCascades + 1)> frustumCenters;
+                frustumCorners.front() = camera.GetFrustumCornersInWorldSpace(camera.GetNear() - light.mZOffset, light.mCascadeRanges.front() + light.mZOffset);
+                for (size_t i = 1; i < NumCascades; ++i) {
+                    frustumCorners[i] = camera.GetFrustumCornersInWorldSpace(light.mCascadeRanges[i - 1] - light.mZOffset, light.mCascadeRanges[i] + light.mZOffset);
+                }
+                frustumCorners.back() = camera.GetFrustumCornersInWorldSpace(light.mCascadeRanges.back() - light.mZOffset, camera.GetFar() + light.mZOffset);
+                Utility::ComputeFrustumCenters(frustumCorners.data(), frustumCorners.size(), frustumCenters.data());
+
+                // refreshed slices are packed to the front for the fit
+                std::array<Utility::FrustumCorners, static_cast<size_t>(NumCascades + 1)> refreshedCorners;
+                std::array<glm::mat4, static_cast<size_t>(NumCascades + 1)> lightViews;
+                std::array<glm::mat4, static_cast<size_t>(NumCascades + 1)> lightProjections;
+                std::array<size_t, static_cast<size_t>(NumCascades + 1)> refreshedCascades;
+                size_t numRefreshed{};
+
+                unsigned refreshMask{};
                 for (int i = 0; i <= NumCascades; ++i) {
-                    std::vector<glm::vec4> frustumCorners = [&](){
-                        if (i == 0) {
-                            return camera.GetFrustumCornersInWorldSpace(camera.GetNear() - light.mZOffset, light.mCascadeRanges.front() + light.mZOffset);
+                    size_t ind{ static_cast<size_t>(i) };
+                    const glm::vec3& frustumCenter{ frustumCenters[ind] };
+
+                    // cached cascades keep the light matrix they were rendered with until they are refreshed
+                    bool isRefreshed{ !useCache ||
+                                      isCacheStale ||
+                                      i < mFirstCachedCascade ||
+                                      mCascadeAges[ind] >= mCascadeRefreshInterval ||
+                                      ComputeCascadeTexelShift(i, frustumCenter) > mCascadeRefreshTexelThreshold };
+                    if (!isRefreshed) {
+                        light.mLightMatrices[ind] = mCachedLightMatrices[ind];
+                        ++mCascadeAges[ind];
+                        continue;
+                    }
+
+                    lightViews[numRefreshed] = glm::lookAt(frustumCenter + -light.mDirection, frustumCenter, glm::cross(-light.mDirection, glm::vec3(1.0f, 0.0f, 0.0f)));
+                    refreshedCorners[numRefreshed] = frustumCorners[ind];
+                    refreshedCascades[numRefreshed++] = ind;
+                    refreshMask |= 1u << i;
+                }
+
+                Utility::FitLightProjectionsToFrusta(lightViews.data(), refreshedCorners.data(), numRefreshed, light.mZMultiplier, lightProjections.data());
+                for (size_t j = 0; j < numRefreshed; ++j) {
+                    const size_t ind{ refreshedCascades[j] };
+                    light.mLightMatrices[ind] = lightProjections[j] * lightViews[j];
+                    if (useCache) {
+                        mCachedLightMatrices[ind] = light.mLightMatrices[ind];
+                        mCachedFrustumCenters[ind] = frustumCenters[ind];
+                        mCascadeAges[ind] = 0;
+                    }
+                }
+
+                DrawDirectionalShadowCasters(light, refreshMask, modelMatrices, meshes);
+
+                if (useCache) {
+                    for (int i = mFirstCachedCascade; i <= NumCascades; ++i) {
+                        if ((refreshMask & (1u << i)) != 0) {
+                            CopyCascade(mDirLightDepthMap, mDirLightStaticDepthMap, i);
                         }
-                        else if (i == NumCascades) {
-                            return camera.GetFrustumCornersInWorldSpace(light.mCascadeRanges.back() - light.mZOffset, camera.GetFar() + light.mZOffset);
+                        else {
+                            CopyCascade(mDirLightStaticDepthMap, mDirLightDepthMap, i);
                         }
-                        size_t ind{ static_cast<size_t>(i) };
-                        return camera.GetFrustumCornersInWorldSpace(light.mCascadeRanges[ind - 1] - light.mZOffset, light.mCascadeRanges[ind] + light.mZOffset);
-                    }();
-                    glm::vec3 frustumCenter{ Utility::ComputeFrustumCenter(frustumCorners) };
-                    glm::mat4 lightView{ glm::lookAt(frustumCenter + -light.mDirection, frustumCenter, glm::cross(-light.mDirection, glm::vec3(1.0f, 0.0f, 0.0f))) };
-                    glm::mat4 lightProjection{ Utility::FitLightProjectionToFrustum(lightView, frustumCorners, light.mZMultiplier) };
-                    light.mLightMatrices[static_cast<size_t>(i)] = lightProjection * lightView;
-                }
-                for (size_t i = 0; i < meshes.size(); ++i) {
-                    const glm::mat4& modelMatrix{ modelMatrices.size() == meshes.size() ? modelMatrices[i] : modelMatrices[modelMatrices.size() - 1] };
-                    mDepthProgram.SetModelMatrix(modelMatrix);
-
-                    for (int j = 0; j <= NumCascades; ++j) {
-                        mDirLightDepthFBOs[static_cast<size_t>(j)].Bind();
-                        glViewport(0, 0, mDirLightDepthMap.GetWidth(), mDirLightDepthMap.GetHeight());
-                        mDepthProgram.SetLightMatrix(light.mLightMatrices[static_cast<size_t>(j)]);
-                        meshes[i].get().Bind();
-                        meshes[i].get().Draw();
                     }
+                    mCachedLightDirection = light.mDirection;
+                    mDirShadowCacheValid = true;
+                    isCacheUsed = true;
                 }
+
+                DrawDirectionalShadowCasters(light, ALL_CASCADES_MASK, dynamicModelMatrices, dynamicMeshes);
             }
             mDirLightBlock.Set(lightIndex, camera.GetViewMatrix(), light);
             ++lightIndex;
@@ -2738,47 +4811,115 @@ namespace Poe
 
     ////////////////////////////////////////
     template <int NumCascades>
-    void LightingStack<NumCascades>::OmnidirectionalShadowPrepass(const std::vector<std::reference_wrapper<const PointLight>>& lights,
-                                                                  const std::vector<std::reference_wrapper<const glm::mat4>>& modelMatrices,
-                                                                  const std::vector<std::reference_wrapper<const StaticMesh>>& meshes)
+    void LightingStack<NumCascades>::DrawOmnidirectionalShadowCasters(const PointLight& light,
+                                                                      const glm::mat4 (&lightMatrices)[6],
+                                                                      const ModelMatrixList& modelMatrices,
+                                                                      const MeshList& meshes)
     {
+        if (meshes.empty()) {
+            return;
+        }
+
+        if (mLayeredShadows) {
+            mPointLightLayeredFBO.Bind();
+            mDepthOmniProgramLayered.SetLightPositionInWorldSpace(light.mWorldPosition);
+            mDepthOmniProgramLayered.SetFarPlane(light.mFarPlane);
+            mDepthOmniProgramLayered.SetLightMatrices(lightMatrices);
+            mDepthOmniProgramLayered.SetLayerMask(0x3fu);
+
+            for (size_t j = 0; j < meshes.size(); ++j) {
+                const glm::mat4& modelMatrix{ modelMatrices.size() == meshes.size() ? modelMatrices[j] : modelMatrices[modelMatrices.size() - 1] };
+                mDepthOmniProgramLayered.SetModelMatrix(modelMatrix);
+                mDepthOmniProgramLayered.DrawLayered(meshes[j].get());
+            }
+            return;
+        }
+
         mPointLightDepthFBO.Bind();
+        mDepthOmniProgram.SetLightPositionInWorldSpace(light.mWorldPosition);
+        mDepthOmniProgram.SetFarPlane(light.mFarPlane);
+
         for (unsigned i = 0; i < 6; ++i) {
             mPointLightDepthFBO.BindTarget(GL_DEPTH_ATTACHMENT, mPointLightDepthMap, i);
+            mDepthOmniProgram.SetLightMatrix(lightMatrices[i]);
+
+            for (size_t j = 0; j < meshes.size(); ++j) {
+                const glm::mat4& modelMatrix{ modelMatrices.size() == meshes.size() ? modelMatrices[j] : modelMatrices[modelMatrices.size() - 1] };
+                mDepthOmniProgram.SetModelMatrix(modelMatrix);
+                meshes[j].get().BindPositions();
+                meshes[j].get().Draw();
+            }
+        }
+    }
+
+    ////////////////////////////////////////
+    template <int NumCascades>
+    void LightingStack<NumCascades>::OmnidirectionalShadowPrepass(const std::vector<std::reference_wrapper<const PointLight>>& lights,
+                                                                  const ModelMatrixList& modelMatrices,
+                                                                  const MeshList& meshes,
+                                                                  const ModelMatrixList& dynamicModelMatrices,
+                                                                  const MeshList& dynamicMeshes)
+    {
+        ProfileScope scope("Point Shadows");
+        if (mLayeredShadows) {
+            mPointLightLayeredFBO.Bind();
             glViewport(0, 0, mPointLightDepthMap.GetWidth(), mPointLightDepthMap.GetHeight());
             glClear(GL_DEPTH_BUFFER_BIT);
+            mDepthOmniProgramLayered.Use();
+        }
+        else {
+            mPointLightDepthFBO.Bind();
+            for (unsigned i = 0; i < 6; ++i) {
+                mPointLightDepthFBO.BindTarget(GL_DEPTH_ATTACHMENT, mPointLightDepthMap, i);
+                glViewport(0, 0, mPointLightDepthMap.GetWidth(), mPointLightDepthMap.GetHeight());
+                glClear(GL_DEPTH_BUFFER_BIT);
+            }
+            mDepthOmniProgram.Use();
         }
 
-        mDepthOmniProgram.Use();
+        if (!mShadowCaching) {
+            mPointShadowCacheValid = false;
+        }
 
         int lightIndex{};
+        bool isCacheUsed{};
         for (const PointLight& light : lights) {
             if (light.mCastShadows) {
+                ProfileScope lightScope("Light", lightIndex);
                 glm::mat4 perspectiveProjection{ glm::perspective(glm::radians(90.0f),
                                                                   static_cast<float>(mPointLightDepthMap.GetWidth()) / static_cast<float>(mPointLightDepthMap.GetHeight()),
                                                                   light.mNearPlane, light.mFarPlane) };
-                glm::mat4 lightMatrices[]{ glm::lookAt(light.mWorldPosition, light.mWorldPosition + glm::vec3( 1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-                                           glm::lookAt(light.mWorldPosition, light.mWorldPosition + glm::vec3(-1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-                                           glm::lookAt(light.mWorldPosition, light.mWorldPosition + glm::vec3( 0.0f,  1.0f,  0.0f), glm::vec3(0.0f,  0.0f,  1.0f)),
-                                           glm::lookAt(light.mWorldPosition, light.mWorldPosition + glm::vec3( 0.0f, -1.0f,  0.0f), glm::vec3(0.0f,  0.0f, -1.0f)),
-                                           glm::lookAt(light.mWorldPosition, light.mWorldPosition + glm::vec3( 0.0f,  0.0f,  1.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-                                           glm::lookAt(light.mWorldPosition, light.mWorldPosition + glm::vec3( 0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f)) };
-
-                mDepthOmniProgram.SetLightPositionInWorldSpace(light.mWorldPosition);
-                mDepthOmniProgram.SetFarPlane(light.mFarPlane);
-
-                for (unsigned i = 0; i < 6; ++i) {
-                    glm::mat4 lightMatrix{ perspectiveProjection * lightMatrices[i] };
-                    mPointLightDepthFBO.BindTarget(GL_DEPTH_ATTACHMENT, mPointLightDepthMap, i);
-                    mDepthOmniProgram.SetLightMatrix(lightMatrix);
-
-                    for (size_t j = 0; j < meshes.size(); ++j) {
-                        const glm::mat4& modelMatrix{ modelMatrices.size() == meshes.size() ? modelMatrices[j] : modelMatrices[modelMatrices.size() - 1] };
-                        mDepthOmniProgram.SetModelMatrix(modelMatrix);
-                        meshes[j].get().Bind();
-                        meshes[j].get().Draw();
+                glm::mat4 lightMatrices[]{ perspectiveProjection * glm::lookAt(light.mWorldPosition, light.mWorldPosition + glm::vec3( 1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
+                                           perspectiveProjection * glm::lookAt(light.mWorldPosition, light.mWorldPosition + glm::vec3(-1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
+                                           perspectiveProjection * glm::lookAt(light.mWorldPosition, light.mWorldPosition + glm::vec3( 0.0f,  1.0f,  0.0f), glm::vec3(0.0f,  0.0f,  1.0f)),
+                                           perspectiveProjection * glm::lookAt(light.mWorldPosition, light.mWorldPosition + glm::vec3( 0.0f, -1.0f,  0.0f), glm::vec3(0.0f,  0.0f, -1.0f)),
+                                           perspectiveProjection * glm::lookAt(light.mWorldPosition, light.mWorldPosition + glm::vec3( 0.0f,  0.0f,  1.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
+                                           perspectiveProjection * glm::lookAt(light.mWorldPosition, light.mWorldPosition + glm::vec3( 0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f)) };
+
+                // a stationary light reuses the depth of the static casters
+                bool useCache{ mShadowCaching && !isCacheUsed };
+                bool isCached{ useCache &&
+                               mPointShadowCacheValid &&
+                               glm::distance(mCachedPointLightPosition, light.mWorldPosition) < 0.0001f &&
+                               glm::abs(mCachedPointLightNearPlane - light.mNearPlane) < 0.0001f &&
+                               glm::abs(mCachedPointLightFarPlane - light.mFarPlane) < 0.0001f };
+
+                if (isCached) {
+                    CopyCubemap(mPointLightStaticDepthMap, mPointLightDepthMap);
+                }
+                else {
+                    DrawOmnidirectionalShadowCasters(light, lightMatrices, modelMatrices, meshes);
+                    if (useCache) {
+                        CopyCubemap(mPointLightDepthMap, mPointLightStaticDepthMap);
+                        mCachedPointLightPosition = light.mWorldPosition;
+                        mCachedPointLightNearPlane = light.mNearPlane;
+                        mCachedPointLightFarPlane = light.mFarPlane;
+                        mPointShadowCacheValid = true;
                     }
                 }
+                isCacheUsed = isCacheUsed || useCache;
+
+                DrawOmnidirectionalShadowCasters(light, lightMatrices, dynamicModelMatrices, dynamicMeshes);
             }
             mPointLightBlock.Set(lightIndex, light);
             ++lightIndex;
@@ -2789,9 +4930,10 @@ namespace Poe
     ////////////////////////////////////////
     template <int NumCascades>
     void LightingStack<NumCascades>::PerspectiveShadowPrepass(const std::vector<std::reference_wrapper<const SpotLight>>& lights,
-                                                              const std::vector<std::reference_wrapper<const glm::mat4>>& modelMatrices,
-                                                              const std::vector<std::reference_wrapper<const StaticMesh>>& meshes)
+                                                              const ModelMatrixList& modelMatrices,
+                                                              const MeshList& meshes)
     {
+        ProfileScope scope("Spot Shadows");
         mSpotLightDepthFBO.Bind();
         glViewport(0, 0, mSpotLightDepthMap.GetWidth(), mSpotLightDepthMap.GetHeight());
         glClear(GL_DEPTH_BUFFER_BIT);
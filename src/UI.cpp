@@ -23,6 +23,19 @@ namespace Poe
     bool DebugUI::mEnableSkybox{true};
     bool DebugUI::mEnableGrid{true};
     bool DebugUI::mEnableVsync{true};
-    std::vector<std::string> DebugUI::mCoutLogs{};
-    std::vector<std::string> DebugUI::mCerrLogs{};
+    bool DebugUI::mEnableFrustumCulling{true};
+    bool DebugUI::mEnableLayeredShadows{true};
+    bool DebugUI::mEnableShadowCaching{true};
+    bool DebugUI::mEnableDeferredShading{false};
+    bool DebugUI::mEnableDepthPrepass{false};
+    bool DebugUI::mEnableComputePostProcess{true};
+    bool DebugUI::mEnableDynamicResolution{false};
+    bool DebugUI::mEnableRenderQueue{true};
+    bool DebugUI::mEnableAmbientOcclusion{false};
+    bool DebugUI::mEnableTransparency{true};
+    bool DebugUI::mEnableClusteredLights{false};
+    LogQueue DebugUI::mLogQueue{};
+    LogHistory<DebugUI::MAX_COUT_LOGS> DebugUI::mCoutLogs{};
+    LogHistory<DebugUI::MAX_CERR_LOGS> DebugUI::mCerrLogs{};
+    const std::chrono::steady_clock::time_point DebugUI::mLogEpoch{ std::chrono::steady_clock::now() };
 }
@@ -34,6 +34,10 @@ ENABLE_WARNINGS()
 
 #include <cstdio>
 #include <cstdarg>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <vector>
 #include <string>
 
@@ -47,6 +51,122 @@ namespace Poe
     struct DirLight;
     struct PbrLightMaterial;
 
+    ////////////////////////////////////////
+    enum class LogSeverity
+    {
+        Info,
+        Error
+    };
+
+    ////////////////////////////////////////
+    struct LogRecord
+    {
+        static constexpr size_t MAX_LENGTH{ 512 };
+
+        double mTimestamp; // seconds since the first log
+        LogSeverity mSeverity;
+        char mText[MAX_LENGTH]; // without the trailing newline
+    };
+
+    ////////////////////////////////////////
+    // bounded lock-free multi-producer single-consumer queue,
+    // each slot's sequence number tells whether it's free, claimed or published
+    struct LogQueue
+    {
+        static constexpr size_t CAPACITY{ 256 };
+        static_assert((CAPACITY & (CAPACITY - 1)) == 0, "CAPACITY must be a power of two");
+
+        LogQueue()
+        {
+            for (size_t i{}; i < CAPACITY; ++i) {
+                mSlots[i].mSequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        LogQueue(const LogQueue&) = delete;
+        LogQueue& operator=(const LogQueue&) = delete;
+
+        // safe to call from any thread, write only runs once a slot is claimed
+        // so messages are formatted in place and never when the queue is full
+        template <typename WriteFunc>
+        bool Push(WriteFunc&& write)
+        {
+            size_t pos{ mHead.load(std::memory_order_relaxed) };
+            for (;;) {
+                Slot& slot{ mSlots[pos & (CAPACITY - 1)] };
+                const size_t sequence{ slot.mSequence.load(std::memory_order_acquire) };
+                if (sequence == pos) {
+                    if (mHead.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        write(slot.mRecord);
+                        slot.mSequence.store(pos + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (sequence < pos) {
+                    mNumDropped.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+                else {
+                    pos = mHead.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // only one thread may drain at a time, stops at the first unpublished slot
+        template <typename ReadFunc>
+        void Drain(ReadFunc&& read)
+        {
+            for (;;) {
+                Slot& slot{ mSlots[mTail & (CAPACITY - 1)] };
+                if (slot.mSequence.load(std::memory_order_acquire) != mTail + 1) {
+                    break;
+                }
+                read(static_cast<const LogRecord&>(slot.mRecord));
+                slot.mSequence.store(mTail + CAPACITY, std::memory_order_release);
+                ++mTail;
+            }
+        }
+
+        unsigned GetNumDropped() const { return mNumDropped.load(std::memory_order_relaxed); }
+
+    private:
+        struct Slot
+        {
+            std::atomic<size_t> mSequence;
+            LogRecord mRecord;
+        };
+
+        std::array<Slot, CAPACITY> mSlots;
+        alignas(64) std::atomic<size_t> mHead{};
+        alignas(64) size_t mTail{};
+        std::atomic<unsigned> mNumDropped{};
+    };
+
+    ////////////////////////////////////////
+    // fixed-capacity history owned by the consumer, overwrites the oldest record
+    template <size_t Capacity>
+    struct LogHistory
+    {
+        void Push(const LogRecord& record)
+        {
+            mRecords[(mFirst + mSize) % Capacity] = record;
+            if (mSize < Capacity) {
+                ++mSize;
+            }
+            else {
+                mFirst = (mFirst + 1) % Capacity;
+            }
+        }
+
+        const LogRecord& operator[](size_t index) const { return mRecords[(mFirst + index) % Capacity]; }
+        size_t GetSize() const { return mSize; }
+        void Clear() { mFirst = mSize = 0; }
+
+    private:
+        std::array<LogRecord, Capacity> mRecords;
+        size_t mFirst{}, mSize{};
+    };
+
     ////////////////////////////////////////
     struct DebugUI
     {
@@ -110,6 +230,17 @@ namespace Poe
         static bool mEnableSkybox;
         static bool mEnableGrid;
         static bool mEnableVsync;
+        static bool mEnableFrustumCulling;
+        static bool mEnableLayeredShadows;
+        static bool mEnableShadowCaching;
+        static bool mEnableDeferredShading;
+        static bool mEnableDepthPrepass;
+        static bool mEnableComputePostProcess;
+        static bool mEnableDynamicResolution;
+        static bool mEnableRenderQueue;
+        static bool mEnableAmbientOcclusion;
+        static bool mEnableTransparency;
+        static bool mEnableClusteredLights;
 
         static void Draw_GlobalInfo_General()
         {
@@ -119,12 +250,54 @@ namespace Poe
             ImGui::Checkbox("Enable Skybox", &mEnableSkybox);
             ImGui::Checkbox("Enable Grid", &mEnableGrid);
             ImGui::Checkbox("Enable Vsync", &mEnableVsync);
+            ImGui::Checkbox("Enable Frustum Culling", &mEnableFrustumCulling);
+            ImGui::Checkbox("Enable Layered Shadows", &mEnableLayeredShadows);
+            ImGui::Checkbox("Enable Shadow Caching", &mEnableShadowCaching);
+            ImGui::Checkbox("Enable Deferred Shading", &mEnableDeferredShading);
+            ImGui::Checkbox("Enable Depth Prepass", &mEnableDepthPrepass);
+            ImGui::Checkbox("Enable Compute Post-Process", &mEnableComputePostProcess);
+            ImGui::Checkbox("Enable Render Queue", &mEnableRenderQueue);
+            ImGui::Checkbox("Enable Transparency", &mEnableTransparency);
+            ImGui::Checkbox("Enable Clustered Lights", &mEnableClusteredLights);
             static float clearColor[]{ 0.01f, 0.01f, 0.01f };
             ImGui::ColorEdit3("Clear Color", clearColor);
             glClearColor(clearColor[0], clearColor[1], clearColor[2], 1.0f);
             ImGui::NewLine();
         }
 
+        static void Draw_GlobalInfo_Profiler()
+        {
+            ImGui::TextColored({ HEADER_COLOR.r, HEADER_COLOR.g, HEADER_COLOR.b, HEADER_COLOR.a }, "[Profiler]");
+            if (ImGui::BeginTable("Profiler", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp)) {
+                ImGui::TableSetupColumn("Scope");
+                ImGui::TableSetupColumn("GPU MS");
+                ImGui::TableSetupColumn("GPU P95");
+                ImGui::TableSetupColumn("CPU MS");
+                ImGui::TableSetupColumn("CPU P95");
+                ImGui::TableHeadersRow();
+
+                for (size_t ind : Profiler::GetFrameScopes()) {
+                    const Profiler::ScopeStats& stats{ Profiler::GetScopeStats(ind) };
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%*s%s", 2 * stats.mDepth, "", stats.mName.c_str());
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.3f", stats.GetGpuAverage());
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.3f", stats.GetGpuPercentile(95.0f));
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.3f", stats.GetCpuAverage());
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.3f", stats.GetCpuPercentile(95.0f));
+                }
+                ImGui::EndTable();
+            }
+            if (ImGui::Button("Reset Profiler")) {
+                Profiler::Reset();
+            }
+            ImGui::NewLine();
+        }
+
         static void Draw_GlobalInfo_Camera(FirstPersonCamera& camera)
         {
             ImGui::TextColored({ HEADER_COLOR.r, HEADER_COLOR.g, HEADER_COLOR.b, HEADER_COLOR.a }, "[Camera]");
@@ -186,6 +359,58 @@ namespace Poe
             block.Update();
         }
 
+        static void Draw_GlobalInfo_PostProcessChain(PostProcessChain& chain)
+        {
+            ImGui::TextColored({ HEADER_COLOR.r, HEADER_COLOR.g, HEADER_COLOR.b, HEADER_COLOR.a }, "[Post-Process Chain]");
+
+            PostProcessChainConfig& config{ chain.GetConfig() };
+            ImGui::Checkbox("Enable Bloom", &config.mEnableBloom);
+            ImGui::SliderInt("Bloom Levels", &config.mNumBloomLevels, 1, PostProcessChain::MAX_BLOOM_LEVELS);
+            ImGui::SliderFloat("Bloom Threshold", &config.mBloomThreshold, 0.0f, 10.0f);
+            ImGui::SliderFloat("Bloom Knee", &config.mBloomKnee, 0.0f, 5.0f);
+            ImGui::SliderFloat("Bloom Intensity", &config.mBloomIntensity, 0.0f, 1.0f);
+            ImGui::SliderFloat("Bloom Radius", &config.mBloomRadius, 0.5f, 4.0f);
+
+            const TexturePool& pool{ chain.GetPool() };
+            ImGui::Text("Pooled Textures: %d (%d in use)", pool.GetNumTextures(), pool.GetNumTexturesInUse());
+            ImGui::NewLine();
+        }
+
+        static void Draw_GlobalInfo_DynamicResolution(DynamicResolution& controller, const PostProcessStack& stack)
+        {
+            ImGui::TextColored({ HEADER_COLOR.r, HEADER_COLOR.g, HEADER_COLOR.b, HEADER_COLOR.a }, "[Dynamic Resolution]");
+            ImGui::Checkbox("Enable Dynamic Resolution", &mEnableDynamicResolution);
+
+            static int currentTarget{};
+            static const char* targetNames[]{ "60 Hz", "120 Hz", "30 Hz" };
+            static constexpr float targetRates[]{ 60.0f, 120.0f, 30.0f };
+            if (ImGui::Combo("Target", &currentTarget, targetNames, sizeof(targetNames) / sizeof(char*))) {
+                controller.mTargetFrameTime = 1000.0f / targetRates[currentTarget];
+            }
+
+            ImGui::SliderFloat("Min Scale", &controller.mMinScale, PostProcessStack::MIN_RENDER_SCALE, 1.0f);
+            ImGui::SliderFloat("Max Scale", &controller.mMaxScale, PostProcessStack::MIN_RENDER_SCALE, 1.0f);
+            controller.mMaxScale = glm::max(controller.mMaxScale, controller.mMinScale);
+
+            ImGui::Text("GPU: %.2f MS, Scale: %.2f (%dx%d)", controller.GetFrameTime(), stack.GetRenderScale(),
+                        stack.GetRenderWidth(), stack.GetRenderHeight());
+            ImGui::NewLine();
+        }
+
+        static void Draw_GlobalInfo_AmbientOcclusion(AmbientOcclusionStack& stack)
+        {
+            ImGui::TextColored({ HEADER_COLOR.r, HEADER_COLOR.g, HEADER_COLOR.b, HEADER_COLOR.a }, "[Ambient Occlusion]");
+            ImGui::Checkbox("Enable SSAO", &mEnableAmbientOcclusion);
+
+            AmbientOcclusionConfig& config{ stack.GetConfig() };
+            ImGui::SliderFloat("AO Radius", &config.mRadius, 0.1f, 10.0f);
+            ImGui::SliderFloat("AO Intensity", &config.mIntensity, 0.0f, 4.0f);
+            ImGui::SliderFloat("AO Bias", &config.mBias, 0.0f, 0.2f);
+            ImGui::SliderFloat("AO Sharpness", &config.mSharpness, 0.0f, 32.0f);
+            ImGui::SliderInt("AO Samples", &config.mNumSamples, 1, AmbientOcclusionStack::MAX_SAMPLES);
+            ImGui::NewLine();
+        }
+
         static void Draw_GlobalInfo_Fog(FogUB& fogBlock)
         {
             ImGui::TextColored({ HEADER_COLOR.r, HEADER_COLOR.g, HEADER_COLOR.b, HEADER_COLOR.a }, "[Fog Settings]");
@@ -220,58 +445,83 @@ namespace Poe
 
         static constexpr float BG_ALPHA{ 0.8f };
 
-        static std::vector<std::string> mCoutLogs;
-        static std::vector<std::string> mCerrLogs;
+        static LogQueue mLogQueue;
+        static LogHistory<MAX_COUT_LOGS> mCoutLogs;
+        static LogHistory<MAX_CERR_LOGS> mCerrLogs;
+        static const std::chrono::steady_clock::time_point mLogEpoch;
 
+        // thread-safe, formats straight into a queue slot without allocating
         static void PushLog(FILE* file, const char* format, ...)
         {
-            if ((file == stdout && mCoutLogs.size() > MAX_COUT_LOGS) ||
-                (file == stderr && mCerrLogs.size() > MAX_CERR_LOGS)) {
-                return;
-            }
-
             std::va_list args;
             va_start(args, format);
-#define BUFFER_MAX 1024
-            char buffer[BUFFER_MAX];
-            std::vsnprintf(buffer, BUFFER_MAX, format, args);
+            mLogQueue.Push([&](LogRecord& record){
+                record.mTimestamp = std::chrono::duration<double>(std::chrono::steady_clock::now() - mLogEpoch).count();
+                record.mSeverity = file == stderr ? LogSeverity::Error : LogSeverity::Info;
+                const int length{ std::vsnprintf(record.mText, LogRecord::MAX_LENGTH, format, args) };
+                size_t end{ length < 0 ? 0 : std::min(static_cast<size_t>(length), LogRecord::MAX_LENGTH - 1) };
+                while (end > 0 && record.mText[end - 1] == '\n') {
+                    --end;
+                }
+                record.mText[end] = '\0';
+            });
             va_end(args);
-            if (file == stdout) {
-                mCoutLogs.push_back(buffer);
-            }
-            else if (file == stderr) {
-                mCerrLogs.push_back(buffer);
+        }
+
+        // hands every published record to func, call from one thread only
+        template <typename Func>
+        static void DrainLogs(Func&& func)
+        {
+            mLogQueue.Drain(func);
+        }
+
+        template <size_t Capacity>
+        static void Render_LogHistory(const char* name, const LogHistory<Capacity>& history)
+        {
+            ImGui::BeginChild(name, { -1, 400 }, false, ImGuiWindowFlags_HorizontalScrollbar);
+            ImGuiListClipper clipper;
+            clipper.Begin(static_cast<int>(history.GetSize()));
+            while (clipper.Step()) {
+                for (int i{ clipper.DisplayStart }; i < clipper.DisplayEnd; ++i) {
+                    const LogRecord& record{ history[static_cast<size_t>(i)] };
+                    ImGui::Text("[%8.3f] %s", record.mTimestamp, record.mText);
+                }
             }
+            ImGui::EndChild();
         }
 
         static void Render_LogInfo(int width, int height)
         {
+            DrainLogs([](const LogRecord& record){
+                if (record.mSeverity == LogSeverity::Error) {
+                    mCerrLogs.Push(record);
+                }
+                else {
+                    mCoutLogs.Push(record);
+                }
+            });
+
             constexpr int coutWidth{ 400 }, cerrWidth{ 600 };
             ImGui::SetNextWindowBgAlpha(BG_ALPHA);
 
-            if (mCoutLogs.size() > 0) {
+            if (mCoutLogs.GetSize() > 0) {
                 ImGui::SetNextWindowSize({ coutWidth, -1 });
                 ImGui::SetNextWindowPos({ static_cast<float>(width - coutWidth - 20), 60.0f });
 
                 ImGui::Begin("Info Logs", nullptr, ImGuiWindowFlags_HorizontalScrollbar | ImGuiWindowFlags_NoResize);
-                ImGui::BeginChild("stdout logs", { -1, 400 });
-                for (size_t i = 0; i < MAX_COUT_LOGS && i < mCoutLogs.size(); ++i) {
-                    ImGui::TextWrapped("%s", mCoutLogs[i].c_str());
-                }
-                ImGui::EndChild();
+                Render_LogHistory("stdout logs", mCoutLogs);
                 ImGui::End();
             }
 
-            if (mCerrLogs.size() > 0) {
+            if (mCerrLogs.GetSize() > 0 || mLogQueue.GetNumDropped() > 0) {
                 ImGui::SetNextWindowSize({ cerrWidth, -1 });
                 ImGui::SetNextWindowPos({ static_cast<float>(width / 2 - cerrWidth / 2), 20.0f });
 
                 ImGui::Begin("Error Logs", nullptr, ImGuiWindowFlags_HorizontalScrollbar | ImGuiWindowFlags_NoResize);
-                ImGui::BeginChild("stderr logs", { -1, 400 });
-                for (size_t i = 0; i < MAX_CERR_LOGS && i < mCerrLogs.size(); ++i) {
-                    ImGui::TextWrapped("%s", mCerrLogs[i].c_str());
+                if (mLogQueue.GetNumDropped() > 0) {
+                    ImGui::Text("%u logs dropped, queue was full", mLogQueue.GetNumDropped());
                 }
-                ImGui::EndChild();
+                Render_LogHistory("stderr logs", mCerrLogs);
                 ImGui::End();
             }
         }
@@ -480,6 +730,11 @@ namespace Poe
                 ImGui::Text("VBO: Total %d MB, Largest %d MB, Total Aux %d MB, Largest Aux %d MB | Texture: Total %d MB, Largest: %d MB, Total Aux: %d MB, Largest Aux: %d MB | Renderbuffer: Total %d MB, Largest: %d mb, Total Aux: %d MB, Largest Aux: %d MB", vboMemory[0] / 1000, vboMemory[1] / 1000, vboMemory[2] / 1000, vboMemory[3] / 1000, textureMemory[0] / 1000, textureMemory[1] / 1000, textureMemory[2] / 1000, textureMemory[3] / 1000, renderbufferMemory[0] / 1000, renderbufferMemory[1] / 1000, renderbufferMemory[2] / 1000, renderbufferMemory[3] / 1000);
             }
             ImGui::Text("# Draw Calls: %d | # Instanced Draw Calls: %d | # VAO Binds: %d | # Texture Binds: %d", RuntimeStats::NumDrawCalls, RuntimeStats::NumInstancedDrawCalls, RuntimeStats::NumVAOBinds, RuntimeStats::NumTextureBinds);
+            ImGui::Text("# Saved Program Binds: %d | # Saved VAO Binds: %d | # Saved Texture Binds: %d", RuntimeStats::NumSavedProgramBinds, RuntimeStats::NumSavedVAOBinds, RuntimeStats::NumSavedTextureBinds);
+#ifdef POE_COUNT_ALLOCATIONS
+            ImGui::Text("# Heap Allocations: %d", RuntimeStats::GetNumAllocations());
+#endif
+            ImGui::Text("# Visible Meshes: %d | # Culled Meshes: %d | # Visible Shadow Casters: %d | # Culled Shadow Casters: %d", RuntimeStats::NumVisibleMeshes, RuntimeStats::NumCulledMeshes, RuntimeStats::NumVisibleShadowCasters, RuntimeStats::NumCulledShadowCasters);
 
             ImGui::End();
         }
@@ -18,6 +18,10 @@
 
 #include <GLFW/glfw3.h>
 
+#include <algorithm>
+#include <numeric>
+#include <unordered_map>
+
 namespace Poe::Utility
 {
     ////////////////////////////////////////
@@ -31,43 +35,326 @@ namespace Poe::Utility
     }
 
     ////////////////////////////////////////
-    glm::mat4 FitLightProjectionToFrustum(const glm::mat4& lightView,
-                                          const std::vector<glm::vec4>& frustumCorners,
-                                          float zMult)
+    thread_local const JobSystem* JobSystem::sCurrentSystem{ nullptr };
+    thread_local int JobSystem::sWorkerIndex{ -1 };
+
+    ////////////////////////////////////////
+    JobSystem::JobSystem(int numWorkers)
+        : mNumWorkers{std::max(numWorkers, 0)},
+          mNumQueued{0},
+          mNextQueue{0},
+          mStopWorkers{false}
+    {
+        for (int i = 0; i < mNumWorkers; ++i) {
+            mQueues.push_back(std::make_unique<WorkerQueue>());
+        }
+        for (int i = 0; i < mNumWorkers; ++i) {
+            mWorkers.emplace_back(&JobSystem::RunWorker, this, i);
+        }
+    }
+
+    ////////////////////////////////////////
+    JobSystem::~JobSystem()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mSleepMutex);
+            mStopWorkers = true;
+        }
+        mJobAvailable.notify_all();
+        for (std::thread& worker : mWorkers) {
+            worker.join();
+        }
+    }
+
+    ////////////////////////////////////////
+    JobSystem& JobSystem::Get()
+    {
+        static JobSystem jobSystem;
+        return jobSystem;
+    }
+
+    ////////////////////////////////////////
+    void JobSystem::Schedule(JobCounter& counter, JobFunc func)
+    {
+        if (mNumWorkers == 0) {
+            func();
+            return;
+        }
+
+        counter.mNumPending.fetch_add(1, std::memory_order_relaxed);
+        const int index{ GetThreadIndex() < mNumWorkers ? GetThreadIndex()
+                                                        : static_cast<int>(mNextQueue.fetch_add(1, std::memory_order_relaxed) % static_cast<unsigned>(mNumWorkers)) };
+        WorkerQueue& queue{ *mQueues[static_cast<size_t>(index)] };
+        {
+            std::lock_guard<std::mutex> lock(queue.mMutex);
+            queue.mJobs.push_back({ func, &counter });
+        }
+        {
+            // under the lock so a worker can't miss it between its check and its wait
+            std::lock_guard<std::mutex> lock(mSleepMutex);
+            mNumQueued.fetch_add(1, std::memory_order_relaxed);
+        }
+        mJobAvailable.notify_one();
+    }
+
+    ////////////////////////////////////////
+    bool JobSystem::TryPop(int index, Job& job)
+    {
+        for (int i = 0; i < mNumWorkers; ++i) {
+            const int victim{ (index + i) % mNumWorkers };
+            WorkerQueue& queue{ *mQueues[static_cast<size_t>(victim)] };
+            std::lock_guard<std::mutex> lock(queue.mMutex);
+            if (queue.mJobs.empty()) {
+                continue;
+            }
+            // the own queue is used like a stack for locality, stolen jobs are the oldest
+            if (victim == index) {
+                job = std::move(queue.mJobs.back());
+                queue.mJobs.pop_back();
+            }
+            else {
+                job = std::move(queue.mJobs.front());
+                queue.mJobs.pop_front();
+            }
+            mNumQueued.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    ////////////////////////////////////////
+    void JobSystem::Execute(Job& job)
+    {
+        job.mFunc();
+        job.mCounter->mNumPending.fetch_sub(1, std::memory_order_release);
+    }
+
+    ////////////////////////////////////////
+    void JobSystem::RunWorker(int index)
+    {
+        sCurrentSystem = this;
+        sWorkerIndex = index;
+        for (;;) {
+            Job job;
+            if (TryPop(index, job)) {
+                Execute(job);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(mSleepMutex);
+            mJobAvailable.wait(lock, [this]{ return mStopWorkers || mNumQueued.load(std::memory_order_relaxed) > 0; });
+            if (mStopWorkers) {
+                return;
+            }
+        }
+    }
+
+    ////////////////////////////////////////
+    void JobSystem::Wait(JobCounter& counter)
+    {
+        // other threads steal from every queue's front
+        const int index{ GetThreadIndex() };
+        while (counter.mNumPending.load(std::memory_order_acquire) > 0) {
+            Job job;
+            if (TryPop(index, job)) {
+                Execute(job);
+            }
+            else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    ////////////////////////////////////////
+    void FitLightProjectionsToFrusta(const glm::mat4* lightViews, const FrustumCorners* frusta, size_t numFrusta,
+                                     float zMult, glm::mat4* projections)
     {
-        float minX = std::numeric_limits<float>::max();
-        float maxX = std::numeric_limits<float>::lowest();
-        float minY = std::numeric_limits<float>::max();
-        float maxY = std::numeric_limits<float>::lowest();
-        float minZ = std::numeric_limits<float>::max();
-        float maxZ = std::numeric_limits<float>::lowest();
+        constexpr size_t NUM_CORNERS{ std::tuple_size_v<FrustumCorners> };
+        for (size_t i = 0; i < numFrusta; ++i) {
+            const glm::mat4& m{ lightViews[i] };
+            const FrustumCorners& corners{ frusta[i] };
 
-        for (const glm::vec4& corner : frustumCorners) {
-            glm::vec4 p{ lightView * corner };
+            std::array<float, NUM_CORNERS> xs, ys, zs;
+            for (size_t j = 0; j < NUM_CORNERS; ++j) {
+                const glm::vec4& c{ corners[j] };
+                xs[j] = m[0][0] * c.x + m[1][0] * c.y + m[2][0] * c.z + m[3][0] * c.w;
+                ys[j] = m[0][1] * c.x + m[1][1] * c.y + m[2][1] * c.z + m[3][1] * c.w;
+                zs[j] = m[0][2] * c.x + m[1][2] * c.y + m[2][2] * c.z + m[3][2] * c.w;
+            }
 
-            minX = std::min(minX, p.x);
-            maxX = std::max(maxX, p.x);
-            minY = std::min(minY, p.y);
-            maxY = std::max(maxY, p.y);
-            minZ = std::min(minZ, p.z);
-            maxZ = std::max(maxZ, p.z);
+            float minX{ xs[0] }, maxX{ xs[0] };
+            float minY{ ys[0] }, maxY{ ys[0] };
+            float minZ{ zs[0] }, maxZ{ zs[0] };
+            for (size_t j = 1; j < NUM_CORNERS; ++j) {
+                minX = std::min(minX, xs[j]);
+                maxX = std::max(maxX, xs[j]);
+                minY = std::min(minY, ys[j]);
+                maxY = std::max(maxY, ys[j]);
+                minZ = std::min(minZ, zs[j]);
+                maxZ = std::max(maxZ, zs[j]);
+            }
+
+            minZ = minZ < 0.0f ? minZ * zMult : minZ / zMult;
+            maxZ = maxZ < 0.0f ? maxZ / zMult : maxZ * zMult;
+
+            projections[i] = glm::ortho(minX, maxX, minY, maxY, minZ, maxZ);
+        }
+    }
+
+    ////////////////////////////////////////
+    glm::mat4 FitLightProjectionToFrustum(const glm::mat4& lightView, const FrustumCorners& frustumCorners, float zMult)
+    {
+        glm::mat4 projection;
+        FitLightProjectionsToFrusta(&lightView, &frustumCorners, 1, zMult, &projection);
+        return projection;
+    }
+
+    ////////////////////////////////////////
+    void ComputeFrustumCenters(const FrustumCorners* frusta, size_t numFrusta, glm::vec3* centers)
+    {
+        for (size_t i = 0; i < numFrusta; ++i) {
+            glm::vec3 center(0.0f);
+            for (const glm::vec4& corner : frusta[i]) {
+                center += glm::vec3(corner);
+            }
+            centers[i] = center / static_cast<float>(frusta[i].size());
         }
+    }
 
-        minZ = minZ < 0.0f ? minZ * zMult : minZ / zMult;
-        maxZ = maxZ < 0.0f ? maxZ / zMult : maxZ * zMult;
+    ////////////////////////////////////////
+    glm::vec3 ComputeFrustumCenter(const FrustumCorners& frustumCorners)
+    {
+        glm::vec3 center;
+        ComputeFrustumCenters(&frustumCorners, 1, &center);
+        return center;
+    }
+
+    ////////////////////////////////////////
+    std::vector<unsigned> SimplifyByVertexClustering(const float* vertices, size_t stride,
+                                                     const unsigned* indices, size_t numIndices,
+                                                     const AABB& bounds, float cellSize)
+    {
+        assert(cellSize > 0.0f);
+        const glm::vec3 gridSize{ glm::max(glm::ceil((bounds.mMax - bounds.mMin) / cellSize), glm::vec3(1.0f)) };
+        const size_t sizeX{ static_cast<size_t>(gridSize.x) };
+        const size_t sizeY{ static_cast<size_t>(gridSize.y) };
 
-        return glm::ortho(minX, maxX, minY, maxY, minZ, maxZ);
+        std::unordered_map<size_t, unsigned> representatives;
+        auto getRepresentative = [&](unsigned index) {
+            const float* position{ vertices + static_cast<size_t>(index) * stride };
+            glm::vec3 cell{ glm::clamp(glm::floor((glm::vec3(position[0], position[1], position[2]) - bounds.mMin) / cellSize),
+                                       glm::vec3(0.0f), gridSize - 1.0f) };
+            size_t key{ static_cast<size_t>(cell.x) + sizeX * (static_cast<size_t>(cell.y) + sizeY * static_cast<size_t>(cell.z)) };
+            return representatives.try_emplace(key, index).first->second;
+        };
+
+        std::vector<unsigned> simplified;
+        for (size_t i = 0; i + 2 < numIndices; i += 3) {
+            unsigned a{ getRepresentative(indices[i]) };
+            unsigned b{ getRepresentative(indices[i + 1]) };
+            unsigned c{ getRepresentative(indices[i + 2]) };
+            if (a != b && b != c && a != c) {
+                simplified.insert(simplified.end(), { a, b, c });
+            }
+        }
+        return simplified;
     }
 
     ////////////////////////////////////////
-    glm::vec3 ComputeFrustumCenter(const std::vector<glm::vec4>& frustumCorners)
+    FrustumTest Frustum::Test(const AABB& aabb) const
     {
-        assert(8 == frustumCorners.size());
+        const glm::vec3 center{ aabb.GetCenter() };
+        const glm::vec3 extents{ aabb.GetExtents() };
 
-        glm::vec3 center(0.0f);
-        for (const glm::vec4& corner : frustumCorners) {
-            center += glm::vec3(corner);
+        FrustumTest result{ FrustumTest::Inside };
+        for (const glm::vec4& plane : mPlanes) {
+            const glm::vec3 normal{ plane };
+            const float radius{ glm::dot(extents, glm::abs(normal)) };
+            const float distance{ glm::dot(normal, center) + plane.w };
+            if (distance < -radius) {
+                return FrustumTest::Outside;
+            }
+            if (distance < radius) {
+                result = FrustumTest::Intersects;
+            }
         }
-        return center / static_cast<float>(frustumCorners.size());
+        return result;
+    }
+
+    ////////////////////////////////////////
+    /// Source: Gribb & Hartmann, "Fast Extraction of Viewing Frustum Planes from the World-View-Projection Matrix"
+    ////////////////////////////////////////
+    Frustum ComputeFrustum(const glm::mat4& projViewModel)
+    {
+        auto row = [&projViewModel](int i) {
+            return glm::vec4(projViewModel[0][i], projViewModel[1][i], projViewModel[2][i], projViewModel[3][i]);
+        };
+
+        Frustum frustum{ { row(3) + row(0),
+                           row(3) - row(0),
+                           row(3) + row(1),
+                           row(3) - row(1),
+                           row(3) + row(2),
+                           row(3) - row(2) } };
+        for (glm::vec4& plane : frustum.mPlanes) {
+            plane /= glm::length(glm::vec3(plane));
+        }
+        return frustum;
+    }
+
+    ////////////////////////////////////////
+    BVH::BVH(const std::vector<AABB>& bounds)
+    {
+        if (bounds.empty()) {
+            return;
+        }
+
+        std::vector<glm::vec3> centers;
+        centers.reserve(bounds.size());
+        for (const AABB& aabb : bounds) {
+            centers.push_back(aabb.GetCenter());
+        }
+
+        mItems.resize(bounds.size());
+        std::iota(mItems.begin(), mItems.end(), 0);
+        mNodes.reserve(2 * bounds.size());
+        Build(bounds, centers, 0, static_cast<int>(bounds.size()));
+    }
+
+    ////////////////////////////////////////
+    int BVH::Build(const std::vector<AABB>& bounds, const std::vector<glm::vec3>& centers, int firstItem, int numItems)
+    {
+        auto first = mItems.begin() + firstItem;
+        auto last = first + numItems;
+
+        AABB nodeBounds, centerBounds;
+        for (auto iter = first; iter != last; ++iter) {
+            nodeBounds.Extend(bounds[static_cast<size_t>(*iter)]);
+            centerBounds.Extend(centers[static_cast<size_t>(*iter)]);
+        }
+
+        const int nodeIndex{ static_cast<int>(mNodes.size()) };
+        mNodes.push_back({ nodeBounds, -1, -1, firstItem, numItems });
+        if (numItems <= MAX_LEAF_ITEMS) {
+            return nodeIndex;
+        }
+
+        // split at the median along the axis where the centers spread the most
+        const glm::vec3 spread{ centerBounds.mMax - centerBounds.mMin };
+        int axis{ spread.y > spread.x ? 1 : 0 };
+        if (spread.z > spread[axis]) {
+            axis = 2;
+        }
+
+        const int numLeftItems{ numItems / 2 };
+        std::nth_element(first, first + numLeftItems, last, [&](int a, int b) {
+            return centers[static_cast<size_t>(a)][axis] < centers[static_cast<size_t>(b)][axis];
+        });
+
+        const int left{ Build(bounds, centers, firstItem, numLeftItems) };
+        const int right{ Build(bounds, centers, firstItem + numLeftItems, numItems - numLeftItems) };
+        mNodes[static_cast<size_t>(nodeIndex)].mLeft = left;
+        mNodes[static_cast<size_t>(nodeIndex)].mRight = right;
+        return nodeIndex;
     }
 }
@@ -27,13 +27,25 @@ SUPPRESS_WARNINGS()
 #include <glm/matrix.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/common.hpp>
+#include <glm/geometric.hpp>
 ENABLE_WARNINGS()
 
 #include <cmath>
 #include <vector>
+#include <array>
 #include <cassert>
 #include <limits>
 #include <string>
+#include <thread>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <new>
+#include <type_traits>
 
 namespace Poe::Utility
 {
@@ -66,8 +78,263 @@ namespace Poe::Utility
     }
 
     ////////////////////////////////////////
-    glm::vec3 ComputeFrustumCenter(const std::vector<glm::vec4>& frustumCorners);
+    // unfinished jobs of a batch, see JobSystem::Wait
+    struct JobCounter
+    {
+        std::atomic<int> mNumPending{};
+    };
+
+    ////////////////////////////////////////
+    // void() callable stored in place so that scheduling never allocates; the captures
+    // have to be trivially copyable and fit CAPACITY, bigger state is captured by reference
+    struct JobFunc
+    {
+    private:
+        static constexpr size_t CAPACITY{ 48 };
+
+        alignas(std::max_align_t) unsigned char mStorage[CAPACITY];
+        void (*mInvoke)(unsigned char*){ nullptr };
+
+    public:
+        JobFunc() = default;
+
+        template <typename Func>
+        JobFunc(Func func)
+        {
+            static_assert(sizeof(Func) <= CAPACITY, "job captures too much, capture a reference to it instead");
+            static_assert(alignof(Func) <= alignof(std::max_align_t));
+            static_assert(std::is_trivially_copyable_v<Func> && std::is_trivially_destructible_v<Func>,
+                          "jobs are copied bytewise and never destroyed");
+            ::new (static_cast<void*>(mStorage)) Func(func);
+            mInvoke = [](unsigned char* storage) { (*std::launder(reinterpret_cast<Func*>(storage)))(); };
+        }
+
+        void operator()() { mInvoke(mStorage); }
+    };
+
+    ////////////////////////////////////////
+    // persistent work-stealing thread pool. Every worker pops its own queue from the back
+    // and steals from the front of the others'; jobs scheduled by a worker go to its own
+    // queue, jobs of other threads are spread round-robin. Wait() runs jobs on the calling
+    // thread until the batch is done, so jobs may schedule and wait on nested batches.
+    struct JobSystem
+    {
+    private:
+        struct Job
+        {
+            JobFunc mFunc;
+            JobCounter* mCounter{ nullptr };
+        };
+
+        struct WorkerQueue
+        {
+            std::mutex mMutex;
+            std::deque<Job> mJobs;
+        };
+
+        int mNumWorkers;
+        std::vector<std::unique_ptr<WorkerQueue>> mQueues;
+        std::vector<std::thread> mWorkers;
+        std::mutex mSleepMutex;
+        std::condition_variable mJobAvailable;
+        std::atomic<int> mNumQueued;
+        std::atomic<unsigned> mNextQueue;
+        bool mStopWorkers;
+
+        static thread_local const JobSystem* sCurrentSystem;
+        static thread_local int sWorkerIndex;
+
+        void RunWorker(int index);
+        bool TryPop(int index, Job& job);
+        void Execute(Job& job);
+
+    public:
+        explicit JobSystem(int numWorkers = std::max(static_cast<int>(std::thread::hardware_concurrency()) - 1, 0));
+        ~JobSystem();
+
+        JobSystem(const JobSystem&) = delete;
+        JobSystem& operator=(const JobSystem&) = delete;
+
+        // runs func inline if there are no workers
+        void Schedule(JobCounter& counter, JobFunc func);
+        void Wait(JobCounter& counter);
+
+        int GetNumWorkers() const { return mNumWorkers; }
+        int GetNumThreads() const { return mNumWorkers + 1; }
+
+        // in [0, GetNumWorkers()) on the workers, GetNumWorkers() on any other thread;
+        // indexes per-thread buffers of GetNumThreads() elements
+        int GetThreadIndex() const { return sCurrentSystem == this ? sWorkerIndex : mNumWorkers; }
+
+        // shared by the whole renderer, started on first use
+        static JobSystem& Get();
+    };
+
+    ////////////////////////////////////////
+    // calls func(i) for every i in [0, count), split into one contiguous chunk per
+    // thread of JobSystem::Get(); counts below minParallelCount run on the calling thread
+    template <typename Func>
+    void ParallelFor(size_t count, Func func, size_t minParallelCount = 4096)
+    {
+        JobSystem& jobSystem{ JobSystem::Get() };
+        const size_t numThreads{ static_cast<size_t>(jobSystem.GetNumThreads()) };
+        if (count < minParallelCount || numThreads == 1) {
+            for (size_t i = 0; i < count; ++i) {
+                func(i);
+            }
+            return;
+        }
+
+        const size_t chunkSize{ (count + numThreads - 1) / numThreads };
+        JobCounter counter;
+        for (size_t first = chunkSize; first < count; first += chunkSize) {
+            const size_t last{ std::min(first + chunkSize, count) };
+            jobSystem.Schedule(counter, [first, last, &func]() {
+                for (size_t i = first; i < last; ++i) {
+                    func(i);
+                }
+            });
+        }
+        for (size_t i = 0; i < chunkSize; ++i) {
+            func(i);
+        }
+        jobSystem.Wait(counter);
+    }
+
+    ////////////////////////////////////////
+    // corners of a frustum slice, see AbstractCamera::GetFrustumCornersInWorldSpace
+    using FrustumCorners = std::array<glm::vec4, 8>;
+
+    ////////////////////////////////////////
+    glm::vec3 ComputeFrustumCenter(const FrustumCorners& frustumCorners);
+
+    ////////////////////////////////////////
+    glm::mat4 FitLightProjectionToFrustum(const glm::mat4& lightView, const FrustumCorners& frustumCorners, float zMult);
 
     ////////////////////////////////////////
-    glm::mat4 FitLightProjectionToFrustum(const glm::mat4& lightView, const std::vector<glm::vec4>& frustumCorners, float zMult);
+    // batch versions for every cascade of a light at once, the corners are reduced
+    // as structure of arrays so the loops over them vectorize
+    void ComputeFrustumCenters(const FrustumCorners* frusta, size_t numFrusta, glm::vec3* centers);
+    void FitLightProjectionsToFrusta(const glm::mat4* lightViews, const FrustumCorners* frusta, size_t numFrusta,
+                                     float zMult, glm::mat4* projections);
+
+    ////////////////////////////////////////
+    struct AABB
+    {
+        glm::vec3 mMin{ std::numeric_limits<float>::max() };
+        glm::vec3 mMax{ std::numeric_limits<float>::lowest() };
+
+        bool IsValid() const { return mMin.x <= mMax.x && mMin.y <= mMax.y && mMin.z <= mMax.z; }
+
+        glm::vec3 GetCenter() const { return (mMin + mMax) * 0.5f; }
+        glm::vec3 GetExtents() const { return (mMax - mMin) * 0.5f; }
+
+        void Extend(const glm::vec3& point)
+        {
+            mMin = glm::min(mMin, point);
+            mMax = glm::max(mMax, point);
+        }
+
+        void Extend(const AABB& other)
+        {
+            mMin = glm::min(mMin, other.mMin);
+            mMax = glm::max(mMax, other.mMax);
+        }
+    };
+
+    ////////////////////////////////////////
+    // snaps every vertex to the first vertex seen in its grid cell and keeps the
+    // triangles whose corners still land in three different cells; vertices holds
+    // stride floats per vertex with the position in the first three
+    std::vector<unsigned> SimplifyByVertexClustering(const float* vertices, size_t stride,
+                                                     const unsigned* indices, size_t numIndices,
+                                                     const AABB& bounds, float cellSize);
+
+    ////////////////////////////////////////
+    enum class FrustumTest { Outside, Intersects, Inside };
+
+    ////////////////////////////////////////
+    struct Frustum
+    {
+        // left, right, bottom, top, near, far; xyz is the inward normal
+        std::array<glm::vec4, 6> mPlanes;
+
+        FrustumTest Test(const AABB& aabb) const;
+        bool Intersects(const AABB& aabb) const { return Test(aabb) != FrustumTest::Outside; }
+    };
+
+    ////////////////////////////////////////
+    // planes end up in the space the matrix transforms from, so passing
+    // projection * view * model yields a frustum in the model's local space
+    Frustum ComputeFrustum(const glm::mat4& projViewModel);
+
+    ////////////////////////////////////////
+    struct BVHNode
+    {
+        AABB mBounds;
+        int mLeft;
+        int mRight;
+        int mFirstItem;
+        int mNumItems;
+
+        bool IsLeaf() const { return mLeft < 0; }
+    };
+
+    ////////////////////////////////////////
+    // median-split bounding volume hierarchy over a fixed list of items;
+    // every node covers a contiguous range of GetItems()
+    struct BVH
+    {
+    private:
+        std::vector<BVHNode> mNodes;
+        std::vector<int> mItems;
+
+        int Build(const std::vector<AABB>& bounds, const std::vector<glm::vec3>& centers, int firstItem, int numItems);
+
+    public:
+        static constexpr int MAX_LEAF_ITEMS{ 4 };
+        static constexpr int MAX_DEPTH{ 64 };
+
+        BVH() = default;
+        explicit BVH(const std::vector<AABB>& bounds);
+
+        bool IsEmpty() const { return mNodes.empty(); }
+        int GetNumNodes() const { return static_cast<int>(mNodes.size()); }
+        int GetNumItems() const { return static_cast<int>(mItems.size()); }
+        AABB GetBounds() const { return mNodes.empty() ? AABB{} : mNodes[0].mBounds; }
+
+        const std::vector<BVHNode>& GetNodes() const { return mNodes; }
+        const std::vector<int>& GetItems() const { return mItems; }
+
+        ////////////////////////////////////////
+        // calls func(item) for every item whose bounds intersect the frustum,
+        // subtrees fully inside the frustum are accepted without further tests
+        template <typename Func>
+        void Query(const Frustum& frustum, Func func) const
+        {
+            if (mNodes.empty()) {
+                return;
+            }
+
+            std::array<int, MAX_DEPTH> stack;
+            int stackSize{};
+            stack[static_cast<size_t>(stackSize++)] = 0;
+            while (stackSize > 0) {
+                const BVHNode& node = mNodes[static_cast<size_t>(stack[static_cast<size_t>(--stackSize)])];
+                FrustumTest result{ frustum.Test(node.mBounds) };
+                if (result == FrustumTest::Outside) {
+                    continue;
+                }
+                if (result == FrustumTest::Inside || node.IsLeaf()) {
+                    for (int i = node.mFirstItem; i < node.mFirstItem + node.mNumItems; ++i) {
+                        func(mItems[static_cast<size_t>(i)]);
+                    }
+                    continue;
+                }
+                assert(stackSize + 2 <= MAX_DEPTH);
+                stack[static_cast<size_t>(stackSize++)] = node.mRight;
+                stack[static_cast<size_t>(stackSize++)] = node.mLeft;
+            }
+        }
+    };
 }
@@ -0,0 +1,544 @@
+// Poe: OpenGL 4.5 Renderer
+// Copyright (C) 2024 Omar Huseynov
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "Poe.hpp"
+#include "UI.hpp"
+#include "Utility.hpp"
+#include "Cameras.hpp"
+#include "Constants.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// replays a camera path through a scene in a hidden window at a fixed timestep, usage:
+//     benchmark <csitaly|sponza> [--path file] [--width w] [--height h] [--fps n]
+//                                [--warmup n] [--post compute|raster] [--csv file] [--json file]
+// without --path the camera is moved along a built-in path, paths are recorded
+// with F5 in the demos
+namespace Benchmark
+{
+    ////////////////////////////////////////
+    struct Options
+    {
+        std::string mScene;
+        std::string mPathFile;
+        std::string mCsvFile;
+        std::string mJsonFile;
+        int mWidth{ 1920 };
+        int mHeight{ 1080 };
+        int mFps{ 60 };
+        int mNumWarmupFrames{ 60 };
+        bool mUseComputePostProcess{ true };
+    };
+
+    ////////////////////////////////////////
+    struct FrameStats
+    {
+        double mCpuTime;  // milliseconds
+        double mGpuTime;  // milliseconds
+        int mNumDrawCalls;
+        unsigned long long mNumTriangles;
+    };
+
+    ////////////////////////////////////////
+    struct Summary
+    {
+        double mMin;
+        double mAverage;
+        double mP99;
+        double mMax;
+    };
+
+    ////////////////////////////////////////
+    struct Scene
+    {
+        virtual ~Scene() {}
+
+        // before the main pass is bound
+        virtual void DrawShadows(const Poe::AbstractCamera& camera) {}
+        virtual void Draw(const Poe::FirstPersonCamera& camera) = 0;
+        virtual void BuildDefaultPath(Poe::CameraPath& path) const = 0;
+    };
+
+    ////////////////////////////////////////
+    // the forward path of csitaly_demo: a shadowed sun, Blinn-Phong and the sky
+    struct CsItalyScene : public Scene
+    {
+        static constexpr int NUM_CASCADES{ 4 };
+
+        Poe::LightingStack<NUM_CASCADES> mLightingStack;
+        Poe::StaticModel mModel;
+        std::vector<std::reference_wrapper<const Poe::StaticMesh>> mMeshes;
+        Poe::BlinnPhongProgram mBlinnPhongProgram;
+        Poe::RealisticSkyboxProgram mSkybox;
+        Poe::BlinnPhongMaterialUB mBlinnPhongBlock;
+        Poe::RealisticSkyboxUB mSkyboxBlock;
+        Poe::DirLight mSun;
+        glm::mat4 mModelMatrix;
+        int mHeight;
+
+        // built once, braced lists would allocate every frame
+        std::vector<std::reference_wrapper<Poe::DirLight>> mDirLights;
+        std::vector<std::reference_wrapper<const glm::mat4>> mModelMatrices;
+
+        CsItalyScene(Poe::ShaderLoader& shaderLoader, Poe::Texture2DLoader& textureLoader, int height)
+            : mLightingStack(2, 4, 2, 1024, "..", shaderLoader, true),
+              mModel(Poe::LoadCsItaly("..", textureLoader, true)),
+              mBlinnPhongProgram("..", shaderLoader, 2, 4, 2, NUM_CASCADES, 0.01f, 0.1f, 0.005f, mModel.GetMaterialTableMode()),
+              mSkybox("..", shaderLoader),
+              mSun{ glm::vec3(1.0f), glm::vec3(0.0f, 0.0f, -1.0f), 1.0f, 1000.0f,
+                    { 50.0f, 100.0f, 250.0f, 500.0f }, std::vector<glm::mat4>(NUM_CASCADES + 1),
+                    true, 10.0f, 10.0f },
+              mModelMatrix(1.0f),
+              mHeight{height}
+        {
+            mModel.EnablePositionStreams();
+            mMeshes = mModel.ExtractMeshes();
+
+            mModelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 2.0f, 0.0f));
+            mModelMatrix = glm::rotate(mModelMatrix, glm::radians(-180.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+            mModelMatrix = glm::scale(mModelMatrix, glm::vec3(0.1f));
+            mDirLights = { mSun };
+            mModelMatrices = { mModelMatrix };
+
+            mBlinnPhongBlock.Buffer().TurnOn();
+            mBlinnPhongBlock.Set({ glm::vec3(1.0f), glm::vec3(1.0f), glm::vec3(1.0f), 32.0f });
+            mBlinnPhongBlock.Update();
+            mSkyboxBlock.Buffer().TurnOn();
+        }
+
+        void DrawShadows(const Poe::AbstractCamera& camera) override
+        {
+            mSkybox.Update(mSkyboxBlock);
+
+            mSun.mDirection = glm::normalize(-mSkyboxBlock.GetSunPosition());
+            mSun.mIntensity = glm::max(0.0f, mSkyboxBlock.GetSunIntensity() * glm::dot(glm::vec3(0.0f, 1.0f, 0.0f), glm::normalize(mSkyboxBlock.GetSunPosition())));
+
+            mLightingStack.PrepareState();
+            mLightingStack.DirectionalShadowPrepass(camera, mDirLights, mModelMatrices, mMeshes);
+            mLightingStack.OmnidirectionalShadowPrepass({}, mModelMatrices, mMeshes);
+            mLightingStack.PerspectiveShadowPrepass({}, mModelMatrices, mMeshes);
+            mLightingStack.ResetState();
+        }
+
+        void Draw(const Poe::FirstPersonCamera& camera) override
+        {
+            mModel.SetLodView(Poe::ComputeLodView(camera, mHeight, 1.0f, mModelMatrix));
+
+            mBlinnPhongProgram.Use();
+            mBlinnPhongProgram.SetModelMatrix(mModelMatrix);
+            mBlinnPhongProgram.SetNormalMatrix(glm::mat3(glm::transpose(glm::inverse(camera.GetViewMatrix() * mModelMatrix))));
+            mBlinnPhongProgram.SetAmbientFactor(0.1f);
+            mBlinnPhongProgram.SetTexMultiplier(glm::vec2(1.0f));
+            mBlinnPhongProgram.SetTexOffset(glm::vec2(0.0f));
+            mModel.DrawCulled(camera.GetFrustum(mModelMatrix));
+
+            mSkybox.Draw();
+        }
+
+        void BuildDefaultPath(Poe::CameraPath& path) const override
+        {
+            path.AddKey({ 0.0f, glm::vec3(-65.0f, -10.0f, 180.0f), glm::vec3(0.0f, 0.0f, -1.0f) });
+            path.AddKey({ 5.0f, glm::vec3(-65.0f, -10.0f, 0.0f), glm::vec3(1.0f, 0.0f, -1.0f) });
+            path.AddKey({ 10.0f, glm::vec3(60.0f, -20.0f, -150.0f), glm::vec3(0.0f, 0.0f, 1.0f) });
+            path.AddKey({ 15.0f, glm::vec3(-65.0f, -10.0f, 180.0f), glm::vec3(0.0f, 0.0f, -1.0f) });
+        }
+    };
+
+    ////////////////////////////////////////
+    // the scene of sponza_demo
+    struct SponzaScene : public Scene
+    {
+        Poe::StaticModel mModel;
+        Poe::EmissiveTextureProgram mEmissiveTextureProgram;
+        Poe::TexturedSkyboxProgram mSkybox;
+        Poe::EmissiveTextureMaterial mMaterial;
+        glm::mat4 mModelMatrix;
+        int mHeight;
+
+        SponzaScene(Poe::ShaderLoader& shaderLoader, Poe::Texture2DLoader& textureLoader, int height)
+            : mModel(Poe::LoadSponza("..", textureLoader, true, Poe::VertexFormat::Quantized)),
+              mEmissiveTextureProgram("..", shaderLoader, mModel.GetMaterialTableMode()),
+              mSkybox("..", shaderLoader, Poe::DefaultSkyboxTexture::Clear),
+              mMaterial{ glm::vec2(1.0f), glm::vec2(0.0f) },
+              mModelMatrix(1.0f),
+              mHeight{height}
+        {
+            mModelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 2.0f, 0.0f));
+            mModelMatrix = glm::rotate(mModelMatrix, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+            mModelMatrix = glm::scale(mModelMatrix, glm::vec3(0.1f));
+        }
+
+        void Draw(const Poe::FirstPersonCamera& camera) override
+        {
+            mModel.SetLodView(Poe::ComputeLodView(camera, mHeight, 1.0f, mModelMatrix));
+
+            mEmissiveTextureProgram.Use();
+            mEmissiveTextureProgram.SetMaterial(mMaterial);
+            mEmissiveTextureProgram.SetModelMatrix(mModelMatrix);
+            mModel.DrawCulled(camera.GetFrustum(mModelMatrix));
+
+            mSkybox.Draw();
+        }
+
+        void BuildDefaultPath(Poe::CameraPath& path) const override
+        {
+            path.AddKey({ 0.0f, glm::vec3(0.0f, 15.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f) });
+            path.AddKey({ 5.0f, glm::vec3(0.0f, 15.0f, -100.0f), glm::vec3(0.0f, 0.0f, 1.0f) });
+            path.AddKey({ 10.0f, glm::vec3(0.0f, 60.0f, 100.0f), glm::vec3(0.0f, -0.5f, -1.0f) });
+            path.AddKey({ 15.0f, glm::vec3(0.0f, 15.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f) });
+        }
+    };
+
+    ////////////////////////////////////////
+    static bool ParseOptions(int argc, char** argv, Options& options)
+    {
+        if (argc < 2 || (std::strcmp(argv[1], "csitaly") != 0 && std::strcmp(argv[1], "sponza") != 0)) {
+            return false;
+        }
+        options.mScene = argv[1];
+
+        for (int i = 2; i + 1 < argc; i += 2) {
+            const char* name{ argv[i] };
+            const char* value{ argv[i + 1] };
+            if (std::strcmp(name, "--path") == 0)
+                options.mPathFile = value;
+            else if (std::strcmp(name, "--csv") == 0)
+                options.mCsvFile = value;
+            else if (std::strcmp(name, "--json") == 0)
+                options.mJsonFile = value;
+            else if (std::strcmp(name, "--width") == 0)
+                options.mWidth = std::atoi(value);
+            else if (std::strcmp(name, "--height") == 0)
+                options.mHeight = std::atoi(value);
+            else if (std::strcmp(name, "--fps") == 0)
+                options.mFps = std::atoi(value);
+            else if (std::strcmp(name, "--warmup") == 0)
+                options.mNumWarmupFrames = std::atoi(value);
+            else if (std::strcmp(name, "--post") == 0 && (std::strcmp(value, "compute") == 0 || std::strcmp(value, "raster") == 0))
+                options.mUseComputePostProcess = std::strcmp(value, "compute") == 0;
+            else
+                return false;
+        }
+        return (argc % 2) == 0 && options.mWidth > 0 && options.mHeight > 0 && options.mFps > 0 && options.mNumWarmupFrames >= 0;
+    }
+
+    ////////////////////////////////////////
+    static GLFWwindow* CreateHiddenWindow(int width, int height)
+    {
+        if (!glfwInit()) {
+            std::fprintf(stderr, "ERROR: couldn't initialize GLFW\n");
+            std::exit(EXIT_FAILURE);
+        }
+
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, Poe::POE_OPENGL_VERSION_MAJOR);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, Poe::POE_OPENGL_VERSION_MINOR);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GLFW_TRUE);
+        glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+        GLFWwindow* window = glfwCreateWindow(width, height, "benchmark", nullptr, nullptr);
+        if (!window) {
+            std::fprintf(stderr, "ERROR: couldn't create window\n");
+            glfwTerminate();
+            std::exit(EXIT_FAILURE);
+        }
+
+        glfwMakeContextCurrent(window);
+        if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress))) {
+            std::fprintf(stderr, "ERROR: couldn't initialize glad\n");
+            glfwTerminate();
+            std::exit(EXIT_FAILURE);
+        }
+        glfwSwapInterval(0);
+        return window;
+    }
+
+    ////////////////////////////////////////
+    static void FlushLogs()
+    {
+        Poe::DebugUI::DrainLogs([](const Poe::LogRecord& record){
+            std::fprintf(record.mSeverity == Poe::LogSeverity::Error ? stderr : stdout, "%s\n", record.mText);
+        });
+    }
+
+    ////////////////////////////////////////
+    static Summary Summarize(std::vector<double> values)
+    {
+        if (values.empty()) {
+            return {};
+        }
+        std::sort(values.begin(), values.end());
+
+        double sum{};
+        for (double value : values) {
+            sum += value;
+        }
+        size_t p99{ std::min(values.size() - 1, values.size() * 99 / 100) };
+        return { values.front(), sum / static_cast<double>(values.size()), values[p99], values.back() };
+    }
+
+    ////////////////////////////////////////
+    static bool WriteCsv(const std::string& filePath, const std::vector<FrameStats>& frames)
+    {
+        std::FILE* fp = std::fopen(filePath.c_str(), "w");
+        if (!fp) {
+            return false;
+        }
+        std::fprintf(fp, "frame,cpu_ms,gpu_ms,draw_calls,triangles\n");
+        for (size_t i = 0; i < frames.size(); ++i) {
+            std::fprintf(fp, "%zu,%.4f,%.4f,%d,%llu\n", i, frames[i].mCpuTime, frames[i].mGpuTime, frames[i].mNumDrawCalls, frames[i].mNumTriangles);
+        }
+        return std::fclose(fp) == 0;
+    }
+
+    ////////////////////////////////////////
+    // quoted, with the characters JSON doesn't allow raw in a string escaped
+    static void WriteJsonString(std::FILE* fp, const char* str)
+    {
+        std::fputc('"', fp);
+        for (const char* c = str ? str : ""; *c; ++c) {
+            const unsigned char ch{ static_cast<unsigned char>(*c) };
+            if (ch == '"' || ch == '\\') {
+                std::fprintf(fp, "\\%c", ch);
+            }
+            else if (ch < 0x20) {
+                std::fprintf(fp, "\\u%04x", ch);
+            }
+            else {
+                std::fputc(ch, fp);
+            }
+        }
+        std::fputc('"', fp);
+    }
+
+    ////////////////////////////////////////
+    static void WriteJsonSummary(std::FILE* fp, const char* name, const Summary& summary, bool isLast)
+    {
+        std::fprintf(fp, "    \"%s\": { \"min\": %.4f, \"avg\": %.4f, \"p99\": %.4f, \"max\": %.4f }%s\n",
+                     name, summary.mMin, summary.mAverage, summary.mP99, summary.mMax, isLast ? "" : ",");
+    }
+
+    ////////////////////////////////////////
+    static bool WriteJson(const std::string& filePath, const Options& options, const std::vector<FrameStats>& frames,
+                          const Summary& cpu, const Summary& gpu, const Summary& drawCalls, const Summary& triangles)
+    {
+        std::FILE* fp = std::fopen(filePath.c_str(), "w");
+        if (!fp) {
+            return false;
+        }
+        std::fprintf(fp, "{\n");
+        std::fprintf(fp, "  \"scene\": ");
+        WriteJsonString(fp, options.mScene.c_str());
+        std::fprintf(fp, ",\n  \"width\": %d,\n  \"height\": %d,\n  \"fps\": %d,\n", options.mWidth, options.mHeight, options.mFps);
+        std::fprintf(fp, "  \"renderer\": ");
+        WriteJsonString(fp, reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+        std::fprintf(fp, ",\n  \"version\": ");
+        WriteJsonString(fp, reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+        std::fprintf(fp, ",\n");
+        std::fprintf(fp, "  \"summary\": {\n");
+        WriteJsonSummary(fp, "cpu_ms", cpu, false);
+        WriteJsonSummary(fp, "gpu_ms", gpu, false);
+        WriteJsonSummary(fp, "draw_calls", drawCalls, false);
+        WriteJsonSummary(fp, "triangles", triangles, true);
+        std::fprintf(fp, "  },\n");
+        std::fprintf(fp, "  \"frames\": [\n");
+        for (size_t i = 0; i < frames.size(); ++i) {
+            std::fprintf(fp, "    { \"cpu_ms\": %.4f, \"gpu_ms\": %.4f, \"draw_calls\": %d, \"triangles\": %llu }%s\n",
+                         frames[i].mCpuTime, frames[i].mGpuTime, frames[i].mNumDrawCalls, frames[i].mNumTriangles,
+                         i + 1 == frames.size() ? "" : ",");
+        }
+        std::fprintf(fp, "  ]\n}\n");
+        return std::fclose(fp) == 0;
+    }
+
+    ////////////////////////////////////////
+    static int Run(int argc, char** argv)
+    {
+        Options options;
+        if (!ParseOptions(argc, argv, options)) {
+            std::fprintf(stderr, "usage: %s <csitaly|sponza> [--path file] [--width w] [--height h] [--fps n] [--warmup n] [--post compute|raster] [--csv file] [--json file]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        GLFWwindow* window = CreateHiddenWindow(options.mWidth, options.mHeight);
+
+        glEnable(GL_DEPTH_TEST);
+        glEnable(GL_STENCIL_TEST);
+        glEnable(GL_CULL_FACE);
+        glDepthFunc(GL_LEQUAL);
+
+        Poe::ShaderLoader shaderLoader("../shaders/cache");
+        Poe::Texture2DLoader texture2DLoader;
+
+        // the scene is drawn offscreen into the framebuffer of the post process stack
+        Poe::PostProcessStack ppStack("..", options.mWidth, options.mHeight, shaderLoader);
+
+        std::unique_ptr<Scene> scene;
+        if (options.mScene == "csitaly") {
+            scene = std::make_unique<CsItalyScene>(shaderLoader, texture2DLoader, options.mHeight);
+        }
+        else {
+            scene = std::make_unique<SponzaScene>(shaderLoader, texture2DLoader, options.mHeight);
+        }
+        texture2DLoader.Finish();
+        FlushLogs();
+
+        Poe::CameraPath path;
+        if (!options.mPathFile.empty()) {
+            if (!path.Load(options.mPathFile) || path.IsEmpty()) {
+                std::fprintf(stderr, "ERROR: couldn't read camera path %s\n", options.mPathFile.c_str());
+                glfwTerminate();
+                return EXIT_FAILURE;
+            }
+        }
+        else {
+            scene->BuildDefaultPath(path);
+        }
+
+        Poe::FirstPersonCamera camera;
+        camera.SetAspectRatio(options.mWidth, options.mHeight);
+
+        Poe::FogUB fogBlock(glm::vec3(1.0f), 1000.0f, 2.0f, true);
+        fogBlock.Buffer().TurnOn();
+        Poe::TransformUB transformBlock(true);
+        transformBlock.Buffer().TurnOn();
+
+        // results are read NUM_QUERY_FRAMES frames later so that the queries don't stall
+        constexpr int NUM_QUERY_FRAMES{ Poe::PersistentBuffer::NUM_FRAMES + 1 };
+        std::array<GLuint, NUM_QUERY_FRAMES> timeQueries{}, primitiveQueries{};
+        glCreateQueries(GL_TIME_ELAPSED, NUM_QUERY_FRAMES, timeQueries.data());
+        glCreateQueries(GL_PRIMITIVES_GENERATED, NUM_QUERY_FRAMES, primitiveQueries.data());
+
+        const float dt{ 1.0f / static_cast<float>(options.mFps) };
+        const int numFrames{ static_cast<int>(path.GetDuration() * static_cast<float>(options.mFps)) + 1 };
+        const int numTotalFrames{ options.mNumWarmupFrames + numFrames };
+
+        std::vector<FrameStats> frames(static_cast<size_t>(numFrames));
+        auto readQueries = [&](int frame) {
+            if (frame < options.mNumWarmupFrames) {
+                return;
+            }
+            size_t slot{ static_cast<size_t>(frame % NUM_QUERY_FRAMES) };
+            GLuint64 gpuTime{}, numPrimitives{};
+            glGetQueryObjectui64v(timeQueries[slot], GL_QUERY_RESULT, &gpuTime);
+            glGetQueryObjectui64v(primitiveQueries[slot], GL_QUERY_RESULT, &numPrimitives);
+            FrameStats& stats{ frames[static_cast<size_t>(frame - options.mNumWarmupFrames)] };
+            stats.mGpuTime = static_cast<double>(gpuTime) / 1000000.0;
+            stats.mNumTriangles = numPrimitives;
+        };
+
+        for (int frame = 0; frame < numTotalFrames; ++frame) {
+            if (frame >= NUM_QUERY_FRAMES) {
+                readQueries(frame - NUM_QUERY_FRAMES);
+            }
+
+            // the warmup frames hold the first key
+            float time{ static_cast<float>(std::max(frame - options.mNumWarmupFrames, 0)) * dt };
+            path.Apply(time, camera);
+            camera.Update(dt);
+
+            auto cpuBegin{ std::chrono::steady_clock::now() };
+
+            size_t slot{ static_cast<size_t>(frame % NUM_QUERY_FRAMES) };
+            glBeginQuery(GL_TIME_ELAPSED, timeQueries[slot]);
+            glBeginQuery(GL_PRIMITIVES_GENERATED, primitiveQueries[slot]);
+
+            transformBlock.Set(camera);
+            transformBlock.Update();
+            fogBlock.Update();
+
+            scene->DrawShadows(camera);
+            ppStack.FirstPass();
+            scene->Draw(camera);
+
+            if (options.mUseComputePostProcess) {
+                ppStack.Execute();
+            }
+            else {
+                ppStack.SecondPass();
+                ppStack.BindColor0();
+                ppStack.Use();
+                ppStack.Draw();
+            }
+
+            glEndQuery(GL_PRIMITIVES_GENERATED);
+            glEndQuery(GL_TIME_ELAPSED);
+
+            std::chrono::duration<double, std::milli> cpuTime{ std::chrono::steady_clock::now() - cpuBegin };
+            if (frame >= options.mNumWarmupFrames) {
+                FrameStats& stats{ frames[static_cast<size_t>(frame - options.mNumWarmupFrames)] };
+                stats.mCpuTime = cpuTime.count();
+                stats.mNumDrawCalls = Poe::RuntimeStats::NumDrawCalls + Poe::RuntimeStats::NumInstancedDrawCalls;
+            }
+            Poe::RuntimeStats::Reset();
+
+            glfwSwapBuffers(window);
+            Poe::PersistentBuffer::EndFrame();
+            glfwPollEvents();
+            FlushLogs();
+        }
+        for (int frame = std::max(numTotalFrames - NUM_QUERY_FRAMES, 0); frame < numTotalFrames; ++frame) {
+            readQueries(frame);
+        }
+
+        std::vector<double> cpuTimes, gpuTimes, drawCalls, triangles;
+        for (const FrameStats& stats : frames) {
+            cpuTimes.push_back(stats.mCpuTime);
+            gpuTimes.push_back(stats.mGpuTime);
+            drawCalls.push_back(static_cast<double>(stats.mNumDrawCalls));
+            triangles.push_back(static_cast<double>(stats.mNumTriangles));
+        }
+        Summary cpu{ Summarize(cpuTimes) }, gpu{ Summarize(gpuTimes) };
+        Summary drawCallSummary{ Summarize(drawCalls) }, triangleSummary{ Summarize(triangles) };
+
+        std::printf("%s %dx%d, %d frames\n", options.mScene.c_str(), options.mWidth, options.mHeight, numFrames);
+        std::printf("cpu ms:     min %.3f | avg %.3f | p99 %.3f | max %.3f\n", cpu.mMin, cpu.mAverage, cpu.mP99, cpu.mMax);
+        std::printf("gpu ms:     min %.3f | avg %.3f | p99 %.3f | max %.3f\n", gpu.mMin, gpu.mAverage, gpu.mP99, gpu.mMax);
+        std::printf("draw calls: avg %.1f | triangles: avg %.0f\n", drawCallSummary.mAverage, triangleSummary.mAverage);
+
+        bool isWritten{ true };
+        if (!options.mCsvFile.empty() && !WriteCsv(options.mCsvFile, frames)) {
+            std::fprintf(stderr, "ERROR: couldn't write %s\n", options.mCsvFile.c_str());
+            isWritten = false;
+        }
+        if (!options.mJsonFile.empty() && !WriteJson(options.mJsonFile, options, frames, cpu, gpu, drawCallSummary, triangleSummary)) {
+            std::fprintf(stderr, "ERROR: couldn't write %s\n", options.mJsonFile.c_str());
+            isWritten = false;
+        }
+
+        glDeleteQueries(NUM_QUERY_FRAMES, timeQueries.data());
+        glDeleteQueries(NUM_QUERY_FRAMES, primitiveQueries.data());
+
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return isWritten ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+}
+
+////////////////////////////////////////
+int main(int argc, char** argv)
+{
+    return Benchmark::Run(argc, argv);
+}
@@ -0,0 +1,125 @@
+// Poe: OpenGL 4.5 Renderer
+// Copyright (C) 2024 Omar Huseynov
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "Poe.hpp"
+#include "IO.hpp"
+#include "UI.hpp"
+
+#include <filesystem>
+#include <system_error>
+#include <algorithm>
+#include <string>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// bakes every image under a directory into a .ptex next to it, usage:
+//     texture_baker <directory> [--force]
+namespace TextureBaker
+{
+    ////////////////////////////////////////
+    static void InitGLFW()
+    {
+        if (!glfwInit()) {
+            std::fprintf(stderr, "ERROR: couldn't initialize GLFW\n");
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
+    ////////////////////////////////////////
+    static GLFWwindow* CreateHiddenWindow()
+    {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, Poe::POE_OPENGL_VERSION_MAJOR);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, Poe::POE_OPENGL_VERSION_MINOR);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GLFW_TRUE);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+        GLFWwindow* window = glfwCreateWindow(1, 1, "texture_baker", nullptr, nullptr);
+        if (!window) {
+            std::fprintf(stderr, "ERROR: couldn't create window\n");
+            glfwTerminate();
+            std::exit(EXIT_FAILURE);
+        }
+
+        glfwMakeContextCurrent(window);
+        if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress))) {
+            std::fprintf(stderr, "ERROR: couldn't initialize glad\n");
+            glfwTerminate();
+            std::exit(EXIT_FAILURE);
+        }
+        return window;
+    }
+
+    ////////////////////////////////////////
+    static bool IsImage(const std::filesystem::path& path)
+    {
+        std::string extension{ path.extension().string() };
+        std::ranges::transform(extension, extension.begin(), [](unsigned char c){ return static_cast<char>(std::tolower(c)); });
+        return extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".tga" || extension == ".bmp";
+    }
+
+    ////////////////////////////////////////
+    static void FlushLogs()
+    {
+        Poe::DebugUI::DrainLogs([](const Poe::LogRecord& record){
+            std::fprintf(record.mSeverity == Poe::LogSeverity::Error ? stderr : stdout, "%s\n", record.mText);
+        });
+    }
+
+    ////////////////////////////////////////
+    static int Run(int argc, char** argv)
+    {
+        if (argc < 2) {
+            std::fprintf(stderr, "usage: %s <directory> [--force]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+        bool force{ argc > 2 && std::strcmp(argv[2], "--force") == 0 };
+
+        InitGLFW();
+        GLFWwindow* window = CreateHiddenWindow();
+
+        int numBaked{}, numSkipped{}, numFailed{};
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(argv[1], ec)) {
+            if (!entry.is_regular_file() || !IsImage(entry.path())) {
+                continue;
+            }
+            std::string url{ entry.path().string() };
+            if (!force && Poe::IO::IsFileUpToDate(Poe::GetCompressedTexturePath(url), url)) {
+                ++numSkipped;
+                continue;
+            }
+            Poe::BakeCompressedTexture(url) ? ++numBaked : ++numFailed;
+            FlushLogs();
+        }
+        if (ec) {
+            std::fprintf(stderr, "ERROR: couldn't read %s: %s\n", argv[1], ec.message().c_str());
+        }
+        std::printf("baked %d, up to date %d, failed %d\n", numBaked, numSkipped, numFailed);
+
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return numFailed == 0 && !ec ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+}
+
+////////////////////////////////////////
+int main(int argc, char** argv)
+{
+    return TextureBaker::Run(argc, argv);
+}